@@ -0,0 +1,76 @@
+#ifndef LIGHT_CLUSTERING_GLSL
+#define LIGHT_CLUSTERING_GLSL
+
+#include <shared/LightData.h>
+
+// NOTE: These functions are mirrored on the CPU in LightClustering.cpp, so any changes must be made in both places!
+
+int lightClusterIndex(ivec3 cluster)
+{
+    return cluster.x + LIGHT_CLUSTER_COUNT_X * (cluster.y + LIGHT_CLUSTER_COUNT_Y * cluster.z);
+}
+
+ivec3 lightClusterFromIndex(int clusterIndex)
+{
+    int x = clusterIndex % LIGHT_CLUSTER_COUNT_X;
+    int y = (clusterIndex / LIGHT_CLUSTER_COUNT_X) % LIGHT_CLUSTER_COUNT_Y;
+    int z = clusterIndex / (LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y);
+    return ivec3(x, y, z);
+}
+
+float lightClusterSliceDepth(int slice, float zNear, float zFar)
+{
+    return zNear * pow(zFar / zNear, float(slice) / float(LIGHT_CLUSTER_COUNT_Z));
+}
+
+ivec3 lightClusterForViewSpacePosition(vec3 viewSpacePos, mat4 projectionFromView, float zNear, float zFar)
+{
+    vec4 projectedPos = projectionFromView * vec4(viewSpacePos, 1.0);
+    vec2 uv = (projectedPos.xy / projectedPos.w) * 0.5 + 0.5;
+    ivec2 tile = ivec2(floor(uv * vec2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y)));
+    tile = clamp(tile, ivec2(0), ivec2(LIGHT_CLUSTER_COUNT_X - 1, LIGHT_CLUSTER_COUNT_Y - 1));
+
+    float depth = max(-viewSpacePos.z, zNear);
+    int slice = int(floor(log(depth / zNear) / log(zFar / zNear) * float(LIGHT_CLUSTER_COUNT_Z)));
+    slice = clamp(slice, 0, LIGHT_CLUSTER_COUNT_Z - 1);
+
+    return ivec3(tile, slice);
+}
+
+void lightClusterViewSpaceBounds(ivec3 cluster, mat4 viewFromProjection, float zNear, float zFar, out vec3 aabbMin, out vec3 aabbMax)
+{
+    vec2 tileSize = 2.0 / vec2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y);
+    vec2 ndcMin = vec2(-1.0) + vec2(cluster.xy) * tileSize;
+    vec2 ndcMax = ndcMin + tileSize;
+
+    float sliceNearDepth = lightClusterSliceDepth(cluster.z, zNear, zFar);
+    float sliceFarDepth = lightClusterSliceDepth(cluster.z + 1, zNear, zFar);
+
+    aabbMin = vec3(1e30);
+    aabbMax = vec3(-1e30);
+
+    for (int corner = 0; corner < 4; ++corner) {
+        vec2 ndc = vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x,
+                        (corner & 2) != 0 ? ndcMax.y : ndcMin.y);
+
+        // Any point along the ray through the corner will do, so then scale it so that it's at depth 1
+        vec4 viewSpacePoint = viewFromProjection * vec4(ndc, 0.5, 1.0);
+        vec3 ray = viewSpacePoint.xyz / viewSpacePoint.w;
+        ray /= -ray.z;
+
+        vec3 nearPoint = ray * sliceNearDepth;
+        vec3 farPoint = ray * sliceFarDepth;
+
+        aabbMin = min(aabbMin, min(nearPoint, farPoint));
+        aabbMax = max(aabbMax, max(nearPoint, farPoint));
+    }
+}
+
+bool lightClusterSphereIntersectsBounds(vec4 sphere, vec3 aabbMin, vec3 aabbMax)
+{
+    vec3 closestPoint = clamp(sphere.xyz, aabbMin, aabbMax);
+    vec3 delta = sphere.xyz - closestPoint;
+    return dot(delta, delta) <= sphere.w * sphere.w;
+}
+
+#endif // LIGHT_CLUSTERING_GLSL
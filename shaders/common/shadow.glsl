@@ -1,26 +1,46 @@
 #ifndef SHADOW_GLSL
 #define SHADOW_GLSL
 
-float evaluateShadow(sampler2D shadowMap, mat4 lightProjectionFromView, vec3 viewSpacePos)
+#include <shared/LightData.h>
+
+float evaluateShadow(sampler2DArray shadowMap, int layer, mat4 lightProjectionFromView, vec3 viewSpacePos)
 {
     vec4 posInShadowMap = lightProjectionFromView * vec4(viewSpacePos, 1.0);
     posInShadowMap.xyz /= posInShadowMap.w;
     vec2 shadowMapUv = posInShadowMap.xy * 0.5 + 0.5;
 
-    // TODO: Fix this! I think the reason we have to do this here is because we have texture repeat and linear filtering!
-    const float eps = 0.01;
-    if (shadowMapUv.x < eps || shadowMapUv.y < eps || shadowMapUv.x > 1.0-eps || shadowMapUv.y > 1.0-eps) {
-        return 1.0;
-    }
-
-    float mapDepth = texture(shadowMap, shadowMapUv).x;
+    float mapDepth = texture(shadowMap, vec3(shadowMapUv, float(layer))).x;
 
     // This isn't optimal but it works for now
-    vec2 pixelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 pixelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
     float bias = max(pixelSize.x, pixelSize.y) + 0.006;
 
     // (remember: 1 is furthest away, 0 is closest!)
     return (mapDepth < posInShadowMap.z - bias) ? 0.0 : 1.0;
 }
 
+bool isInsideShadowMap(mat4 lightProjectionFromView, vec3 viewSpacePos)
+{
+    vec4 posInShadowMap = lightProjectionFromView * vec4(viewSpacePos, 1.0);
+    vec2 shadowMapUv = (posInShadowMap.xy / posInShadowMap.w) * 0.5 + 0.5;
+
+    // TODO: Fix this! I think the reason we have to do this here is because we have texture repeat and linear filtering!
+    const float eps = 0.01;
+    return all(greaterThan(shadowMapUv, vec2(eps))) && all(lessThan(shadowMapUv, vec2(1.0 - eps)));
+}
+
+float evaluateCascadedShadow(sampler2DArray shadowMap, DirectionalLightData light, mat4 worldFromView, vec3 viewSpacePos)
+{
+    // The cascades are ordered from the nearest to the furthest, so the first one covering the position has the highest resolution.
+    // This doesn't depend on the distance to the main camera, so it also works when rendering from other views, e.g. GI probes.
+    for (int cascade = 0; cascade < light.cascadeCount; ++cascade) {
+        mat4 lightProjectionFromView = light.lightProjectionFromWorld[cascade] * worldFromView;
+        if (isInsideShadowMap(lightProjectionFromView, viewSpacePos))
+            return evaluateShadow(shadowMap, cascade, lightProjectionFromView, viewSpacePos);
+    }
+
+    // Outside of all cascades, i.e. beyond the shadow distance
+    return 1.0;
+}
+
 #endif // SHADOW_GLSL
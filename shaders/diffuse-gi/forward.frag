@@ -16,7 +16,7 @@ layout(set = 0, binding = 0) uniform CameraBlock { CameraMatrices cameras[6]; };
 layout(set = 1, binding = 1) uniform MaterialBlock { ShaderMaterial materials[SCENE_MAX_MATERIALS]; };
 layout(set = 1, binding = 2) uniform sampler2D textures[SCENE_MAX_TEXTURES];
 
-layout(set = 2, binding = 0) uniform sampler2D dirLightShadowMapTex;
+layout(set = 2, binding = 0) uniform sampler2DArray dirLightShadowMapTex;
 layout(set = 2, binding = 1) uniform LightDataBlock { DirectionalLightData dirLight; };
 
 layout(push_constant) uniform PushConstants {
@@ -32,8 +32,7 @@ vec3 evaluateDirectionalLight(DirectionalLightData light, vec3 V, vec3 N, vec3 b
     vec3 lightColor = light.colorAndIntensity.a * light.colorAndIntensity.rgb;
     vec3 L = -normalize(mat3(cameras[sideIndex].viewFromWorld) * light.worldSpaceDirection.xyz);
 
-    mat4 lightProjectionFromView = light.lightProjectionFromWorld * cameras[sideIndex].worldFromView;
-    float shadowFactor = evaluateShadow(dirLightShadowMapTex, lightProjectionFromView, vPosition);
+    float shadowFactor = evaluateCascadedShadow(dirLightShadowMapTex, light, cameras[sideIndex].worldFromView, vPosition);
 
     vec3 brdf = evaluateBRDF(L, V, N, baseColor, roughness, metallic);
     vec3 directLight = lightColor * shadowFactor;
@@ -1,6 +1,7 @@
 #version 460
 
 #include <common/brdf.glsl>
+#include <common/lightClustering.glsl>
 #include <common/shadow.glsl>
 #include <shared/CameraState.h>
 #include <shared/SceneData.h>
@@ -17,9 +18,14 @@ layout(set = 0, binding = 0) uniform CameraStateBlock { CameraState camera; };
 layout(set = 1, binding = 1) uniform MaterialBlock { ShaderMaterial materials[SCENE_MAX_MATERIALS]; };
 layout(set = 1, binding = 2) uniform sampler2D textures[SCENE_MAX_TEXTURES];
 
-layout(set = 2, binding = 0) uniform sampler2D dirLightShadowMapTex;
+layout(set = 2, binding = 0) uniform sampler2DArray dirLightShadowMapTex;
 layout(set = 2, binding = 1) uniform LightDataBlock { DirectionalLightData dirLight; };
 
+layout(set = 3, binding = 0) uniform ClusterInfoBlock { LightClusterInfo clusterInfo; };
+layout(set = 3, binding = 1) readonly buffer LocalLightBlock { LocalLightData localLights[]; };
+layout(set = 3, binding = 2) readonly buffer ClusterLightCountBlock { int clusterLightCounts[]; };
+layout(set = 3, binding = 3) readonly buffer ClusterLightIndexBlock { int clusterLightIndices[]; };
+
 layout(push_constant) uniform PushConstants {
     float ambientAmount;
 };
@@ -33,8 +39,7 @@ vec3 evaluateDirectionalLight(DirectionalLightData light, vec3 V, vec3 N, vec3 b
     vec3 lightColor = light.colorAndIntensity.a * light.colorAndIntensity.rgb;
     vec3 L = -normalize(light.viewSpaceDirection.xyz);
 
-    mat4 lightProjectionFromView = light.lightProjectionFromWorld * camera.worldFromView;
-    float shadowFactor = evaluateShadow(dirLightShadowMapTex, lightProjectionFromView, vPosition);
+    float shadowFactor = evaluateCascadedShadow(dirLightShadowMapTex, light, camera.worldFromView, vPosition);
 
     vec3 brdf = evaluateBRDF(L, V, N, baseColor, roughness, metallic);
     vec3 directLight = lightColor * shadowFactor;
@@ -43,6 +48,32 @@ vec3 evaluateDirectionalLight(DirectionalLightData light, vec3 V, vec3 N, vec3 b
     return brdf * LdotN * directLight;
 }
 
+vec3 evaluateLocalLight(LocalLightData light, vec3 V, vec3 N, vec3 baseColor, float roughness, float metallic)
+{
+    vec3 lightColor = light.colorAndIntensity.a * light.colorAndIntensity.rgb;
+
+    vec3 toLight = light.viewSpacePositionAndRange.xyz - vPosition;
+    float distance2 = lengthSquared(toLight);
+    vec3 L = toLight * inversesqrt(distance2);
+
+    // Inverse square falloff, windowed so that it smoothly reaches zero at the range of the light
+    float range = light.viewSpacePositionAndRange.w;
+    float distanceRatio2 = distance2 / (range * range);
+    float window = clamp(1.0 - distanceRatio2 * distanceRatio2, 0.0, 1.0);
+    float attenuation = (window * window) / max(distance2, 1e-4);
+
+    if (light.cosOuterConeAngle > -1.0) {
+        float cosAngle = dot(-L, normalize(light.viewSpaceDirection.xyz));
+        attenuation *= smoothstep(light.cosOuterConeAngle, light.cosInnerConeAngle, cosAngle);
+    }
+
+    vec3 brdf = evaluateBRDF(L, V, N, baseColor, roughness, metallic);
+    vec3 directLight = lightColor * attenuation;
+
+    float LdotN = max(dot(L, N), 0.0);
+    return brdf * LdotN * directLight;
+}
+
 void main()
 {
     ShaderMaterial material = materials[vMaterialIndex];
@@ -69,9 +100,17 @@ void main()
     vec3 ambient = ambientAmount * baseColor;
     vec3 color = emissive + ambient;
 
-    // TODO: Evaluate ALL lights that will have an effect on this pixel/tile/cluster or whatever we go with
     color += evaluateDirectionalLight(dirLight, V, N, baseColor, roughness, metallic);
 
+    // Only evaluate the local lights which have been binned into the cluster of this fragment
+    ivec3 cluster = lightClusterForViewSpacePosition(vPosition, camera.projectionFromView, clusterInfo.zNear, clusterInfo.zFar);
+    int clusterIdx = lightClusterIndex(cluster);
+    int clusterLightCount = clusterLightCounts[clusterIdx];
+    for (int i = 0; i < clusterLightCount; ++i) {
+        int lightIdx = clusterLightIndices[clusterIdx * LIGHT_CLUSTER_MAX_LIGHTS + i];
+        color += evaluateLocalLight(localLights[lightIdx], V, N, baseColor, roughness, metallic);
+    }
+
     oColor = vec4(color, 1.0);
     oNormal = vec4(N, 0.0);
     oBaseColor = vec4(baseColor, 0.0);
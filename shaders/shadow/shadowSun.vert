@@ -1,22 +1,18 @@
-#version 450
+#version 460
 
-#include <shared/ShadowData.h>
+#include <shared/SceneData.h>
 
 layout(location = 0) in vec3 aPosition;
 
-layout(set = 0, binding = 0) uniform LightDataBlock
-{
-    mat4 lightProjectionFromWorld;
-};
+layout(set = 0, binding = 0) readonly buffer PerObjectBlock { ShaderDrawable perObject[]; };
 
-layout(set = 1, binding = 0) uniform TransformDataBlock
-{
-    mat4 transforms[SHADOW_MAX_OCCLUDERS];
+layout(push_constant) uniform PushConstants {
+    mat4 lightProjectionFromWorld;
 };
 
 void main()
 {
     int objectIndex = gl_InstanceIndex;
-    mat4 worldFromLocal = transforms[objectIndex];
+    mat4 worldFromLocal = perObject[objectIndex].worldFromLocal;
     gl_Position = lightProjectionFromWorld * worldFromLocal * vec4(aPosition, 1.0);
 }
@@ -0,0 +1,13 @@
+#ifndef INDIRECT_DATA_H
+#define INDIRECT_DATA_H
+
+//! Where in the shared vertex & index buffers a drawable's geometry is, and its bounds for culling
+struct IndirectDrawableGeometry {
+    vec4 localBoundingSphere;
+    int indexCount;
+    int firstIndex;
+    int vertexOffset;
+    int pad;
+};
+
+#endif // INDIRECT_DATA_H
@@ -1,11 +1,42 @@
 #ifndef LIGHT_DATA_H
 #define LIGHT_DATA_H
 
+// Directional lights have cascaded shadow maps, fitted to slices of the camera frustum and stored as layers of an array texture
+#define SHADOW_MAX_CASCADES 4
+
 struct DirectionalLightData {
     vec4 colorAndIntensity;
     vec4 worldSpaceDirection;
     vec4 viewSpaceDirection;
-    mat4 lightProjectionFromWorld;
+    mat4 lightProjectionFromWorld[SHADOW_MAX_CASCADES];
+    int cascadeCount;
+    int pad1, pad2, pad3;
+};
+
+// Point & spot lights are binned into clusters (froxels), with exponentially distributed depth slices from the near to the far plane
+#define LIGHT_CLUSTER_COUNT_X 16
+#define LIGHT_CLUSTER_COUNT_Y 9
+#define LIGHT_CLUSTER_COUNT_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y * LIGHT_CLUSTER_COUNT_Z)
+#define LIGHT_CLUSTER_MAX_LIGHTS 128
+
+// This limit is arbitrary, it's only to have a fixed size light buffer
+#define SCENE_MAX_LOCAL_LIGHTS 8192
+
+struct LocalLightData {
+    vec4 colorAndIntensity;
+    vec4 viewSpacePositionAndRange;
+    vec4 viewSpaceDirection; // (spot lights only)
+    float cosOuterConeAngle; // -1 for point lights, i.e. no cone
+    float cosInnerConeAngle;
+    float pad1, pad2;
+};
+
+struct LightClusterInfo {
+    float zNear;
+    float zFar;
+    int localLightCount;
+    int pad;
 };
 
 #endif // LIGHT_DATA_H
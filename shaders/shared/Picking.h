@@ -1,6 +0,0 @@
-#ifndef PICKING_H
-#define PICKING_H
-
-#define PICKING_MAX_DRAWABLES 256
-
-#endif // PICKING_H
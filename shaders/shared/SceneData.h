@@ -2,7 +2,7 @@
 #define SCENE_DATA_H
 
 // These limits are arbitrary, and should be changed!
-#define SCENE_MAX_DRAWABLES 128
+#define SCENE_MAX_DRAWABLES 16384
 #define SCENE_MAX_MATERIALS 128
 #define SCENE_MAX_TEXTURES 256
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "apps/IndirectDrawBenchmarkApp.h"
 #include "apps/MultisampleTest.h"
 #include "apps/RayTracingApp.h"
 #include "apps/ShowcaseApp.h"
@@ -0,0 +1,196 @@
+#include "IndirectDrawBenchmarkApp.h"
+
+#include "SceneData.h"
+#include "rendering/nodes/GBufferNode.h"
+#include "rendering/nodes/LightClusterNode.h"
+#include "rendering/nodes/SceneNode.h"
+#include "rendering/nodes/ShadowMapNode.h"
+#include "rendering/scene/models/BakedModel.h"
+#include "utility/GlobalState.h"
+#include "utility/Input.h"
+#include "utility/Logging.h"
+#include <cmath>
+#include <imgui.h>
+#include <moos/transform.h>
+#include <optional>
+
+std::vector<Backend::Capability> IndirectDrawBenchmarkApp::requiredCapabilities()
+{
+    return { Backend::Capability::DrawIndirectCount,
+             Backend::Capability::ShaderTextureArrayDynamicIndexing,
+             Backend::Capability::ShaderBufferArrayDynamicIndexing };
+}
+
+std::vector<Backend::Capability> IndirectDrawBenchmarkApp::optionalCapabilities()
+{
+    return {};
+}
+
+void IndirectDrawBenchmarkApp::setup(RenderGraph& graph)
+{
+    scene().loadFromFile("assets/sample/cornell-box.json");
+
+    // Fill the scene with a grid of copies of the cornell box, as many as the scene can hold
+
+    const std::string modelPath = "assets/sample/models/CornellBox/CornellBox.gltf";
+    size_t meshesPerModel = BakedModel::loadGltfUsingCache(modelPath)->meshCount();
+    size_t maxCopies = (SCENE_MAX_DRAWABLES / meshesPerModel) - 1;
+
+    int gridSize = static_cast<int>(std::sqrt(static_cast<float>(maxCopies)));
+    constexpr float gridSpacing = 2.5f;
+
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            Model& model = scene().addModel(BakedModel::loadGltfUsingCache(modelPath));
+            vec3 offset = vec3(float(x - gridSize / 2), 0.0f, -float(z + 1)) * gridSpacing;
+            model.transform().setLocalMatrix(moos::translate(offset));
+        }
+    }
+
+    size_t totalMeshCount = scene().forEachMesh([](size_t, Mesh&) {});
+    LogInfo("IndirectDrawBenchmarkApp: benchmarking with up to %zu meshes\n", totalMeshCount);
+
+    for (size_t meshLimit = 16; meshLimit < 4 * totalMeshCount; meshLimit *= 4) {
+        size_t limit = std::min(meshLimit, totalMeshCount);
+        m_cases.push_back({ limit, ForwardRenderNode::DrawMode::CpuCulling });
+        m_cases.push_back({ limit, ForwardRenderNode::DrawMode::GpuDriven });
+    }
+
+    graph.addNode<SceneNode>(scene());
+    graph.addNode<GBufferNode>(scene());
+    graph.addNode<ShadowMapNode>(scene());
+    graph.addNode<LightClusterNode>(scene());
+    // (switchable, so the node keeps the geometry for both draw modes)
+    m_forwardNode = &graph.addNode<ForwardRenderNode>(scene(), ForwardRenderNode::DrawMode::GpuDriven, true);
+
+    // (created up front so they are queued for compilation along with the shaders of the other nodes, before any state is created)
+    Shader tonemapShader = Shader::createBasicRasterize("final/showcase/tonemap.vert", "final/showcase/tonemap.frag");
+    graph.addNode("final", [tonemapShader](Registry& reg) {
+        std::vector<vec2> fullScreenTriangle { { -1, -3 }, { -1, 1 }, { 3, 1 } };
+        Buffer& vertexBuffer = reg.createBuffer(std::move(fullScreenTriangle), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
+        VertexLayout vertexLayout = VertexLayout { sizeof(vec2), { { 0, VertexAttributeType::Float2, 0 } } };
+
+        BindingSet& tonemapBindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, reg.getTexture("forward", "color").value(), ShaderBindingType::TextureSampler } });
+        RenderStateBuilder tonemapStateBuilder { reg.windowRenderTarget(), tonemapShader, vertexLayout };
+        tonemapStateBuilder.addBindingSet(tonemapBindingSet);
+        tonemapStateBuilder.writeDepth = false;
+        tonemapStateBuilder.testDepth = false;
+        RenderState& tonemapRenderState = reg.createRenderState(tonemapStateBuilder);
+
+        return [&](const AppState& appState, CommandList& cmdList) {
+            cmdList.beginRendering(tonemapRenderState, ClearColor(0.5f, 0.1f, 0.5f), 1.0f);
+            cmdList.bindSet(tonemapBindingSet, 0);
+            cmdList.draw(vertexBuffer, 3);
+        };
+    });
+
+    startCase(0);
+}
+
+void IndirectDrawBenchmarkApp::update(float elapsedTime, float deltaTime)
+{
+    if (!m_benchmarkDone) {
+        // NOTE: The node reports the CPU time for the previous frame, and the GPU time for the last frame that finished executing on the GPU,
+        // but since we always start with more warmup frames than there are frames in flight that doesn't matter
+        m_framesInCase += 1;
+        if (m_framesInCase > warmupFrameCount) {
+            m_accumulatedTimeMs += m_forwardNode->lastDrawRecordingTimeMs();
+            if (std::optional<double> gpuTime = m_forwardNode->timer().lastGpuTime(); gpuTime.has_value()) {
+                m_accumulatedGpuTimeMs += gpuTime.value() * 1000.0;
+                m_gpuTimedFrameCount += 1;
+            }
+        }
+
+        if (m_framesInCase == warmupFrameCount + measuredFrameCount) {
+            BenchmarkCase& benchmarkCase = m_cases[m_currentCase];
+            benchmarkCase.avgDrawRecordingTimeMs = m_accumulatedTimeMs / measuredFrameCount;
+            if (m_gpuTimedFrameCount > 0)
+                benchmarkCase.avgGpuTimeMs = m_accumulatedGpuTimeMs / m_gpuTimedFrameCount;
+            if (m_currentCase + 1 < m_cases.size()) {
+                startCase(m_currentCase + 1);
+            } else {
+                m_benchmarkDone = true;
+                reportResults();
+            }
+        }
+    }
+
+    ImGui::Begin("IndirectDrawBenchmarkApp");
+    if (!m_benchmarkDone) {
+        ImGui::Text("Running case %zu of %zu..", m_currentCase + 1, m_cases.size());
+    }
+    ImGui::Columns(5);
+    ImGui::Text("Meshes");
+    ImGui::NextColumn();
+    ImGui::Text("CPU culling, CPU (ms)");
+    ImGui::NextColumn();
+    ImGui::Text("CPU culling, GPU (ms)");
+    ImGui::NextColumn();
+    ImGui::Text("GPU-driven, CPU (ms)");
+    ImGui::NextColumn();
+    ImGui::Text("GPU-driven, GPU (ms)");
+    ImGui::NextColumn();
+    for (size_t i = 0; i + 1 < m_cases.size(); i += 2) {
+        if (m_cases[i + 1].avgDrawRecordingTimeMs == 0.0)
+            break;
+        ImGui::Text("%zu", m_cases[i].meshLimit);
+        ImGui::NextColumn();
+        for (const BenchmarkCase& benchmarkCase : { m_cases[i], m_cases[i + 1] }) {
+            ImGui::Text("%.3f", benchmarkCase.avgDrawRecordingTimeMs);
+            ImGui::NextColumn();
+            if (benchmarkCase.avgGpuTimeMs.has_value())
+                ImGui::Text("%.3f", benchmarkCase.avgGpuTimeMs.value());
+            else
+                ImGui::Text("n/a");
+            ImGui::NextColumn();
+        }
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+
+    const Input& input = Input::instance();
+    scene().camera().update(input, GlobalState::get().windowExtent(), deltaTime);
+}
+
+void IndirectDrawBenchmarkApp::startCase(size_t caseIndex)
+{
+    m_currentCase = caseIndex;
+    m_framesInCase = 0;
+    m_accumulatedTimeMs = 0.0;
+    m_accumulatedGpuTimeMs = 0.0;
+    m_gpuTimedFrameCount = 0;
+
+    const BenchmarkCase& benchmarkCase = m_cases[caseIndex];
+    m_forwardNode->setMeshLimit(benchmarkCase.meshLimit);
+    m_forwardNode->setDrawMode(benchmarkCase.drawMode);
+}
+
+void IndirectDrawBenchmarkApp::reportResults() const
+{
+    // NOTE: The GPU time is for the whole forward node, which for the GPU-driven path includes the cull dispatch
+    LogInfo("IndirectDrawBenchmarkApp: forward pass draw recording time (CPU) & forward node time (GPU), in ms\n");
+    LogInfo("  %8s  %25s  %25s\n", "", "CPU culling", "GPU-driven");
+    LogInfo("  %8s  %7s  %7s  %7s  %7s  %7s  %7s\n", "meshes", "CPU", "GPU", "total", "CPU", "GPU", "total");
+
+    bool hasGpuTimes = true;
+    std::optional<size_t> crossoverMeshCount {};
+    for (size_t i = 0; i + 1 < m_cases.size(); i += 2) {
+        const BenchmarkCase& cpuCase = m_cases[i];
+        const BenchmarkCase& gpuCase = m_cases[i + 1];
+        LogInfo("  %8zu  %7.3f  %7.3f  %7.3f  %7.3f  %7.3f  %7.3f\n", cpuCase.meshLimit,
+                cpuCase.avgDrawRecordingTimeMs, cpuCase.avgGpuTimeMs.value_or(0.0), cpuCase.totalTimeMs(),
+                gpuCase.avgDrawRecordingTimeMs, gpuCase.avgGpuTimeMs.value_or(0.0), gpuCase.totalTimeMs());
+
+        hasGpuTimes = hasGpuTimes && cpuCase.avgGpuTimeMs.has_value() && gpuCase.avgGpuTimeMs.has_value();
+        if (!crossoverMeshCount.has_value() && gpuCase.totalTimeMs() < cpuCase.totalTimeMs())
+            crossoverMeshCount = cpuCase.meshLimit;
+    }
+
+    if (!hasGpuTimes)
+        LogWarning("IndirectDrawBenchmarkApp: GPU times are not available for all cases, so the totals are (partially) CPU only\n");
+
+    if (crossoverMeshCount.has_value())
+        LogInfo("IndirectDrawBenchmarkApp: GPU-driven drawing is cheaper in total from %zu meshes and up\n", crossoverMeshCount.value());
+    else
+        LogInfo("IndirectDrawBenchmarkApp: GPU-driven drawing was never cheaper in total for the tested mesh counts\n");
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "rendering/App.h"
+#include "rendering/nodes/ForwardRenderNode.h"
+#include "rendering/scene/Scene.h"
+#include <optional>
+
+//! Renders a scene with many copies of the same model and compares the cost of the forward pass draws, with CPU culling & one draw call
+//! per mesh versus GPU culling & a single indirect draw, for an increasing number of meshes. Both the CPU time of recording the draws
+//! (including culling, for the CPU path) and the GPU time of the forward node (the cull dispatch & the draws) are measured.
+class IndirectDrawBenchmarkApp : public App {
+public:
+    std::vector<Backend::Capability> requiredCapabilities() override;
+    std::vector<Backend::Capability> optionalCapabilities() override;
+
+    void setup(RenderGraph&) override;
+    void update(float elapsedTime, float deltaTime) override;
+
+private:
+    struct BenchmarkCase {
+        size_t meshLimit;
+        ForwardRenderNode::DrawMode drawMode;
+        double avgDrawRecordingTimeMs { 0.0 };
+        //! Not available if the backend can't time nodes on the GPU
+        std::optional<double> avgGpuTimeMs {};
+
+        double totalTimeMs() const { return avgDrawRecordingTimeMs + avgGpuTimeMs.value_or(0.0); }
+    };
+
+    void startCase(size_t caseIndex);
+    void reportResults() const;
+
+    ForwardRenderNode* m_forwardNode { nullptr };
+
+    std::vector<BenchmarkCase> m_cases {};
+    size_t m_currentCase { 0 };
+    int m_framesInCase { 0 };
+    double m_accumulatedTimeMs { 0.0 };
+    double m_accumulatedGpuTimeMs { 0.0 };
+    int m_gpuTimedFrameCount { 0 };
+    bool m_benchmarkDone { false };
+
+    static constexpr int warmupFrameCount = 30;
+    static constexpr int measuredFrameCount = 120;
+};
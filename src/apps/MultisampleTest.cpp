@@ -29,7 +29,9 @@ void MultisampleTest::setup(RenderGraph& graph)
     graph.addNode<PickingNode>(scene());
     graph.addNode<DebugForwardNode>(scene());
 
-    graph.addNode("final", [](Registry& reg) {
+    // (created up front so they are queued for compilation along with the shaders of the other nodes, before any state is created)
+    Shader shader = Shader::createBasicRasterize("final/multisampled.vert", "final/multisampled.frag");
+    graph.addNode("final", [shader](Registry& reg) {
         std::vector<vec2> fullScreenTriangle { { -1, -3 }, { -1, 1 }, { 3, 1 } };
         Buffer& vertexBuffer = reg.createBuffer(std::move(fullScreenTriangle), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
         VertexLayout vertexLayout = VertexLayout { sizeof(vec2), { { 0, VertexAttributeType::Float2, 0 } } };
@@ -40,7 +42,6 @@ void MultisampleTest::setup(RenderGraph& graph)
                                                            { 2, ShaderStageFragment, reg.getTexture("forward", "depth").value(), ShaderBindingType::TextureSampler },
                                                            { 3, ShaderStageFragment, reg.getBuffer("scene", "environmentData") } });
 
-        Shader shader = Shader::createBasicRasterize("final/multisampled.vert", "final/multisampled.frag");
         RenderStateBuilder renderStateBuilder { reg.windowRenderTarget(), shader, vertexLayout };
         renderStateBuilder.addBindingSet(sourceBindingSet).addBindingSet(envBindingSet);
         renderStateBuilder.writeDepth = false;
@@ -3,6 +3,7 @@
 #include "rendering/nodes/ExposureNode.h"
 #include "rendering/nodes/ForwardRenderNode.h"
 #include "rendering/nodes/GBufferNode.h"
+#include "rendering/nodes/LightClusterNode.h"
 #include "rendering/nodes/PickingNode.h"
 #include "rendering/nodes/RTAccelerationStructures.h"
 #include "rendering/nodes/RTAmbientOcclusion.h"
@@ -42,6 +43,7 @@ void RayTracingApp::setup(RenderGraph& graph)
     graph.addNode<PickingNode>(scene());
     graph.addNode<GBufferNode>(scene());
     graph.addNode<ShadowMapNode>(scene());
+    graph.addNode<LightClusterNode>(scene());
     graph.addNode<ForwardRenderNode>(scene());
     if (rtxOn) {
         graph.addNode<RTAccelerationStructures>(scene());
@@ -55,7 +57,9 @@ void RayTracingApp::setup(RenderGraph& graph)
 
     graph.addNode<SkyViewNode>(scene());
 
-    graph.addNode("rt-combine", [](Registry& reg) {
+    // (created up front so they are queued for compilation along with the shaders of all other nodes, before any state is created)
+    Shader giCombineShader = Shader::createCompute("post/gi-combine.comp");
+    graph.addNode("rt-combine", [giCombineShader](Registry& reg) {
         // TODO: Consider placing something like this in the Registry itself so we can just do value_or(reg.placeholderTexture())
         Texture& placeholder = reg.loadTexture2D("assets/test-pattern.png", true, true);
 
@@ -67,8 +71,7 @@ void RayTracingApp::setup(RenderGraph& graph)
         BindingSet& giBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, diffuseGI, ShaderBindingType::TextureSampler },
                                                           { 1, ShaderStageCompute, ambientOcclusion, ShaderBindingType::TextureSampler } });
 
-        Shader shader = Shader::createCompute("post/gi-combine.comp");
-        ComputeState& computeState = reg.createComputeState(shader, { &targetBindingSet, &giBindingSet });
+        ComputeState& computeState = reg.createComputeState(giCombineShader, { &targetBindingSet, &giBindingSet });
 
         return [&](const AppState& appState, CommandList& cmdList) {
             cmdList.setComputeState(computeState);
@@ -85,15 +88,15 @@ void RayTracingApp::setup(RenderGraph& graph)
 
     graph.addNode<ExposureNode>(scene());
 
-    graph.addNode("final", [](Registry& reg) {
+    Shader tonemapShader = Shader::createBasicRasterize("final/showcase/tonemap.vert", "final/showcase/tonemap.frag");
+    graph.addNode("final", [tonemapShader](Registry& reg) {
         // TODO: We should probably use compute for this now.. we don't require interpolation or any type of depth writing etc.
         std::vector<vec2> fullScreenTriangle { { -1, -3 }, { -1, 1 }, { 3, 1 } };
         Buffer& vertexBuffer = reg.createBuffer(std::move(fullScreenTriangle), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
         VertexLayout vertexLayout = VertexLayout { sizeof(vec2), { { 0, VertexAttributeType::Float2, 0 } } };
 
         BindingSet& bindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, reg.getTexture("forward", "color").value(), ShaderBindingType::TextureSampler } });
-        Shader shader = Shader::createBasicRasterize("final/showcase/tonemap.vert", "final/showcase/tonemap.frag");
-        RenderStateBuilder renderStateBuilder { reg.windowRenderTarget(), shader, vertexLayout };
+        RenderStateBuilder renderStateBuilder { reg.windowRenderTarget(), tonemapShader, vertexLayout };
         renderStateBuilder.addBindingSet(bindingSet);
         renderStateBuilder.writeDepth = false;
         renderStateBuilder.testDepth = false;
@@ -6,6 +6,7 @@
 #include "rendering/nodes/ExposureNode.h"
 #include "rendering/nodes/ForwardRenderNode.h"
 #include "rendering/nodes/GBufferNode.h"
+#include "rendering/nodes/LightClusterNode.h"
 #include "rendering/nodes/PickingNode.h"
 #include "rendering/nodes/SceneNode.h"
 #include "rendering/nodes/ShadowMapNode.h"
@@ -24,7 +25,7 @@ std::vector<Backend::Capability> ShowcaseApp::requiredCapabilities()
 
 std::vector<Backend::Capability> ShowcaseApp::optionalCapabilities()
 {
-    return {};
+    return { Backend::Capability::DrawIndirectCount };
 }
 
 void ShowcaseApp::setup(RenderGraph& graph)
@@ -43,6 +44,7 @@ void ShowcaseApp::setup(RenderGraph& graph)
 
     // Prepass nodes
     graph.addNode<ShadowMapNode>(scene());
+    graph.addNode<LightClusterNode>(scene());
     graph.addNode<DiffuseGINode>(scene());
 
     // Main nodes (pre-exposure)
@@ -54,13 +56,19 @@ void ShowcaseApp::setup(RenderGraph& graph)
     // Exposure & post-exposure additions (e.g. debug visualizations)
     graph.addNode<ExposureNode>(scene());
 
-    graph.addNode("final", [](Registry& reg) {
+    // (created up front so they are queued for compilation along with the shaders of all other nodes, before any state is created)
+#define USE_FXAA 1
+    Shader tonemapShader = Shader::createBasicRasterize("final/showcase/tonemap.vert", "final/showcase/tonemap.frag");
+#if USE_FXAA
+    Shader fxaaShader = Shader::createBasicRasterize("final/showcase/anti-alias.vert", "final/showcase/anti-alias.frag");
+#endif
+
+    graph.addNode("final", [=](Registry& reg) {
         // TODO: We should probably use compute for this now.. we don't require interpolation or any type of depth writing etc.
         std::vector<vec2> fullScreenTriangle { { -1, -3 }, { -1, 1 }, { 3, 1 } };
         Buffer& vertexBuffer = reg.createBuffer(std::move(fullScreenTriangle), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
         VertexLayout vertexLayout = VertexLayout { sizeof(vec2), { { 0, VertexAttributeType::Float2, 0 } } };
 
-#define USE_FXAA 1
 #if USE_FXAA
         Texture& ldrTexture = reg.createTexture2D(reg.windowRenderTarget().extent(), Texture::Format::RGBA8);
         RenderTarget& ldrTarget = reg.createRenderTarget({ { RenderTarget::AttachmentType::Color0, &ldrTexture } });
@@ -69,7 +77,6 @@ void ShowcaseApp::setup(RenderGraph& graph)
 #endif
 
         BindingSet& tonemapBindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, reg.getTexture("forward", "color").value(), ShaderBindingType::TextureSampler } });
-        Shader tonemapShader = Shader::createBasicRasterize("final/showcase/tonemap.vert", "final/showcase/tonemap.frag");
         RenderStateBuilder tonemapStateBuilder { ldrTarget, tonemapShader, vertexLayout };
         tonemapStateBuilder.addBindingSet(tonemapBindingSet);
         tonemapStateBuilder.writeDepth = false;
@@ -78,7 +85,6 @@ void ShowcaseApp::setup(RenderGraph& graph)
 
 #if USE_FXAA
         BindingSet& fxaaBindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, &ldrTexture, ShaderBindingType::TextureSampler } });
-        Shader fxaaShader = Shader::createBasicRasterize("final/showcase/anti-alias.vert", "final/showcase/anti-alias.frag");
         RenderStateBuilder fxaaStateBuilder { reg.windowRenderTarget(), fxaaShader, vertexLayout };
         fxaaStateBuilder.addBindingSet(fxaaBindingSet);
         fxaaStateBuilder.writeDepth = false;
@@ -11,6 +11,8 @@ std::string Backend::capabilityName(Capability capability)
         return "ShaderTextureArrayDynamicIndexing";
     case Capability::ShaderBufferArrayDynamicIndexing:
         return "ShaderBufferArrayDynamicIndexing";
+    case Capability::DrawIndirectCount:
+        return "DrawIndirectCount";
     default:
         ASSERT_NOT_REACHED();
     }
@@ -4,6 +4,7 @@
 #include "utility/Badge.h"
 #include "utility/util.h"
 #include <memory>
+#include <optional>
 #include <vector>
 
 class Backend {
@@ -20,12 +21,20 @@ public:
         Shader16BitFloat,
         ShaderTextureArrayDynamicIndexing,
         ShaderBufferArrayDynamicIndexing,
+        DrawIndirectCount,
     };
 
     static std::string capabilityName(Capability capability);
     virtual bool hasActiveCapability(Capability) const = 0;
     virtual bool executeFrame(double elapsedTime, double deltaTime) = 0;
 
+    //! Block until the GPU is done with the most recently executed frame, and return how long it took to execute there (in seconds), if known
+    virtual std::optional<double> waitForFrameCompletion() = 0;
+
+    //! Save the window image of the most recently executed frame to a PNG file. Only possible when rendering offscreen, since presented
+    //! swapchain images aren't ours to read back.
+    virtual bool saveFrameImageToFile(const std::string& filePath) = 0;
+
     virtual std::unique_ptr<Buffer> createBuffer(size_t, Buffer::Usage, Buffer::MemoryHint) = 0;
     virtual std::unique_ptr<RenderTarget> createRenderTarget(std::vector<RenderTarget::Attachment>) = 0;
     virtual std::unique_ptr<Texture> createTexture(Texture::TextureDescription) = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <backend/Resources.h>
+#include <functional>
 #include <string>
 
 class CommandList {
@@ -25,16 +26,25 @@ public:
     virtual void draw(Buffer& vertexBuffer, uint32_t vertexCount) = 0;
     virtual void drawIndexed(const Buffer& vertexBuffer, const Buffer& indexBuffer, uint32_t indexCount, IndexType, uint32_t instanceIndex = 0) = 0;
 
-    virtual void rebuildTopLevelAcceratationStructure(TopLevelAS&) = 0;
+    //! Draw with arguments sourced from the GPU: the count buffer holds a single uint32 draw count, and the indirect buffer holds (at most
+    //! maxDrawCount) tightly packed indexed draw commands as laid out by e.g. VkDrawIndexedIndirectCommand. Requires the DrawIndirectCount
+    //! capability, which also allows the commands to have a nonzero first instance.
+    virtual void drawIndexedIndirect(const Buffer& vertexBuffer, const Buffer& indexBuffer, IndexType, const Buffer& indirectBuffer, const Buffer& countBuffer, uint32_t maxDrawCount) = 0;
+
+    //! Record draws for the items [0, itemCount) of the active render pass, possibly spread over multiple threads. The callback is called
+    //! for disjoint ranges [begin, end) with a command list that inherits the render state, bound sets, and push constants of this one.
+    //! Only draws (and set/constant updates) may be recorded in the callback, and no inline draws may follow in the same render pass.
+    using ParallelDrawCallback = std::function<void(CommandList&, size_t begin, size_t end)>;
+    virtual void drawInParallel(size_t itemCount, const ParallelDrawCallback&) = 0;
+
+    //! Bring the acceleration structure up to date with the current transforms of its instances. Does nothing if none of them have moved,
+    //! and otherwise either refits the structure in place or (if the instances have moved far since it was last built) rebuilds it.
+    virtual void updateTopLevelAccelerationStructure(TopLevelAS&) = 0;
     virtual void traceRays(Extent2D) = 0;
 
     virtual void dispatch(Extent3D globalSize, Extent3D localSize) = 0;
     virtual void dispatch(uint32_t x, uint32_t y, uint32_t z = 1) = 0;
 
-    virtual void waitEvent(uint8_t eventId, PipelineStage) = 0;
-    virtual void resetEvent(uint8_t eventId, PipelineStage) = 0;
-    virtual void signalEvent(uint8_t eventId, PipelineStage) = 0;
-
     //! A barrier for all commands and memory, which probably only should be used for debug stuff.
     virtual void debugBarrier() = 0;
 
@@ -42,7 +52,10 @@ public:
     virtual void beginDebugLabel(const std::string&) = 0;
     virtual void endDebugLabel() = 0;
 
+    //! Barriers between passes within a node. There is no need for barriers between nodes, as the render graph derives those from the
+    //! binding sets & render targets that the nodes use.
     virtual void textureWriteBarrier(const Texture&) = 0;
+    virtual void bufferWriteBarrier(std::vector<Buffer*>) = 0;
 
     virtual void slowBlockingReadFromBuffer(const Buffer&, size_t offset, size_t size, void* dst) = 0;
 
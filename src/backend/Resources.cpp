@@ -131,6 +131,12 @@ RenderTarget::RenderTarget(Backend& backend, std::vector<Attachment> attachments
             LogErrorAndExit("RenderTarget error: tried to create render target with multisample texture but no resolve texture\n");
     }
 
+    for (const Attachment& attachment : attachments) {
+        if (attachment.arrayLayer >= attachment.texture->arrayCount())
+            LogErrorAndExit("RenderTarget error: tried to create render target with attachment layer %u but the texture only has %u layers\n",
+                            attachment.arrayLayer, attachment.texture->arrayCount());
+    }
+
     Extent2D firstExtent = m_depthAttachment.has_value()
         ? m_depthAttachment.value().texture->extent()
         : m_colorAttachments.front().texture->extent();
@@ -269,6 +275,7 @@ ShaderBinding::ShaderBinding(uint32_t index, ShaderStage shaderStage, Buffer* bu
         type = ShaderBindingType::UniformBuffer;
         break;
     case Buffer::Usage::StorageBuffer:
+    case Buffer::Usage::IndirectBuffer:
         type = ShaderBindingType::StorageBuffer;
         break;
     default:
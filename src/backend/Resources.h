@@ -4,6 +4,7 @@
 #include "rendering/scene/Transform.h"
 #include "utility/Badge.h"
 #include "utility/Extent.h"
+#include "utility/Image.h"
 #include "utility/util.h"
 #include <cstdint>
 #include <functional>
@@ -29,7 +30,7 @@ public:
     Resource& operator=(Resource&&) noexcept;
 
     void setOwningRegistry(Badge<Registry>, Registry* registry);
-    Registry* owningRegistry(Badge<Registry>) { return m_owningRegistry; }
+    Registry* owningRegistry(Badge<Registry>) const { return m_owningRegistry; }
 
 protected:
     bool hasBackend() const { return m_backend != nullptr; }
@@ -215,6 +216,9 @@ struct Texture : public Resource {
     virtual void setPixelData(vec4 pixel) = 0;
     virtual void setData(const void* data, size_t size) = 0;
 
+    //! Decode the image file & upload its data in the background, leaving the texture filled with the placeholder color until then
+    virtual void streamDataFromImageFile(const std::string& imagePath, Image::PixelType, vec4 placeholderColor) = 0;
+
     virtual void generateMipmaps() = 0;
 
     [[nodiscard]] Type type() const { return m_type; }
@@ -306,6 +310,8 @@ struct RenderTarget : public Resource {
         LoadOp loadOp { LoadOp::Clear };
         StoreOp storeOp { StoreOp::Store };
         Texture* multisampleResolveTexture { nullptr };
+        //! For array textures, the layer of the texture which is rendered to
+        uint32_t arrayLayer { 0 };
     };
 
     RenderTarget() = default;
@@ -341,6 +347,8 @@ struct Buffer : public Resource {
         Index,
         UniformBuffer,
         StorageBuffer,
+        //! Indirect draw arguments, which can also be written to as a storage buffer
+        IndirectBuffer,
     };
 
     enum class MemoryHint {
@@ -431,13 +439,6 @@ struct Viewport {
     Extent2D extent;
 };
 
-enum class PipelineStage {
-    Host,
-    Compute,
-    RayTracing,
-    // TODO: Add more obviously
-};
-
 enum ShaderStage : uint8_t {
     ShaderStageVertex = 0x01,
     ShaderStageFragment = 0x02,
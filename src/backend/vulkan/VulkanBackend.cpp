@@ -10,10 +10,14 @@
 #include "utility/FileIO.h"
 #include "utility/GlobalState.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include "utility/ThreadPool.h"
 #include "utility/util.h"
 #include <ImGuizmo.h>
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <filesystem>
 #include <fmt/format.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -25,19 +29,34 @@
 static bool s_unhandledWindowResize = false;
 
 VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
+    : VulkanBackend(window, app, {})
+{
+}
+
+VulkanBackend::VulkanBackend(App& app, Extent2D windowExtent)
+    : VulkanBackend(nullptr, app, windowExtent)
+{
+}
+
+VulkanBackend::VulkanBackend(GLFWwindow* window, App& app, Extent2D windowExtent)
     : m_window(window)
     , m_app(app)
 {
     m_sceneRegistry = std::make_unique<Registry>(*this);
     app.createScene(badge(), *m_sceneRegistry);
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    GlobalState::getMutable(badge()).updateWindowExtent({ width, height });
-    glfwSetFramebufferSizeCallback(window, static_cast<GLFWframebuffersizefun>([](GLFWwindow* window, int width, int height) {
-                                       GlobalState::getMutable(badge()).updateWindowExtent({ width, height });
-                                       s_unhandledWindowResize = true;
-                                   }));
+    if (isHeadless()) {
+        LogInfo("VulkanBackend: running headless, rendering offscreen at %ux%u.\n", windowExtent.width(), windowExtent.height());
+        GlobalState::getMutable(badge()).updateWindowExtent(windowExtent);
+    } else {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        GlobalState::getMutable(badge()).updateWindowExtent({ width, height });
+        glfwSetFramebufferSizeCallback(window, static_cast<GLFWframebuffersizefun>([](GLFWwindow* window, int width, int height) {
+                                           GlobalState::getMutable(badge()).updateWindowExtent({ width, height });
+                                           s_unhandledWindowResize = true;
+                                       }));
+    }
 
     {
         uint32_t availableLayerCount;
@@ -77,7 +96,7 @@ VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
         m_instance = createInstance(requestedLayers, nullptr);
     }
 
-    if (glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface) != VK_SUCCESS)
+    if (!isHeadless() && glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface) != VK_SUCCESS)
         LogErrorAndExit("VulkanBackend: can't create window surface, exiting.\n");
 
     m_physicalDevice = pickBestPhysicalDevice();
@@ -101,7 +120,15 @@ VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
     vkGetDeviceQueue(m_device, m_graphicsQueue.familyIndex, 0, &m_graphicsQueue.queue);
     vkGetDeviceQueue(m_device, m_computeQueue.familyIndex, 0, &m_computeQueue.queue);
 
+    if (hasActiveCapability(Capability::DrawIndirectCount)) {
+        vkCmdDrawIndexedIndirectCountKHR = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR"));
+        ASSERT(vkCmdDrawIndexedIndirectCountKHR);
+    }
+
     createSemaphoresAndFences(device());
+    createFrameQueryPools();
+
+    m_pipelineCache = createAndLoadPipelineCacheFromDisk();
 
     if (VulkanRTX::isSupportedOnPhysicalDevice(physicalDevice())) {
         m_rtx = std::make_unique<VulkanRTX>(*this, physicalDevice(), device());
@@ -115,6 +142,11 @@ VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
         LogErrorAndExit("VulkanBackend::VulkanBackend(): could not create memory allocator, exiting.\n");
     }
 
+    // NOTE: Uploads go on the graphics queue since generating mipmaps requires blitting
+    m_textureStreamer = std::make_unique<VulkanTextureStreamer>(*this, m_graphicsQueue.queue, m_graphicsQueue.familyIndex);
+
+    m_descriptorAllocator = std::make_unique<VulkanDescriptorAllocator>(*this);
+
     VkCommandPoolCreateInfo poolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
     poolCreateInfo.queueFamilyIndex = m_graphicsQueue.familyIndex;
     poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // (so we can easily reuse them each frame)
@@ -122,6 +154,15 @@ VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
         LogErrorAndExit("VulkanBackend::VulkanBackend(): could not create command pool for the graphics queue, exiting.\n");
     }
 
+    if (hasAsyncComputeQueue()) {
+        VkCommandPoolCreateInfo computePoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+        computePoolCreateInfo.queueFamilyIndex = m_computeQueue.familyIndex;
+        computePoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        if (vkCreateCommandPool(device(), &computePoolCreateInfo, nullptr, &m_asyncComputeCommandPool) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanBackend::VulkanBackend(): could not create command pool for the async compute queue, exiting.\n");
+        }
+    }
+
     VkCommandPoolCreateInfo transientPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
     transientPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     transientPoolCreateInfo.queueFamilyIndex = m_graphicsQueue.familyIndex;
@@ -129,18 +170,6 @@ VulkanBackend::VulkanBackend(GLFWwindow* window, App& app)
         LogErrorAndExit("VulkanBackend::VulkanBackend(): could not create transient command pool, exiting.\n");
     }
 
-    size_t numEvents = 4;
-    m_events.resize(numEvents);
-    VkEventCreateInfo eventCreateInfo = { VK_STRUCTURE_TYPE_EVENT_CREATE_INFO };
-    for (size_t i = 0; i < numEvents; ++i) {
-        if (vkCreateEvent(device(), &eventCreateInfo, nullptr, &m_events[i]) != VK_SUCCESS) {
-            LogErrorAndExit("VulkanBackend::VulkanBackend(): could not create event, exiting.\n");
-        }
-        if (vkSetEvent(device(), m_events[i]) != VK_SUCCESS) {
-            LogErrorAndExit("VulkanBackend::VulkanBackend(): could not signal event after creating it, exiting.\n");
-        }
-    }
-
     createAndSetupSwapchain(physicalDevice(), device(), m_surface);
     createWindowRenderTargetFrontend();
 
@@ -161,17 +190,32 @@ VulkanBackend::~VulkanBackend()
     vkFreeCommandBuffers(device(), m_renderGraphFrameCommandPool, m_frameCommandBuffers.size(), m_frameCommandBuffers.data());
 
     m_frameRegistries.clear();
+    for (TransientMemory& transientMemory : m_frameTransientMemory)
+        freeTransientMemory(transientMemory);
     m_nodeRegistry.reset();
     m_sceneRegistry.reset();
+    m_textureStreamer.reset();
+    m_descriptorAllocator.reset();
 
     destroySwapchain();
 
-    for (VkEvent event : m_events) {
-        vkDestroyEvent(device(), event, nullptr);
+    for (auto& events : m_frameEvents) {
+        for (VkEvent event : events)
+            vkDestroyEvent(device(), event, nullptr);
+    }
+    for (auto& semaphores : m_frameSemaphores) {
+        for (VkSemaphore semaphore : semaphores)
+            vkDestroySemaphore(device(), semaphore, nullptr);
     }
 
     vkDestroyCommandPool(device(), m_renderGraphFrameCommandPool, nullptr);
     vkDestroyCommandPool(device(), m_transientCommandPool, nullptr);
+    if (m_asyncComputeCommandPool)
+        vkDestroyCommandPool(device(), m_asyncComputeCommandPool, nullptr);
+    for (auto& secondaryCommandPools : m_secondaryCommandPools) {
+        for (SecondaryCommandPool& secondaryCommandPool : secondaryCommandPools)
+            vkDestroyCommandPool(device(), secondaryCommandPool.commandPool, nullptr);
+    }
 
     for (size_t it = 0; it < maxFramesInFlight; ++it) {
         vkDestroySemaphore(device(), m_imageAvailableSemaphores[it], nullptr);
@@ -179,10 +223,16 @@ VulkanBackend::~VulkanBackend()
         vkDestroyFence(device(), m_inFlightFrameFences[it], nullptr);
     }
 
+    destroyFrameQueryPools();
+
+    savePipelineCacheToDisk(m_pipelineCache);
+    vkDestroyPipelineCache(device(), m_pipelineCache, nullptr);
+
     vmaDestroyAllocator(m_memoryAllocator);
 
     vkDestroyDevice(m_device, nullptr);
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    if (!isHeadless())
+        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
 
     if (vulkanDebugMode) {
         debugUtils().vkDestroyDebugUtilsMessengerEXT(m_instance, m_messenger, nullptr);
@@ -261,6 +311,10 @@ bool VulkanBackend::collectAndVerifyCapabilitySupport(App& app)
                 && features.shaderStorageBufferArrayDynamicIndexing && features.shaderUniformBufferArrayDynamicIndexing
                 && indexingFeatures.shaderStorageBufferArrayNonUniformIndexing && indexingFeatures.shaderUniformBufferArrayNonUniformIndexing
                 && indexingFeatures.runtimeDescriptorArray;
+        case Capability::DrawIndirectCount:
+            // (the GPU-driven draws pass the drawable index as the first instance, which is what drawIndirectFirstInstance allows)
+            return hasSupportForExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)
+                && features.multiDrawIndirect && features.drawIndirectFirstInstance;
         }
         ASSERT_NOT_REACHED();
     };
@@ -424,12 +478,15 @@ VkInstance VulkanBackend::createInstance(const std::vector<const char*>& request
     bool includeValidationFeatures = false;
     std::vector<const char*> instanceExtensions;
     {
-        uint32_t requiredCount;
-        const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&requiredCount);
-        for (uint32_t i = 0; i < requiredCount; ++i) {
-            const char* name = requiredExtensions[i];
-            ASSERT(hasSupportForInstanceExtension(name));
-            instanceExtensions.emplace_back(name);
+        // (when headless there is no surface, so no need for any window system integration extensions)
+        if (!isHeadless()) {
+            uint32_t requiredCount;
+            const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&requiredCount);
+            for (uint32_t i = 0; i < requiredCount; ++i) {
+                const char* name = requiredExtensions[i];
+                ASSERT(hasSupportForInstanceExtension(name));
+                instanceExtensions.emplace_back(name);
+            }
         }
 
         // Required for checking support of complex features. It's probably fine to always require it. If it doesn't exist, we deal with it then..
@@ -493,7 +550,7 @@ VkInstance VulkanBackend::createInstance(const std::vector<const char*>& request
 VkDevice VulkanBackend::createDevice(const std::vector<const char*>& requestedLayers, VkPhysicalDevice physicalDevice)
 {
     // TODO: Allow users to specify beforehand that they e.g. might want 2 compute queues.
-    std::unordered_set<uint32_t> queueFamilyIndices = { m_graphicsQueue.familyIndex, m_presentQueue.familyIndex };
+    std::unordered_set<uint32_t> queueFamilyIndices = { m_graphicsQueue.familyIndex, m_presentQueue.familyIndex, m_computeQueue.familyIndex };
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     const float queuePriority = 1.0f;
     for (uint32_t familyIndex : queueFamilyIndices) {
@@ -510,8 +567,10 @@ VkDevice VulkanBackend::createDevice(const std::vector<const char*>& requestedLa
 
     std::vector<const char*> deviceExtensions {};
 
-    ASSERT(hasSupportForExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME));
-    deviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!isHeadless()) {
+        ASSERT(hasSupportForExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME));
+        deviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     VkPhysicalDeviceFeatures features = {};
     VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES };
@@ -524,6 +583,15 @@ VkDevice VulkanBackend::createDevice(const std::vector<const char*>& requestedLa
     features.fragmentStoresAndAtomics = VK_TRUE;
     features.vertexPipelineStoresAndAtomics = VK_TRUE;
 
+    // Optional, for profiling. Inherited queries are needed too since nodes can record into secondary command buffers while a query is active.
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    if (supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries) {
+        features.pipelineStatisticsQuery = VK_TRUE;
+        features.inheritedQueries = VK_TRUE;
+        m_pipelineStatisticsSupported = true;
+    }
+
     for (auto& [capability, active] : m_activeCapabilities) {
         if (!active)
             continue;
@@ -555,6 +623,11 @@ VkDevice VulkanBackend::createDevice(const std::vector<const char*>& requestedLa
             indexingFeatures.shaderUniformBufferArrayNonUniformIndexing = VK_TRUE;
             indexingFeatures.runtimeDescriptorArray = VK_TRUE;
             break;
+        case Capability::DrawIndirectCount:
+            deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            features.multiDrawIndirect = VK_TRUE;
+            features.drawIndirectFirstInstance = VK_TRUE;
+            break;
         default:
             ASSERT_NOT_REACHED();
         }
@@ -605,12 +678,17 @@ void VulkanBackend::findQueueFamilyIndices(VkPhysicalDevice physicalDevice, VkSu
             foundGraphicsQueue = true;
         }
 
-        if (!foundComputeQueue && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
-            m_computeQueue.familyIndex = idx;
-            foundComputeQueue = true;
+        // Prefer a dedicated compute family, which is what gives us an async compute queue that can run alongside the graphics queue
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            bool isDedicated = !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            bool currentIsDedicated = foundComputeQueue && !(queueFamilies[m_computeQueue.familyIndex].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            if (!foundComputeQueue || (isDedicated && !currentIsDedicated)) {
+                m_computeQueue.familyIndex = idx;
+                foundComputeQueue = true;
+            }
         }
 
-        if (!foundPresentQueue) {
+        if (!foundPresentQueue && surface != VK_NULL_HANDLE) {
             VkBool32 presentSupportForQueue;
             vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, idx, surface, &presentSupportForQueue);
             if (presentSupportForQueue) {
@@ -623,6 +701,11 @@ void VulkanBackend::findQueueFamilyIndices(VkPhysicalDevice physicalDevice, VkSu
     if (!foundGraphicsQueue) {
         LogErrorAndExit("VulkanBackend::findQueueFamilyIndices(): could not find a graphics queue, exiting.\n");
     }
+    if (surface == VK_NULL_HANDLE) {
+        // There is nothing to present to without a surface, so just let the present queue be the graphics queue
+        m_presentQueue.familyIndex = m_graphicsQueue.familyIndex;
+        foundPresentQueue = true;
+    }
     if (!foundComputeQueue) {
         LogErrorAndExit("VulkanBackend::findQueueFamilyIndices(): could not find a compute queue, exiting.\n");
     }
@@ -656,6 +739,106 @@ VkPhysicalDevice VulkanBackend::pickBestPhysicalDevice() const
     return physicalDevice;
 }
 
+// NOTE: The driver also validates the header of the cache data itself, but it doesn't consider the driver version, so we keep our own header too
+struct PipelineCacheFileHeader {
+    static constexpr uint32_t expectedMagic = 0x41504348; // "APCH"
+    uint32_t magic;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+};
+
+static PipelineCacheFileHeader pipelineCacheFileHeaderForDevice(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    PipelineCacheFileHeader header {};
+    header.magic = PipelineCacheFileHeader::expectedMagic;
+    header.vendorID = props.vendorID;
+    header.deviceID = props.deviceID;
+    header.driverVersion = props.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+VkPipelineCache VulkanBackend::createAndLoadPipelineCacheFromDisk() const
+{
+    PipelineCacheFileHeader expectedHeader = pipelineCacheFileHeaderForDevice(physicalDevice());
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    pipelineCacheCreateInfo.initialDataSize = 0;
+    pipelineCacheCreateInfo.pInitialData = nullptr;
+
+    std::optional<FileIO::BinaryData> maybeFileData = FileIO::readEntireFileAsByteBuffer(pipelineCacheFilePath);
+    if (maybeFileData.has_value() && maybeFileData->size() >= sizeof(PipelineCacheFileHeader)) {
+        const FileIO::BinaryData& fileData = maybeFileData.value();
+
+        PipelineCacheFileHeader header;
+        std::memcpy(&header, fileData.data(), sizeof(PipelineCacheFileHeader));
+
+        bool headerMatches = header.magic == expectedHeader.magic
+            && header.vendorID == expectedHeader.vendorID
+            && header.deviceID == expectedHeader.deviceID
+            && header.driverVersion == expectedHeader.driverVersion
+            && std::memcmp(header.pipelineCacheUUID, expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+        // (some drivers don't handle truncated cache data well, so never pass on data that isn't exactly what was written)
+        bool sizeMatches = header.dataSize == fileData.size() - sizeof(PipelineCacheFileHeader);
+
+        if (headerMatches && !sizeMatches) {
+            LogWarning("VulkanBackend: ignoring pipeline cache on disk since its size doesn't match its header\n");
+        } else if (headerMatches) {
+            pipelineCacheCreateInfo.initialDataSize = header.dataSize;
+            pipelineCacheCreateInfo.pInitialData = fileData.data() + sizeof(PipelineCacheFileHeader);
+            LogInfo("VulkanBackend: loading pipeline cache from disk (%.2f KB)\n", header.dataSize / 1024.0f);
+        } else {
+            LogInfo("VulkanBackend: ignoring pipeline cache on disk since it's from a different device or driver\n");
+        }
+    }
+
+    VkPipelineCache pipelineCache;
+    if (vkCreatePipelineCache(device(), &pipelineCacheCreateInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanBackend: could not create pipeline cache, exiting.\n");
+    }
+
+    return pipelineCache;
+}
+
+void VulkanBackend::savePipelineCacheToDisk(VkPipelineCache pipelineCache) const
+{
+    size_t dataSize;
+    if (vkGetPipelineCacheData(device(), pipelineCache, &dataSize, nullptr) != VK_SUCCESS) {
+        LogError("VulkanBackend: could not get pipeline cache data size, ignoring.\n");
+        return;
+    }
+
+    PipelineCacheFileHeader header = pipelineCacheFileHeaderForDevice(physicalDevice());
+    header.dataSize = dataSize;
+
+    FileIO::BinaryData fileData(sizeof(PipelineCacheFileHeader) + dataSize);
+    std::memcpy(fileData.data(), &header, sizeof(PipelineCacheFileHeader));
+
+    if (vkGetPipelineCacheData(device(), pipelineCache, &dataSize, fileData.data() + sizeof(PipelineCacheFileHeader)) != VK_SUCCESS) {
+        LogError("VulkanBackend: could not get pipeline cache data, ignoring.\n");
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(pipelineCacheDirectory, error);
+    if (error) {
+        LogError("VulkanBackend: could not create pipeline cache directory '%s', ignoring.\n", pipelineCacheDirectory);
+        return;
+    }
+
+    // (written atomically, so that a crash mid-write can't leave a truncated cache behind)
+    if (!FileIO::writeBinaryDataToFileAtomically(pipelineCacheFilePath, fileData)) {
+        LogError("VulkanBackend: could not write pipeline cache to file '%s', ignoring.\n", pipelineCacheFilePath);
+    }
+}
+
 void VulkanBackend::createSemaphoresAndFences(VkDevice device)
 {
     VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
@@ -689,64 +872,116 @@ void VulkanBackend::createSemaphoresAndFences(VkDevice device)
     }
 }
 
-void VulkanBackend::createAndSetupSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface)
+VkImageLayout VulkanBackend::windowImageFinalLayout() const
 {
-    VkSurfaceCapabilitiesKHR surfaceCapabilities;
-    if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities) != VK_SUCCESS) {
-        LogErrorAndExit("VulkanBackend::createAndSetupSwapchain(): could not get surface capabilities, exiting.\n");
-    }
+    return isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
 
-    VkSwapchainCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
-    createInfo.surface = surface;
+void VulkanBackend::createFrameQueryPools()
+{
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t timestampValidBits = queueFamilies[m_graphicsQueue.familyIndex].timestampValidBits;
+    if (timestampValidBits == 0) {
+        LogWarning("VulkanBackend: the graphics queue doesn't support timestamps, so GPU times won't be available.\n");
+    } else {
+        // Nodes on the async compute queue are only timed if it supports timestamps too, and then both queues use the narrower mask
+        // (which still works as long as no node takes longer than the narrower timestamps take to wrap around, so it's fine)
+        uint32_t asyncComputeTimestampValidBits = queueFamilies[m_computeQueue.familyIndex].timestampValidBits;
+        m_asyncComputeTimestampsSupported = hasAsyncComputeQueue() && asyncComputeTimestampValidBits > 0;
+        if (m_asyncComputeTimestampsSupported)
+            timestampValidBits = std::min(timestampValidBits, asyncComputeTimestampValidBits);
+
+        m_timestampValidBitMask = (timestampValidBits >= 64) ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice(), &props);
+        m_timestampPeriod = props.limits.timestampPeriod;
+    }
+
+    for (FrameQueries& frameQueries : m_frameQueries) {
+        if (timestampValidBits > 0) {
+            VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolCreateInfo.queryCount = 2 + 2 * maxTimedNodesPerFrame;
+            if (vkCreateQueryPool(device(), &queryPoolCreateInfo, nullptr, &frameQueries.timestampPool) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::createFrameQueryPools(): could not create timestamp query pool, exiting.\n");
+            }
+        }
 
-    // Request one more image than required, if possible (see https://github.com/KhronosGroup/Vulkan-Docs/issues/909 for information)
-    createInfo.minImageCount = surfaceCapabilities.minImageCount + 1;
-    if (surfaceCapabilities.minImageCount != 0) {
-        // (max of zero means no upper limit, so don't clamp in that case)
-        createInfo.minImageCount = std::min(createInfo.minImageCount, surfaceCapabilities.maxImageCount);
+        if (m_pipelineStatisticsSupported) {
+            VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            queryPoolCreateInfo.queryCount = maxTimedNodesPerFrame;
+            queryPoolCreateInfo.pipelineStatistics = collectedPipelineStatistics;
+            if (vkCreateQueryPool(device(), &queryPoolCreateInfo, nullptr, &frameQueries.pipelineStatisticsPool) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::createFrameQueryPools(): could not create pipeline statistics query pool, exiting.\n");
+            }
+        }
     }
+}
 
-    VkSurfaceFormatKHR surfaceFormat = pickBestSurfaceFormat();
-    createInfo.imageFormat = surfaceFormat.format;
-    createInfo.imageColorSpace = surfaceFormat.colorSpace;
-
-    VkPresentModeKHR presentMode = pickBestPresentMode();
-    createInfo.presentMode = presentMode;
-
-    VkExtent2D swapchainExtent = pickBestSwapchainExtent();
-    createInfo.imageExtent = swapchainExtent;
-    createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT; // TODO: What do we want here? Maybe this suffices?
-    // TODO: Assure VK_IMAGE_USAGE_STORAGE_BIT is supported using vkGetPhysicalDeviceSurfaceCapabilitiesKHR & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT
-
-    if (vulkanDebugMode) {
-        // for nsight debugging & similar stuff)
-        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+void VulkanBackend::destroyFrameQueryPools()
+{
+    for (FrameQueries& frameQueries : m_frameQueries) {
+        vkDestroyQueryPool(device(), frameQueries.timestampPool, nullptr);
+        vkDestroyQueryPool(device(), frameQueries.pipelineStatisticsPool, nullptr);
+        frameQueries = {};
     }
+}
 
-    uint32_t queueFamilyIndices[] = { m_graphicsQueue.familyIndex, m_presentQueue.familyIndex };
-    if (m_graphicsQueue.familyIndex != m_computeQueue.familyIndex) {
-        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        createInfo.pQueueFamilyIndices = queueFamilyIndices;
-        createInfo.queueFamilyIndexCount = 2;
+void VulkanBackend::reportNodeQueryResults(FrameQueries& frameQueries)
+{
+    uint32_t nodeCount = uint32_t(frameQueries.timedNodes.size());
+    if (nodeCount == 0)
+        return;
+
+    // NOTE: The frame has finished executing, so all results are available and this doesn't wait for anything
+    std::vector<uint64_t> timestamps(2 * nodeCount);
+    VkResult timestampsResult = vkGetQueryPoolResults(device(), frameQueries.timestampPool, 2, 2 * nodeCount,
+                                                      timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (timestampsResult == VK_SUCCESS) {
+        for (uint32_t i = 0; i < nodeCount; ++i) {
+            uint64_t elapsedTicks = (timestamps[2 * i + 1] - timestamps[2 * i]) & m_timestampValidBitMask;
+            frameQueries.timedNodes[i]->reportGpuTime(double(elapsedTicks) * double(m_timestampPeriod) * 1e-9);
+        }
     } else {
-        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        LogError("VulkanBackend::reportNodeQueryResults(): could not get node timestamps.\n");
+    }
+
+    if (frameQueries.hasPipelineStatistics) {
+        // (the values are written in the order of the bits of the statistics flags)
+        static_assert(sizeof(NodeTimer::PipelineStatistics) == 5 * sizeof(uint64_t));
+        std::vector<NodeTimer::PipelineStatistics> statistics(nodeCount);
+        VkResult statisticsResult = vkGetQueryPoolResults(device(), frameQueries.pipelineStatisticsPool, 0, nodeCount,
+                                                          statistics.size() * sizeof(NodeTimer::PipelineStatistics), statistics.data(),
+                                                          sizeof(NodeTimer::PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+        if (statisticsResult == VK_SUCCESS || statisticsResult == VK_NOT_READY) {
+            // (queries of nodes that didn't collect any were never begun, so they are not available, but all other results are still written)
+            for (uint32_t i = 0; i < nodeCount; ++i) {
+                if (frameQueries.timedNodeHasPipelineStatistics[i])
+                    frameQueries.timedNodes[i]->reportPipelineStatistics(statistics[i]);
+            }
+        } else {
+            LogError("VulkanBackend::reportNodeQueryResults(): could not get node pipeline statistics.\n");
+        }
     }
 
-    createInfo.preTransform = surfaceCapabilities.currentTransform;
-    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // opaque swapchain
-    createInfo.clipped = VK_TRUE; // clip pixels obscured by other windows etc.
-
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    frameQueries.timedNodes.clear();
+    frameQueries.timedNodeHasPipelineStatistics.clear();
+}
 
-    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &m_swapchain) != VK_SUCCESS) {
-        LogErrorAndExit("VulkanBackend::createAndSetupSwapchain(): could not create swapchain, exiting.\n");
+void VulkanBackend::createAndSetupSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface)
+{
+    if (isHeadless()) {
+        createOffscreenWindowImages();
+    } else {
+        createSwapchain(physicalDevice, device, surface);
     }
 
-    vkGetSwapchainImagesKHR(device, m_swapchain, &m_numSwapchainImages, nullptr);
-    m_swapchainImages.resize(m_numSwapchainImages);
-    vkGetSwapchainImagesKHR(device, m_swapchain, &m_numSwapchainImages, m_swapchainImages.data());
-
     m_swapchainImageViews.resize(m_numSwapchainImages);
     for (size_t i = 0; i < m_swapchainImages.size(); ++i) {
 
@@ -754,7 +989,7 @@ void VulkanBackend::createAndSetupSwapchain(VkPhysicalDevice physicalDevice, VkD
 
         imageViewCreateInfo.image = m_swapchainImages[i];
         imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        imageViewCreateInfo.format = surfaceFormat.format;
+        imageViewCreateInfo.format = m_swapchainImageFormat;
 
         imageViewCreateInfo.components = {
             .r = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -776,9 +1011,6 @@ void VulkanBackend::createAndSetupSwapchain(VkPhysicalDevice physicalDevice, VkD
         }
     }
 
-    m_swapchainExtent = { swapchainExtent.width, swapchainExtent.height };
-    m_swapchainImageFormat = surfaceFormat.format;
-
     Texture::TextureDescription depthDesc {
         .type = Texture::Type::Texture2D,
         .arrayCount = 1u,
@@ -813,6 +1045,119 @@ void VulkanBackend::createAndSetupSwapchain(VkPhysicalDevice physicalDevice, VkD
             LogErrorAndExit("VulkanBackend::createAndSetupSwapchain(): could not create the main command buffers, exiting.\n");
         }
     }
+
+    // Create pools for secondary command buffers, one per swapchain image and recording thread (unless we already have them from before).
+    // The recording threads are the command recording pool's workers plus the thread that records the frame, which helps out.
+    for (size_t imageIdx = m_secondaryCommandPools.size(); imageIdx < m_numSwapchainImages; ++imageIdx) {
+        auto& secondaryCommandPools = m_secondaryCommandPools.emplace_back(ThreadPool::commandRecording().threadCount() + 1);
+        for (SecondaryCommandPool& secondaryCommandPool : secondaryCommandPools) {
+            VkCommandPoolCreateInfo poolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+            poolCreateInfo.queueFamilyIndex = m_graphicsQueue.familyIndex;
+            poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // (the whole pool is reset each frame)
+            if (vkCreateCommandPool(device, &poolCreateInfo, nullptr, &secondaryCommandPool.commandPool) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::createAndSetupSwapchain(): could not create secondary command pool, exiting.\n");
+            }
+        }
+    }
+
+    // (command buffers for any further submissions are allocated as they are needed, see drawFrame)
+    m_frameSubmissions.resize(m_numSwapchainImages);
+    m_submissionCommandBuffers.resize(std::max(m_submissionCommandBuffers.size(), size_t(m_numSwapchainImages)));
+}
+
+void VulkanBackend::createSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface)
+{
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanBackend::createSwapchain(): could not get surface capabilities, exiting.\n");
+    }
+
+    VkSwapchainCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+    createInfo.surface = surface;
+
+    // Request one more image than required, if possible (see https://github.com/KhronosGroup/Vulkan-Docs/issues/909 for information)
+    createInfo.minImageCount = surfaceCapabilities.minImageCount + 1;
+    if (surfaceCapabilities.minImageCount != 0) {
+        // (max of zero means no upper limit, so don't clamp in that case)
+        createInfo.minImageCount = std::min(createInfo.minImageCount, surfaceCapabilities.maxImageCount);
+    }
+
+    VkSurfaceFormatKHR surfaceFormat = pickBestSurfaceFormat();
+    createInfo.imageFormat = surfaceFormat.format;
+    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+
+    VkPresentModeKHR presentMode = pickBestPresentMode();
+    createInfo.presentMode = presentMode;
+
+    VkExtent2D swapchainExtent = pickBestSwapchainExtent();
+    createInfo.imageExtent = swapchainExtent;
+    createInfo.imageArrayLayers = 1;
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT; // TODO: What do we want here? Maybe this suffices?
+    // TODO: Assure VK_IMAGE_USAGE_STORAGE_BIT is supported using vkGetPhysicalDeviceSurfaceCapabilitiesKHR & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT
+
+    if (vulkanDebugMode) {
+        // for nsight debugging & similar stuff)
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
+    // (the window image is only ever accessed on the graphics queue, never on the async compute queue)
+    uint32_t queueFamilyIndices[] = { m_graphicsQueue.familyIndex, m_presentQueue.familyIndex };
+    if (m_graphicsQueue.familyIndex != m_presentQueue.familyIndex) {
+        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        createInfo.pQueueFamilyIndices = queueFamilyIndices;
+        createInfo.queueFamilyIndexCount = 2;
+    } else {
+        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    createInfo.preTransform = surfaceCapabilities.currentTransform;
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // opaque swapchain
+    createInfo.clipped = VK_TRUE; // clip pixels obscured by other windows etc.
+
+    createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &m_swapchain) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanBackend::createSwapchain(): could not create swapchain, exiting.\n");
+    }
+
+    vkGetSwapchainImagesKHR(device, m_swapchain, &m_numSwapchainImages, nullptr);
+    m_swapchainImages.resize(m_numSwapchainImages);
+    vkGetSwapchainImagesKHR(device, m_swapchain, &m_numSwapchainImages, m_swapchainImages.data());
+
+    m_swapchainExtent = { swapchainExtent.width, swapchainExtent.height };
+    m_swapchainImageFormat = surfaceFormat.format;
+}
+
+void VulkanBackend::createOffscreenWindowImages()
+{
+    // Without a surface we render into regular images instead, one per frame in flight. They need the same usage as swapchain images, plus
+    // being transfer sources so that they can be read back.
+    m_numSwapchainImages = maxFramesInFlight;
+    m_swapchainExtent = GlobalState::get().windowExtent();
+    m_swapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = m_swapchainImageFormat;
+    imageCreateInfo.extent = { .width = m_swapchainExtent.width(), .height = m_swapchainExtent.height(), .depth = 1 };
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    m_swapchainImages.resize(m_numSwapchainImages);
+    m_offscreenWindowImageAllocations.resize(m_numSwapchainImages);
+    for (size_t i = 0; i < m_numSwapchainImages; ++i) {
+        if (vmaCreateImage(m_memoryAllocator, &imageCreateInfo, &allocCreateInfo, &m_swapchainImages[i], &m_offscreenWindowImageAllocations[i], nullptr) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanBackend::createOffscreenWindowImages(): could not create offscreen window image %u, exiting.\n", i);
+        }
+    }
 }
 
 void VulkanBackend::destroySwapchain()
@@ -832,7 +1177,13 @@ void VulkanBackend::destroySwapchain()
         vkDestroyImageView(device(), m_swapchainImageViews[it], nullptr);
     }
 
-    vkDestroySwapchainKHR(device(), m_swapchain, nullptr);
+    if (isHeadless()) {
+        for (size_t it = 0; it < m_numSwapchainImages; ++it) {
+            vmaDestroyImage(m_memoryAllocator, m_swapchainImages[it], m_offscreenWindowImageAllocations[it]);
+        }
+    } else {
+        vkDestroySwapchainKHR(device(), m_swapchain, nullptr);
+    }
 }
 
 Extent2D VulkanBackend::recreateSwapchain()
@@ -904,7 +1255,7 @@ void VulkanBackend::createWindowRenderTargetFrontend()
             renderTarget->compatibleRenderPass = m_swapchainRenderPass;
             renderTarget->framebuffer = m_swapchainFramebuffers[i];
             renderTarget->attachedTextures = {
-                { m_swapchainMockColorTextures[i].get(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR }, // this (layout) is important so that we know that we don't need to do an explicit transition before presenting
+                { m_swapchainMockColorTextures[i].get(), windowImageFinalLayout() }, // this (layout) is important so that we know that we don't need to do an explicit transition before presenting
                 { m_swapchainDepthTexture.get(), VK_IMAGE_LAYOUT_UNDEFINED } // (this (layout) probably doesn't matter for the depth image)
             };
         }
@@ -921,6 +1272,15 @@ void VulkanBackend::setupDearImgui()
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     //ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
 
+    if (isHeadless()) {
+        // The GUI is never drawn when headless, but the GUI code still runs each frame (as it's part of the cost of a frame), which
+        // requires a built font atlas. The display size & delta time are set manually in drawFrame.
+        unsigned char* fontPixels;
+        int fontWidth, fontHeight;
+        ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&fontPixels, &fontWidth, &fontHeight);
+        return;
+    }
+
     //
 
     ImGui_ImplGlfw_InitForVulkan(m_window, true);
@@ -1019,7 +1379,7 @@ void VulkanBackend::setupDearImgui()
     initInfo.ImageCount = m_numSwapchainImages;
 
     initInfo.DescriptorPool = m_guiDescriptorPool;
-    initInfo.PipelineCache = VK_NULL_HANDLE;
+    initInfo.PipelineCache = m_pipelineCache;
 
     ImGui_ImplVulkan_Init(&initInfo, m_guiRenderPass);
 
@@ -1037,6 +1397,11 @@ void VulkanBackend::setupDearImgui()
 
 void VulkanBackend::destroyDearImgui()
 {
+    if (isHeadless()) {
+        ImGui::DestroyContext();
+        return;
+    }
+
     vkDestroyDescriptorPool(device(), m_guiDescriptorPool, nullptr);
     vkDestroyRenderPass(device(), m_guiRenderPass, nullptr);
     for (VkFramebuffer framebuffer : m_guiFramebuffers) {
@@ -1095,17 +1460,46 @@ void VulkanBackend::renderDearImguiFrame(VkCommandBuffer commandBuffer, uint32_t
 
 bool VulkanBackend::executeFrame(double elapsedTime, double deltaTime)
 {
+    SCOPED_PROFILE_ZONE("Execute frame");
+
     uint32_t currentFrameMod = m_currentFrameIndex % maxFramesInFlight;
 
-    if (vkWaitForFences(device(), 1, &m_inFlightFrameFences[currentFrameMod], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
-        LogError("VulkanBackend::executeFrame(): error while waiting for in-flight frame fence (frame %u).\n", m_currentFrameIndex);
+    {
+        SCOPED_PROFILE_ZONE("Wait for frame fence");
+        if (vkWaitForFences(device(), 1, &m_inFlightFrameFences[currentFrameMod], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+            LogError("VulkanBackend::executeFrame(): error while waiting for in-flight frame fence (frame %u).\n", m_currentFrameIndex);
+        }
     }
 
+    reportNodeQueryResults(m_frameQueries[currentFrameMod]);
+
     bool isRelativeFirstFrame = m_currentFrameIndex == (m_lastSwapchainRecreationFrameIndex + 1);
     AppState appState { m_swapchainExtent, deltaTime, elapsedTime, m_currentFrameIndex, isRelativeFirstFrame };
 
+    if (isHeadless()) {
+        // There is one offscreen window image per frame in flight, so the one for this frame is free to use now that we've waited for its fence
+        uint32_t windowImageIndex = currentFrameMod;
+
+        VulkanTexture& currentColorTexture = *m_swapchainMockColorTextures[windowImageIndex];
+        currentColorTexture.currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        m_swapchainDepthTexture->currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        drawFrame(appState, elapsedTime, deltaTime, windowImageIndex);
+
+        SCOPED_PROFILE_ZONE("Submit");
+        m_textureStreamer->submitPendingUploads();
+        submitQueue(windowImageIndex, nullptr, nullptr, &m_inFlightFrameFences[currentFrameMod]);
+
+        m_currentFrameIndex += 1;
+        return true;
+    }
+
     uint32_t swapchainImageIndex;
-    VkResult acquireResult = vkAcquireNextImageKHR(device(), m_swapchain, UINT64_MAX, m_imageAvailableSemaphores[currentFrameMod], VK_NULL_HANDLE, &swapchainImageIndex);
+    VkResult acquireResult;
+    {
+        SCOPED_PROFILE_ZONE("Acquire swapchain image");
+        acquireResult = vkAcquireNextImageKHR(device(), m_swapchain, UINT64_MAX, m_imageAvailableSemaphores[currentFrameMod], VK_NULL_HANDLE, &swapchainImageIndex);
+    }
 
     if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
         // Since we couldn't acquire an image to draw to, recreate the swapchain and report that it didn't work
@@ -1130,10 +1524,19 @@ bool VulkanBackend::executeFrame(double elapsedTime, double deltaTime)
 
     drawFrame(appState, elapsedTime, deltaTime, swapchainImageIndex);
 
-    submitQueue(swapchainImageIndex, &m_imageAvailableSemaphores[currentFrameMod], &m_renderFinishedSemaphores[currentFrameMod], &m_inFlightFrameFences[currentFrameMod]);
+    {
+        SCOPED_PROFILE_ZONE("Submit");
+
+        // Submitted ahead of the frame on the same queue, so any texture data uploaded (or placeholder written) is visible to it
+        m_textureStreamer->submitPendingUploads();
+
+        submitQueue(swapchainImageIndex, &m_imageAvailableSemaphores[currentFrameMod], &m_renderFinishedSemaphores[currentFrameMod], &m_inFlightFrameFences[currentFrameMod]);
+    }
 
     // Present results (synced on the semaphores)
     {
+        SCOPED_PROFILE_ZONE("Present");
+
         VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
 
         presentInfo.waitSemaphoreCount = 1;
@@ -1157,15 +1560,90 @@ bool VulkanBackend::executeFrame(double elapsedTime, double deltaTime)
     return true;
 }
 
+std::optional<double> VulkanBackend::waitForFrameCompletion()
+{
+    if (m_currentFrameIndex == 0)
+        return {};
+
+    uint32_t lastFrameMod = (m_currentFrameIndex - 1) % maxFramesInFlight;
+    if (vkWaitForFences(device(), 1, &m_inFlightFrameFences[lastFrameMod], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+        LogError("VulkanBackend::waitForFrameCompletion(): error while waiting for in-flight frame fence (frame %u).\n", m_currentFrameIndex - 1);
+        return {};
+    }
+
+    VkQueryPool timestampPool = m_frameQueries[lastFrameMod].timestampPool;
+    if (!timestampPool)
+        return {};
+
+    uint64_t timestamps[2];
+    VkResult queryResult = vkGetQueryPoolResults(device(), timestampPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (queryResult != VK_SUCCESS) {
+        LogError("VulkanBackend::waitForFrameCompletion(): could not get frame timestamps (frame %u).\n", m_currentFrameIndex - 1);
+        return {};
+    }
+
+    uint64_t elapsedTicks = (timestamps[1] - timestamps[0]) & m_timestampValidBitMask;
+    return double(elapsedTicks) * double(m_timestampPeriod) * 1e-9;
+}
+
+bool VulkanBackend::saveFrameImageToFile(const std::string& filePath)
+{
+    if (!isHeadless()) {
+        LogError("VulkanBackend::saveFrameImageToFile(): can only save frame images when headless, ignoring.\n");
+        return false;
+    }
+
+    if (m_currentFrameIndex == 0)
+        return false;
+
+    waitForFrameCompletion();
+
+    // (saving the texture doesn't record anything into the command list's command buffer, it's issued as a single-time command)
+    uint32_t windowImageIndex = (m_currentFrameIndex - 1) % maxFramesInFlight;
+    VulkanCommandList cmdList { *this, VK_NULL_HANDLE };
+    cmdList.saveTextureToFile(*m_swapchainMockColorTextures[windowImageIndex], filePath);
+
+    return true;
+}
+
+VkCommandBuffer VulkanBackend::nextSecondaryCommandBuffer(SecondaryCommandPool& secondaryCommandPool)
+{
+    if (secondaryCommandPool.nextFreeCommandBuffer == secondaryCommandPool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        commandBufferAllocateInfo.commandPool = secondaryCommandPool.commandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device(), &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanBackend::nextSecondaryCommandBuffer(): could not allocate secondary command buffer, exiting.\n");
+        }
+        secondaryCommandPool.commandBuffers.push_back(commandBuffer);
+    }
+
+    return secondaryCommandPool.commandBuffers[secondaryCommandPool.nextFreeCommandBuffer++];
+}
+
 void VulkanBackend::drawFrame(const AppState& appState, double elapsedTime, double deltaTime, uint32_t swapchainImageIndex)
 {
+    SCOPED_PROFILE_ZONE("Draw frame");
     ASSERT(m_renderGraph);
 
-    ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (isHeadless()) {
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(float(m_swapchainExtent.width()), float(m_swapchainExtent.height()));
+        io.DeltaTime = std::max(float(deltaTime), 1e-6f); // (must be positive)
+    } else {
+        ImGui_ImplVulkan_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+    }
     ImGui::NewFrame();
 
-    m_app.update(float(elapsedTime), float(deltaTime));
+    {
+        SCOPED_PROFILE_ZONE("Update app");
+        m_app.update(float(elapsedTime), float(deltaTime));
+        m_app.scene().updateTransforms();
+    }
 
     VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     commandBufferBeginInfo.flags = 0u;
@@ -1176,31 +1654,197 @@ void VulkanBackend::drawFrame(const AppState& appState, double elapsedTime, doub
         LogError("VulkanBackend::executeRenderGraph(): error beginning command buffer command!\n");
     }
 
+    // (any results from the last use of these queries have already been reported, after waiting for the frame fence)
+    FrameQueries& frameQueries = m_frameQueries[m_currentFrameIndex % maxFramesInFlight];
+    ASSERT(frameQueries.timedNodes.empty());
+    frameQueries.hasPipelineStatistics = m_collectPipelineStatistics && frameQueries.pipelineStatisticsPool;
+    if (frameQueries.timestampPool) {
+        vkCmdResetQueryPool(commandBuffer, frameQueries.timestampPool, 0, 2 + 2 * maxTimedNodesPerFrame);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frameQueries.timestampPool, 0);
+    }
+    if (frameQueries.hasPipelineStatistics) {
+        vkCmdResetQueryPool(commandBuffer, frameQueries.pipelineStatisticsPool, 0, maxTimedNodesPerFrame);
+    }
+
+    // Secondary command buffers are recorded from scratch each frame, so recycle all of them at once
+    std::vector<SecondaryCommandPool>& secondaryCommandPools = m_secondaryCommandPools[swapchainImageIndex];
+    for (SecondaryCommandPool& secondaryCommandPool : secondaryCommandPools) {
+        if (vkResetCommandPool(device(), secondaryCommandPool.commandPool, 0u) != VK_SUCCESS) {
+            LogError("VulkanBackend::executeRenderGraph(): error resetting secondary command pool!\n");
+        }
+        secondaryCommandPool.nextFreeCommandBuffer = 0;
+    }
+
     Registry& associatedRegistry = *m_frameRegistries[swapchainImageIndex];
-    VulkanCommandList cmdList { *this, commandBuffer };
+    const TransientMemory& transientMemory = m_frameTransientMemory[swapchainImageIndex];
+    const RenderGraph::FrameQueueSynchronization& queueSynchronization = m_renderGraph->frameQueueSynchronization(associatedRegistry);
+    const std::vector<VkSemaphore>& frameSemaphores = m_frameSemaphores[swapchainImageIndex];
+
+    for (VulkanTexture* texture : transientMemory.asyncComputeTextures)
+        texture->currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // The frame begins with the frame command buffer as its only submission, which is also the only one unless any nodes run on the async
+    // compute queue. The command buffer being recorded for each queue is null while there is no open submission on it.
+    std::vector<FrameSubmission>& submissions = m_frameSubmissions[swapchainImageIndex];
+    submissions.clear();
+    submissions.push_back({ .commandBuffer = commandBuffer, .asyncCompute = false });
+    VkCommandBuffer asyncComputeCommandBuffer = VK_NULL_HANDLE;
+
+    SubmissionCommandBuffers& submissionCommandBuffers = m_submissionCommandBuffers[swapchainImageIndex];
+    size_t usedGraphicsCommandBuffers = 0;
+    size_t usedAsyncComputeCommandBuffers = 0;
+
+    auto endSubmission = [&](bool asyncCompute, VkSemaphore signalSemaphore) {
+        VkCommandBuffer& currentCommandBuffer = asyncCompute ? asyncComputeCommandBuffer : commandBuffer;
+        ASSERT(currentCommandBuffer != VK_NULL_HANDLE);
+        if (vkEndCommandBuffer(currentCommandBuffer) != VK_SUCCESS) {
+            LogError("VulkanBackend::executeRenderGraph(): error ending command buffer command!\n");
+        }
+
+        // (the last submission on the queue is the open one)
+        auto submission = std::find_if(submissions.rbegin(), submissions.rend(), [&](const FrameSubmission& candidate) {
+            return candidate.asyncCompute == asyncCompute;
+        });
+        submission->signalSemaphore = signalSemaphore;
+
+        currentCommandBuffer = VK_NULL_HANDLE;
+    };
+
+    auto beginSubmission = [&](bool asyncCompute, VkSemaphore waitSemaphore) {
+        VkCommandBuffer& currentCommandBuffer = asyncCompute ? asyncComputeCommandBuffer : commandBuffer;
+        if (currentCommandBuffer != VK_NULL_HANDLE)
+            endSubmission(asyncCompute, VK_NULL_HANDLE);
+
+        std::vector<VkCommandBuffer>& commandBuffers = asyncCompute ? submissionCommandBuffers.asyncCompute : submissionCommandBuffers.graphics;
+        size_t& usedCommandBuffers = asyncCompute ? usedAsyncComputeCommandBuffers : usedGraphicsCommandBuffers;
+        if (usedCommandBuffers == commandBuffers.size()) {
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+            commandBufferAllocateInfo.commandPool = asyncCompute ? m_asyncComputeCommandPool : m_renderGraphFrameCommandPool;
+            commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            commandBufferAllocateInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(device(), &commandBufferAllocateInfo, &commandBuffers.emplace_back()) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::executeRenderGraph(): could not allocate command buffer for submission, exiting.\n");
+            }
+        }
+
+        currentCommandBuffer = commandBuffers[usedCommandBuffers++];
+        if (vkBeginCommandBuffer(currentCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+            LogError("VulkanBackend::executeRenderGraph(): error beginning command buffer command!\n");
+        }
+
+        submissions.push_back({ .commandBuffer = currentCommandBuffer, .asyncCompute = asyncCompute, .waitSemaphore = waitSemaphore });
+    };
+
+    // Resources that are first accessed on the async compute queue are released as soon as the frame starts, which the first node on that
+    // queue waits for (unless it waits for a later node), as it also has to come after the query resets above
+    VulkanCommandList { *this, commandBuffer }.releaseQueueOwnership(queueSynchronization.releasesAtStart, false, {});
+    if (queueSynchronization.signalSemaphoreAtStart.has_value())
+        endSubmission(false, frameSemaphores[queueSynchronization.signalSemaphoreAtStart.value()]);
+
+    uint32_t nodeIndex = 0;
 
     ImGui::Begin("Nodes (in order)");
-    m_renderGraph->forEachNodeInResolvedOrder(associatedRegistry, [&](const std::string& nodeName, NodeTimer& nodeTimer, const RenderGraphNode::ExecuteCallback& nodeExecuteCallback) {
+    if (m_pipelineStatisticsSupported) {
+        ImGui::Checkbox("Collect pipeline statistics", &m_collectPipelineStatistics);
+    }
+    const std::vector<VkEvent>& frameEvents = m_frameEvents[swapchainImageIndex];
+
+    m_renderGraph->forEachNodeInResolvedOrder(associatedRegistry, [&](const std::string& nodeName, const char* profileZoneName, NodeTimer& nodeTimer, const RenderGraph::NodeSynchronization& nodeSynchronization, const RenderGraphNode::ExecuteCallback& nodeExecuteCallback) {
+        // Aliased transient textures have undefined contents at the start of their lifetime, since other textures share their memory
+        if (nodeIndex < transientMemory.texturesBeginningInNode.size()) {
+            for (VulkanTexture* texture : transientMemory.texturesBeginningInNode[nodeIndex])
+                texture->currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+        bool reusesAliasedMemory = nodeIndex < transientMemory.aliasingBeginsInNode.size() && transientMemory.aliasingBeginsInNode[nodeIndex];
+        nodeIndex += 1;
+
         double cpuTime = nodeTimer.averageCpuTime() * 1000.0;
-        std::string title = isnan(cpuTime)
-            ? fmt::format("{} | CPU: - ms", nodeName)
-            : fmt::format("{} | CPU: {:.2f} ms", nodeName, cpuTime);
-        ImGui::CollapsingHeader(title.c_str(), ImGuiTreeNodeFlags_Leaf);
+        double gpuTime = nodeTimer.averageGpuTime() * 1000.0;
+        std::string title = fmt::format("{} | CPU: {} ms | GPU: {} ms", nodeName,
+                                        isnan(cpuTime) ? "-" : fmt::format("{:.2f}", cpuTime),
+                                        isnan(gpuTime) ? "-" : fmt::format("{:.2f}", gpuTime));
+
+        const auto& pipelineStatistics = nodeTimer.lastPipelineStatistics();
+        bool showPipelineStatistics = m_collectPipelineStatistics && pipelineStatistics.has_value();
+        if (ImGui::CollapsingHeader(title.c_str(), showPipelineStatistics ? 0 : ImGuiTreeNodeFlags_Leaf) && showPipelineStatistics) {
+            ImGui::Text("Input assembly primitives: %llu", (unsigned long long)pipelineStatistics->inputAssemblyPrimitives);
+            ImGui::Text("Vertex shader invocations: %llu", (unsigned long long)pipelineStatistics->vertexShaderInvocations);
+            ImGui::Text("Clipping primitives: %llu", (unsigned long long)pipelineStatistics->clippingPrimitives);
+            ImGui::Text("Fragment shader invocations: %llu", (unsigned long long)pipelineStatistics->fragmentShaderInvocations);
+            ImGui::Text("Compute shader invocations: %llu", (unsigned long long)pipelineStatistics->computeShaderInvocations);
+        }
+
+        bool asyncCompute = nodeSynchronization.asyncCompute;
+        VkCommandBuffer& nodeCommandBuffer = asyncCompute ? asyncComputeCommandBuffer : commandBuffer;
+        if (nodeSynchronization.waitSemaphore.has_value())
+            beginSubmission(asyncCompute, frameSemaphores[nodeSynchronization.waitSemaphore.value()]);
+        else if (nodeCommandBuffer == VK_NULL_HANDLE)
+            beginSubmission(asyncCompute, VK_NULL_HANDLE);
+
+        // Both node timestamps are written at the bottom of the pipe, i.e. once all previous work is done, so that the GPU times of
+        // consecutive nodes don't overlap and add up to the frame time (minus the GUI). Nodes that are too many to fit are left untimed.
+        // Nodes on the async compute queue overlap the graphics nodes, so their times are only for themselves, and they never collect
+        // pipeline statistics, as those queries are only for the graphics queue.
+        uint32_t timedNodeIndex = uint32_t(frameQueries.timedNodes.size());
+        bool timeNode = frameQueries.timestampPool && timedNodeIndex < maxTimedNodesPerFrame && (!asyncCompute || m_asyncComputeTimestampsSupported);
+        bool collectPipelineStatistics = frameQueries.hasPipelineStatistics && !asyncCompute;
+        if (timeNode) {
+            frameQueries.timedNodes.push_back(&nodeTimer);
+            frameQueries.timedNodeHasPipelineStatistics.push_back(collectPipelineStatistics);
+            vkCmdWriteTimestamp(nodeCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameQueries.timestampPool, 2 + 2 * timedNodeIndex);
+            if (collectPipelineStatistics) {
+                vkCmdBeginQuery(nodeCommandBuffer, frameQueries.pipelineStatisticsPool, timedNodeIndex, 0);
+                m_activePipelineStatistics = collectedPipelineStatistics;
+            }
+        }
+
+        auto cpuStartTime = std::chrono::steady_clock::now();
+
+        {
+            SCOPED_PROFILE_ZONE(profileZoneName);
+            // (secondary command buffers are only for rendering, which nodes on the async compute queue don't do)
+            VulkanCommandList cmdList { *this, nodeCommandBuffer, asyncCompute ? nullptr : &secondaryCommandPools };
+            cmdList.beginDebugLabel(nodeName);
+            cmdList.beginNode(nodeSynchronization, frameEvents, reusesAliasedMemory, {});
+            nodeExecuteCallback(appState, cmdList);
+            cmdList.endNode(nodeSynchronization, frameEvents, {});
+            cmdList.endDebugLabel();
+        }
 
-        double cpuStartTime = glfwGetTime();
+        std::chrono::duration<double> cpuElapsed = std::chrono::steady_clock::now() - cpuStartTime;
+        nodeTimer.reportCpuTime(cpuElapsed.count());
 
-        cmdList.beginDebugLabel(nodeName);
-        nodeExecuteCallback(appState, cmdList);
-        cmdList.endNode({});
-        cmdList.endDebugLabel();
+        if (timeNode) {
+            if (collectPipelineStatistics) {
+                vkCmdEndQuery(nodeCommandBuffer, frameQueries.pipelineStatisticsPool, timedNodeIndex);
+                m_activePipelineStatistics = 0;
+            }
+            vkCmdWriteTimestamp(nodeCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameQueries.timestampPool, 2 + 2 * timedNodeIndex + 1);
+        }
 
-        double cpuElapsed = glfwGetTime() - cpuStartTime;
-        nodeTimer.reportCpuTime(cpuElapsed);
+        if (nodeSynchronization.signalSemaphore.has_value())
+            endSubmission(asyncCompute, frameSemaphores[nodeSynchronization.signalSemaphore.value()]);
     });
     ImGui::End();
 
+    // The rest of the frame is on the graphics queue, which takes back all resources from the async compute queue once it's done
+    if (queueSynchronization.waitSemaphoreAtEnd.has_value())
+        beginSubmission(false, frameSemaphores[queueSynchronization.waitSemaphoreAtEnd.value()]);
+    else if (commandBuffer == VK_NULL_HANDLE)
+        beginSubmission(false, VK_NULL_HANDLE);
+    ASSERT(asyncComputeCommandBuffer == VK_NULL_HANDLE);
+
+    VulkanCommandList cmdList { *this, commandBuffer, &secondaryCommandPools };
+    cmdList.acquireQueueOwnership(queueSynchronization.acquiresAtEnd, false, {});
+
+    // The nodes only synchronize with each other, so wait for all of them before the GUI & the next frame. This is also what keeps the
+    // frame registry resources (and the shared window depth texture) safe to use again when a later frame uses the same ones.
+    cmdList.debugBarrier();
+
     cmdList.beginDebugLabel("GUI");
     {
+        SCOPED_PROFILE_ZONE("GUI");
+
         static ImGuizmo::OPERATION operation = ImGuizmo::TRANSLATE;
 
         auto& input = Input::instance();
@@ -1234,20 +1878,25 @@ void VulkanBackend::drawFrame(const AppState& appState, double elapsedTime, doub
         }
 
         ImGui::Render();
-        renderDearImguiFrame(commandBuffer, swapchainImageIndex);
+        if (!isHeadless())
+            renderDearImguiFrame(commandBuffer, swapchainImageIndex);
         ImGui::UpdatePlatformWindows();
     }
     cmdList.endDebugLabel();
 
-    // Explicitly transfer the swapchain image to a present layout if not already
+    // Explicitly transfer the swapchain image to a present layout (or the readback layout, if headless) if not already
     // In most cases it should always be, but with nsight it seems to do weird things.
     VulkanTexture& swapchainTexture = *m_swapchainMockColorTextures[swapchainImageIndex];
-    if (swapchainTexture.currentLayout != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
-        transitionImageLayout(swapchainTexture.image, false, swapchainTexture.currentLayout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &commandBuffer);
+    if (swapchainTexture.currentLayout != windowImageFinalLayout()) {
+        transitionImageLayout(swapchainTexture.image, false, swapchainTexture.currentLayout, windowImageFinalLayout(), &commandBuffer);
         LogInfo("VulkanBackend::executeRenderGraph(): performing explicit swapchain layout transition. "
                 "This should only happen if we don't render to the window and don't draw any GUI.\n");
     }
 
+    if (frameQueries.timestampPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameQueries.timestampPool, 1);
+    }
+
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         LogError("VulkanBackend::executeRenderGraph(): error ending command buffer command!\n");
     }
@@ -1267,7 +1916,7 @@ void VulkanBackend::setupWindowRenderTargets()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = windowImageFinalLayout();
 
     VkAttachmentDescription depthAttachment = {};
     depthAttachment.format = m_swapchainDepthTexture->vkFormat;
@@ -1351,6 +2000,9 @@ void VulkanBackend::reconstructRenderGraphResources(RenderGraph& renderGraph)
 {
     uint32_t numFrameManagers = m_numSwapchainImages;
 
+    // All descriptor sets of the new node & frame registries are transient, since they're all replaced together on the next reconstruction
+    auto descriptorScope = m_descriptorAllocator->beginTransientScope();
+
     // Create new resource managers
     auto nodeRegistry = std::make_unique<Registry>(*this);
     std::vector<std::unique_ptr<Registry>> frameRegistries {};
@@ -1366,7 +2018,38 @@ void VulkanBackend::reconstructRenderGraphResources(RenderGraph& renderGraph)
         regPointers.emplace_back(mng.get());
     }
 
-    renderGraph.constructAll(*nodeRegistry, regPointers);
+    renderGraph.constructAll(*nodeRegistry, regPointers, hasAsyncComputeQueue());
+
+    std::vector<TransientMemory> frameTransientMemory {};
+    for (auto& frameRegistry : frameRegistries) {
+        frameTransientMemory.push_back(aliasTransientResources(renderGraph, *frameRegistry));
+    }
+
+    // (events are created unsignaled, which is the state the frames expect them to be in when they start)
+    std::vector<std::vector<VkEvent>> frameEvents {};
+    for (auto& frameRegistry : frameRegistries) {
+        std::vector<VkEvent>& events = frameEvents.emplace_back(renderGraph.eventCount(*frameRegistry));
+        VkEventCreateInfo eventCreateInfo = { VK_STRUCTURE_TYPE_EVENT_CREATE_INFO };
+        for (VkEvent& event : events) {
+            if (vkCreateEvent(device(), &eventCreateInfo, nullptr, &event) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::reconstructRenderGraphResources(): could not create event, exiting.\n");
+            }
+        }
+    }
+
+    // (and since each semaphore is signaled & waited on once per frame they are also unsignaled whenever a frame starts)
+    std::vector<std::vector<VkSemaphore>> frameSemaphores {};
+    for (auto& frameRegistry : frameRegistries) {
+        std::vector<VkSemaphore>& semaphores = frameSemaphores.emplace_back(renderGraph.semaphoreCount(*frameRegistry));
+        VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        for (VkSemaphore& semaphore : semaphores) {
+            if (vkCreateSemaphore(device(), &semaphoreCreateInfo, nullptr, &semaphore) != VK_SUCCESS) {
+                LogErrorAndExit("VulkanBackend::reconstructRenderGraphResources(): could not create semaphore, exiting.\n");
+            }
+        }
+    }
+
+    m_descriptorAllocator->endTransientScope();
 
     // First create & replace node resources
     //replaceResourcesForRegistry(m_nodeRegistry.get(), nodeRegistry.get());
@@ -1378,6 +2061,182 @@ void VulkanBackend::reconstructRenderGraphResources(RenderGraph& renderGraph)
         //replaceResourcesForRegistry(m_frameRegistries[i].get(), frameRegistries[i].get());
         m_frameRegistries[i] = std::move(frameRegistries[i]);
     }
+
+    // (only free the old transient memory now that all resources bound to it are destroyed)
+    for (TransientMemory& transientMemory : m_frameTransientMemory)
+        freeTransientMemory(transientMemory);
+    m_frameTransientMemory = std::move(frameTransientMemory);
+
+    for (auto& events : m_frameEvents) {
+        for (VkEvent event : events)
+            vkDestroyEvent(device(), event, nullptr);
+    }
+    m_frameEvents = std::move(frameEvents);
+
+    for (auto& semaphores : m_frameSemaphores) {
+        for (VkSemaphore semaphore : semaphores)
+            vkDestroySemaphore(device(), semaphore, nullptr);
+    }
+    m_frameSemaphores = std::move(frameSemaphores);
+
+    // (and the same goes for the descriptor sets of the old registries)
+    if (m_graphDescriptorScope.has_value())
+        m_descriptorAllocator->releaseTransientScope(m_graphDescriptorScope.value());
+    m_graphDescriptorScope = descriptorScope;
+}
+
+VulkanBackend::TransientMemory VulkanBackend::aliasTransientResources(const RenderGraph& renderGraph, Registry& frameRegistry)
+{
+    struct AliasingCandidate {
+        RenderGraph::TransientResourceLifetime lifetime;
+        VkMemoryRequirements memoryRequirements;
+        VulkanTexture* texture { nullptr };
+        VulkanBuffer* buffer { nullptr };
+    };
+
+    std::vector<AliasingCandidate> candidates {};
+    for (auto& lifetime : renderGraph.transientResourceLifetimes(frameRegistry)) {
+        AliasingCandidate candidate { .lifetime = lifetime };
+        if (auto* texture = dynamic_cast<VulkanTexture*>(lifetime.resource)) {
+            vkGetImageMemoryRequirements(device(), texture->image, &candidate.memoryRequirements);
+            candidate.texture = texture;
+        } else if (auto* buffer = dynamic_cast<VulkanBuffer*>(lifetime.resource)) {
+            vkGetBufferMemoryRequirements(device(), buffer->buffer, &candidate.memoryRequirements);
+            candidate.buffer = buffer;
+        } else {
+            continue;
+        }
+        candidates.push_back(candidate);
+    }
+
+    // Greedily place the largest resources first, each into the first memory block where it doesn't overlap in lifetime with any other
+    // resource placed in that block. Nodes where the lifetime of an aliased resource begins wait for all earlier work in the frame, so
+    // there is no need for any additional synchronization as long as no two resources in a block are used in the same node.
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const AliasingCandidate& lhs, const AliasingCandidate& rhs) {
+        return lhs.memoryRequirements.size > rhs.memoryRequirements.size;
+    });
+
+    struct MemoryBlock {
+        VkMemoryRequirements memoryRequirements;
+        std::vector<const AliasingCandidate*> candidates;
+    };
+    std::vector<MemoryBlock> blocks {};
+
+    auto lifetimesOverlap = [](const RenderGraph::TransientResourceLifetime& a, const RenderGraph::TransientResourceLifetime& b) -> bool {
+        return a.firstNodeIndex <= b.lastNodeIndex && b.firstNodeIndex <= a.lastNodeIndex;
+    };
+
+    VkDeviceSize totalSizeWithoutAliasing = 0;
+    for (const AliasingCandidate& candidate : candidates) {
+        const VkMemoryRequirements& requirements = candidate.memoryRequirements;
+        totalSizeWithoutAliasing += requirements.size;
+
+        MemoryBlock* block = nullptr;
+        for (MemoryBlock& existingBlock : blocks) {
+            if ((existingBlock.memoryRequirements.memoryTypeBits & requirements.memoryTypeBits) == 0)
+                continue;
+            bool overlaps = std::any_of(existingBlock.candidates.begin(), existingBlock.candidates.end(), [&](const AliasingCandidate* other) {
+                return lifetimesOverlap(candidate.lifetime, other->lifetime);
+            });
+            if (!overlaps) {
+                block = &existingBlock;
+                break;
+            }
+        }
+
+        if (block) {
+            block->memoryRequirements.size = std::max(block->memoryRequirements.size, requirements.size);
+            block->memoryRequirements.alignment = std::max(block->memoryRequirements.alignment, requirements.alignment);
+            block->memoryRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+            block->candidates.push_back(&candidate);
+        } else {
+            blocks.push_back({ requirements, { &candidate } });
+        }
+    }
+
+    TransientMemory transientMemory {};
+    std::unordered_set<const Resource*> aliasedResources {};
+
+    for (const AliasingCandidate& candidate : candidates) {
+        if (candidate.lifetime.asyncCompute && candidate.texture)
+            transientMemory.asyncComputeTextures.push_back(candidate.texture);
+    }
+
+    VkDeviceSize totalSizeWithAliasing = 0;
+    for (const MemoryBlock& block : blocks) {
+        totalSizeWithAliasing += block.memoryRequirements.size;
+
+        // Resources which don't share memory with any other can keep their own allocation
+        if (block.candidates.size() < 2)
+            continue;
+
+        VmaAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        VmaAllocation allocation;
+        if (vmaAllocateMemory(globalAllocator(), &block.memoryRequirements, &allocCreateInfo, &allocation, nullptr) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanBackend::aliasTransientResources(): could not allocate memory for transient resources, exiting.\n");
+        }
+        transientMemory.memoryBlocks.push_back(allocation);
+
+        for (const AliasingCandidate* candidate : block.candidates) {
+            uint32_t firstNodeIndex = candidate->lifetime.firstNodeIndex;
+            if (firstNodeIndex >= transientMemory.aliasingBeginsInNode.size())
+                transientMemory.aliasingBeginsInNode.resize(firstNodeIndex + 1, false);
+            transientMemory.aliasingBeginsInNode[firstNodeIndex] = true;
+
+            if (candidate->texture) {
+                candidate->texture->bindToAliasedMemory(allocation);
+
+                uint32_t nodeIndex = candidate->lifetime.firstNodeIndex;
+                if (nodeIndex >= transientMemory.texturesBeginningInNode.size())
+                    transientMemory.texturesBeginningInNode.resize(nodeIndex + 1);
+                transientMemory.texturesBeginningInNode[nodeIndex].push_back(candidate->texture);
+            } else {
+                candidate->buffer->bindToAliasedMemory(allocation);
+            }
+            aliasedResources.insert(candidate->lifetime.resource);
+        }
+    }
+
+    // Descriptors & framebuffers still reference the old images, image views, and buffers
+
+    for (BindingSet* bindingSet : frameRegistry.bindingSets()) {
+        bool referencesAliasedResource = false;
+        for (auto& binding : bindingSet->shaderBindings()) {
+            for (Texture* texture : binding.textures)
+                referencesAliasedResource |= aliasedResources.contains(texture);
+            for (Buffer* buffer : binding.buffers)
+                referencesAliasedResource |= aliasedResources.contains(buffer);
+        }
+        if (referencesAliasedResource)
+            static_cast<VulkanBindingSet*>(bindingSet)->updateDescriptorSet();
+    }
+
+    for (RenderTarget* renderTarget : frameRegistry.renderTargets()) {
+        auto& vulkanRenderTarget = static_cast<VulkanRenderTarget&>(*renderTarget);
+        bool referencesAliasedResource = std::any_of(vulkanRenderTarget.attachedTextures.begin(), vulkanRenderTarget.attachedTextures.end(), [&](auto& attachedTexture) {
+            return aliasedResources.contains(attachedTexture.first);
+        });
+        if (referencesAliasedResource)
+            vulkanRenderTarget.recreateFramebuffer();
+    }
+
+    constexpr double bytesPerMegabyte = 1024.0 * 1024.0;
+    LogInfo("VulkanBackend: transient resource memory %.1f MB before aliasing, %.1f MB after aliasing (%u resources in %u memory blocks)\n",
+            totalSizeWithoutAliasing / bytesPerMegabyte, totalSizeWithAliasing / bytesPerMegabyte, uint32_t(candidates.size()), uint32_t(blocks.size()));
+
+    return transientMemory;
+}
+
+void VulkanBackend::freeTransientMemory(TransientMemory& transientMemory)
+{
+    for (VmaAllocation allocation : transientMemory.memoryBlocks)
+        vmaFreeMemory(globalAllocator(), allocation);
+    transientMemory.memoryBlocks.clear();
+    transientMemory.texturesBeginningInNode.clear();
+    transientMemory.aliasingBeginsInNode.clear();
 }
 
 bool VulkanBackend::issueSingleTimeCommand(const std::function<void(VkCommandBuffer)>& callback) const
@@ -1590,6 +2449,16 @@ bool VulkanBackend::transitionImageLayout(VkImage image, bool isDepthFormat, VkI
         destinationStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
+    } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+
+        // Wait for all color attachment writes ...
+        sourceStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        // ... before allowing any transfers to read the memory
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
     } else {
         LogErrorAndExit("VulkanBackend::transitionImageLayout(): old & new layout combination unsupported by application, exiting.\n");
     }
@@ -1759,27 +2628,17 @@ std::pair<std::vector<VkDescriptorSetLayout>, std::optional<VkPushConstantRange>
     std::vector<VkDescriptorSetLayout> setLayouts { (size_t)maxSetId + 1 };
     for (uint32_t setId = 0; setId <= maxSetId; ++setId) {
 
-        VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        // There can be no gaps in the list of set layouts when creating a pipeline layout, so we fill them in here (with empty layouts)
         std::vector<VkDescriptorSetLayoutBinding> layoutBindings {};
 
-        // There can be no gaps in the list of set layouts when creating a pipeline layout, so we fill them in here
-        descriptorSetLayoutCreateInfo.bindingCount = 0;
-        descriptorSetLayoutCreateInfo.pBindings = nullptr;
-
         auto entry = sets.find(setId);
         if (entry != sets.end()) {
-
             for (auto& [id, binding] : entry->second) {
                 layoutBindings.push_back(binding);
             }
-
-            descriptorSetLayoutCreateInfo.bindingCount = layoutBindings.size();
-            descriptorSetLayoutCreateInfo.pBindings = layoutBindings.data();
         }
 
-        if (vkCreateDescriptorSetLayout(device(), &descriptorSetLayoutCreateInfo, nullptr, &setLayouts[setId]) != VK_SUCCESS) {
-            LogErrorAndExit("Error trying to create descriptor set layout from shader\n");
-        }
+        setLayouts[setId] = descriptorAllocator().getOrCreateLayout(layoutBindings);
     }
 
     return { setLayouts, pushConstantRange };
@@ -1806,25 +2665,54 @@ uint32_t VulkanBackend::findAppropriateMemory(uint32_t typeBits, VkMemoryPropert
 
 void VulkanBackend::submitQueue(uint32_t imageIndex, VkSemaphore* waitFor, VkSemaphore* signal, VkFence* inFlight)
 {
-    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitFor;
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.pWaitDstStageMask = waitStages;
-
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_frameCommandBuffers[imageIndex];
-
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signal;
+    const std::vector<FrameSubmission>& submissions = m_frameSubmissions[imageIndex];
+    ASSERT(!submissions.empty() && !submissions.front().asyncCompute && !submissions.back().asyncCompute);
 
     if (vkResetFences(device(), 1, inFlight) != VK_SUCCESS) {
         LogError("VulkanBackend::submitQueue(): error resetting in-flight frame fence (index %u).\n", imageIndex);
     }
 
-    VkResult submitStatus = vkQueueSubmit(m_graphicsQueue.queue, 1, &submitInfo, *inFlight);
-    if (submitStatus != VK_SUCCESS) {
-        LogError("VulkanBackend::submitQueue(): could not submit the graphics queue (index %u).\n", imageIndex);
+    // Only the graphics queue touches the window image, and it both begins & ends the frame (as it waits for the async compute queue to
+    // finish before the GUI), so the first submission waits for the window image, and the last one signals when it's rendered & the fence
+    for (size_t idx = 0; idx < submissions.size(); ++idx) {
+        const FrameSubmission& submission = submissions[idx];
+        bool isFirst = idx == 0;
+        bool isLast = idx == submissions.size() - 1;
+
+        // (the window semaphores are optional, e.g. there are none when headless since there is no swapchain to sync with)
+        std::vector<VkSemaphore> waitSemaphores {};
+        std::vector<VkPipelineStageFlags> waitStages {};
+        if (isFirst && waitFor) {
+            waitSemaphores.push_back(*waitFor);
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+        if (submission.waitSemaphore != VK_NULL_HANDLE) {
+            waitSemaphores.push_back(submission.waitSemaphore);
+            waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+
+        std::vector<VkSemaphore> signalSemaphores {};
+        if (submission.signalSemaphore != VK_NULL_HANDLE)
+            signalSemaphores.push_back(submission.signalSemaphore);
+        if (isLast && signal)
+            signalSemaphores.push_back(*signal);
+
+        VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
+
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        VkQueue queue = submission.asyncCompute ? m_computeQueue.queue : m_graphicsQueue.queue;
+        VkResult submitStatus = vkQueueSubmit(queue, 1, &submitInfo, isLast ? *inFlight : VK_NULL_HANDLE);
+        if (submitStatus != VK_SUCCESS) {
+            LogError("VulkanBackend::submitQueue(): could not submit the %s queue (index %u).\n", submission.asyncCompute ? "async compute" : "graphics", imageIndex);
+        }
     }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "VulkanDebugUtils.h"
+#include "VulkanDescriptorAllocator.h"
 #include "VulkanRTX.h"
+#include "VulkanTextureStreamer.h"
 #include "backend/Backend.h"
 #include "backend/Resources.h"
 #include "backend/vulkan/VulkanResources.h"
@@ -21,6 +23,8 @@ static constexpr bool vulkanVerboseDebugMessages = false;
 class VulkanBackend final : public Backend {
 public:
     VulkanBackend(GLFWwindow*, App&);
+    //! Headless mode: render into offscreen window images of the given extent, with no window, surface, or presentation
+    VulkanBackend(App&, Extent2D windowExtent);
     ~VulkanBackend() final;
 
     VulkanBackend(VulkanBackend&&) = delete;
@@ -28,15 +32,20 @@ public:
     VulkanBackend& operator=(VulkanBackend&) = delete;
 
     // FIXME: There might be more elegant ways of giving access. We really don't need everything from here.
-    //  Currently only VkEvent are accessed privately from the command list.
     friend class VulkanCommandList;
 
+    //! The number of frames that can be recorded or executing at once, so resources written by the CPU every frame need this many copies
+    static constexpr size_t maxFramesInFlight { 2 };
+
     ///////////////////////////////////////////////////////////////////////////
     /// Public backend API
 
     bool hasActiveCapability(Capability) const override;
     bool executeFrame(double elapsedTime, double deltaTime) override;
 
+    std::optional<double> waitForFrameCompletion() override;
+    bool saveFrameImageToFile(const std::string& filePath) override;
+
     ///////////////////////////////////////////////////////////////////////////
     /// Backend-specific resource types
 
@@ -69,6 +78,12 @@ public:
         return m_physicalDevice;
     }
 
+    //! Shared by all pipeline creation, and persisted to disk between runs
+    VkPipelineCache pipelineCache() const
+    {
+        return m_pipelineCache;
+    }
+
     bool hasRtxSupport() const
     {
         return m_rtx != nullptr;
@@ -91,6 +106,23 @@ public:
         return *m_debugUtils;
     }
 
+    bool hasTextureStreamer() const
+    {
+        return m_textureStreamer != nullptr;
+    }
+
+    VulkanTextureStreamer& textureStreamer()
+    {
+        ASSERT(hasTextureStreamer());
+        return *m_textureStreamer;
+    }
+
+    VulkanDescriptorAllocator& descriptorAllocator()
+    {
+        ASSERT(m_descriptorAllocator);
+        return *m_descriptorAllocator;
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     /// Backend services
 
@@ -108,6 +140,8 @@ public:
     std::pair<std::vector<VkDescriptorSetLayout>, std::optional<VkPushConstantRange>> createDescriptorSetLayoutForShader(const Shader&) const;
 
 private:
+    VulkanBackend(GLFWwindow*, App&, Extent2D windowExtent);
+
     ///////////////////////////////////////////////////////////////////////////
     /// Capability query metadata & utilities
 
@@ -128,11 +162,87 @@ private:
 
     void reconstructRenderGraphResources(RenderGraph& renderGraph);
 
+    struct TransientMemory {
+        //! Memory blocks shared between transient resources with non-overlapping lifetimes
+        std::vector<VmaAllocation> memoryBlocks {};
+        //! For each node (in resolved order), the aliased textures whose lifetime begins in that node
+        std::vector<std::vector<VulkanTexture*>> texturesBeginningInNode {};
+        //! For each node (in resolved order), if the lifetime of any aliased resource (texture or buffer) begins in that node
+        std::vector<bool> aliasingBeginsInNode {};
+        //! Textures used on the async compute queue, which are undefined at the start of every frame (but are never aliased)
+        std::vector<VulkanTexture*> asyncComputeTextures {};
+    };
+
+    TransientMemory aliasTransientResources(const RenderGraph&, Registry& frameRegistry);
+    void freeTransientMemory(TransientMemory&);
+
     ///////////////////////////////////////////////////////////////////////////
     /// Drawing
 
     void drawFrame(const AppState&, double elapsedTime, double deltaTime, uint32_t swapchainImageIndex);
 
+    struct SecondaryCommandPool {
+        VkCommandPool commandPool {};
+        std::vector<VkCommandBuffer> commandBuffers {};
+        size_t nextFreeCommandBuffer { 0 };
+    };
+
+    VkCommandBuffer nextSecondaryCommandBuffer(SecondaryCommandPool&);
+
+    //! A frame with nodes on the async compute queue is split into several submissions, since the queues can only wait on each other's
+    //! semaphores between submissions. They are submitted in the order they were begun, which puts every semaphore wait after its signal.
+    struct FrameSubmission {
+        VkCommandBuffer commandBuffer {};
+        bool asyncCompute { false };
+        VkSemaphore waitSemaphore { VK_NULL_HANDLE };
+        VkSemaphore signalSemaphore { VK_NULL_HANDLE };
+    };
+
+    //! Command buffers for all submissions of a frame except the first one on the graphics queue (which is the frame command buffer)
+    struct SubmissionCommandBuffers {
+        std::vector<VkCommandBuffer> graphics {};
+        std::vector<VkCommandBuffer> asyncCompute {};
+    };
+
+    //! Nodes beyond this count in a frame are not timed on the GPU
+    static constexpr uint32_t maxTimedNodesPerFrame { 256 };
+
+    //! GPU queries of one frame in flight. They are only read back after waiting for the frame's fence before reusing them, so it never stalls.
+    struct FrameQueries {
+        //! The first pair of timestamps is for the whole frame, followed by one pair per timed node (if the graphics queue supports timestamps)
+        VkQueryPool timestampPool {};
+        //! One query per timed node (only if pipeline statistics are supported)
+        VkQueryPool pipelineStatisticsPool {};
+        //! The timer of each node that was timed in the frame, in the order of their queries
+        std::vector<NodeTimer*> timedNodes {};
+        bool hasPipelineStatistics { false };
+        //! For each timed node, if its pipeline statistics were collected (which they never are on the async compute queue)
+        std::vector<bool> timedNodeHasPipelineStatistics {};
+    };
+
+    std::array<FrameQueries, maxFramesInFlight> m_frameQueries {};
+    uint64_t m_timestampValidBitMask {};
+    //! Nanoseconds per timestamp tick
+    float m_timestampPeriod {};
+    //! If nodes on the async compute queue are timed too (the valid bit mask is then the narrower one of the two queues)
+    bool m_asyncComputeTimestampsSupported { false };
+
+    bool m_pipelineStatisticsSupported { false };
+    bool m_collectPipelineStatistics { false };
+    //! The pipeline statistics of the currently recording node, which secondary command buffers must inherit (zero if not collecting)
+    VkQueryPipelineStatisticFlags m_activePipelineStatistics { 0 };
+
+    static constexpr VkQueryPipelineStatisticFlags collectedPipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+    void createFrameQueryPools();
+    void destroyFrameQueryPools();
+    //! Report the GPU times (and pipeline statistics) of the nodes of the frame that last used these queries to their node timers
+    void reportNodeQueryResults(FrameQueries&);
+
     ///////////////////////////////////////////////////////////////////////////
     /// Swapchain management
 
@@ -140,7 +250,13 @@ private:
 
     void createSemaphoresAndFences(VkDevice);
 
+    bool isHeadless() const { return m_window == nullptr; }
+    //! The layout that the window images are left in at the end of a frame, i.e. ready for presenting, or for reading back when headless
+    VkImageLayout windowImageFinalLayout() const;
+
     void createAndSetupSwapchain(VkPhysicalDevice, VkDevice, VkSurfaceKHR);
+    void createSwapchain(VkPhysicalDevice, VkDevice, VkSurfaceKHR);
+    void createOffscreenWindowImages();
     void destroySwapchain();
     Extent2D recreateSwapchain();
 
@@ -171,12 +287,20 @@ private:
 
     VkInstance createInstance(const std::vector<const char*>& requestedLayers, VkDebugUtilsMessengerCreateInfoEXT*) const;
     VkDevice createDevice(const std::vector<const char*>& requestedLayers, VkPhysicalDevice);
+
+    // (lives next to the SPIR-V cache, which is gitignored, since the data is driver specific)
+    static constexpr const char* pipelineCacheDirectory = "shaders/.cache";
+    static constexpr const char* pipelineCacheFilePath = "shaders/.cache/pipeline-cache.bin";
+    VkPipelineCache createAndLoadPipelineCacheFromDisk() const;
+    void savePipelineCacheToDisk(VkPipelineCache) const;
     VkDebugUtilsMessengerEXT m_messenger {};
 
     VkInstance m_instance {};
     VkPhysicalDevice m_physicalDevice {};
     VkDevice m_device {};
 
+    VkPipelineCache m_pipelineCache {};
+
     struct VulkanQueue {
         uint32_t familyIndex;
         VkQueue queue;
@@ -188,6 +312,12 @@ private:
     VulkanQueue m_graphicsQueue {};
     VulkanQueue m_computeQueue {};
 
+    //! Only if the compute queue is from a different family than the graphics queue is there any point running nodes on it
+    bool hasAsyncComputeQueue() const { return m_computeQueue.familyIndex != m_graphicsQueue.familyIndex; }
+
+    // (only available with the DrawIndirectCount capability)
+    PFN_vkCmdDrawIndexedIndirectCountKHR vkCmdDrawIndexedIndirectCountKHR { nullptr };
+
     ///////////////////////////////////////////////////////////////////////////
     /// Window and swapchain related members
 
@@ -203,6 +333,9 @@ private:
     std::vector<VkImage> m_swapchainImages {};
     std::vector<VkImageView> m_swapchainImageViews {};
 
+    // (only used when headless, in which case they are the "swapchain images")
+    std::vector<VmaAllocation> m_offscreenWindowImageAllocations {};
+
     std::unique_ptr<VulkanTexture> m_swapchainDepthTexture {};
 
     std::vector<VkFramebuffer> m_swapchainFramebuffers {};
@@ -210,7 +343,6 @@ private:
 
     //
 
-    static constexpr size_t maxFramesInFlight { 2 };
     uint32_t m_currentFrameIndex { 0 };
     uint32_t m_lastSwapchainRecreationFrameIndex { 0 };
 
@@ -223,6 +355,9 @@ private:
 
     std::unique_ptr<VulkanRTX> m_rtx {};
     std::unique_ptr<VulkanDebugUtils> m_debugUtils {};
+    std::unique_ptr<VulkanTextureStreamer> m_textureStreamer {};
+    std::unique_ptr<VulkanDescriptorAllocator> m_descriptorAllocator {};
+    std::optional<VulkanDescriptorAllocator::TransientScope> m_graphDescriptorScope {};
 
     ///////////////////////////////////////////////////////////////////////////
     /// Resource & resource management members
@@ -234,13 +369,24 @@ private:
     std::unique_ptr<Registry> m_sceneRegistry {};
     std::unique_ptr<Registry> m_nodeRegistry {};
     std::vector<std::unique_ptr<Registry>> m_frameRegistries {};
+    std::vector<TransientMemory> m_frameTransientMemory {};
 
-    std::vector<VkEvent> m_events {};
+    //! Events for the split barriers of the render graph, per frame registry
+    std::vector<std::vector<VkEvent>> m_frameEvents {};
+    //! Semaphores between the graphics & async compute queues of the render graph, per frame registry
+    std::vector<std::vector<VkSemaphore>> m_frameSemaphores {};
 
     VkCommandPool m_renderGraphFrameCommandPool {};
     VkCommandPool m_transientCommandPool {};
+    // (only if there is an async compute queue)
+    VkCommandPool m_asyncComputeCommandPool {};
 
     std::vector<VkCommandBuffer> m_frameCommandBuffers {};
+    //! For each swapchain image, one pool per worker thread for recording secondary command buffers in parallel
+    std::vector<std::vector<SecondaryCommandPool>> m_secondaryCommandPools {};
+    //! For each swapchain image, the submissions of the frame last recorded for it & their command buffers
+    std::vector<std::vector<FrameSubmission>> m_frameSubmissions {};
+    std::vector<SubmissionCommandBuffers> m_submissionCommandBuffers {};
     std::unique_ptr<RenderGraph> m_renderGraph {};
 
     std::vector<std::unique_ptr<VulkanTexture>> m_swapchainMockColorTextures {};
@@ -3,11 +3,14 @@
 #include "VulkanBackend.h"
 #include "VulkanResources.h"
 #include "utility/Logging.h"
+#include "utility/ThreadPool.h"
+#include <algorithm>
 #include <stb_image_write.h>
 
-VulkanCommandList::VulkanCommandList(VulkanBackend& backend, VkCommandBuffer commandBuffer)
+VulkanCommandList::VulkanCommandList(VulkanBackend& backend, VkCommandBuffer commandBuffer, std::vector<VulkanBackend::SecondaryCommandPool>* secondaryCommandPools)
     : m_backend(backend)
     , m_commandBuffer(commandBuffer)
+    , m_secondaryCommandPools(secondaryCommandPools)
 {
 }
 
@@ -16,37 +19,32 @@ void VulkanCommandList::clearTexture(Texture& genColorTexture, ClearColor color)
     auto& colorTexture = static_cast<VulkanTexture&>(genColorTexture);
     ASSERT(!colorTexture.hasDepthFormat());
 
-    std::optional<VkImageLayout> originalLayout;
-    if (colorTexture.currentLayout != VK_IMAGE_LAYOUT_GENERAL && colorTexture.currentLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        originalLayout = colorTexture.currentLayout;
-
-        VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-        imageBarrier.oldLayout = originalLayout.value();
-        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        imageBarrier.image = colorTexture.image;
-        imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageBarrier.subresourceRange.baseMipLevel = 0;
-        imageBarrier.subresourceRange.levelCount = colorTexture.mipLevels();
-        imageBarrier.subresourceRange.baseArrayLayer = 0;
-        imageBarrier.subresourceRange.layerCount = colorTexture.layerCount();
+    VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = colorTexture.image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = colorTexture.mipLevels();
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = colorTexture.layerCount();
 
-        // FIXME: Probably overly aggressive barriers!
+    // Clears are not declared to the render graph, so they have to synchronize with any access before & after themselves
 
-        VkPipelineStageFlags sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        imageBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    std::optional<VkImageLayout> originalLayout;
+    if (colorTexture.currentLayout != VK_IMAGE_LAYOUT_GENERAL && colorTexture.currentLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+        originalLayout = colorTexture.currentLayout;
 
-        VkPipelineStageFlags destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.oldLayout = colorTexture.currentLayout;
+    imageBarrier.newLayout = originalLayout.has_value() ? VK_IMAGE_LAYOUT_GENERAL : colorTexture.currentLayout;
+    imageBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-        vkCmdPipelineBarrier(m_commandBuffer,
-                             sourceStage, destinationStage, 0,
-                             0, nullptr,
-                             0, nullptr,
-                             1, &imageBarrier);
-    }
+    vkCmdPipelineBarrier(m_commandBuffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &imageBarrier);
 
     VkClearColorValue clearValue {};
     clearValue.float32[0] = color.r;
@@ -65,34 +63,20 @@ void VulkanCommandList::clearTexture(Texture& genColorTexture, ClearColor color)
 
     vkCmdClearColorImage(m_commandBuffer, colorTexture.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &range);
 
-    if (originalLayout.has_value() && originalLayout.value() != VK_IMAGE_LAYOUT_UNDEFINED && originalLayout.value() != VK_IMAGE_LAYOUT_PREINITIALIZED) {
-        VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-        imageBarrier.newLayout = originalLayout.value();
-        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        imageBarrier.image = colorTexture.image;
-        imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageBarrier.subresourceRange.baseMipLevel = 0;
-        imageBarrier.subresourceRange.levelCount = colorTexture.mipLevels();
-        imageBarrier.subresourceRange.baseArrayLayer = 0;
-        imageBarrier.subresourceRange.layerCount = colorTexture.layerCount();
+    bool restoreLayout = originalLayout.has_value() && originalLayout.value() != VK_IMAGE_LAYOUT_UNDEFINED && originalLayout.value() != VK_IMAGE_LAYOUT_PREINITIALIZED;
 
-        // FIXME: Probably overly aggressive barriers!
+    imageBarrier.oldLayout = imageBarrier.newLayout;
+    imageBarrier.newLayout = restoreLayout ? originalLayout.value() : imageBarrier.oldLayout;
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
-        VkPipelineStageFlags sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        imageBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
-
-        VkPipelineStageFlags destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(m_commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &imageBarrier);
 
-        vkCmdPipelineBarrier(m_commandBuffer,
-                             sourceStage, destinationStage, 0,
-                             0, nullptr,
-                             0, nullptr,
-                             1, &imageBarrier);
-    }
+    colorTexture.currentLayout = imageBarrier.newLayout;
 }
 
 void VulkanCommandList::copyTexture(Texture& genSrc, Texture& genDst, uint32_t srcLayer, uint32_t dstLayer)
@@ -202,8 +186,9 @@ void VulkanCommandList::copyTexture(Texture& genSrc, Texture& genDst, uint32_t s
         barriers[1].newLayout = finalDstLayout;
         barriers[1].subresourceRange.baseArrayLayer = dstLayer;
 
+        // (copies are not declared to the render graph, so any later access has to wait for them here)
         vkCmdPipelineBarrier(m_commandBuffer,
-                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                              0, nullptr,
                              0, nullptr,
                              barriers.size(), barriers.data());
@@ -497,20 +482,22 @@ void VulkanCommandList::beginRendering(const RenderState& genRenderState, ClearC
     renderPassBeginInfo.renderArea.offset = { 0, 0 };
     renderPassBeginInfo.renderArea.extent = { targetExtent.width(), targetExtent.height() };
 
-    renderPassBeginInfo.clearValueCount = clearValues.size();
-    renderPassBeginInfo.pClearValues = clearValues.data();
+    m_pendingClearValues = std::move(clearValues);
+    renderPassBeginInfo.clearValueCount = m_pendingClearValues.size();
+    renderPassBeginInfo.pClearValues = m_pendingClearValues.data();
+
+    // NOTE: The render pass itself is begun on the first draw (or at the end), see beginPendingRenderPassIfAny
+    m_pendingRenderPass = renderPassBeginInfo;
+    m_renderPassHasSecondaryContents = false;
+    m_boundDescriptorSets.clear();
+    m_pushedConstants.clear();
 
-    // TODO: Handle subpasses properly!
-    vkCmdBeginRenderPass(m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
     vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderState.pipeline);
 }
 
 void VulkanCommandList::endRendering()
 {
-    if (activeRenderState) {
-        vkCmdEndRenderPass(m_commandBuffer);
-        activeRenderState = nullptr;
-    }
+    endCurrentRenderPassIfAny();
 }
 
 void VulkanCommandList::setRayTracingState(const RayTracingState& genRtState)
@@ -713,6 +700,12 @@ void VulkanCommandList::bindSet(BindingSet& bindingSet, uint32_t index)
 
     auto& vulkanBindingSet = static_cast<VulkanBindingSet&>(bindingSet);
     vkCmdBindDescriptorSets(m_commandBuffer, bindPoint, pipelineLayout, index, 1, &vulkanBindingSet.descriptorSet, 0, nullptr);
+
+    if (activeRenderState) {
+        if (index >= m_boundDescriptorSets.size())
+            m_boundDescriptorSets.resize(index + 1, VK_NULL_HANDLE);
+        m_boundDescriptorSets[index] = vulkanBindingSet.descriptorSet;
+    }
 }
 
 void VulkanCommandList::pushConstants(ShaderStage shaderStage, void* data, size_t size, size_t byteOffset)
@@ -750,6 +743,11 @@ void VulkanCommandList::pushConstants(ShaderStage shaderStage, void* data, size_
         stageFlags |= VK_SHADER_STAGE_CLOSEST_HIT_BIT_NV;
 
     vkCmdPushConstants(m_commandBuffer, pipelineLayout, stageFlags, byteOffset, size, data);
+
+    if (activeRenderState) {
+        auto* bytes = static_cast<const uint8_t*>(data);
+        m_pushedConstants.push_back({ stageFlags, static_cast<uint32_t>(byteOffset), std::vector<uint8_t>(bytes, bytes + size) });
+    }
 }
 
 void VulkanCommandList::draw(Buffer& vertexBuffer, uint32_t vertexCount)
@@ -757,6 +755,11 @@ void VulkanCommandList::draw(Buffer& vertexBuffer, uint32_t vertexCount)
     if (!activeRenderState) {
         LogErrorAndExit("draw: no active render state!\n");
     }
+    if (m_renderPassHasSecondaryContents) {
+        LogErrorAndExit("draw: can't draw inline after drawInParallel in the same render pass!\n");
+    }
+
+    beginPendingRenderPassIfAny(VK_SUBPASS_CONTENTS_INLINE);
 
     VkBuffer vertBuffer = static_cast<VulkanBuffer&>(vertexBuffer).buffer;
 
@@ -772,6 +775,11 @@ void VulkanCommandList::drawIndexed(const Buffer& vertexBuffer, const Buffer& in
     if (!activeRenderState) {
         LogErrorAndExit("drawIndexed: no active render state!\n");
     }
+    if (m_renderPassHasSecondaryContents) {
+        LogErrorAndExit("drawIndexed: can't draw inline after drawInParallel in the same render pass!\n");
+    }
+
+    beginPendingRenderPassIfAny(VK_SUBPASS_CONTENTS_INLINE);
 
     VkBuffer vertBuffer = static_cast<const VulkanBuffer&>(vertexBuffer).buffer;
     VkBuffer idxBuffer = static_cast<const VulkanBuffer&>(indexBuffer).buffer;
@@ -794,20 +802,134 @@ void VulkanCommandList::drawIndexed(const Buffer& vertexBuffer, const Buffer& in
     vkCmdDrawIndexed(m_commandBuffer, indexCount, 1, 0, 0, instanceIndex);
 }
 
-void VulkanCommandList::rebuildTopLevelAcceratationStructure(TopLevelAS& tlas)
+void VulkanCommandList::drawIndexedIndirect(const Buffer& vertexBuffer, const Buffer& indexBuffer, IndexType indexType, const Buffer& indirectBuffer, const Buffer& countBuffer, uint32_t maxDrawCount)
+{
+    if (!activeRenderState) {
+        LogErrorAndExit("drawIndexedIndirect: no active render state!\n");
+    }
+    if (m_renderPassHasSecondaryContents) {
+        LogErrorAndExit("drawIndexedIndirect: can't draw inline after drawInParallel in the same render pass!\n");
+    }
+    if (!backend().hasActiveCapability(Backend::Capability::DrawIndirectCount)) {
+        LogErrorAndExit("drawIndexedIndirect: requires the DrawIndirectCount capability to be active!\n");
+    }
+    if (indirectBuffer.usage() != Buffer::Usage::IndirectBuffer || countBuffer.usage() != Buffer::Usage::IndirectBuffer) {
+        LogErrorAndExit("drawIndexedIndirect: the indirect & count buffers must have indirect buffer usage!\n");
+    }
+
+    beginPendingRenderPassIfAny(VK_SUBPASS_CONTENTS_INLINE);
+
+    VkBuffer vertBuffer = static_cast<const VulkanBuffer&>(vertexBuffer).buffer;
+    VkBuffer idxBuffer = static_cast<const VulkanBuffer&>(indexBuffer).buffer;
+
+    VkBuffer vertexBuffers[] = { vertBuffer };
+    VkDeviceSize offsets[] = { 0 };
+
+    VkIndexType vkIndexType;
+    switch (indexType) {
+    case IndexType::UInt16:
+        vkIndexType = VK_INDEX_TYPE_UINT16;
+        break;
+    case IndexType::UInt32:
+        vkIndexType = VK_INDEX_TYPE_UINT32;
+        break;
+    }
+
+    vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(m_commandBuffer, idxBuffer, 0, vkIndexType);
+
+    backend().vkCmdDrawIndexedIndirectCountKHR(m_commandBuffer,
+                                               static_cast<const VulkanBuffer&>(indirectBuffer).buffer, 0,
+                                               static_cast<const VulkanBuffer&>(countBuffer).buffer, 0,
+                                               maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void VulkanCommandList::drawInParallel(size_t itemCount, const ParallelDrawCallback& callback)
+{
+    if (!activeRenderState) {
+        LogErrorAndExit("drawInParallel: no active render state!\n");
+    }
+    if (!m_pendingRenderPass.has_value() && !m_renderPassHasSecondaryContents) {
+        LogErrorAndExit("drawInParallel: can't draw in parallel after inline draws in the same render pass!\n");
+    }
+
+    // Don't bother with secondary command buffers unless each job gets a decent amount of work to do
+    constexpr size_t minItemsPerJob = 32;
+    size_t maxJobCount = m_secondaryCommandPools ? m_secondaryCommandPools->size() : 0;
+    size_t jobCount = std::min(maxJobCount, (itemCount + minItemsPerJob - 1) / minItemsPerJob);
+
+    if (jobCount <= 1 && !m_renderPassHasSecondaryContents) {
+        callback(*this, 0, itemCount);
+        return;
+    }
+    jobCount = std::max(jobCount, size_t(1));
+
+    beginPendingRenderPassIfAny(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    m_renderPassHasSecondaryContents = true;
+
+    // Each job has its own pool, since command pools must not be accessed from multiple threads at once
+    std::vector<VkCommandBuffer> secondaryCommandBuffers {};
+    for (size_t jobIdx = 0; jobIdx < jobCount; ++jobIdx) {
+        VkCommandBuffer secondaryCommandBuffer = backend().nextSecondaryCommandBuffer(m_secondaryCommandPools->at(jobIdx));
+        secondaryCommandBuffers.push_back(secondaryCommandBuffer);
+    }
+
+    auto& renderTarget = static_cast<const VulkanRenderTarget&>(activeRenderState->renderTarget());
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    inheritanceInfo.renderPass = renderTarget.compatibleRenderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = renderTarget.framebuffer;
+    // (if the backend is collecting pipeline statistics for this node the query is active while the secondary command buffers execute)
+    inheritanceInfo.pipelineStatistics = backend().m_activePipelineStatistics;
+
+    size_t itemsPerJob = (itemCount + jobCount - 1) / jobCount;
+
+    ThreadPool::commandRecording().parallelFor(jobCount, [&](size_t jobIdx) {
+        VkCommandBuffer secondaryCommandBuffer = secondaryCommandBuffers[jobIdx];
+
+        VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(secondaryCommandBuffer, &beginInfo) != VK_SUCCESS) {
+            LogError("drawInParallel: error beginning secondary command buffer!\n");
+        }
+
+        VulkanCommandList secondaryCmdList { backend(), secondaryCommandBuffer };
+        secondaryCmdList.continueRenderPassOf(*this);
+
+        size_t begin = std::min(jobIdx * itemsPerJob, itemCount);
+        size_t end = std::min(begin + itemsPerJob, itemCount);
+        callback(secondaryCmdList, begin, end);
+
+        if (vkEndCommandBuffer(secondaryCommandBuffer) != VK_SUCCESS) {
+            LogError("drawInParallel: error ending secondary command buffer!\n");
+        }
+    });
+
+    // Execute in job order, so the draw order is the same as if recorded inline
+    vkCmdExecuteCommands(m_commandBuffer, secondaryCommandBuffers.size(), secondaryCommandBuffers.data());
+}
+
+void VulkanCommandList::updateTopLevelAccelerationStructure(TopLevelAS& tlas)
 {
     if (!backend().hasRtxSupport())
-        LogErrorAndExit("Trying to rebuild a top level acceleration structure but there is no ray tracing support!\n");
+        LogErrorAndExit("Trying to update a top level acceleration structure but there is no ray tracing support!\n");
 
     auto& vulkanTlas = static_cast<VulkanTopLevelAS&>(tlas);
 
-    // TODO: Maybe don't throw the allocation away (when building the first time), so we can reuse it here?
-    //  However, it's a different size, though! So maybe not. Or if we use the max(build, rebuild) size?
-    VmaAllocation scratchAllocation;
-    VkBuffer scratchBuffer = backend().rtx().createScratchBufferForAccelerationStructure(vulkanTlas.accelerationStructure, true, scratchAllocation);
+    std::optional<VulkanTopLevelAS::PendingBuild> pendingBuild = vulkanTlas.prepareBuild();
+    if (!pendingBuild.has_value())
+        return;
 
-    VmaAllocation instanceAllocation;
-    VkBuffer instanceBuffer = backend().rtx().createInstanceBuffer(tlas.instances(), instanceAllocation);
+    // Rays traced in the previous frame might still be reading the acceleration structure we are about to write to
+    VkMemoryBarrier readBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    readBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_NV;
+    readBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_NV;
+    vkCmdPipelineBarrier(m_commandBuffer,
+                         VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV,
+                         VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_NV,
+                         0, 1, &readBarrier, 0, nullptr, 0, nullptr);
 
     VkAccelerationStructureInfoNV buildInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_INFO_NV };
     buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_NV;
@@ -816,14 +938,15 @@ void VulkanCommandList::rebuildTopLevelAcceratationStructure(TopLevelAS& tlas)
     buildInfo.geometryCount = 0;
     buildInfo.pGeometries = nullptr;
 
+    bool updateInPlace = pendingBuild->updateInPlace;
     m_backend.rtx().vkCmdBuildAccelerationStructureNV(
         m_commandBuffer,
         &buildInfo,
-        instanceBuffer, 0,
-        VK_TRUE,
+        vulkanTlas.instanceBuffer, pendingBuild->instanceBufferOffset,
+        updateInPlace ? VK_TRUE : VK_FALSE,
         vulkanTlas.accelerationStructure,
-        vulkanTlas.accelerationStructure,
-        scratchBuffer, 0);
+        updateInPlace ? vulkanTlas.accelerationStructure : VK_NULL_HANDLE,
+        vulkanTlas.scratchBuffer, 0);
 
     VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
     barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_NV;
@@ -832,14 +955,6 @@ void VulkanCommandList::rebuildTopLevelAcceratationStructure(TopLevelAS& tlas)
                          VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_NV,
                          VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV,
                          0, 1, &barrier, 0, nullptr, 0, nullptr);
-
-    vmaDestroyBuffer(m_backend.globalAllocator(), scratchBuffer, scratchAllocation);
-
-    // Delete the old instance buffer & replace with the new one
-    ASSERT(vulkanTlas.associatedBuffers.size() == 1);
-    auto& [prevInstanceBuf, prevInstanceAlloc] = vulkanTlas.associatedBuffers[0];
-    vmaDestroyBuffer(m_backend.globalAllocator(), prevInstanceBuf, prevInstanceAlloc);
-    vulkanTlas.associatedBuffers[0] = { instanceBuffer, instanceAllocation };
 }
 
 void VulkanCommandList::traceRays(Extent2D extent)
@@ -888,30 +1003,6 @@ void VulkanCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z)
     vkCmdDispatch(m_commandBuffer, x, y, z);
 }
 
-void VulkanCommandList::waitEvent(uint8_t eventId, PipelineStage stage)
-{
-    VkEvent event = getEvent(eventId);
-    VkPipelineStageFlags flags = stageFlags(stage);
-
-    vkCmdWaitEvents(m_commandBuffer, 1, &event,
-                    flags, flags, // TODO: Might be required that we have different stages here later!
-                    0, nullptr,
-                    0, nullptr,
-                    0, nullptr);
-}
-
-void VulkanCommandList::resetEvent(uint8_t eventId, PipelineStage stage)
-{
-    VkEvent event = getEvent(eventId);
-    vkCmdResetEvent(m_commandBuffer, event, stageFlags(stage));
-}
-
-void VulkanCommandList::signalEvent(uint8_t eventId, PipelineStage stage)
-{
-    VkEvent event = getEvent(eventId);
-    vkCmdSetEvent(m_commandBuffer, event, stageFlags(stage));
-}
-
 void VulkanCommandList::slowBlockingReadFromBuffer(const Buffer& buffer, size_t offset, size_t size, void* dst)
 {
     ASSERT(offset < buffer.size());
@@ -1144,39 +1235,382 @@ void VulkanCommandList::textureWriteBarrier(const Texture& genTexture)
                          1, &barrier);
 }
 
-void VulkanCommandList::endNode(Badge<class VulkanBackend>)
+void VulkanCommandList::bufferWriteBarrier(std::vector<Buffer*> buffers)
+{
+    std::vector<VkBufferMemoryBarrier> barriers {};
+    for (Buffer* buffer : buffers) {
+        VkBufferMemoryBarrier barrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+        barrier.buffer = static_cast<VulkanBuffer*>(buffer)->buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        // all buffer writes must finish before any later memory access (r/w), including reading indirect arguments
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+        barriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(m_commandBuffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0,
+                         0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data(),
+                         0, nullptr);
+}
+
+void VulkanCommandList::beginNode(const RenderGraph::NodeSynchronization& synchronization, const std::vector<VkEvent>& events, bool reusesAliasedMemory, Badge<VulkanBackend>)
+{
+    // Resources coming from the other queue are acquired first, so that the barriers below synchronize against the acquire
+    if (!synchronization.queueAcquires.empty())
+        queueOwnershipBarrier(synchronization.queueAcquires, false, synchronization.asyncCompute);
+
+    // All barriers against the node right before (or the previous frame) are batched into a single pipeline barrier
+    {
+        BarrierBatch batch {};
+        for (const RenderGraph::ResourceBarrier& barrier : synchronization.barriers)
+            addResourceBarrier(batch, barrier);
+
+        if (reusesAliasedMemory) {
+            batch.srcStageMask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            batch.dstStageMask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            batch.memoryBarrier.srcAccessMask |= VK_ACCESS_MEMORY_WRITE_BIT;
+            batch.memoryBarrier.dstAccessMask |= VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+
+        if (batch.srcStageMask != 0) {
+            bool hasMemoryBarrier = batch.memoryBarrier.srcAccessMask != 0 || batch.memoryBarrier.dstAccessMask != 0;
+            vkCmdPipelineBarrier(m_commandBuffer,
+                                 batch.srcStageMask, batch.dstStageMask, 0,
+                                 hasMemoryBarrier ? 1 : 0, &batch.memoryBarrier,
+                                 static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+                                 static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+        }
+    }
+
+    // ..and all barriers against nodes further back into a single wait for their events
+    if (!synchronization.waitEvents.empty()) {
+        BarrierBatch batch {};
+        for (const RenderGraph::ResourceBarrier& barrier : synchronization.eventBarriers)
+            addResourceBarrier(batch, barrier);
+
+        std::vector<VkEvent> waitEvents {};
+        for (uint32_t event : synchronization.waitEvents)
+            waitEvents.push_back(events[event]);
+
+        // (the source stages must match the stages the events are signaled with, see endNode)
+        bool hasMemoryBarrier = batch.memoryBarrier.srcAccessMask != 0 || batch.memoryBarrier.dstAccessMask != 0;
+        vkCmdWaitEvents(m_commandBuffer,
+                        static_cast<uint32_t>(waitEvents.size()), waitEvents.data(),
+                        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, batch.dstStageMask,
+                        hasMemoryBarrier ? 1 : 0, &batch.memoryBarrier,
+                        static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+                        static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+    }
+}
+
+void VulkanCommandList::endNode(const RenderGraph::NodeSynchronization& synchronization, const std::vector<VkEvent>& events, Badge<VulkanBackend>)
 {
     endCurrentRenderPassIfAny();
-    debugBarrier(); // TODO: We probably don't need to do this..?
+
+    // Signaled for all commands so far, but since the later nodes waiting for the event come after the commands in between, those can
+    // still overlap with this node
+    if (synchronization.signalEvent.has_value())
+        vkCmdSetEvent(m_commandBuffer, events[synchronization.signalEvent.value()], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    // No later node waits for these events, so reset them for the next time the frame is recorded (as it expects all to be unsignaled)
+    for (uint32_t event : synchronization.resetEvents)
+        vkCmdResetEvent(m_commandBuffer, events[event], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    if (!synchronization.queueReleases.empty())
+        queueOwnershipBarrier(synchronization.queueReleases, true, synchronization.asyncCompute);
+}
+
+void VulkanCommandList::releaseQueueOwnership(const std::vector<NodeResourceAccess>& accesses, bool fromAsyncCompute, Badge<VulkanBackend>)
+{
+    if (!accesses.empty())
+        queueOwnershipBarrier(accesses, true, fromAsyncCompute);
+}
+
+void VulkanCommandList::acquireQueueOwnership(const std::vector<NodeResourceAccess>& accesses, bool toAsyncCompute, Badge<VulkanBackend>)
+{
+    if (!accesses.empty())
+        queueOwnershipBarrier(accesses, false, toAsyncCompute);
+}
+
+void VulkanCommandList::queueOwnershipBarrier(const std::vector<NodeResourceAccess>& accesses, bool isRelease, bool onAsyncCompute)
+{
+    uint32_t graphicsFamily = m_backend.m_graphicsQueue.familyIndex;
+    uint32_t asyncComputeFamily = m_backend.m_computeQueue.familyIndex;
+
+    uint32_t srcFamily = (isRelease == onAsyncCompute) ? asyncComputeFamily : graphicsFamily;
+    uint32_t dstFamily = (isRelease == onAsyncCompute) ? graphicsFamily : asyncComputeFamily;
+
+    // The release makes all earlier writes on its queue available, and the semaphore between the two halves takes care of the execution
+    // dependency, so the acquire only has to make the resources visible to the next access. Neither half transitions the layout, as the
+    // next access does that itself if needed, after the acquire.
+    VkPipelineStageFlags srcStages = isRelease ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkPipelineStageFlags dstStages = isRelease ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : 0;
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers {};
+    std::vector<VkImageMemoryBarrier> imageBarriers {};
+
+    for (const NodeResourceAccess& access : accesses) {
+        VkAccessFlags srcAccess = isRelease ? VK_ACCESS_MEMORY_WRITE_BIT : 0;
+        VkAccessFlags dstAccess = isRelease ? 0 : accessFlags(access);
+
+        if (access.texture) {
+            auto& texture = static_cast<VulkanTexture&>(*access.texture);
+
+            // (the window render target is only for the graphics queue, as its layouts are managed by its render pass)
+            ASSERT(!isWindowTexture(texture));
+
+            // (there are no contents to keep if the texture is undefined, and a barrier can't keep it in the undefined layout)
+            if (texture.currentLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+                continue;
+
+            VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            imageBarrier.oldLayout = texture.currentLayout;
+            imageBarrier.newLayout = texture.currentLayout;
+            imageBarrier.srcQueueFamilyIndex = srcFamily;
+            imageBarrier.dstQueueFamilyIndex = dstFamily;
+            imageBarrier.srcAccessMask = srcAccess;
+            imageBarrier.dstAccessMask = dstAccess;
+
+            imageBarrier.image = texture.image;
+            imageBarrier.subresourceRange.aspectMask = texture.hasDepthFormat() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = texture.mipLevels();
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = texture.layerCount();
+
+            imageBarriers.push_back(imageBarrier);
+        } else {
+            VkBufferMemoryBarrier bufferBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+            bufferBarrier.buffer = static_cast<VulkanBuffer&>(*access.buffer).buffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            bufferBarrier.srcQueueFamilyIndex = srcFamily;
+            bufferBarrier.dstQueueFamilyIndex = dstFamily;
+            bufferBarrier.srcAccessMask = srcAccess;
+            bufferBarrier.dstAccessMask = dstAccess;
+
+            bufferBarriers.push_back(bufferBarrier);
+        }
+
+        if (!isRelease)
+            dstStages |= stageFlags(access);
+    }
+
+    if (bufferBarriers.empty() && imageBarriers.empty())
+        return;
+
+    vkCmdPipelineBarrier(m_commandBuffer,
+                         srcStages, dstStages, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
 }
 
 void VulkanCommandList::endCurrentRenderPassIfAny()
 {
     if (activeRenderState) {
+        // Even if nothing was drawn we have to begin the render pass, as it might have clears to perform
+        beginPendingRenderPassIfAny(VK_SUBPASS_CONTENTS_INLINE);
         vkCmdEndRenderPass(m_commandBuffer);
         activeRenderState = nullptr;
+        m_renderPassHasSecondaryContents = false;
+    }
+}
+
+void VulkanCommandList::beginPendingRenderPassIfAny(VkSubpassContents subpassContents)
+{
+    if (!m_pendingRenderPass.has_value())
+        return;
+
+    // TODO: Handle subpasses properly!
+    vkCmdBeginRenderPass(m_commandBuffer, &m_pendingRenderPass.value(), subpassContents);
+    m_pendingRenderPass.reset();
+}
+
+void VulkanCommandList::continueRenderPassOf(const VulkanCommandList& primary)
+{
+    ASSERT(primary.activeRenderState);
+    activeRenderState = primary.activeRenderState;
+
+    // Secondary command buffers don't inherit any of the state bound in the primary, so bind it again
+    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activeRenderState->pipeline);
+
+    for (uint32_t index = 0; index < primary.m_boundDescriptorSets.size(); ++index) {
+        VkDescriptorSet descriptorSet = primary.m_boundDescriptorSets[index];
+        if (descriptorSet != VK_NULL_HANDLE)
+            vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activeRenderState->pipelineLayout, index, 1, &descriptorSet, 0, nullptr);
+    }
+
+    for (const PushedConstants& pushedConstants : primary.m_pushedConstants) {
+        vkCmdPushConstants(m_commandBuffer, activeRenderState->pipelineLayout, pushedConstants.stageFlags,
+                           pushedConstants.byteOffset, pushedConstants.data.size(), pushedConstants.data.data());
     }
+
+    m_boundDescriptorSets = primary.m_boundDescriptorSets;
+    m_pushedConstants = primary.m_pushedConstants;
 }
 
-VkEvent VulkanCommandList::getEvent(uint8_t eventId)
+void VulkanCommandList::addResourceBarrier(BarrierBatch& batch, const RenderGraph::ResourceBarrier& barrier)
 {
-    const auto& events = m_backend.m_events;
+    const NodeResourceAccess& nextAccess = barrier.nextAccess;
+    bool hasPreviousAccesses = !barrier.previousAccesses.empty();
+
+    VkPipelineStageFlags dstStages = stageFlags(nextAccess);
+    VkAccessFlags dstAccess = accessFlags(nextAccess);
+
+    // With no previous accesses the barrier waits for its own stages, which is enough for a layout transition, and also chains with
+    // the wait for the swapchain image to be acquired (since it's for the color attachment output stage)
+    VkPipelineStageFlags srcStages = hasPreviousAccesses ? 0 : dstStages;
+    VkAccessFlags srcAccess = 0;
+    for (const NodeResourceAccess& previousAccess : barrier.previousAccesses) {
+        srcStages |= stageFlags(previousAccess);
+        if (previousAccess.isWrite())
+            srcAccess |= accessFlags(previousAccess);
+    }
+
+    if (nextAccess.texture) {
+        auto& texture = static_cast<VulkanTexture&>(*nextAccess.texture);
+
+        if (isWindowTexture(texture)) {
+            // The window render target has its layouts managed by its render pass, so all we need is to synchronize the access
+            if (!hasPreviousAccesses)
+                return;
+            batch.memoryBarrier.srcAccessMask |= srcAccess;
+            batch.memoryBarrier.dstAccessMask |= dstAccess;
+        } else {
+            VkImageLayout layout = imageLayout(nextAccess);
+            if (!hasPreviousAccesses && texture.currentLayout == layout)
+                return;
+
+            VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            imageBarrier.oldLayout = texture.currentLayout;
+            imageBarrier.newLayout = layout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.srcAccessMask = srcAccess;
+            imageBarrier.dstAccessMask = dstAccess;
 
-    if (eventId >= events.size()) {
-        LogErrorAndExit("Event of id %u requested, which is >= than the number of created events (%u)\n", eventId, events.size());
+            imageBarrier.image = texture.image;
+            imageBarrier.subresourceRange.aspectMask = texture.hasDepthFormat() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = texture.mipLevels();
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = texture.layerCount();
+
+            batch.imageBarriers.push_back(imageBarrier);
+            texture.currentLayout = layout;
+        }
+    } else {
+        // (buffers have no layouts, so their first access needs no barrier)
+        if (!hasPreviousAccesses)
+            return;
+
+        VkBufferMemoryBarrier bufferBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+        bufferBarrier.buffer = static_cast<VulkanBuffer*>(nextAccess.buffer)->buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        bufferBarrier.srcAccessMask = srcAccess;
+        bufferBarrier.dstAccessMask = dstAccess;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+        batch.bufferBarriers.push_back(bufferBarrier);
     }
-    return events[eventId];
+
+    batch.srcStageMask |= srcStages;
+    batch.dstStageMask |= dstStages;
+}
+
+bool VulkanCommandList::isWindowTexture(const VulkanTexture& texture) const
+{
+    if (&texture == m_backend.m_swapchainDepthTexture.get())
+        return true;
+    return std::any_of(m_backend.m_swapchainMockColorTextures.begin(), m_backend.m_swapchainMockColorTextures.end(), [&](auto& windowTexture) {
+        return &texture == windowTexture.get();
+    });
+}
+
+VkPipelineStageFlags VulkanCommandList::stageFlags(const NodeResourceAccess& access) const
+{
+    VkPipelineStageFlags flags = 0;
+
+    if (access.shaderStages & ShaderStageVertex)
+        flags |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    if (access.shaderStages & ShaderStageFragment)
+        flags |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    if (access.shaderStages & ShaderStageCompute)
+        flags |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if (access.shaderStages & (ShaderStageRTRayGen | ShaderStageRTMiss | ShaderStageRTClosestHit | ShaderStageRTAnyHit | ShaderStageRTIntersection))
+        flags |= VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV;
+
+    switch (access.type) {
+    case ResourceAccessType::ColorAttachment:
+        flags |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        break;
+    case ResourceAccessType::DepthAttachment:
+        flags |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        break;
+    default:
+        break;
+    }
+
+    // (shouldn't happen, but bindings without any shader stages are technically possible)
+    if (flags == 0)
+        flags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    return flags;
+}
+
+VkAccessFlags VulkanCommandList::accessFlags(const NodeResourceAccess& access) const
+{
+    VkAccessFlags flags = 0;
+
+    if (access.shaderStages != 0) {
+        flags |= VK_ACCESS_SHADER_READ_BIT;
+        if (access.buffer)
+            flags |= VK_ACCESS_UNIFORM_READ_BIT;
+        if (access.isWrite())
+            flags |= VK_ACCESS_SHADER_WRITE_BIT;
+    }
+
+    switch (access.type) {
+    case ResourceAccessType::ColorAttachment:
+        flags |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case ResourceAccessType::DepthAttachment:
+        flags |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    default:
+        break;
+    }
+
+    if (flags == 0)
+        flags = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    return flags;
 }
 
-VkPipelineStageFlags VulkanCommandList::stageFlags(PipelineStage stage) const
+VkImageLayout VulkanCommandList::imageLayout(const NodeResourceAccess& access) const
 {
-    switch (stage) {
-    case PipelineStage::Host:
-        return VK_PIPELINE_STAGE_HOST_BIT;
-    case PipelineStage::Compute:
-        return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-    case PipelineStage::RayTracing:
-        return VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV;
+    switch (access.type) {
+    case ResourceAccessType::ShaderRead:
+        return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    case ResourceAccessType::ShaderReadWrite:
+        return VK_IMAGE_LAYOUT_GENERAL;
+    case ResourceAccessType::ColorAttachment:
+        return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    case ResourceAccessType::DepthAttachment:
+        return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     default:
         ASSERT_NOT_REACHED();
     }
@@ -4,7 +4,7 @@
 
 class VulkanCommandList final : public CommandList {
 public:
-    explicit VulkanCommandList(VulkanBackend&, VkCommandBuffer);
+    explicit VulkanCommandList(VulkanBackend&, VkCommandBuffer, std::vector<VulkanBackend::SecondaryCommandPool>* = nullptr);
 
     void clearTexture(Texture&, ClearColor) override;
     void copyTexture(Texture& src, Texture& dst, uint32_t srcLayer = 0, uint32_t dstLayer = 0) override;
@@ -22,39 +22,63 @@ public:
 
     void draw(Buffer& vertexBuffer, uint32_t vertexCount) override;
     void drawIndexed(const Buffer& vertexBuffer, const Buffer& indexBuffer, uint32_t indexCount, IndexType, uint32_t instanceIndex) override;
+    void drawIndexedIndirect(const Buffer& vertexBuffer, const Buffer& indexBuffer, IndexType, const Buffer& indirectBuffer, const Buffer& countBuffer, uint32_t maxDrawCount) override;
 
-    void rebuildTopLevelAcceratationStructure(TopLevelAS&) override;
+    void drawInParallel(size_t itemCount, const ParallelDrawCallback&) override;
+
+    void updateTopLevelAccelerationStructure(TopLevelAS&) override;
     void traceRays(Extent2D) override;
 
     void dispatch(Extent3D globalSize, Extent3D localSize) override;
     void dispatch(uint32_t x, uint32_t y, uint32_t z = 1) override;
 
-    void waitEvent(uint8_t eventId, PipelineStage) override;
-    void resetEvent(uint8_t eventId, PipelineStage) override;
-    void signalEvent(uint8_t eventId, PipelineStage) override;
-
     void debugBarrier() override;
     void beginDebugLabel(const std::string&) override;
     void endDebugLabel() override;
 
     void textureWriteBarrier(const Texture&) override;
+    void bufferWriteBarrier(std::vector<Buffer*>) override;
 
     void slowBlockingReadFromBuffer(const Buffer&, size_t offset, size_t size, void* dst) override;
 
     void saveTextureToFile(const Texture&, const std::string&) override;
 
-    void endNode(Badge<VulkanBackend>);
+    //! Perform the synchronization that the render graph derived for the node, before & after it executes. If aliased resources begin their
+    //! lifetime in the node it also has to wait for all earlier work, since their memory may have been used by any earlier node.
+    void beginNode(const RenderGraph::NodeSynchronization&, const std::vector<VkEvent>& events, bool reusesAliasedMemory, Badge<VulkanBackend>);
+    void endNode(const RenderGraph::NodeSynchronization&, const std::vector<VkEvent>& events, Badge<VulkanBackend>);
+
+    //! Transfer ownership of resources between the graphics & async compute queues, which takes a release on the queue that owns them, and
+    //! then an acquire on the other queue, after waiting on a semaphore that is signaled after the release. (The nodes do this themselves.)
+    void releaseQueueOwnership(const std::vector<NodeResourceAccess>&, bool fromAsyncCompute, Badge<VulkanBackend>);
+    void acquireQueueOwnership(const std::vector<NodeResourceAccess>&, bool toAsyncCompute, Badge<VulkanBackend>);
 
 private:
     void endCurrentRenderPassIfAny();
 
+    //! The render pass is begun lazily, since we don't know if its contents will be inline or secondary until the first draw
+    void beginPendingRenderPassIfAny(VkSubpassContents);
+    void continueRenderPassOf(const VulkanCommandList& primary);
+
     VulkanBackend& backend() { return m_backend; }
 
     VkDevice device() { return backend().device(); }
     VkPhysicalDevice physicalDevice() { return backend().physicalDevice(); }
 
-    VkEvent getEvent(uint8_t eventId);
-    VkPipelineStageFlags stageFlags(PipelineStage) const;
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStageMask { 0 };
+        VkPipelineStageFlags dstStageMask { 0 };
+        VkMemoryBarrier memoryBarrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        std::vector<VkBufferMemoryBarrier> bufferBarriers {};
+        std::vector<VkImageMemoryBarrier> imageBarriers {};
+    };
+    void addResourceBarrier(BarrierBatch&, const RenderGraph::ResourceBarrier&);
+    void queueOwnershipBarrier(const std::vector<NodeResourceAccess>&, bool isRelease, bool onAsyncCompute);
+    bool isWindowTexture(const VulkanTexture&) const;
+
+    VkPipelineStageFlags stageFlags(const NodeResourceAccess&) const;
+    VkAccessFlags accessFlags(const NodeResourceAccess&) const;
+    VkImageLayout imageLayout(const NodeResourceAccess&) const;
 
     // TODO: Remove this.. Make something more fine grained
     void transitionImageLayoutDEBUG(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkImageAspectFlags, VkCommandBuffer) const;
@@ -66,4 +90,19 @@ private:
     const VulkanRenderState* activeRenderState = nullptr;
     const VulkanComputeState* activeComputeState = nullptr;
     const VulkanRayTracingState* activeRayTracingState = nullptr;
+
+    std::vector<VulkanBackend::SecondaryCommandPool>* m_secondaryCommandPools { nullptr };
+
+    std::optional<VkRenderPassBeginInfo> m_pendingRenderPass {};
+    std::vector<VkClearValue> m_pendingClearValues {};
+    bool m_renderPassHasSecondaryContents { false };
+
+    // Graphics state of the active render pass, which secondary command buffers need to replay as they don't inherit it
+    std::vector<VkDescriptorSet> m_boundDescriptorSets {};
+    struct PushedConstants {
+        VkShaderStageFlags stageFlags;
+        uint32_t byteOffset;
+        std::vector<uint8_t> data;
+    };
+    std::vector<PushedConstants> m_pushedConstants {};
 };
@@ -0,0 +1,233 @@
+#include "VulkanDescriptorAllocator.h"
+
+#include "backend/vulkan/VulkanBackend.h"
+#include "utility/Logging.h"
+#include "utility/util.h"
+#include <algorithm>
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(VulkanBackend& backend)
+    : m_backend(backend)
+{
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+    VkDevice device = m_backend.device();
+
+    for (VkDescriptorPool pool : m_persistentPools.pools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    for (auto& [scope, poolGroup] : m_transientScopes) {
+        for (VkDescriptorPool pool : poolGroup.pools)
+            vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    for (VkDescriptorPool pool : m_freeTransientPools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+
+    for (auto& [key, layout] : m_layoutCache)
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+bool VulkanDescriptorAllocator::LayoutKey::operator==(const LayoutKey& other) const
+{
+    return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+                      [](const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs) {
+                          return lhs.binding == rhs.binding
+                              && lhs.descriptorType == rhs.descriptorType
+                              && lhs.descriptorCount == rhs.descriptorCount
+                              && lhs.stageFlags == rhs.stageFlags;
+                      });
+}
+
+size_t VulkanDescriptorAllocator::LayoutKeyHasher::operator()(const LayoutKey& key) const
+{
+    auto hashCombine = [](size_t& seed, size_t value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+
+    size_t hash = key.bindings.size();
+    for (const VkDescriptorSetLayoutBinding& binding : key.bindings) {
+        hashCombine(hash, binding.binding);
+        hashCombine(hash, binding.descriptorType);
+        hashCombine(hash, binding.descriptorCount);
+        hashCombine(hash, binding.stageFlags);
+    }
+    return hash;
+}
+
+VkDescriptorSetLayout VulkanDescriptorAllocator::getOrCreateLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    LayoutKey key { bindings };
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& lhs, const VkDescriptorSetLayoutBinding& rhs) {
+        return lhs.binding < rhs.binding;
+    });
+
+    auto entry = m_layoutCache.find(key);
+    if (entry != m_layoutCache.end())
+        return entry->second;
+
+    std::vector<VkDescriptorPoolSize> poolSizes {};
+    for (const VkDescriptorSetLayoutBinding& binding : key.bindings) {
+        // We don't support immutable samplers, and they would not be compared when looking up the layout
+        ASSERT(binding.pImmutableSamplers == nullptr);
+
+        auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& poolSize) {
+            return poolSize.type == binding.descriptorType;
+        });
+        if (poolSize == poolSizes.end())
+            poolSizes.push_back({ binding.descriptorType, binding.descriptorCount });
+        else
+            poolSize->descriptorCount += binding.descriptorCount;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    descriptorSetLayoutCreateInfo.bindingCount = key.bindings.size();
+    descriptorSetLayoutCreateInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(m_backend.device(), &descriptorSetLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanDescriptorAllocator: error trying to create descriptor set layout\n");
+    }
+
+    m_layoutPoolSizes[layout] = std::move(poolSizes);
+    m_layoutCache[std::move(key)] = layout;
+
+    return layout;
+}
+
+VulkanDescriptorAllocator::Allocation VulkanDescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    if (m_currentTransientScope.has_value())
+        return allocateFromGroup(m_transientScopes[m_currentTransientScope.value()], true, layout);
+    return allocateFromGroup(m_persistentPools, false, layout);
+}
+
+void VulkanDescriptorAllocator::free(const Allocation& allocation)
+{
+    // Transient sets are released with the rest of their scope
+    if (allocation.transient)
+        return;
+
+    vkFreeDescriptorSets(m_backend.device(), allocation.descriptorPool, 1, &allocation.descriptorSet);
+}
+
+VulkanDescriptorAllocator::TransientScope VulkanDescriptorAllocator::beginTransientScope()
+{
+    ASSERT(!m_currentTransientScope.has_value());
+
+    TransientScope scope = m_nextTransientScope++;
+    m_transientScopes[scope] = PoolGroup();
+    m_currentTransientScope = scope;
+
+    return scope;
+}
+
+void VulkanDescriptorAllocator::endTransientScope()
+{
+    ASSERT(m_currentTransientScope.has_value());
+    m_currentTransientScope.reset();
+}
+
+void VulkanDescriptorAllocator::releaseTransientScope(TransientScope scope)
+{
+    ASSERT(m_currentTransientScope != scope);
+
+    auto entry = m_transientScopes.find(scope);
+    ASSERT(entry != m_transientScopes.end());
+
+    for (VkDescriptorPool pool : entry->second.pools) {
+        vkResetDescriptorPool(m_backend.device(), pool, 0u);
+        m_freeTransientPools.push_back(pool);
+    }
+
+    m_transientScopes.erase(entry);
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::createPool(bool transient, const std::vector<VkDescriptorPoolSize>& minimumPoolSizes) const
+{
+    constexpr uint32_t descriptorsPerTypePerSet = 4;
+
+    std::vector<VkDescriptorType> descriptorTypes = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
+    if (m_backend.hasActiveCapability(Backend::Capability::RtxRayTracing))
+        descriptorTypes.push_back(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV);
+
+    std::vector<VkDescriptorPoolSize> poolSizes {};
+    for (VkDescriptorType type : descriptorTypes) {
+        uint32_t descriptorCount = setsPerPool * descriptorsPerTypePerSet;
+
+        // (make sure that a single large set, e.g. with big texture arrays, will always fit in a fresh pool)
+        for (const VkDescriptorPoolSize& minimumPoolSize : minimumPoolSizes) {
+            if (minimumPoolSize.type == type)
+                descriptorCount = std::max(descriptorCount, minimumPoolSize.descriptorCount);
+        }
+
+        poolSizes.push_back({ type, descriptorCount });
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    descriptorPoolCreateInfo.poolSizeCount = poolSizes.size();
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
+    descriptorPoolCreateInfo.maxSets = setsPerPool;
+
+    // Transient pools are only ever reset as a whole
+    if (!transient)
+        descriptorPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(m_backend.device(), &descriptorPoolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanDescriptorAllocator: error trying to create descriptor pool\n");
+    }
+
+    return pool;
+}
+
+std::optional<VkDescriptorSet> VulkanDescriptorAllocator::tryAllocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout) const
+{
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    descriptorSetAllocateInfo.descriptorPool = pool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &layout;
+
+    // NOTE: Any failure here is either VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL, which both mean we need another pool
+    VkDescriptorSet descriptorSet;
+    if (vkAllocateDescriptorSets(m_backend.device(), &descriptorSetAllocateInfo, &descriptorSet) != VK_SUCCESS)
+        return {};
+
+    return descriptorSet;
+}
+
+VulkanDescriptorAllocator::Allocation VulkanDescriptorAllocator::allocateFromGroup(PoolGroup& poolGroup, bool transient, VkDescriptorSetLayout layout)
+{
+    auto layoutPoolSizes = m_layoutPoolSizes.find(layout);
+    ASSERT(layoutPoolSizes != m_layoutPoolSizes.end());
+
+    // Only the most recent pool of the group can have space left (unless persistent sets have been freed, but then we just accept some waste)
+    if (!poolGroup.pools.empty()) {
+        VkDescriptorPool pool = poolGroup.pools.back();
+        if (auto descriptorSet = tryAllocateFromPool(pool, layout))
+            return { descriptorSet.value(), pool, transient };
+    }
+
+    if (transient) {
+        while (!m_freeTransientPools.empty()) {
+            VkDescriptorPool pool = m_freeTransientPools.back();
+            m_freeTransientPools.pop_back();
+            poolGroup.pools.push_back(pool);
+
+            if (auto descriptorSet = tryAllocateFromPool(pool, layout))
+                return { descriptorSet.value(), pool, transient };
+        }
+    }
+
+    VkDescriptorPool pool = createPool(transient, layoutPoolSizes->second);
+    poolGroup.pools.push_back(pool);
+
+    auto descriptorSet = tryAllocateFromPool(pool, layout);
+    if (!descriptorSet.has_value()) {
+        LogErrorAndExit("VulkanDescriptorAllocator: could not allocate descriptor set from a fresh pool\n");
+    }
+
+    return { descriptorSet.value(), pool, transient };
+}
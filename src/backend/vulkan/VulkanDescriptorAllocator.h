@@ -0,0 +1,74 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanBackend;
+
+//! Allocates descriptor sets from shared, growable pools, and caches descriptor set layouts so identical layouts are only created once.
+//! Sets are either persistent, and freed individually, or transient, and only ever released all at once together with the rest of
+//! the sets of their transient scope (e.g. all sets of the render graph registries, which are replaced together on reconstruction).
+class VulkanDescriptorAllocator {
+public:
+    explicit VulkanDescriptorAllocator(VulkanBackend&);
+    ~VulkanDescriptorAllocator();
+
+    VulkanDescriptorAllocator(VulkanDescriptorAllocator&) = delete;
+    VulkanDescriptorAllocator& operator=(VulkanDescriptorAllocator&) = delete;
+
+    //! Get a layout for the bindings, creating it only if no identical layout has been requested before. The layout is owned by the allocator.
+    VkDescriptorSetLayout getOrCreateLayout(const std::vector<VkDescriptorSetLayoutBinding>&);
+
+    struct Allocation {
+        VkDescriptorSet descriptorSet {};
+        VkDescriptorPool descriptorPool {};
+        bool transient { false };
+    };
+
+    //! Allocate a set for the layout (which must come from getOrCreateLayout). It's transient if there is an open transient scope.
+    Allocation allocate(VkDescriptorSetLayout);
+    void free(const Allocation&);
+
+    using TransientScope = uint32_t;
+
+    //! All sets allocated until the scope is ended will be transient and belong to the returned scope
+    TransientScope beginTransientScope();
+    void endTransientScope();
+
+    //! Release all sets of the scope at once by resetting their pools, which are then reused for later scopes. None of the sets may be in use.
+    void releaseTransientScope(TransientScope);
+
+private:
+    struct LayoutKey {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        bool operator==(const LayoutKey&) const;
+    };
+
+    struct LayoutKeyHasher {
+        size_t operator()(const LayoutKey&) const;
+    };
+
+    struct PoolGroup {
+        std::vector<VkDescriptorPool> pools {};
+    };
+
+    VkDescriptorPool createPool(bool transient, const std::vector<VkDescriptorPoolSize>& minimumPoolSizes) const;
+    std::optional<VkDescriptorSet> tryAllocateFromPool(VkDescriptorPool, VkDescriptorSetLayout) const;
+    Allocation allocateFromGroup(PoolGroup&, bool transient, VkDescriptorSetLayout);
+
+    VulkanBackend& m_backend;
+
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHasher> m_layoutCache {};
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorPoolSize>> m_layoutPoolSizes {};
+
+    PoolGroup m_persistentPools {};
+
+    std::unordered_map<TransientScope, PoolGroup> m_transientScopes {};
+    std::vector<VkDescriptorPool> m_freeTransientPools {};
+    std::optional<TransientScope> m_currentTransientScope {};
+    TransientScope m_nextTransientScope { 0 };
+
+    static constexpr uint32_t setsPerPool = 256;
+};
@@ -2,6 +2,8 @@
 
 #include "backend/vulkan/VulkanBackend.h"
 #include "utility/Logging.h"
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 VulkanRTX::VulkanRTX(VulkanBackend& backend, VkPhysicalDevice physicalDevice, VkDevice device)
@@ -19,6 +21,8 @@ VulkanRTX::VulkanRTX(VulkanBackend& backend, VkPhysicalDevice physicalDevice, Vk
     vkGetAccelerationStructureHandleNV = reinterpret_cast<PFN_vkGetAccelerationStructureHandleNV>(vkGetDeviceProcAddr(m_device, "vkGetAccelerationStructureHandleNV"));
     vkGetAccelerationStructureMemoryRequirementsNV = reinterpret_cast<PFN_vkGetAccelerationStructureMemoryRequirementsNV>(vkGetDeviceProcAddr(m_device, "vkGetAccelerationStructureMemoryRequirementsNV"));
     vkCmdBuildAccelerationStructureNV = reinterpret_cast<PFN_vkCmdBuildAccelerationStructureNV>(vkGetDeviceProcAddr(m_device, "vkCmdBuildAccelerationStructureNV"));
+    vkCmdCopyAccelerationStructureNV = reinterpret_cast<PFN_vkCmdCopyAccelerationStructureNV>(vkGetDeviceProcAddr(m_device, "vkCmdCopyAccelerationStructureNV"));
+    vkCmdWriteAccelerationStructuresPropertiesNV = reinterpret_cast<PFN_vkCmdWriteAccelerationStructuresPropertiesNV>(vkGetDeviceProcAddr(m_device, "vkCmdWriteAccelerationStructuresPropertiesNV"));
     vkCreateRayTracingPipelinesNV = reinterpret_cast<PFN_vkCreateRayTracingPipelinesNV>(vkGetDeviceProcAddr(m_device, "vkCreateRayTracingPipelinesNV"));
     vkGetRayTracingShaderGroupHandlesNV = reinterpret_cast<PFN_vkGetRayTracingShaderGroupHandlesNV>(vkGetDeviceProcAddr(m_device, "vkGetRayTracingShaderGroupHandlesNV"));
     vkCmdTraceRaysNV = reinterpret_cast<PFN_vkCmdTraceRaysNV>(vkGetDeviceProcAddr(m_device, "vkCmdTraceRaysNV"));
@@ -54,7 +58,7 @@ const VkPhysicalDeviceRayTracingPropertiesNV& VulkanRTX::properties() const
     return m_rayTracingProperties;
 }
 
-VkBuffer VulkanRTX::createInstanceBuffer(const std::vector<RTGeometryInstance>& instances, VmaAllocation& allocation) const
+VkBuffer VulkanRTX::createInstanceBuffer(const std::vector<RTGeometryInstance>& instances, uint32_t copyCount, VmaAllocation& allocation, void*& mappedData) const
 {
     std::vector<VulkanRTX::GeometryInstance> instanceData {};
 
@@ -79,12 +83,12 @@ VkBuffer VulkanRTX::createInstanceBuffer(const std::vector<RTGeometryInstance>&
         instanceData.push_back(data);
     }
 
-    VkDeviceSize totalSize = instanceData.size() * sizeof(VulkanRTX::GeometryInstance);
+    VkDeviceSize copySize = instanceData.size() * sizeof(VulkanRTX::GeometryInstance);
 
     VkBufferCreateInfo instanceBufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     instanceBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     instanceBufferCreateInfo.usage = VK_BUFFER_USAGE_RAY_TRACING_BIT_NV;
-    instanceBufferCreateInfo.size = totalSize;
+    instanceBufferCreateInfo.size = std::max(copyCount * copySize, VkDeviceSize(1));
 
     if (vulkanDebugMode) {
         // for nsight debugging & similar stuff)
@@ -93,34 +97,56 @@ VkBuffer VulkanRTX::createInstanceBuffer(const std::vector<RTGeometryInstance>&
 
     VmaAllocationCreateInfo instanceAllocCreateInfo = {};
     instanceAllocCreateInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    instanceAllocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
     VkBuffer instanceBuffer;
-    if (vmaCreateBuffer(m_backend.globalAllocator(), &instanceBufferCreateInfo, &instanceAllocCreateInfo, &instanceBuffer, &allocation, nullptr) != VK_SUCCESS) {
-        LogError("Could not create RTX instance buffer.\n");
+    VmaAllocationInfo allocationInfo;
+    if (vmaCreateBuffer(m_backend.globalAllocator(), &instanceBufferCreateInfo, &instanceAllocCreateInfo, &instanceBuffer, &allocation, &allocationInfo) != VK_SUCCESS) {
+        LogErrorAndExit("Could not create RTX instance buffer.\n");
     }
 
-    if (!m_backend.setBufferMemoryUsingMapping(allocation, instanceData.data(), totalSize)) {
-        LogError("Could not set RTX instance instance buffer data.\n");
+    mappedData = allocationInfo.pMappedData;
+    for (uint32_t copy = 0; copy < copyCount; ++copy) {
+        std::memcpy(static_cast<std::byte*>(mappedData) + copy * copySize, instanceData.data(), copySize);
     }
+    vmaFlushAllocation(m_backend.globalAllocator(), allocation, 0, VK_WHOLE_SIZE);
 
     return instanceBuffer;
 }
 
 VkBuffer VulkanRTX::createScratchBufferForAccelerationStructure(VkAccelerationStructureNV accelerationStructure, bool updateInPlace, VmaAllocation& allocation) const
 {
-    VkAccelerationStructureMemoryRequirementsInfoNV memoryRequirementsInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_INFO_NV };
-    memoryRequirementsInfo.type = updateInPlace
+    auto requirementsType = updateInPlace
         ? VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_UPDATE_SCRATCH_NV
         : VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_NV;
+    return createScratchBuffer(scratchMemoryRequirements(accelerationStructure, requirementsType).size, allocation);
+}
+
+VkBuffer VulkanRTX::createScratchBufferForBuildsAndUpdates(VkAccelerationStructureNV accelerationStructure, VmaAllocation& allocation) const
+{
+    VkDeviceSize buildSize = scratchMemoryRequirements(accelerationStructure, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_BUILD_SCRATCH_NV).size;
+    VkDeviceSize updateSize = scratchMemoryRequirements(accelerationStructure, VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_UPDATE_SCRATCH_NV).size;
+    return createScratchBuffer(std::max(buildSize, updateSize), allocation);
+}
+
+VkMemoryRequirements VulkanRTX::scratchMemoryRequirements(VkAccelerationStructureNV accelerationStructure, VkAccelerationStructureMemoryRequirementsTypeNV requirementsType) const
+{
+    VkAccelerationStructureMemoryRequirementsInfoNV memoryRequirementsInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_INFO_NV };
+    memoryRequirementsInfo.type = requirementsType;
 
     VkMemoryRequirements2 scratchMemRequirements2;
     memoryRequirementsInfo.accelerationStructure = accelerationStructure;
     vkGetAccelerationStructureMemoryRequirementsNV(m_backend.device(), &memoryRequirementsInfo, &scratchMemRequirements2);
 
+    return scratchMemRequirements2.memoryRequirements;
+}
+
+VkBuffer VulkanRTX::createScratchBuffer(VkDeviceSize size, VmaAllocation& allocation) const
+{
     VkBufferCreateInfo scratchBufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     scratchBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     scratchBufferCreateInfo.usage = VK_BUFFER_USAGE_RAY_TRACING_BIT_NV;
-    scratchBufferCreateInfo.size = scratchMemRequirements2.memoryRequirements.size;
+    scratchBufferCreateInfo.size = size;
 
     if (vulkanDebugMode) {
         // for nsight debugging & similar stuff)
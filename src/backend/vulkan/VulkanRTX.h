@@ -19,14 +19,19 @@ public:
     PFN_vkGetAccelerationStructureHandleNV vkGetAccelerationStructureHandleNV { nullptr };
     PFN_vkGetAccelerationStructureMemoryRequirementsNV vkGetAccelerationStructureMemoryRequirementsNV { nullptr };
     PFN_vkCmdBuildAccelerationStructureNV vkCmdBuildAccelerationStructureNV { nullptr };
+    PFN_vkCmdCopyAccelerationStructureNV vkCmdCopyAccelerationStructureNV { nullptr };
+    PFN_vkCmdWriteAccelerationStructuresPropertiesNV vkCmdWriteAccelerationStructuresPropertiesNV { nullptr };
     PFN_vkCreateRayTracingPipelinesNV vkCreateRayTracingPipelinesNV { nullptr };
     PFN_vkGetRayTracingShaderGroupHandlesNV vkGetRayTracingShaderGroupHandlesNV { nullptr };
     PFN_vkCmdTraceRaysNV vkCmdTraceRaysNV { nullptr };
 
     const VkPhysicalDeviceRayTracingPropertiesNV& properties() const;
 
-    VkBuffer createInstanceBuffer(const std::vector<RTGeometryInstance>&, VmaAllocation&) const;
+    //! Create a persistently mapped buffer with copyCount consecutive copies of the instance data, e.g. one per frame in flight
+    VkBuffer createInstanceBuffer(const std::vector<RTGeometryInstance>&, uint32_t copyCount, VmaAllocation&, void*& mappedData) const;
     VkBuffer createScratchBufferForAccelerationStructure(VkAccelerationStructureNV, bool updateInPlace, VmaAllocation&) const;
+    //! Create a scratch buffer which is large enough for both building and updating the acceleration structure
+    VkBuffer createScratchBufferForBuildsAndUpdates(VkAccelerationStructureNV, VmaAllocation&) const;
 
 public:
     struct GeometryInstance {
@@ -39,6 +44,9 @@ public:
     };
 
 private:
+    VkMemoryRequirements scratchMemoryRequirements(VkAccelerationStructureNV, VkAccelerationStructureMemoryRequirementsTypeNV) const;
+    VkBuffer createScratchBuffer(VkDeviceSize, VmaAllocation&) const;
+
     VulkanBackend& m_backend;
     VkPhysicalDevice m_physicalDevice;
     VkDevice m_device;
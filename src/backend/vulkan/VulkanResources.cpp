@@ -4,6 +4,8 @@
 #include "rendering/ShaderManager.h"
 #include "utility/CapList.h"
 #include "utility/Logging.h"
+#include <algorithm>
+#include <cstring>
 #include <moos/core.h>
 #include <stb_image.h>
 
@@ -34,6 +36,9 @@ VulkanBuffer::VulkanBuffer(Backend& backend, size_t size, Usage usage, MemoryHin
     case Buffer::Usage::StorageBuffer:
         usageFlags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
         break;
+    case Buffer::Usage::IndirectBuffer:
+        usageFlags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        break;
     default:
         ASSERT_NOT_REACHED();
     }
@@ -64,7 +69,7 @@ VulkanBuffer::VulkanBuffer(Backend& backend, size_t size, Usage usage, MemoryHin
         break;
     }
 
-    VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     bufferCreateInfo.size = bufferSize;
     bufferCreateInfo.usage = usageFlags;
@@ -86,6 +91,24 @@ VulkanBuffer::~VulkanBuffer()
     vmaDestroyBuffer(vulkanBackend.globalAllocator(), buffer, allocation);
 }
 
+void VulkanBuffer::bindToAliasedMemory(VmaAllocation aliasedAllocation, VkDeviceSize offset)
+{
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+
+    VkBuffer aliasedBuffer;
+    if (vkCreateBuffer(vulkanBackend.device(), &bufferCreateInfo, nullptr, &aliasedBuffer) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanBuffer::bindToAliasedMemory(): could not create buffer, exiting.\n");
+    }
+    if (vmaBindBufferMemory2(vulkanBackend.globalAllocator(), aliasedAllocation, offset, aliasedBuffer, nullptr) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanBuffer::bindToAliasedMemory(): could not bind buffer memory, exiting.\n");
+    }
+
+    vmaDestroyBuffer(vulkanBackend.globalAllocator(), buffer, allocation);
+
+    buffer = aliasedBuffer;
+    allocation = VK_NULL_HANDLE; // (not owned by this buffer)
+}
+
 void VulkanBuffer::updateData(const std::byte* data, size_t updateSize)
 {
     if (updateSize == 0)
@@ -187,7 +210,7 @@ VulkanTexture::VulkanTexture(Backend& backend, TextureDescription desc)
     VmaAllocationCreateInfo allocCreateInfo = {};
     allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-    VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
     imageCreateInfo.extent = { .width = extent().width(), .height = extent().height(), .depth = 1 };
     imageCreateInfo.mipLevels = mipLevels();
     imageCreateInfo.usage = usageFlags;
@@ -223,31 +246,31 @@ VulkanTexture::VulkanTexture(Backend& backend, TextureDescription desc)
         aspectFlags |= VK_IMAGE_ASPECT_COLOR_BIT;
     }
 
-    VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
-    viewCreateInfo.subresourceRange.aspectMask = aspectFlags;
-    viewCreateInfo.image = image;
-    viewCreateInfo.format = vkFormat;
-    viewCreateInfo.components = {
+    imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    imageViewCreateInfo.subresourceRange.aspectMask = aspectFlags;
+    imageViewCreateInfo.image = image;
+    imageViewCreateInfo.format = vkFormat;
+    imageViewCreateInfo.components = {
         VK_COMPONENT_SWIZZLE_IDENTITY,
         VK_COMPONENT_SWIZZLE_IDENTITY,
         VK_COMPONENT_SWIZZLE_IDENTITY,
         VK_COMPONENT_SWIZZLE_IDENTITY
     };
-    viewCreateInfo.subresourceRange.baseMipLevel = 0;
-    viewCreateInfo.subresourceRange.levelCount = mipLevels();
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = mipLevels();
 
     switch (type()) {
     case Type::Texture2D:
-        viewCreateInfo.subresourceRange.baseArrayLayer = 0;
-        viewCreateInfo.subresourceRange.layerCount = arrayCount();
-        viewCreateInfo.viewType = isArray()
+        imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        imageViewCreateInfo.subresourceRange.layerCount = arrayCount();
+        imageViewCreateInfo.viewType = isArray()
             ? VK_IMAGE_VIEW_TYPE_2D_ARRAY
             : VK_IMAGE_VIEW_TYPE_2D;
         break;
     case Type::Cubemap:
-        viewCreateInfo.subresourceRange.baseArrayLayer = 0;
-        viewCreateInfo.subresourceRange.layerCount = 6 * arrayCount();
-        viewCreateInfo.viewType = isArray()
+        imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        imageViewCreateInfo.subresourceRange.layerCount = 6 * arrayCount();
+        imageViewCreateInfo.viewType = isArray()
             ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY
             : VK_IMAGE_VIEW_TYPE_CUBE;
         break;
@@ -256,7 +279,7 @@ VulkanTexture::VulkanTexture(Backend& backend, TextureDescription desc)
     }
 
     VkDevice device = static_cast<VulkanBackend&>(backend).device();
-    if (vkCreateImageView(device, &viewCreateInfo, nullptr, &imageView) != VK_SUCCESS) {
+    if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageView) != VK_SUCCESS) {
         LogError("VulkanBackend::newTexture(): could not create image view.\n");
     }
 
@@ -335,11 +358,43 @@ VulkanTexture::~VulkanTexture()
     if (!hasBackend())
         return;
     auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+    if (vulkanBackend.hasTextureStreamer())
+        vulkanBackend.textureStreamer().cancelStreamingTo(*this);
     vkDestroySampler(vulkanBackend.device(), sampler, nullptr);
     vkDestroyImageView(vulkanBackend.device(), imageView, nullptr);
     vmaDestroyImage(vulkanBackend.globalAllocator(), image, allocation);
 }
 
+void VulkanTexture::bindToAliasedMemory(VmaAllocation aliasedAllocation, VkDeviceSize offset)
+{
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+    VkDevice device = vulkanBackend.device();
+
+    VkImage aliasedImage;
+    if (vkCreateImage(device, &imageCreateInfo, nullptr, &aliasedImage) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanTexture::bindToAliasedMemory(): could not create image, exiting.\n");
+    }
+    if (vmaBindImageMemory2(vulkanBackend.globalAllocator(), aliasedAllocation, offset, aliasedImage, nullptr) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanTexture::bindToAliasedMemory(): could not bind image memory, exiting.\n");
+    }
+
+    imageViewCreateInfo.image = aliasedImage;
+    VkImageView aliasedImageView;
+    if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &aliasedImageView) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanTexture::bindToAliasedMemory(): could not create image view, exiting.\n");
+    }
+
+    vkDestroyImageView(device, imageView, nullptr);
+    vmaDestroyImage(vulkanBackend.globalAllocator(), image, allocation);
+
+    image = aliasedImage;
+    imageView = aliasedImageView;
+    allocation = VK_NULL_HANDLE; // (not owned by this texture)
+
+    // The contents of the memory is undefined from the point of view of this image
+    currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
 void VulkanTexture::setPixelData(vec4 pixel)
 {
     int numChannels;
@@ -541,6 +596,12 @@ void VulkanTexture::setData(const void* data, size_t size)
     currentLayout = VK_IMAGE_LAYOUT_GENERAL;
 }
 
+void VulkanTexture::streamDataFromImageFile(const std::string& imagePath, Image::PixelType pixelType, vec4 placeholderColor)
+{
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+    vulkanBackend.textureStreamer().streamImageToTexture(*this, imagePath, pixelType, placeholderColor);
+}
+
 void VulkanTexture::generateMipmaps()
 {
     if (!hasMipmaps()) {
@@ -553,6 +614,20 @@ void VulkanTexture::generateMipmaps()
         return;
     }
 
+    bool success = static_cast<VulkanBackend&>(backend()).issueSingleTimeCommand([&](VkCommandBuffer commandBuffer) {
+        generateMipmaps(commandBuffer);
+    });
+
+    if (!success) {
+        LogError("VulkanTexture: error while generating mipmaps\n");
+    }
+}
+
+void VulkanTexture::generateMipmaps(VkCommandBuffer commandBuffer)
+{
+    ASSERT(hasMipmaps());
+    ASSERT(currentLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+
     VkImageAspectFlagBits aspectMask = hasDepthFormat() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 
     VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
@@ -573,90 +648,73 @@ void VulkanTexture::generateMipmaps()
     VkImageLayout finalLayout = VK_IMAGE_LAYOUT_GENERAL;
     VkAccessFlags finalAccess = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
-    bool success = static_cast<VulkanBackend&>(backend()).issueSingleTimeCommand([&](VkCommandBuffer commandBuffer) {
-        // Transition mips 1-n to transfer dst optimal
-        {
-            VkImageMemoryBarrier initialBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-            initialBarrier.image = image;
-            initialBarrier.subresourceRange.aspectMask = aspectMask;
-            initialBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            initialBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            initialBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            initialBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            initialBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            initialBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            initialBarrier.subresourceRange.baseArrayLayer = 0;
-            initialBarrier.subresourceRange.layerCount = 1;
-            initialBarrier.subresourceRange.baseMipLevel = 1;
-            initialBarrier.subresourceRange.levelCount = levels - 1;
-
-            vkCmdPipelineBarrier(commandBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &initialBarrier);
-        }
-
-        for (uint32_t i = 1; i < levels; ++i) {
+    // Transition mips 1-n to transfer dst optimal
+    {
+        VkImageMemoryBarrier initialBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        initialBarrier.image = image;
+        initialBarrier.subresourceRange.aspectMask = aspectMask;
+        initialBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        initialBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        initialBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        initialBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        initialBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        initialBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        initialBarrier.subresourceRange.baseArrayLayer = 0;
+        initialBarrier.subresourceRange.layerCount = 1;
+        initialBarrier.subresourceRange.baseMipLevel = 1;
+        initialBarrier.subresourceRange.levelCount = levels - 1;
 
-            int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
-            int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &initialBarrier);
+    }
 
-            // The 'currentLayout' keeps track of the whole image (or kind of mip0) but when we are messing
-            // with it here, it will have to be different for the different mip levels.
-            VkImageLayout oldLayout = (i == 1) ? currentLayout : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    for (uint32_t i = 1; i < levels; ++i) {
 
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = oldLayout;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
 
-            vkCmdPipelineBarrier(commandBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            VkImageBlit blit = {};
-            blit.srcOffsets[0] = { 0, 0, 0 };
-            blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-            blit.srcSubresource.aspectMask = aspectMask;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = { 0, 0, 0 };
-            blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
-            blit.dstSubresource.aspectMask = aspectMask;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(commandBuffer,
-                           image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                           image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1, &blit,
-                           VK_FILTER_LINEAR);
-
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = finalLayout;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = finalAccess;
+        // The 'currentLayout' keeps track of the whole image (or kind of mip0) but when we are messing
+        // with it here, it will have to be different for the different mip levels.
+        VkImageLayout oldLayout = (i == 1) ? currentLayout : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 
-            vkCmdPipelineBarrier(commandBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-            mipWidth = nextWidth;
-            mipHeight = nextHeight;
-        }
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
 
-        barrier.subresourceRange.baseMipLevel = levels - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        VkImageBlit blit = {};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = aspectMask;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+        blit.dstSubresource.aspectMask = aspectMask;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit,
+                       VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         barrier.newLayout = finalLayout;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = finalAccess;
 
         vkCmdPipelineBarrier(commandBuffer,
@@ -664,11 +722,22 @@ void VulkanTexture::generateMipmaps()
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
-    });
 
-    if (!success) {
-        LogError("VulkanTexture: error while generating mipmaps\n");
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
     }
+
+    barrier.subresourceRange.baseMipLevel = levels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = finalAccess;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
 }
 
 uint32_t VulkanTexture::layerCount() const
@@ -796,18 +865,7 @@ VulkanRenderTarget::VulkanRenderTarget(Backend& backend, std::vector<Attachment>
         LogErrorAndExit("Error trying to create render pass\n");
     }
 
-    VkFramebufferCreateInfo framebufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-    framebufferCreateInfo.renderPass = compatibleRenderPass;
-    framebufferCreateInfo.attachmentCount = allAttachmentImageViews.size();
-    framebufferCreateInfo.pAttachments = allAttachmentImageViews.data();
-    framebufferCreateInfo.width = extent().width();
-    framebufferCreateInfo.height = extent().height();
-    framebufferCreateInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &framebuffer) != VK_SUCCESS) {
-        LogErrorAndExit("Error trying to create framebuffer\n");
-    }
-
+    // NOTE: This is in the same order as the attachment descriptions & image views above
     for (auto& colorAttachment : colorAttachments()) {
         VkImageLayout finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         attachedTextures.push_back({ colorAttachment.texture, finalLayout });
@@ -819,6 +877,65 @@ VulkanRenderTarget::VulkanRenderTarget(Backend& backend, std::vector<Attachment>
         VkImageLayout finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         attachedTextures.push_back({ depthAttachment().value().texture, finalLayout });
     }
+
+    ASSERT(attachedTextures.size() == allAttachmentImageViews.size());
+    recreateFramebuffer();
+}
+
+void VulkanRenderTarget::recreateFramebuffer()
+{
+    VkDevice device = static_cast<VulkanBackend&>(backend()).device();
+
+    if (framebuffer != VK_NULL_HANDLE)
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+    for (VkImageView layerImageView : layerImageViews)
+        vkDestroyImageView(device, layerImageView, nullptr);
+    layerImageViews.clear();
+
+    // The image view of an array texture covers all layers, so for rendering to a single layer we need a separate view
+    auto imageViewForAttachment = [&](Texture* genTexture, uint32_t arrayLayer) -> VkImageView {
+        auto& texture = static_cast<VulkanTexture&>(*genTexture);
+        if (!texture.isArray())
+            return texture.imageView;
+
+        VkImageViewCreateInfo layerImageViewCreateInfo = texture.imageViewCreateInfo;
+        layerImageViewCreateInfo.image = texture.image;
+        layerImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        layerImageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+        layerImageViewCreateInfo.subresourceRange.levelCount = 1;
+        layerImageViewCreateInfo.subresourceRange.baseArrayLayer = arrayLayer;
+        layerImageViewCreateInfo.subresourceRange.layerCount = 1;
+
+        VkImageView layerImageView;
+        if (vkCreateImageView(device, &layerImageViewCreateInfo, nullptr, &layerImageView) != VK_SUCCESS) {
+            LogErrorAndExit("Error trying to create image view for render target layer\n");
+        }
+
+        layerImageViews.push_back(layerImageView);
+        return layerImageView;
+    };
+
+    // NOTE: This is in the same order as the attached textures
+    std::vector<VkImageView> attachmentImageViews {};
+    forEachAttachmentInOrder([&](const Attachment& attachment) {
+        attachmentImageViews.push_back(imageViewForAttachment(attachment.texture, attachment.arrayLayer));
+        if (attachment.multisampleResolveTexture)
+            attachmentImageViews.push_back(imageViewForAttachment(attachment.multisampleResolveTexture, attachment.arrayLayer));
+    });
+    ASSERT(attachmentImageViews.size() == attachedTextures.size());
+
+    VkFramebufferCreateInfo framebufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+    framebufferCreateInfo.renderPass = compatibleRenderPass;
+    framebufferCreateInfo.attachmentCount = attachmentImageViews.size();
+    framebufferCreateInfo.pAttachments = attachmentImageViews.data();
+    framebufferCreateInfo.width = extent().width();
+    framebufferCreateInfo.height = extent().height();
+    framebufferCreateInfo.layers = 1;
+
+    if (vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+        LogErrorAndExit("Error trying to create framebuffer\n");
+    }
 }
 
 VulkanRenderTarget::~VulkanRenderTarget()
@@ -828,12 +945,14 @@ VulkanRenderTarget::~VulkanRenderTarget()
     auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
     vkDestroyFramebuffer(vulkanBackend.device(), framebuffer, nullptr);
     vkDestroyRenderPass(vulkanBackend.device(), compatibleRenderPass, nullptr);
+    for (VkImageView layerImageView : layerImageViews)
+        vkDestroyImageView(vulkanBackend.device(), layerImageView, nullptr);
 }
 
 VulkanBindingSet::VulkanBindingSet(Backend& backend, std::vector<ShaderBinding> bindings)
     : BindingSet(backend, std::move(bindings))
 {
-    const auto& device = static_cast<VulkanBackend&>(backend).device();
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend);
 
     {
         std::vector<VkDescriptorSetLayoutBinding> layoutBindings {};
@@ -891,202 +1010,164 @@ VulkanBindingSet::VulkanBindingSet(Backend& backend, std::vector<ShaderBinding>
             layoutBindings.push_back(binding);
         }
 
-        VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-        descriptorSetLayoutCreateInfo.bindingCount = layoutBindings.size();
-        descriptorSetLayoutCreateInfo.pBindings = layoutBindings.data();
-
-        if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-            LogErrorAndExit("Error trying to create descriptor set layout\n");
-        }
+        descriptorSetLayout = vulkanBackend.descriptorAllocator().getOrCreateLayout(layoutBindings);
     }
 
-    {
-        // TODO: Maybe in the future we don't want one pool per shader binding state? We could group a lot of stuff together probably..?
-
-        std::unordered_map<ShaderBindingType, size_t> bindingTypeIndex {};
-        std::vector<VkDescriptorPoolSize> descriptorPoolSizes {};
+    descriptorSetAllocation = vulkanBackend.descriptorAllocator().allocate(descriptorSetLayout);
+    descriptorSet = descriptorSetAllocation.descriptorSet;
 
-        for (auto& bindingInfo : shaderBindings()) {
+    updateDescriptorSet();
+}
 
-            ShaderBindingType type = bindingInfo.type;
+void VulkanBindingSet::updateDescriptorSet()
+{
+    const auto& device = static_cast<VulkanBackend&>(backend()).device();
 
-            auto entry = bindingTypeIndex.find(type);
-            if (entry == bindingTypeIndex.end()) {
+    std::vector<VkWriteDescriptorSet> descriptorSetWrites {};
+    CapList<VkDescriptorBufferInfo> descBufferInfos { 1024 };
+    CapList<VkDescriptorImageInfo> descImageInfos { 1024 };
+    std::optional<VkWriteDescriptorSetAccelerationStructureNV> accelStructWrite {};
 
-                VkDescriptorPoolSize poolSize = {};
-                poolSize.descriptorCount = bindingInfo.count;
+    for (auto& bindingInfo : shaderBindings()) {
 
-                switch (bindingInfo.type) {
-                case ShaderBindingType::UniformBuffer:
-                    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                    break;
-                case ShaderBindingType::StorageBuffer:
-                case ShaderBindingType::StorageBufferArray:
-                    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-                    break;
-                case ShaderBindingType::StorageImage:
-                    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-                    break;
-                case ShaderBindingType::TextureSampler:
-                case ShaderBindingType::TextureSamplerArray:
-                    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                    break;
-                case ShaderBindingType::RTAccelerationStructure:
-                    poolSize.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV;
-                    break;
-                default:
-                    ASSERT_NOT_REACHED();
-                }
+        VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        write.pTexelBufferView = nullptr;
 
-                bindingTypeIndex[type] = descriptorPoolSizes.size();
-                descriptorPoolSizes.push_back(poolSize);
+        write.dstSet = descriptorSet;
+        write.dstBinding = bindingInfo.bindingIndex;
 
-            } else {
+        switch (bindingInfo.type) {
+        case ShaderBindingType::UniformBuffer: {
 
-                size_t index = entry->second;
-                VkDescriptorPoolSize& poolSize = descriptorPoolSizes[index];
-                poolSize.descriptorCount += bindingInfo.count;
-            }
-        }
+            ASSERT(bindingInfo.buffers.size() == 1);
+            ASSERT(bindingInfo.buffers[0]);
+            auto& buffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
 
-        VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-        descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
-        descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-        descriptorPoolCreateInfo.maxSets = 1;
+            VkDescriptorBufferInfo descBufferInfo {};
+            descBufferInfo.offset = 0;
+            descBufferInfo.range = VK_WHOLE_SIZE;
+            descBufferInfo.buffer = buffer.buffer;
 
-        if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-            LogErrorAndExit("Error trying to create descriptor pool\n");
-        }
-    }
+            descBufferInfos.push_back(descBufferInfo);
+            write.pBufferInfo = &descBufferInfos.back();
+            write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 
-    {
-        VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-        descriptorSetAllocateInfo.descriptorPool = descriptorPool;
-        descriptorSetAllocateInfo.descriptorSetCount = 1;
-        descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+            write.descriptorCount = 1;
+            write.dstArrayElement = 0;
 
-        if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet) != VK_SUCCESS) {
-            LogErrorAndExit("Error trying to create descriptor set\n");
+            break;
         }
-    }
-
-    // Update descriptor set
-    {
-        std::vector<VkWriteDescriptorSet> descriptorSetWrites {};
-        CapList<VkDescriptorBufferInfo> descBufferInfos { 1024 };
-        CapList<VkDescriptorImageInfo> descImageInfos { 1024 };
-        std::optional<VkWriteDescriptorSetAccelerationStructureNV> accelStructWrite {};
 
-        for (auto& bindingInfo : shaderBindings()) {
+        case ShaderBindingType::StorageBuffer: {
 
-            VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-            write.pTexelBufferView = nullptr;
+            ASSERT(bindingInfo.buffers.size() == 1);
+            ASSERT(bindingInfo.buffers[0]);
+            auto& buffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
 
-            write.dstSet = descriptorSet;
-            write.dstBinding = bindingInfo.bindingIndex;
+            VkDescriptorBufferInfo descBufferInfo {};
+            descBufferInfo.offset = 0;
+            descBufferInfo.range = VK_WHOLE_SIZE;
+            descBufferInfo.buffer = buffer.buffer;
 
-            switch (bindingInfo.type) {
-            case ShaderBindingType::UniformBuffer: {
+            descBufferInfos.push_back(descBufferInfo);
+            write.pBufferInfo = &descBufferInfos.back();
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 
-                ASSERT(bindingInfo.buffers.size() == 1);
-                ASSERT(bindingInfo.buffers[0]);
-                auto& buffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
+            write.descriptorCount = 1;
+            write.dstArrayElement = 0;
 
-                VkDescriptorBufferInfo descBufferInfo {};
-                descBufferInfo.offset = 0;
-                descBufferInfo.range = VK_WHOLE_SIZE;
-                descBufferInfo.buffer = buffer.buffer;
+            break;
+        }
 
-                descBufferInfos.push_back(descBufferInfo);
-                write.pBufferInfo = &descBufferInfos.back();
-                write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        case ShaderBindingType::StorageBufferArray: {
 
-                write.descriptorCount = 1;
-                write.dstArrayElement = 0;
+            ASSERT(bindingInfo.count == bindingInfo.buffers.size());
 
-                break;
+            if (bindingInfo.count == 0) {
+                continue;
             }
 
-            case ShaderBindingType::StorageBuffer: {
+            for (const Buffer* buffer : bindingInfo.buffers) {
 
-                ASSERT(bindingInfo.buffers.size() == 1);
-                ASSERT(bindingInfo.buffers[0]);
-                auto& buffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
+                ASSERT(buffer);
+                ASSERT(buffer->usage() == Buffer::Usage::StorageBuffer);
+                auto& vulkanBuffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
 
                 VkDescriptorBufferInfo descBufferInfo {};
                 descBufferInfo.offset = 0;
                 descBufferInfo.range = VK_WHOLE_SIZE;
-                descBufferInfo.buffer = buffer.buffer;
+                descBufferInfo.buffer = vulkanBuffer.buffer;
 
                 descBufferInfos.push_back(descBufferInfo);
-                write.pBufferInfo = &descBufferInfos.back();
-                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
 
-                write.descriptorCount = 1;
-                write.dstArrayElement = 0;
+            // NOTE: This should point at the first VkDescriptorBufferInfo
+            write.pBufferInfo = &descBufferInfos.back() - (bindingInfo.count - 1);
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = bindingInfo.count;
+            write.dstArrayElement = 0;
 
-                break;
-            }
+            break;
+        }
 
-            case ShaderBindingType::StorageBufferArray: {
+        case ShaderBindingType::StorageImage: {
 
-                ASSERT(bindingInfo.count == bindingInfo.buffers.size());
+            ASSERT(bindingInfo.textures.size() == 1);
+            ASSERT(bindingInfo.textures[0]);
+            auto& texture = static_cast<const VulkanTexture&>(*bindingInfo.textures[0]);
 
-                if (bindingInfo.count == 0) {
-                    continue;
-                }
+            VkDescriptorImageInfo descImageInfo {};
+            descImageInfo.sampler = texture.sampler;
+            descImageInfo.imageView = texture.imageView;
 
-                for (const Buffer* buffer : bindingInfo.buffers) {
+            // The runtime systems make sure that the input texture is in the layout!
+            descImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-                    ASSERT(buffer);
-                    ASSERT(buffer->usage() == Buffer::Usage::StorageBuffer);
-                    auto& vulkanBuffer = static_cast<const VulkanBuffer&>(*bindingInfo.buffers[0]);
+            descImageInfos.push_back(descImageInfo);
+            write.pImageInfo = &descImageInfos.back();
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 
-                    VkDescriptorBufferInfo descBufferInfo {};
-                    descBufferInfo.offset = 0;
-                    descBufferInfo.range = VK_WHOLE_SIZE;
-                    descBufferInfo.buffer = vulkanBuffer.buffer;
+            write.descriptorCount = 1;
+            write.dstArrayElement = 0;
 
-                    descBufferInfos.push_back(descBufferInfo);
-                }
+            break;
+        }
 
-                // NOTE: This should point at the first VkDescriptorBufferInfo
-                write.pBufferInfo = &descBufferInfos.back() - (bindingInfo.count - 1);
-                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-                write.descriptorCount = bindingInfo.count;
-                write.dstArrayElement = 0;
+        case ShaderBindingType::TextureSampler: {
 
-                break;
-            }
+            ASSERT(bindingInfo.textures.size() == 1);
+            ASSERT(bindingInfo.textures[0]);
+            auto& texture = static_cast<const VulkanTexture&>(*bindingInfo.textures[0]);
 
-            case ShaderBindingType::StorageImage: {
+            VkDescriptorImageInfo descImageInfo {};
+            descImageInfo.sampler = texture.sampler;
+            descImageInfo.imageView = texture.imageView;
 
-                ASSERT(bindingInfo.textures.size() == 1);
-                ASSERT(bindingInfo.textures[0]);
-                auto& texture = static_cast<const VulkanTexture&>(*bindingInfo.textures[0]);
+            // The runtime systems make sure that the input texture is in the layout!
+            descImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-                VkDescriptorImageInfo descImageInfo {};
-                descImageInfo.sampler = texture.sampler;
-                descImageInfo.imageView = texture.imageView;
+            descImageInfos.push_back(descImageInfo);
+            write.pImageInfo = &descImageInfos.back();
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
-                // The runtime systems make sure that the input texture is in the layout!
-                descImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            write.descriptorCount = 1;
+            write.dstArrayElement = 0;
 
-                descImageInfos.push_back(descImageInfo);
-                write.pImageInfo = &descImageInfos.back();
-                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            break;
+        }
 
-                write.descriptorCount = 1;
-                write.dstArrayElement = 0;
+        case ShaderBindingType::TextureSamplerArray: {
 
-                break;
-            }
+            size_t numTextures = bindingInfo.textures.size();
+            ASSERT(numTextures > 0);
 
-            case ShaderBindingType::TextureSampler: {
+            for (uint32_t i = 0; i < bindingInfo.count; ++i) {
 
-                ASSERT(bindingInfo.textures.size() == 1);
-                ASSERT(bindingInfo.textures[0]);
-                auto& texture = static_cast<const VulkanTexture&>(*bindingInfo.textures[0]);
+                // NOTE: We always have to fill in the count here, but for the unused we just fill with a "default"
+                const Texture* genTexture = (i >= numTextures) ? bindingInfo.textures.front() : bindingInfo.textures[i];
+                ASSERT(genTexture);
+
+                auto& texture = static_cast<const VulkanTexture&>(*genTexture);
 
                 VkDescriptorImageInfo descImageInfo {};
                 descImageInfo.sampler = texture.sampler;
@@ -1096,82 +1177,51 @@ VulkanBindingSet::VulkanBindingSet(Backend& backend, std::vector<ShaderBinding>
                 descImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
                 descImageInfos.push_back(descImageInfo);
-                write.pImageInfo = &descImageInfos.back();
-                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-
-                write.descriptorCount = 1;
-                write.dstArrayElement = 0;
-
-                break;
             }
 
-            case ShaderBindingType::TextureSamplerArray: {
-
-                size_t numTextures = bindingInfo.textures.size();
-                ASSERT(numTextures > 0);
-
-                for (uint32_t i = 0; i < bindingInfo.count; ++i) {
-
-                    // NOTE: We always have to fill in the count here, but for the unused we just fill with a "default"
-                    const Texture* genTexture = (i >= numTextures) ? bindingInfo.textures.front() : bindingInfo.textures[i];
-                    ASSERT(genTexture);
-
-                    auto& texture = static_cast<const VulkanTexture&>(*genTexture);
+            // NOTE: This should point at the first VkDescriptorImageInfo
+            write.pImageInfo = &descImageInfos.back() - (bindingInfo.count - 1);
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.descriptorCount = bindingInfo.count;
+            write.dstArrayElement = 0;
 
-                    VkDescriptorImageInfo descImageInfo {};
-                    descImageInfo.sampler = texture.sampler;
-                    descImageInfo.imageView = texture.imageView;
-
-                    // The runtime systems make sure that the input texture is in the layout!
-                    descImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-                    descImageInfos.push_back(descImageInfo);
-                }
-
-                // NOTE: This should point at the first VkDescriptorImageInfo
-                write.pImageInfo = &descImageInfos.back() - (bindingInfo.count - 1);
-                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                write.descriptorCount = bindingInfo.count;
-                write.dstArrayElement = 0;
-
-                break;
-            }
-
-            case ShaderBindingType::RTAccelerationStructure: {
+            break;
+        }
 
-                ASSERT(bindingInfo.textures.empty());
-                ASSERT(bindingInfo.buffers.empty());
-                ASSERT(bindingInfo.tlas != nullptr);
+        case ShaderBindingType::RTAccelerationStructure: {
 
-                ASSERT(bindingInfo.tlas);
-                auto& vulkanTlas = static_cast<const VulkanTopLevelAS&>(*bindingInfo.tlas);
+            ASSERT(bindingInfo.textures.empty());
+            ASSERT(bindingInfo.buffers.empty());
+            ASSERT(bindingInfo.tlas != nullptr);
 
-                VkWriteDescriptorSetAccelerationStructureNV descriptorAccelerationStructureInfo { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_NV };
-                descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
-                descriptorAccelerationStructureInfo.pAccelerationStructures = &vulkanTlas.accelerationStructure;
+            ASSERT(bindingInfo.tlas);
+            auto& vulkanTlas = static_cast<const VulkanTopLevelAS&>(*bindingInfo.tlas);
 
-                // (there can only be one in a set!) (well maybe not, but it makes sense..)
-                ASSERT(!accelStructWrite.has_value());
-                accelStructWrite = descriptorAccelerationStructureInfo;
+            VkWriteDescriptorSetAccelerationStructureNV descriptorAccelerationStructureInfo { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_NV };
+            descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
+            descriptorAccelerationStructureInfo.pAccelerationStructures = &vulkanTlas.accelerationStructure;
 
-                write.pNext = &accelStructWrite.value();
-                write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV;
+            // (there can only be one in a set!) (well maybe not, but it makes sense..)
+            ASSERT(!accelStructWrite.has_value());
+            accelStructWrite = descriptorAccelerationStructureInfo;
 
-                write.descriptorCount = 1;
-                write.dstArrayElement = 0;
+            write.pNext = &accelStructWrite.value();
+            write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV;
 
-                break;
-            }
+            write.descriptorCount = 1;
+            write.dstArrayElement = 0;
 
-            default:
-                ASSERT_NOT_REACHED();
-            }
+            break;
+        }
 
-            descriptorSetWrites.push_back(write);
+        default:
+            ASSERT_NOT_REACHED();
         }
 
-        vkUpdateDescriptorSets(device, descriptorSetWrites.size(), descriptorSetWrites.data(), 0, nullptr);
+        descriptorSetWrites.push_back(write);
     }
+
+    vkUpdateDescriptorSets(device, descriptorSetWrites.size(), descriptorSetWrites.data(), 0, nullptr);
 }
 
 VulkanBindingSet::~VulkanBindingSet()
@@ -1179,8 +1229,7 @@ VulkanBindingSet::~VulkanBindingSet()
     if (!hasBackend())
         return;
     auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
-    vkDestroyDescriptorPool(vulkanBackend.device(), descriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(vulkanBackend.device(), descriptorSetLayout, nullptr);
+    vulkanBackend.descriptorAllocator().free(descriptorSetAllocation);
 }
 
 VulkanRenderState::VulkanRenderState(Backend& backend, const RenderTarget& renderTarget, VertexLayout vertexLayout,
@@ -1288,11 +1337,6 @@ VulkanRenderState::VulkanRenderState(Backend& backend, const RenderTarget& rende
         LogErrorAndExit("Error trying to create pipeline layout\n");
     }
 
-    // (it's *probably* safe to delete these after creating the pipeline layout! no layers are complaining)
-    for (const VkDescriptorSetLayout& layout : descriptorSetLayouts) {
-        vkDestroyDescriptorSetLayout(device, layout, nullptr);
-    }
-
     //
     // Create pipeline
     //
@@ -1419,7 +1463,7 @@ VulkanRenderState::VulkanRenderState(Backend& backend, const RenderTarget& rende
     pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineCreateInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device, vulkanBackend.pipelineCache(), 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
         LogErrorAndExit("Error trying to create graphics pipeline\n");
     }
 
@@ -1491,11 +1535,17 @@ VulkanTopLevelAS::VulkanTopLevelAS(Backend& backend, std::vector<RTGeometryInsta
         LogErrorAndExit("Error trying to get acceleration structure handle\n");
     }
 
-    VmaAllocation scratchAllocation;
-    VkBuffer scratchBuffer = vulkanBackend.rtx().createScratchBufferForAccelerationStructure(accelerationStructure, false, scratchAllocation);
+    scratchBuffer = vulkanBackend.rtx().createScratchBufferForBuildsAndUpdates(accelerationStructure, scratchAllocation);
 
-    VmaAllocation instanceAllocation;
-    VkBuffer instanceBuffer = vulkanBackend.rtx().createInstanceBuffer(instances(), instanceAllocation);
+    void* mappedInstanceData;
+    instanceBuffer = vulkanBackend.rtx().createInstanceBuffer(instances(), static_cast<uint32_t>(VulkanBackend::maxFramesInFlight), instanceAllocation, mappedInstanceData);
+    m_mappedInstanceData = static_cast<std::byte*>(mappedInstanceData);
+
+    m_builtTransforms.reserve(instanceCount());
+    for (const RTGeometryInstance& instance : instances())
+        m_builtTransforms.push_back(instance.transform.worldMatrix());
+    m_slotTransforms.resize(VulkanBackend::maxFramesInFlight, m_builtTransforms);
+    resetMotionSinceRebuild();
 
     VkAccelerationStructureInfoNV buildInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_INFO_NV };
     buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_NV;
@@ -1515,10 +1565,8 @@ VulkanTopLevelAS::VulkanTopLevelAS(Backend& backend, std::vector<RTGeometryInsta
             scratchBuffer, 0);
     });
 
-    vmaDestroyBuffer(vulkanBackend.globalAllocator(), scratchBuffer, scratchAllocation);
-
-    // (should persist for the lifetime of this TLAS)
-    associatedBuffers.push_back({ instanceBuffer, instanceAllocation });
+    // (the initial build used the first slot)
+    m_nextInstanceSlot = 1 % VulkanBackend::maxFramesInFlight;
 }
 
 VulkanTopLevelAS::~VulkanTopLevelAS()
@@ -1530,9 +1578,79 @@ VulkanTopLevelAS::~VulkanTopLevelAS()
     vulkanBackend.rtx().vkDestroyAccelerationStructureNV(vulkanBackend.device(), accelerationStructure, nullptr);
     vkFreeMemory(vulkanBackend.device(), memory, nullptr);
 
-    for (auto& [buffer, allocation] : associatedBuffers) {
-        vmaDestroyBuffer(vulkanBackend.globalAllocator(), buffer, allocation);
+    vmaDestroyBuffer(vulkanBackend.globalAllocator(), scratchBuffer, scratchAllocation);
+    vmaDestroyBuffer(vulkanBackend.globalAllocator(), instanceBuffer, instanceAllocation);
+}
+
+std::optional<VulkanTopLevelAS::PendingBuild> VulkanTopLevelAS::prepareBuild()
+{
+    auto isSameMatrix = [](const mat4& lhs, const mat4& rhs) -> bool {
+        // (exact comparison is what we want here, as anything that moved at all must be moved in the acceleration structure too)
+        return std::memcmp(&lhs, &rhs, sizeof(mat4)) == 0;
+    };
+
+    bool anyInstanceMoved = false;
+    for (uint32_t idx = 0; idx < instanceCount() && !anyInstanceMoved; ++idx) {
+        anyInstanceMoved = !isSameMatrix(instances()[idx].transform.worldMatrix(), m_builtTransforms[idx]);
+    }
+    if (!anyInstanceMoved)
+        return {};
+
+    // NOTE: This assumes at most one build per frame, in which case the build which last read from this slot was at least
+    // maxFramesInFlight frames ago, and the backend has waited for that frame to finish before letting us record this one.
+    uint32_t slot = m_nextInstanceSlot;
+    m_nextInstanceSlot = (m_nextInstanceSlot + 1) % m_slotTransforms.size();
+
+    VkDeviceSize slotSize = instanceCount() * sizeof(VulkanRTX::GeometryInstance);
+    auto* slotInstances = reinterpret_cast<VulkanRTX::GeometryInstance*>(m_mappedInstanceData + slot * slotSize);
+    std::vector<mat4>& slotTransforms = m_slotTransforms[slot];
+
+    float maxDistanceMovedSinceRebuild = 0.0f;
+    for (uint32_t idx = 0; idx < instanceCount(); ++idx) {
+        mat4 worldMatrix = instances()[idx].transform.worldMatrix();
+
+        // (the slot can be behind by more than the last build, so compare against what was actually written to it)
+        if (!isSameMatrix(worldMatrix, slotTransforms[idx])) {
+            slotInstances[idx].transform = transpose(worldMatrix);
+            slotTransforms[idx] = worldMatrix;
+        }
+
+        m_builtTransforms[idx] = worldMatrix;
+        maxDistanceMovedSinceRebuild = std::max(maxDistanceMovedSinceRebuild, length(worldMatrix.w.xyz() - m_rebuiltPositions[idx]));
+    }
+
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+    vmaFlushAllocation(vulkanBackend.globalAllocator(), instanceAllocation, slot * slotSize, slotSize);
+
+    // Refitting keeps the tree as it was built and only grows its nodes to fit, so once instances have moved far relative to the size of
+    // the whole scene the nodes overlap a lot and tracing slows down. At that point the cost of a full build is worth paying again.
+    constexpr float maxRelativeMotionForRefit = 0.1f;
+    bool updateInPlace = maxDistanceMovedSinceRebuild <= maxRelativeMotionForRefit * m_rebuiltExtent;
+    if (!updateInPlace)
+        resetMotionSinceRebuild();
+
+    return PendingBuild { .instanceBufferOffset = slot * slotSize,
+                          .updateInPlace = updateInPlace };
+}
+
+void VulkanTopLevelAS::resetMotionSinceRebuild()
+{
+    m_rebuiltPositions.clear();
+    m_rebuiltExtent = 0.0f;
+
+    if (m_builtTransforms.empty())
+        return;
+
+    vec3 minPosition = m_builtTransforms.front().w.xyz();
+    vec3 maxPosition = minPosition;
+    for (const mat4& worldMatrix : m_builtTransforms) {
+        vec3 position = worldMatrix.w.xyz();
+        m_rebuiltPositions.push_back(position);
+        minPosition = vec3(std::min(minPosition.x, position.x), std::min(minPosition.y, position.y), std::min(minPosition.z, position.z));
+        maxPosition = vec3(std::max(maxPosition.x, position.x), std::max(maxPosition.y, position.y), std::max(maxPosition.z, position.z));
     }
+
+    m_rebuiltExtent = length(maxPosition - minPosition);
 }
 
 VulkanBottomLevelAS::VulkanBottomLevelAS(Backend& backend, std::vector<RTGeometry> geos)
@@ -1648,9 +1766,12 @@ VulkanBottomLevelAS::VulkanBottomLevelAS(Backend& backend, std::vector<RTGeometr
         }
     }
 
+    // The structure is static once built, so allow compacting it into only as much memory as the built structure actually needs
+    auto flags = VkBuildAccelerationStructureFlagsNV(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_NV | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_NV);
+
     VkAccelerationStructureInfoNV accelerationStructureInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_INFO_NV };
     accelerationStructureInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_NV;
-    accelerationStructureInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_NV;
+    accelerationStructureInfo.flags = flags;
     accelerationStructureInfo.instanceCount = 0;
     accelerationStructureInfo.geometryCount = vkGeometries.size();
     accelerationStructureInfo.pGeometries = vkGeometries.data();
@@ -1690,11 +1811,21 @@ VulkanBottomLevelAS::VulkanBottomLevelAS(Backend& backend, std::vector<RTGeometr
 
     VkAccelerationStructureInfoNV buildInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_INFO_NV };
     buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_NV;
-    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_NV;
+    buildInfo.flags = flags;
     buildInfo.geometryCount = vkGeometries.size();
     buildInfo.pGeometries = vkGeometries.data();
 
+    VkQueryPoolCreateInfo queryPoolCreateInfo { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_NV;
+    queryPoolCreateInfo.queryCount = 1;
+    VkQueryPool compactedSizeQueryPool;
+    if (vkCreateQueryPool(vulkanBackend.device(), &queryPoolCreateInfo, nullptr, &compactedSizeQueryPool) != VK_SUCCESS) {
+        LogErrorAndExit("Error trying to create query pool for the compacted size of the bottom level acceleration structure\n");
+    }
+
     vulkanBackend.issueSingleTimeCommand([&](VkCommandBuffer commandBuffer) {
+        vkCmdResetQueryPool(commandBuffer, compactedSizeQueryPool, 0, 1);
+
         vulkanBackend.rtx().vkCmdBuildAccelerationStructureNV(
             commandBuffer,
             &buildInfo,
@@ -1703,10 +1834,36 @@ VulkanBottomLevelAS::VulkanBottomLevelAS(Backend& backend, std::vector<RTGeometr
             accelerationStructure,
             VK_NULL_HANDLE,
             scratchBuffer, 0);
+
+        // (the compacted size is only known once the build has finished)
+        VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_NV;
+        barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_NV;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_NV,
+                             VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_NV,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        vulkanBackend.rtx().vkCmdWriteAccelerationStructuresPropertiesNV(commandBuffer, 1, &accelerationStructure,
+                                                                         VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_NV,
+                                                                         compactedSizeQueryPool, 0);
     });
 
     vmaDestroyBuffer(vulkanBackend.globalAllocator(), scratchBuffer, scratchAllocation);
 
+    VkDeviceSize compactedSize = 0;
+    if (vkGetQueryPoolResults(vulkanBackend.device(), compactedSizeQueryPool, 0, 1, sizeof(VkDeviceSize), &compactedSize, sizeof(VkDeviceSize),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT)
+        != VK_SUCCESS) {
+        LogError("Error trying to get the compacted size of the bottom level acceleration structure, so it won't be compacted\n");
+        compactedSize = 0;
+    }
+    vkDestroyQueryPool(vulkanBackend.device(), compactedSizeQueryPool, nullptr);
+
+    if (compactedSize > 0 && compactedSize < memoryAllocateInfo.allocationSize) {
+        compact(compactedSize);
+    }
+
     if (isTriangleBLAS) {
         // (should persist for the lifetime of this BLAS)
         associatedBuffers.push_back({ transformBuffer, transformBufferAllocation });
@@ -1727,6 +1884,61 @@ VulkanBottomLevelAS::~VulkanBottomLevelAS()
     }
 }
 
+void VulkanBottomLevelAS::compact(VkDeviceSize compactedSize)
+{
+    auto& vulkanBackend = static_cast<VulkanBackend&>(backend());
+
+    VkAccelerationStructureInfoNV compactedInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_INFO_NV };
+    compactedInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_NV;
+
+    // (the geometry of a compacted structure comes from the structure that is copied into it, so none is specified here)
+    VkAccelerationStructureCreateInfoNV compactedCreateInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_NV };
+    compactedCreateInfo.compactedSize = compactedSize;
+    compactedCreateInfo.info = compactedInfo;
+
+    VkAccelerationStructureNV compactedAccelerationStructure;
+    if (vulkanBackend.rtx().vkCreateAccelerationStructureNV(vulkanBackend.device(), &compactedCreateInfo, nullptr, &compactedAccelerationStructure) != VK_SUCCESS) {
+        LogError("Error trying to create compacted bottom level acceleration structure, keeping the original\n");
+        return;
+    }
+
+    VkAccelerationStructureMemoryRequirementsInfoNV memoryRequirementsInfo { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_INFO_NV };
+    memoryRequirementsInfo.type = VK_ACCELERATION_STRUCTURE_MEMORY_REQUIREMENTS_TYPE_OBJECT_NV;
+    memoryRequirementsInfo.accelerationStructure = compactedAccelerationStructure;
+    VkMemoryRequirements2 memoryRequirements2 {};
+    vulkanBackend.rtx().vkGetAccelerationStructureMemoryRequirementsNV(vulkanBackend.device(), &memoryRequirementsInfo, &memoryRequirements2);
+
+    VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    memoryAllocateInfo.allocationSize = memoryRequirements2.memoryRequirements.size;
+    memoryAllocateInfo.memoryTypeIndex = vulkanBackend.findAppropriateMemory(memoryRequirements2.memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkDeviceMemory compactedMemory;
+    if (vkAllocateMemory(vulkanBackend.device(), &memoryAllocateInfo, nullptr, &compactedMemory) != VK_SUCCESS) {
+        LogErrorAndExit("Error trying to create allocate memory for compacted acceleration structure\n");
+    }
+
+    VkBindAccelerationStructureMemoryInfoNV accelerationStructureMemoryInfo { VK_STRUCTURE_TYPE_BIND_ACCELERATION_STRUCTURE_MEMORY_INFO_NV };
+    accelerationStructureMemoryInfo.accelerationStructure = compactedAccelerationStructure;
+    accelerationStructureMemoryInfo.memory = compactedMemory;
+    if (vulkanBackend.rtx().vkBindAccelerationStructureMemoryNV(vulkanBackend.device(), 1, &accelerationStructureMemoryInfo) != VK_SUCCESS) {
+        LogErrorAndExit("Error trying to bind memory to compacted acceleration structure\n");
+    }
+
+    vulkanBackend.issueSingleTimeCommand([&](VkCommandBuffer commandBuffer) {
+        vulkanBackend.rtx().vkCmdCopyAccelerationStructureNV(commandBuffer, compactedAccelerationStructure, accelerationStructure, VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_NV);
+    });
+
+    vulkanBackend.rtx().vkDestroyAccelerationStructureNV(vulkanBackend.device(), accelerationStructure, nullptr);
+    vkFreeMemory(vulkanBackend.device(), memory, nullptr);
+
+    accelerationStructure = compactedAccelerationStructure;
+    memory = compactedMemory;
+
+    // (the handle is of the acceleration structure object, so the instances referencing it must use the new one)
+    if (vulkanBackend.rtx().vkGetAccelerationStructureHandleNV(vulkanBackend.device(), accelerationStructure, sizeof(uint64_t), &handle) != VK_SUCCESS) {
+        LogErrorAndExit("Error trying to get compacted acceleration structure handle\n");
+    }
+}
+
 VulkanRayTracingState::VulkanRayTracingState(Backend& backend, ShaderBindingTable sbt, std::vector<BindingSet*> bindingSets, uint32_t maxRecursionDepth)
     : RayTracingState(backend, sbt, bindingSets, maxRecursionDepth)
 {
@@ -1906,7 +2118,7 @@ VulkanRayTracingState::VulkanRayTracingState(Backend& backend, ShaderBindingTabl
     rtPipelineCreateInfo.pGroups = shaderGroups.data();
     rtPipelineCreateInfo.layout = pipelineLayout;
 
-    if (vulkanBackend.rtx().vkCreateRayTracingPipelinesNV(vulkanBackend.device(), VK_NULL_HANDLE, 1, &rtPipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    if (vulkanBackend.rtx().vkCreateRayTracingPipelinesNV(vulkanBackend.device(), vulkanBackend.pipelineCache(), 1, &rtPipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
         LogErrorAndExit("Error creating ray tracing pipeline\n");
     }
 
@@ -2041,11 +2253,6 @@ VulkanComputeState::VulkanComputeState(Backend& backend, Shader shader, std::vec
         LogErrorAndExit("Error trying to create pipeline layout\n");
     }
 
-    // (it's *probably* safe to delete these after creating the pipeline layout! no layers are complaining)
-    for (const VkDescriptorSetLayout& layout : descriptorSetLayouts) {
-        vkDestroyDescriptorSetLayout(vulkanBackend.device(), layout, nullptr);
-    }
-
     //
     // Create pipeline
     //
@@ -2056,7 +2263,7 @@ VulkanComputeState::VulkanComputeState(Backend& backend, Shader shader, std::vec
     pipelineCreateInfo.layout = pipelineLayout;
     pipelineCreateInfo.flags = 0u;
 
-    if (vkCreateComputePipelines(vulkanBackend.device(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    if (vkCreateComputePipelines(vulkanBackend.device(), vulkanBackend.pipelineCache(), 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
         LogErrorAndExit("Error trying to create compute pipeline\n");
     }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "VulkanDescriptorAllocator.h"
 #include <backend/Resources.h>
+#include <cstddef>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
@@ -11,8 +13,14 @@ public:
 
     void updateData(const std::byte* data, size_t size) override;
 
+    //! Recreate the buffer with its memory bound to the (possibly shared) allocation, which is not owned by the buffer.
+    //! Any descriptors referencing the old buffer must be updated after this.
+    void bindToAliasedMemory(VmaAllocation, VkDeviceSize offset = 0);
+
     VkBuffer buffer;
     VmaAllocation allocation;
+
+    VkBufferCreateInfo bufferCreateInfo;
 };
 
 struct VulkanTexture final : public Texture {
@@ -23,14 +31,23 @@ public:
 
     void setPixelData(vec4 pixel) override;
     void setData(const void* data, size_t size) override;
+    void streamDataFromImageFile(const std::string& imagePath, Image::PixelType, vec4 placeholderColor) override;
 
     void generateMipmaps() override;
+    void generateMipmaps(VkCommandBuffer);
 
     uint32_t layerCount() const;
 
+    //! Recreate the image (and image view) with its memory bound to the (possibly shared) allocation, which is not owned by
+    //! the texture. Any descriptors or framebuffers referencing the old image view must be updated after this.
+    void bindToAliasedMemory(VmaAllocation, VkDeviceSize offset = 0);
+
     VkImage image { VK_NULL_HANDLE };
     VmaAllocation allocation { VK_NULL_HANDLE };
 
+    VkImageCreateInfo imageCreateInfo {};
+    VkImageViewCreateInfo imageViewCreateInfo {};
+
     VkFormat vkFormat { VK_FORMAT_R8G8B8A8_UINT };
     VkImageView imageView { VK_NULL_HANDLE };
     VkSampler sampler { VK_NULL_HANDLE };
@@ -44,10 +61,16 @@ public:
     explicit VulkanRenderTarget(Backend&, std::vector<Attachment> attachments);
     virtual ~VulkanRenderTarget() override;
 
-    VkFramebuffer framebuffer;
+    //! Recreate the framebuffer from the current image views of the attached textures
+    void recreateFramebuffer();
+
+    VkFramebuffer framebuffer { VK_NULL_HANDLE };
     VkRenderPass compatibleRenderPass;
 
     std::vector<std::pair<Texture*, VkImageLayout>> attachedTextures;
+
+    //! Image views for attachments which are single layers of array textures (owned by the render target)
+    std::vector<VkImageView> layerImageViews;
 };
 
 struct VulkanBindingSet : public BindingSet {
@@ -55,9 +78,14 @@ public:
     VulkanBindingSet(Backend&, std::vector<ShaderBinding>);
     virtual ~VulkanBindingSet() override;
 
-    VkDescriptorPool descriptorPool;
+    //! Write the current buffers, image views, etc. of all shader bindings to the descriptor set
+    void updateDescriptorSet();
+
+    //! Owned by the backend's descriptor allocator, and shared with all other sets with identical layouts
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorSet descriptorSet;
+
+    VulkanDescriptorAllocator::Allocation descriptorSetAllocation {};
 };
 
 struct VulkanRenderState final : public RenderState {
@@ -77,11 +105,43 @@ public:
     VulkanTopLevelAS(Backend&, std::vector<RTGeometryInstance>);
     virtual ~VulkanTopLevelAS() override;
 
+    struct PendingBuild {
+        VkDeviceSize instanceBufferOffset;
+        bool updateInPlace;
+    };
+
+    //! Write the transforms of the instances that have moved into the next slot of the instance buffer, and decide whether to refit the
+    //! structure in place or to build it from scratch. If no instance has moved since the last build there is nothing to do, and no build.
+    std::optional<PendingBuild> prepareBuild();
+
     VkAccelerationStructureNV accelerationStructure;
     VkDeviceMemory memory { VK_NULL_HANDLE };
     uint64_t handle { 0u };
 
-    std::vector<std::pair<VkBuffer, VmaAllocation>> associatedBuffers;
+    // (large enough for both full builds & in-place updates, and kept for the lifetime of this TLAS)
+    VkBuffer scratchBuffer { VK_NULL_HANDLE };
+    VmaAllocation scratchAllocation { VK_NULL_HANDLE };
+
+    // Persistently mapped, with one slot of instance data per frame in flight, used as a ring so that we never write to a slot
+    // which the build of a previous frame might still be reading from
+    VkBuffer instanceBuffer { VK_NULL_HANDLE };
+    VmaAllocation instanceAllocation { VK_NULL_HANDLE };
+
+private:
+    void resetMotionSinceRebuild();
+
+    std::byte* m_mappedInstanceData { nullptr };
+    uint32_t m_nextInstanceSlot { 0 };
+
+    // The world matrices as last written to each slot of the instance buffer, so that only transforms that changed are written
+    std::vector<std::vector<mat4>> m_slotTransforms {};
+
+    // The world matrices as of the last build or update of the acceleration structure
+    std::vector<mat4> m_builtTransforms {};
+
+    // Instance positions as of the last full build, and the size of the volume they spanned, to tell how far refitting has drifted from it
+    std::vector<vec3> m_rebuiltPositions {};
+    float m_rebuiltExtent { 0.0f };
 };
 
 struct VulkanBottomLevelAS final : public BottomLevelAS {
@@ -94,6 +154,10 @@ public:
     uint64_t handle { 0u };
 
     std::vector<std::pair<VkBuffer, VmaAllocation>> associatedBuffers;
+
+private:
+    //! Replace the built acceleration structure with a copy that only takes up the given (queried) compacted size
+    void compact(VkDeviceSize compactedSize);
 };
 
 struct VulkanRayTracingState final : public RayTracingState {
@@ -0,0 +1,342 @@
+#include "VulkanTextureStreamer.h"
+
+#include "backend/vulkan/VulkanBackend.h"
+#include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include "utility/ThreadPool.h"
+#include <chrono>
+#include <cstring>
+
+VulkanTextureStreamer::VulkanTextureStreamer(VulkanBackend& backend, VkQueue queue, uint32_t queueFamilyIndex)
+    : m_backend(backend)
+    , m_queue(queue)
+{
+    VkCommandPoolCreateInfo poolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // (so we can reuse the batches)
+    if (vkCreateCommandPool(m_backend.device(), &poolCreateInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanTextureStreamer: could not create command pool, exiting.\n");
+    }
+
+    VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.size = stagingRingSize;
+
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo allocationInfo;
+    if (vmaCreateBuffer(m_backend.globalAllocator(), &bufferCreateInfo, &allocCreateInfo, &m_stagingBuffer, &m_stagingAllocation, &allocationInfo) != VK_SUCCESS) {
+        LogErrorAndExit("VulkanTextureStreamer: could not create staging buffer, exiting.\n");
+    }
+    m_stagingMemory = static_cast<std::byte*>(allocationInfo.pMappedData);
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer()
+{
+    for (auto& request : m_pendingRequests)
+        request->decodeJob.wait();
+
+    for (UploadBatch& batch : m_inFlightBatches) {
+        vkWaitForFences(m_backend.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        m_freeBatches.push_back(batch);
+    }
+    if (m_currentBatch.has_value()) {
+        vkEndCommandBuffer(m_currentBatch->commandBuffer);
+        m_freeBatches.push_back(m_currentBatch.value());
+    }
+
+    for (UploadBatch& batch : m_freeBatches)
+        vkDestroyFence(m_backend.device(), batch.fence, nullptr);
+
+    vkDestroyCommandPool(m_backend.device(), m_commandPool, nullptr);
+    vmaDestroyBuffer(m_backend.globalAllocator(), m_stagingBuffer, m_stagingAllocation);
+}
+
+void VulkanTextureStreamer::streamImageToTexture(VulkanTexture& texture, const std::string& imagePath, Image::PixelType pixelType, vec4 placeholderColor)
+{
+    ASSERT(texture.type() == Texture::Type::Texture2D && !texture.isArray());
+    ASSERT(!texture.hasDepthFormat());
+
+    // Fill the texture with the placeholder color so that it can be sampled right away, while waiting for the actual data
+    {
+        VkCommandBuffer commandBuffer = currentBatch().commandBuffer;
+
+        VkImageSubresourceRange allMipsRange = {};
+        allMipsRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        allMipsRange.baseMipLevel = 0;
+        allMipsRange.levelCount = texture.mipLevels();
+        allMipsRange.baseArrayLayer = 0;
+        allMipsRange.layerCount = 1;
+
+        VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        barrier.image = texture.image;
+        barrier.subresourceRange = allMipsRange;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        VkClearColorValue clearColor = { { placeholderColor.x, placeholderColor.y, placeholderColor.z, placeholderColor.w } };
+        vkCmdClearColorImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &allMipsRange);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        texture.currentLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    auto request = std::make_unique<StreamingRequest>();
+    request->texture = &texture;
+    request->imagePath = imagePath;
+
+    StreamingRequest* requestPtr = request.get();
+    request->decodeJob = ThreadPool::global().enqueue([requestPtr, pixelType]() {
+        requestPtr->decodedImage = Image::decode(requestPtr->imagePath, pixelType);
+    });
+
+    m_pendingRequests.push_back(std::move(request));
+}
+
+void VulkanTextureStreamer::cancelStreamingTo(const VulkanTexture& texture)
+{
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+        StreamingRequest& request = **it;
+        if (request.texture == &texture) {
+            // The job writes to the request, so it can't be removed until the job is done
+            request.decodeJob.wait();
+            it = m_pendingRequests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void VulkanTextureStreamer::submitPendingUploads()
+{
+    SCOPED_PROFILE_ZONE("Submit texture uploads");
+
+    recycleCompletedBatches();
+
+    std::vector<std::unique_ptr<StreamingRequest>> stillPendingRequests {};
+    bool stagingMemoryIsFull = false;
+
+    for (auto& request : m_pendingRequests) {
+
+        bool isDecoded = request->decodeJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        if (!isDecoded || stagingMemoryIsFull) {
+            stillPendingRequests.push_back(std::move(request));
+            continue;
+        }
+
+        if (!request->decodedImage) {
+            LogError("VulkanTextureStreamer: could not decode image '%s', texture will keep its placeholder.\n", request->imagePath.c_str());
+            continue;
+        }
+
+        const Image& image = *request->decodedImage;
+        VulkanTexture& texture = *request->texture;
+
+        if (image.size() > stagingRingSize) {
+            // Too big to ever fit in the ring, so just upload it directly. The placeholder clear must happen before the data is set though.
+            submitCurrentBatch();
+            texture.setData(image.data(), image.size());
+            continue;
+        }
+
+        std::optional<VkDeviceSize> stagingOffset = allocateStagingMemory(image.size(), currentBatch());
+        if (!stagingOffset.has_value()) {
+            // Try again next frame when some in-flight uploads have completed and released their staging memory
+            stagingMemoryIsFull = true;
+            stillPendingRequests.push_back(std::move(request));
+            continue;
+        }
+
+        std::memcpy(m_stagingMemory + stagingOffset.value(), image.data(), image.size());
+        recordUpload(texture, image, stagingOffset.value(), currentBatch().commandBuffer);
+    }
+
+    m_pendingRequests = std::move(stillPendingRequests);
+
+    submitCurrentBatch();
+}
+
+VulkanTextureStreamer::UploadBatch& VulkanTextureStreamer::currentBatch()
+{
+    if (m_currentBatch.has_value())
+        return m_currentBatch.value();
+
+    UploadBatch batch {};
+    if (!m_freeBatches.empty()) {
+        batch = m_freeBatches.back();
+        m_freeBatches.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        commandBufferAllocateInfo.commandPool = m_commandPool;
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_backend.device(), &commandBufferAllocateInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanTextureStreamer: could not allocate command buffer, exiting.\n");
+        }
+
+        VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        if (vkCreateFence(m_backend.device(), &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            LogErrorAndExit("VulkanTextureStreamer: could not create fence, exiting.\n");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        LogError("VulkanTextureStreamer: could not begin the command buffer.\n");
+    }
+
+    batch.stagingMemoryUsed = 0;
+    m_currentBatch = batch;
+    return m_currentBatch.value();
+}
+
+void VulkanTextureStreamer::submitCurrentBatch()
+{
+    if (!m_currentBatch.has_value())
+        return;
+
+    UploadBatch batch = m_currentBatch.value();
+    m_currentBatch.reset();
+
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        LogError("VulkanTextureStreamer: could not end the command buffer.\n");
+    }
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    if (vkQueueSubmit(m_queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+        LogError("VulkanTextureStreamer: could not submit the upload batch.\n");
+    }
+
+    m_inFlightBatches.push_back(batch);
+}
+
+void VulkanTextureStreamer::recycleCompletedBatches()
+{
+    // NOTE: Batches are submitted to a single queue, so they complete in order, and thus release staging memory in order
+    size_t completedCount = 0;
+    for (UploadBatch& batch : m_inFlightBatches) {
+        if (vkGetFenceStatus(m_backend.device(), batch.fence) != VK_SUCCESS)
+            break;
+
+        ASSERT(m_stagingRingUsed >= batch.stagingMemoryUsed);
+        m_stagingRingUsed -= batch.stagingMemoryUsed;
+
+        vkResetFences(m_backend.device(), 1, &batch.fence);
+        vkResetCommandBuffer(batch.commandBuffer, 0u);
+        m_freeBatches.push_back(batch);
+
+        completedCount += 1;
+    }
+    m_inFlightBatches.erase(m_inFlightBatches.begin(), m_inFlightBatches.begin() + completedCount);
+
+    if (m_stagingRingUsed == 0 && !m_currentBatch.has_value())
+        m_stagingRingHead = 0;
+}
+
+std::optional<VkDeviceSize> VulkanTextureStreamer::allocateStagingMemory(VkDeviceSize size, UploadBatch& batch)
+{
+    // (aligned enough for the texel size of any of our formats, and for buffer-image copies in general)
+    constexpr VkDeviceSize alignment = 16;
+
+    VkDeviceSize offset = (m_stagingRingHead + alignment - 1) & ~(alignment - 1);
+    if (offset + size > stagingRingSize)
+        offset = 0; // (wrap around, wasting the remainder at the end of the ring)
+
+    VkDeviceSize consumed = (offset >= m_stagingRingHead)
+        ? offset + size - m_stagingRingHead
+        : stagingRingSize - m_stagingRingHead + size;
+
+    if (m_stagingRingUsed + consumed > stagingRingSize)
+        return {};
+
+    m_stagingRingHead = offset + size;
+    m_stagingRingUsed += consumed;
+    batch.stagingMemoryUsed += consumed;
+
+    return offset;
+}
+
+void VulkanTextureStreamer::recordUpload(VulkanTexture& texture, const Image& image, VkDeviceSize stagingOffset, VkCommandBuffer commandBuffer)
+{
+    ASSERT(image.info().width == (int)texture.extent().width() && image.info().height == (int)texture.extent().height());
+
+    // NOTE: The texture might be in use by frames in flight (showing the placeholder), which all are before us on the queue
+    VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.image = texture.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = stagingOffset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { texture.extent().width(), texture.extent().height(), 1 };
+
+    vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    texture.currentLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    if (texture.hasMipmaps() && texture.extent().width() > 1 && texture.extent().height() > 1) {
+        texture.generateMipmaps(commandBuffer);
+    } else {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+    }
+
+    texture.currentLayout = VK_IMAGE_LAYOUT_GENERAL;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "backend/vulkan/VulkanResources.h"
+#include "utility/Image.h"
+#include <future>
+#include <memory>
+#include <moos/vector.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+class VulkanBackend;
+
+//! Streams image files into textures in the background. Images are decoded in parallel on the thread pool and their data is
+//! uploaded in batches through a ring buffer of staging memory, so no single texture upload has to wait for the queue to idle.
+class VulkanTextureStreamer {
+public:
+    VulkanTextureStreamer(VulkanBackend&, VkQueue, uint32_t queueFamilyIndex);
+    ~VulkanTextureStreamer();
+
+    VulkanTextureStreamer(VulkanTextureStreamer&) = delete;
+    VulkanTextureStreamer& operator=(VulkanTextureStreamer&) = delete;
+
+    //! Start decoding the image and upload it to the texture once decoded. Until then the texture is filled with the placeholder color.
+    void streamImageToTexture(VulkanTexture&, const std::string& imagePath, Image::PixelType, vec4 placeholderColor);
+
+    //! Forget about any pending upload to the texture, e.g. when it's about to be destroyed
+    void cancelStreamingTo(const VulkanTexture&);
+
+    //! Submit all uploads which are ready (within the available staging memory) and recycle the memory of completed ones.
+    //! Must be called before the frame is submitted, on the same queue, so that the uploads are ordered before its use.
+    void submitPendingUploads();
+
+    bool hasPendingUploads() const { return !m_pendingRequests.empty(); }
+
+private:
+    struct StreamingRequest {
+        VulkanTexture* texture { nullptr };
+        std::string imagePath {};
+        std::unique_ptr<Image> decodedImage {};
+        std::future<void> decodeJob {};
+    };
+
+    struct UploadBatch {
+        VkCommandBuffer commandBuffer {};
+        VkFence fence {};
+        //! Staging memory consumed by this batch (including any wasted space at the end of the ring)
+        VkDeviceSize stagingMemoryUsed { 0 };
+    };
+
+    UploadBatch& currentBatch();
+    void submitCurrentBatch();
+    void recycleCompletedBatches();
+
+    std::optional<VkDeviceSize> allocateStagingMemory(VkDeviceSize size, UploadBatch&);
+    void recordUpload(VulkanTexture&, const Image&, VkDeviceSize stagingOffset, VkCommandBuffer);
+
+    VulkanBackend& m_backend;
+    VkQueue m_queue {};
+
+    VkCommandPool m_commandPool {};
+    std::vector<UploadBatch> m_freeBatches {};
+    std::vector<UploadBatch> m_inFlightBatches {};
+    std::optional<UploadBatch> m_currentBatch {};
+
+    std::vector<std::unique_ptr<StreamingRequest>> m_pendingRequests {};
+
+    static constexpr VkDeviceSize stagingRingSize = 64 * 1024 * 1024;
+    VkBuffer m_stagingBuffer {};
+    VmaAllocation m_stagingAllocation {};
+    std::byte* m_stagingMemory { nullptr };
+    VkDeviceSize m_stagingRingHead { 0 };
+    VkDeviceSize m_stagingRingUsed { 0 };
+};
@@ -0,0 +1,115 @@
+#include "geometry/Frustum.h"
+#include "utility/Logging.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <moos/transform.h>
+#include <random>
+#include <vector>
+
+// CPU-only microbenchmark of frustum culling, comparing one Frustum::includesSphere call per object against the batched (SIMD) culling
+// of the bounds stored as arrays per component. It doesn't need a GPU or any of the rendering dependencies, so it's its own executable.
+
+namespace {
+
+constexpr int warmupRuns = 2;
+constexpr int measuredRuns = 10;
+
+//! Run the function a few times and return the fastest of the measured runs in milliseconds (to filter out e.g. context switches)
+template<typename Func>
+double measureMilliseconds(Func&& func)
+{
+    for (int run = 0; run < warmupRuns; ++run)
+        func();
+
+    double fastestTime = std::numeric_limits<double>::max();
+    for (int run = 0; run < measuredRuns; ++run) {
+        auto startTime = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - startTime;
+        fastestTime = std::min(fastestTime, time.count());
+    }
+
+    return fastestTime;
+}
+
+const char* simdInstructionSetName()
+{
+    // NOTE: Must match the instruction set selection in Frustum.cpp
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return "SSE2";
+#else
+    return "none (scalar)";
+#endif
+}
+
+}
+
+int main()
+{
+    // A camera in the middle of a cube filled with objects, looking down the negative z-axis
+    mat4 projection = moos::perspectiveProjectionToVulkanClipSpace(moos::toRadians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    mat4 view = moos::lookAt(vec3(0.0f), vec3(0.0f, 0.0f, -1.0f));
+    auto frustum = geometry::Frustum::createFromProjectionMatrix(projection * view);
+
+    constexpr float worldExtent = 500.0f;
+    std::mt19937 randomEngine { 12345 };
+    std::uniform_real_distribution<float> positionDistribution { -worldExtent, worldExtent };
+    std::uniform_real_distribution<float> radiusDistribution { 0.5f, 5.0f };
+
+    LogInfo("CullingBenchmark: SIMD instruction set: %s\n", simdInstructionSetName());
+    LogInfo("CullingBenchmark: fastest of %d runs, times in ms\n\n", measuredRuns);
+    LogInfo("%10s %10s %12s %12s %12s %9s\n", "objects", "visible", "per-object", "spheres", "boxes", "speedup");
+
+    for (size_t objectCount : { 10'000, 100'000, 1'000'000 }) {
+
+        std::vector<geometry::Sphere> sphereList {};
+        geometry::SphereArray sphereArray {};
+        geometry::BoxArray boxArray {};
+        sphereList.reserve(objectCount);
+        sphereArray.reserve(objectCount);
+        boxArray.reserve(objectCount);
+
+        for (size_t idx = 0; idx < objectCount; ++idx) {
+            vec3 center = vec3(positionDistribution(randomEngine), positionDistribution(randomEngine), positionDistribution(randomEngine));
+            float radius = radiusDistribution(randomEngine);
+            sphereList.emplace_back(center, radius);
+            sphereArray.add(sphereList.back());
+            boxArray.add(moos::aabb3(center - vec3(radius), center + vec3(radius)));
+        }
+
+        geometry::VisibilityMask perObjectMask {};
+        double perObjectTime = measureMilliseconds([&]() {
+            perObjectMask.reset(objectCount);
+            for (size_t idx = 0; idx < objectCount; ++idx) {
+                if (frustum.includesSphere(sphereList[idx]))
+                    perObjectMask.words()[idx / 64] |= uint64_t(1) << (idx % 64);
+            }
+        });
+
+        geometry::VisibilityMask sphereMask {};
+        double sphereTime = measureMilliseconds([&]() {
+            frustum.cullSpheres(sphereArray, sphereMask);
+        });
+
+        geometry::VisibilityMask boxMask {};
+        double boxTime = measureMilliseconds([&]() {
+            frustum.cullBoxes(boxArray, boxMask);
+        });
+
+        for (size_t idx = 0; idx < objectCount; ++idx) {
+            if (sphereMask.isVisible(idx) != perObjectMask.isVisible(idx))
+                LogErrorAndExit("CullingBenchmark: batched & per-object sphere culling disagree for object %zu, exiting.\n", idx);
+            // (a box always contains its sphere, so it can't be culled if the sphere isn't)
+            if (perObjectMask.isVisible(idx) && !boxMask.isVisible(idx))
+                LogErrorAndExit("CullingBenchmark: box of visible sphere %zu is culled, exiting.\n", idx);
+        }
+
+        LogInfo("%10zu %10zu %12.3f %12.3f %12.3f %8.1fx\n", objectCount, sphereMask.visibleCount(),
+                perObjectTime, sphereTime, boxTime, perObjectTime / sphereTime);
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "rendering/lighting/LightClustering.h"
+#include "utility/Logging.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <moos/transform.h>
+#include <random>
+#include <vector>
+
+// Shared with shaders
+#include "CameraState.h"
+
+// CPU-only test & microbenchmark of the light clustering reference (LightClustering), which mirrors the binning of the light clustering
+// compute pass. It checks the cluster assignments of a few lights with known placements and then times binning many point & spot lights.
+// It doesn't need a GPU or any of the rendering dependencies, so it's its own executable.
+
+namespace {
+
+constexpr int warmupRuns = 1;
+constexpr int measuredRuns = 5;
+
+//! Run the function a few times and return the fastest of the measured runs in milliseconds (to filter out e.g. context switches)
+template<typename Func>
+double measureMilliseconds(Func&& func)
+{
+    for (int run = 0; run < warmupRuns; ++run)
+        func();
+
+    double fastestTime = std::numeric_limits<double>::max();
+    for (int run = 0; run < measuredRuns; ++run) {
+        auto startTime = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - startTime;
+        fastestTime = std::min(fastestTime, time.count());
+    }
+
+    return fastestTime;
+}
+
+// (same as FpsCamera, which can't be used here as it depends on the input handling)
+constexpr float zNear = 0.25f;
+constexpr float zFar = 10000.0f;
+
+CameraState createFixedCameraState()
+{
+    // A camera at the origin looking down the negative z-axis, i.e. world space is view space
+    CameraState cameraState {};
+    cameraState.projectionFromView = moos::perspectiveProjectionToVulkanClipSpace(moos::toRadians(60.0f), 16.0f / 9.0f, zNear, zFar);
+    cameraState.viewFromProjection = inverse(cameraState.projectionFromView);
+    cameraState.viewFromWorld = mat4(1.0f);
+    cameraState.worldFromView = mat4(1.0f);
+    return cameraState;
+}
+
+LocalLightData createPointLight(const CameraState& cameraState, vec3 worldSpacePosition, float range)
+{
+    vec3 viewSpacePosition = (cameraState.viewFromWorld * vec4(worldSpacePosition, 1.0f)).xyz();
+    return { .colorAndIntensity = vec4(1.0f),
+             .viewSpacePositionAndRange = vec4(viewSpacePosition, range),
+             .viewSpaceDirection = vec4(0.0f),
+             .cosOuterConeAngle = -1.0f,
+             .cosInnerConeAngle = -1.0f };
+}
+
+LocalLightData createSpotLight(const CameraState& cameraState, vec3 worldSpacePosition, vec3 worldSpaceDirection, float range)
+{
+    LocalLightData light = createPointLight(cameraState, worldSpacePosition, range);
+    light.viewSpaceDirection = cameraState.viewFromWorld * vec4(normalize(worldSpaceDirection), 0.0f);
+    light.cosOuterConeAngle = std::cos(moos::toRadians(30.0f));
+    light.cosInnerConeAngle = std::cos(moos::toRadians(20.0f));
+    return light;
+}
+
+//! The world space position at the given depth along the ray through the center of the screen space tile
+vec3 tileCenterAtDepth(const CameraState& cameraState, int tileX, int tileY, float depth)
+{
+    float ndcX = -1.0f + (tileX + 0.5f) * (2.0f / LIGHT_CLUSTER_COUNT_X);
+    float ndcY = -1.0f + (tileY + 0.5f) * (2.0f / LIGHT_CLUSTER_COUNT_Y);
+    vec4 viewSpacePoint = cameraState.viewFromProjection * vec4(ndcX, ndcY, 0.5f, 1.0f);
+    vec3 ray = viewSpacePoint.xyz() / viewSpacePoint.w;
+    vec3 viewSpacePosition = ray * (depth / -ray.z);
+    return (cameraState.worldFromView * vec4(viewSpacePosition, 1.0f)).xyz();
+}
+
+//! The clusters which the (only) light was binned into
+std::vector<int> clustersOfLight(const CameraState& cameraState, const LocalLightData& light)
+{
+    LightClusterInfo clusterInfo { .zNear = zNear, .zFar = zFar, .localLightCount = 1 };
+    LightClustering::Result result = LightClustering::binLights(cameraState.viewFromProjection, clusterInfo, { light });
+
+    std::vector<int> clusters {};
+    for (int clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; ++clusterIdx) {
+        if (result.clusterLightCounts[clusterIdx] > 0)
+            clusters.push_back(clusterIdx);
+    }
+    return clusters;
+}
+
+void expectClusters(const char* testName, const CameraState& cameraState, const LocalLightData& light, std::vector<int> expectedClusters)
+{
+    std::vector<int> clusters = clustersOfLight(cameraState, light);
+    std::sort(expectedClusters.begin(), expectedClusters.end());
+
+    if (clusters != expectedClusters) {
+        LogError("LightClusteringBenchmark: %s: expected %zu cluster(s), got %zu:", testName, expectedClusters.size(), clusters.size());
+        for (size_t idx = 0; idx < clusters.size() && idx < 8; ++idx)
+            LogError(" %i", clusters[idx]);
+        LogErrorAndExit("\n");
+    }
+
+    LogInfo("  %-44s ok\n", testName);
+}
+
+void testKnownClusterAssignments(const CameraState& cameraState)
+{
+    LogInfo("LightClusteringBenchmark: cluster assignments\n");
+
+    // NOTE: Tiles next to the center of the screen are used since the bounds of the clusters are boxes around the froxels, and away from
+    // the center of the screen the boxes of neighbouring froxels overlap a lot, so there a light deep inside one froxel is also in others.
+    constexpr int tileX = LIGHT_CLUSTER_COUNT_X / 2;
+    constexpr int tileY = LIGHT_CLUSTER_COUNT_Y / 2;
+    constexpr int slice = 10;
+
+    float sliceNear = LightClustering::sliceDepth(slice, zNear, zFar);
+    float sliceFar = LightClustering::sliceDepth(slice + 1, zNear, zFar);
+    float sliceThickness = sliceFar - sliceNear;
+
+    {
+        vec3 position = tileCenterAtDepth(cameraState, tileX, tileY, 0.5f * (sliceNear + sliceFar));
+        LocalLightData light = createPointLight(cameraState, position, 0.01f * sliceThickness);
+        expectClusters("point light inside one froxel", cameraState, light, { LightClustering::clusterIndex(tileX, tileY, slice) });
+    }
+
+    {
+        vec3 position = tileCenterAtDepth(cameraState, tileX, tileY, sliceFar);
+        LocalLightData light = createSpotLight(cameraState, position, vec3(0.0f, 0.0f, -1.0f), 0.01f * sliceThickness);
+        expectClusters("spot light straddling a depth slice boundary", cameraState, light,
+                       { LightClustering::clusterIndex(tileX, tileY, slice), LightClustering::clusterIndex(tileX, tileY, slice + 1) });
+    }
+
+    {
+        LocalLightData light = createPointLight(cameraState, vec3(0.0f, 0.0f, 10.0f), 1.0f);
+        expectClusters("point light behind the camera", cameraState, light, {});
+    }
+
+    {
+        LocalLightData light = createPointLight(cameraState, vec3(0.0f, 0.0f, -2.0f * zFar), 1.0f);
+        expectClusters("point light beyond the far plane", cameraState, light, {});
+    }
+
+    {
+        std::vector<int> allClusters(LIGHT_CLUSTER_COUNT);
+        for (int clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; ++clusterIdx)
+            allClusters[clusterIdx] = clusterIdx;
+        LocalLightData light = createPointLight(cameraState, vec3(0.0f), 2.0f * zFar);
+        expectClusters("point light covering the whole frustum", cameraState, light, allClusters);
+    }
+
+    LogInfo("\n");
+}
+
+}
+
+int main()
+{
+    CameraState cameraState = createFixedCameraState();
+
+    testKnownClusterAssignments(cameraState);
+
+    // Lights scattered in front of the camera, about half of them within the view frustum
+    constexpr float sceneDepth = 200.0f;
+    std::mt19937 randomEngine { 12345 };
+    std::uniform_real_distribution<float> lateralDistribution { -sceneDepth, sceneDepth };
+    std::uniform_real_distribution<float> depthDistribution { zNear, sceneDepth };
+    std::uniform_real_distribution<float> rangeDistribution { 1.0f, 10.0f };
+    std::uniform_real_distribution<float> directionDistribution { -1.0f, 1.0f };
+
+    LogInfo("LightClusteringBenchmark: %d x %d x %d clusters, fastest of %d runs, times in ms\n\n",
+            LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y, LIGHT_CLUSTER_COUNT_Z, measuredRuns);
+    LogInfo("%10s %10s %16s %18s\n", "lights", "time", "lights/cluster", "full clusters");
+
+    for (int lightCount : { 64, 512, 4096, SCENE_MAX_LOCAL_LIGHTS }) {
+
+        std::vector<LocalLightData> lights {};
+        lights.reserve(lightCount);
+        for (int idx = 0; idx < lightCount; ++idx) {
+            vec3 position = vec3(0.5f * lateralDistribution(randomEngine), 0.5f * lateralDistribution(randomEngine), -depthDistribution(randomEngine));
+            float range = rangeDistribution(randomEngine);
+            if (idx % 2 == 0) {
+                lights.push_back(createPointLight(cameraState, position, range));
+            } else {
+                vec3 direction = vec3(directionDistribution(randomEngine), directionDistribution(randomEngine), directionDistribution(randomEngine));
+                lights.push_back(createSpotLight(cameraState, position, direction, range));
+            }
+        }
+
+        LightClusterInfo clusterInfo { .zNear = zNear, .zFar = zFar, .localLightCount = lightCount };
+
+        LightClustering::Result result {};
+        double binningTime = measureMilliseconds([&]() {
+            result = LightClustering::binLights(cameraState.viewFromProjection, clusterInfo, lights);
+        });
+
+        int binnedLightCount = 0;
+        int fullClusterCount = 0;
+        for (int clusterLightCount : result.clusterLightCounts) {
+            binnedLightCount += clusterLightCount;
+            if (clusterLightCount == LIGHT_CLUSTER_MAX_LIGHTS)
+                fullClusterCount += 1;
+        }
+
+        LogInfo("%10d %10.3f %16.2f %18d\n", lightCount, binningTime, float(binnedLightCount) / LIGHT_CLUSTER_COUNT, fullClusterCount);
+    }
+
+    return 0;
+}
@@ -0,0 +1,364 @@
+#include "BVH.h"
+
+#include "utility/util.h"
+#include <algorithm>
+#include <numeric>
+
+namespace geometry {
+
+namespace {
+
+constexpr uint32_t binCount = 16;
+
+// Leaves with at most this many objects are never split, and leaves with more are always split, regardless of what the SAH says
+constexpr uint32_t minSplitObjectCount = 3;
+constexpr uint32_t maxLeafObjectCount = 16;
+
+moos::aabb3 emptyBox()
+{
+    return moos::aabb3(vec3(std::numeric_limits<float>::max()), vec3(std::numeric_limits<float>::lowest()));
+}
+
+moos::aabb3 mergedBox(const moos::aabb3& a, const moos::aabb3& b)
+{
+    return moos::aabb3(vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+                       vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+}
+
+bool isSameBox(const moos::aabb3& a, const moos::aabb3& b)
+{
+    return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z
+        && a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+float surfaceArea(const moos::aabb3& box)
+{
+    vec3 size = box.max - box.min;
+    if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f)
+        return 0.0f;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+float component(const vec3& v, int axis)
+{
+    switch (axis) {
+    case 0:
+        return v.x;
+    case 1:
+        return v.y;
+    case 2:
+        return v.z;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+}
+
+enum class FrustumOverlap {
+    Outside,
+    Intersecting,
+    Inside,
+};
+
+FrustumOverlap classifyBox(const Frustum& frustum, const moos::aabb3& box)
+{
+    FrustumOverlap overlap = FrustumOverlap::Inside;
+
+    for (size_t i = 0; i < 6; ++i) {
+        const Plane& plane = frustum.plane(i);
+        const vec3& normal = plane.normal();
+
+        // The corners of the box furthest into (i.e. along the negative normal) and out of the plane
+        vec3 innerCorner = vec3(normal.x > 0.0f ? box.min.x : box.max.x,
+                                normal.y > 0.0f ? box.min.y : box.max.y,
+                                normal.z > 0.0f ? box.min.z : box.max.z);
+        vec3 outerCorner = vec3(normal.x > 0.0f ? box.max.x : box.min.x,
+                                normal.y > 0.0f ? box.max.y : box.min.y,
+                                normal.z > 0.0f ? box.max.z : box.min.z);
+
+        if (dot(normal, innerCorner) + plane.distance() > 0.0f)
+            return FrustumOverlap::Outside;
+        if (dot(normal, outerCorner) + plane.distance() > 0.0f)
+            overlap = FrustumOverlap::Intersecting;
+    }
+
+    return overlap;
+}
+
+bool sphereIntersectsBox(const Sphere& sphere, const moos::aabb3& box)
+{
+    const vec3& center = sphere.center();
+    vec3 closestPoint = vec3(std::clamp(center.x, box.min.x, box.max.x),
+                             std::clamp(center.y, box.min.y, box.max.y),
+                             std::clamp(center.z, box.min.z, box.max.z));
+    vec3 delta = center - closestPoint;
+    return dot(delta, delta) <= sphere.radius() * sphere.radius();
+}
+
+}
+
+void BVH::build(std::span<const moos::aabb3> objectBounds)
+{
+    uint32_t objectCount = static_cast<uint32_t>(objectBounds.size());
+
+    m_objectBounds.assign(objectBounds.begin(), objectBounds.end());
+    m_objectIndices.resize(objectCount);
+    std::iota(m_objectIndices.begin(), m_objectIndices.end(), 0u);
+    m_objectLeaves.assign(objectCount, 0);
+
+    m_nodes.clear();
+    m_parents.clear();
+    m_builtRootSurfaceArea = 0.0f;
+
+    if (objectCount == 0)
+        return;
+
+    std::vector<vec3> objectCenters {};
+    objectCenters.reserve(objectCount);
+    for (const moos::aabb3& bounds : objectBounds)
+        objectCenters.push_back((bounds.min + bounds.max) / 2.0f);
+
+    // (a binary tree with at least one object per leaf can't have more nodes than this)
+    m_nodes.reserve(2 * objectCount - 1);
+    m_parents.reserve(2 * objectCount - 1);
+
+    m_nodes.push_back(Node { .bounds = emptyBox(), .firstObject = 0, .objectCount = objectCount, .firstChild = 0 });
+    m_parents.push_back(NoParent);
+    buildNode(0, objectCenters);
+
+    m_builtRootSurfaceArea = surfaceArea(m_nodes[0].bounds);
+}
+
+void BVH::buildNode(uint32_t nodeIndex, std::span<const vec3> objectCenters)
+{
+    // NOTE: Don't keep any references to nodes in here, as the node vector grows when children are added
+
+    uint32_t firstObject = m_nodes[nodeIndex].firstObject;
+    uint32_t objectCount = m_nodes[nodeIndex].objectCount;
+    auto nodeObjectsBegin = m_objectIndices.begin() + firstObject;
+    auto nodeObjectsEnd = nodeObjectsBegin + objectCount;
+
+    moos::aabb3 bounds = emptyBox();
+    moos::aabb3 centerBounds = emptyBox();
+    for (auto it = nodeObjectsBegin; it != nodeObjectsEnd; ++it) {
+        bounds = mergedBox(bounds, m_objectBounds[*it]);
+        centerBounds = mergedBox(centerBounds, moos::aabb3(objectCenters[*it], objectCenters[*it]));
+    }
+    m_nodes[nodeIndex].bounds = bounds;
+
+    auto makeLeaf = [&]() {
+        for (auto it = nodeObjectsBegin; it != nodeObjectsEnd; ++it)
+            m_objectLeaves[*it] = nodeIndex;
+    };
+
+    if (objectCount < minSplitObjectCount) {
+        makeLeaf();
+        return;
+    }
+
+    // Sort the object centers into bins along each axis, and find the split between two bins with the lowest SAH cost, i.e. the
+    // surface area of each side (which is proportional to the probability of a query hitting it) times its number of objects
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+
+    auto binIndex = [&](uint32_t objectIndex, int axis) -> uint32_t {
+        float axisMin = component(centerBounds.min, axis);
+        float axisExtent = component(centerBounds.max, axis) - axisMin;
+        float relative = (component(objectCenters[objectIndex], axis) - axisMin) / axisExtent;
+        return std::min(binCount - 1, static_cast<uint32_t>(relative * binCount));
+    };
+
+    for (int axis = 0; axis < 3; ++axis) {
+        // (all centers in the same place along this axis, so there is nothing to split)
+        if (component(centerBounds.max, axis) <= component(centerBounds.min, axis))
+            continue;
+
+        struct Bin {
+            moos::aabb3 bounds = emptyBox();
+            uint32_t objectCount = 0;
+        };
+        Bin bins[binCount];
+
+        for (auto it = nodeObjectsBegin; it != nodeObjectsEnd; ++it) {
+            Bin& bin = bins[binIndex(*it, axis)];
+            bin.bounds = mergedBox(bin.bounds, m_objectBounds[*it]);
+            bin.objectCount += 1;
+        }
+
+        // Sweep from the right to get the cost of everything to the right of each split, then from the left to evaluate the splits
+        float rightCosts[binCount];
+        moos::aabb3 rightBounds = emptyBox();
+        uint32_t rightCount = 0;
+        for (uint32_t bin = binCount - 1; bin > 0; --bin) {
+            rightBounds = mergedBox(rightBounds, bins[bin].bounds);
+            rightCount += bins[bin].objectCount;
+            rightCosts[bin] = (rightCount > 0) ? surfaceArea(rightBounds) * float(rightCount) : std::numeric_limits<float>::max();
+        }
+
+        moos::aabb3 leftBounds = emptyBox();
+        uint32_t leftCount = 0;
+        for (uint32_t split = 1; split < binCount; ++split) {
+            leftBounds = mergedBox(leftBounds, bins[split - 1].bounds);
+            leftCount += bins[split - 1].objectCount;
+            if (leftCount == 0 || leftCount == objectCount)
+                continue;
+
+            float cost = surfaceArea(leftBounds) * float(leftCount) + rightCosts[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    // (no split is possible when all objects have the same center)
+    if (bestAxis == -1) {
+        makeLeaf();
+        return;
+    }
+
+    // Not splitting has the cost of testing all objects against any query that hits this node
+    float leafCost = surfaceArea(bounds) * float(objectCount);
+    if (leafCost <= bestCost && objectCount <= maxLeafObjectCount) {
+        makeLeaf();
+        return;
+    }
+
+    auto splitPoint = std::partition(nodeObjectsBegin, nodeObjectsEnd, [&](uint32_t objectIndex) {
+        return binIndex(objectIndex, bestAxis) < bestSplit;
+    });
+    uint32_t leftCount = static_cast<uint32_t>(splitPoint - nodeObjectsBegin);
+    ASSERT(leftCount > 0 && leftCount < objectCount);
+
+    uint32_t firstChild = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node { .bounds = emptyBox(), .firstObject = firstObject, .objectCount = leftCount, .firstChild = 0 });
+    m_nodes.push_back(Node { .bounds = emptyBox(), .firstObject = firstObject + leftCount, .objectCount = objectCount - leftCount, .firstChild = 0 });
+    m_parents.push_back(nodeIndex);
+    m_parents.push_back(nodeIndex);
+    m_nodes[nodeIndex].firstChild = firstChild;
+
+    buildNode(firstChild, objectCenters);
+    buildNode(firstChild + 1, objectCenters);
+}
+
+moos::aabb3 BVH::fitNodeToChildren(uint32_t nodeIndex) const
+{
+    const Node& node = m_nodes[nodeIndex];
+
+    if (!node.isLeaf())
+        return mergedBox(m_nodes[node.firstChild].bounds, m_nodes[node.firstChild + 1].bounds);
+
+    moos::aabb3 bounds = emptyBox();
+    for (uint32_t i = 0; i < node.objectCount; ++i)
+        bounds = mergedBox(bounds, m_objectBounds[m_objectIndices[node.firstObject + i]]);
+    return bounds;
+}
+
+void BVH::refit(std::span<const uint32_t> objectIndices, std::span<const moos::aabb3> newObjectBounds)
+{
+    ASSERT(objectIndices.size() == newObjectBounds.size());
+
+    for (size_t i = 0; i < objectIndices.size(); ++i) {
+        uint32_t objectIndex = objectIndices[i];
+        m_objectBounds[objectIndex] = newObjectBounds[i];
+
+        // Walk up towards the root until a node doesn't change, since then none of its ancestors will either
+        uint32_t nodeIndex = m_objectLeaves[objectIndex];
+        while (nodeIndex != NoParent) {
+            moos::aabb3 fittedBounds = fitNodeToChildren(nodeIndex);
+            if (isSameBox(fittedBounds, m_nodes[nodeIndex].bounds))
+                break;
+            m_nodes[nodeIndex].bounds = fittedBounds;
+            nodeIndex = m_parents[nodeIndex];
+        }
+    }
+}
+
+float BVH::refitDegradation() const
+{
+    if (m_nodes.empty() || m_builtRootSurfaceArea <= 0.0f)
+        return 1.0f;
+    return surfaceArea(m_nodes[0].bounds) / m_builtRootSurfaceArea;
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& objectIndices) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack { 0 };
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        switch (classifyBox(frustum, node.bounds)) {
+        case FrustumOverlap::Outside:
+            break;
+        case FrustumOverlap::Inside:
+            // (so then all of the objects are inside too, and they are conveniently consecutive)
+            objectIndices.insert(objectIndices.end(),
+                                 m_objectIndices.begin() + node.firstObject,
+                                 m_objectIndices.begin() + node.firstObject + node.objectCount);
+            break;
+        case FrustumOverlap::Intersecting:
+            if (node.isLeaf()) {
+                for (uint32_t i = 0; i < node.objectCount; ++i) {
+                    uint32_t objectIndex = m_objectIndices[node.firstObject + i];
+                    if (classifyBox(frustum, m_objectBounds[objectIndex]) != FrustumOverlap::Outside)
+                        objectIndices.push_back(objectIndex);
+                }
+            } else {
+                stack.push_back(node.firstChild);
+                stack.push_back(node.firstChild + 1);
+            }
+            break;
+        }
+    }
+}
+
+void BVH::querySphere(const Sphere& sphere, std::vector<uint32_t>& objectIndices) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack { 0 };
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (!sphereIntersectsBox(sphere, node.bounds))
+            continue;
+
+        if (node.isLeaf()) {
+            for (uint32_t i = 0; i < node.objectCount; ++i) {
+                uint32_t objectIndex = m_objectIndices[node.firstObject + i];
+                if (sphereIntersectsBox(sphere, m_objectBounds[objectIndex]))
+                    objectIndices.push_back(objectIndex);
+            }
+        } else {
+            stack.push_back(node.firstChild);
+            stack.push_back(node.firstChild + 1);
+        }
+    }
+}
+
+std::optional<float> BVH::rayEntryDistance(const moos::aabb3& box, vec3 origin, vec3 inverseDirection, float maxDistance)
+{
+    float tx1 = (box.min.x - origin.x) * inverseDirection.x;
+    float tx2 = (box.max.x - origin.x) * inverseDirection.x;
+    float ty1 = (box.min.y - origin.y) * inverseDirection.y;
+    float ty2 = (box.max.y - origin.y) * inverseDirection.y;
+    float tz1 = (box.min.z - origin.z) * inverseDirection.z;
+    float tz2 = (box.max.z - origin.z) * inverseDirection.z;
+
+    float tEnter = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+    float tExit = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), maxDistance });
+
+    if (tEnter > tExit)
+        return {};
+    return tEnter;
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Frustum.h"
+#include "Sphere.h"
+#include <cstdint>
+#include <limits>
+#include <moos/aabb.h>
+#include <moos/vector.h>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace geometry {
+
+//! Bounding volume hierarchy over a set of axis-aligned bounding boxes, built top-down with binned SAH (surface area heuristic). Objects are
+//! referred to by their index in the span of boxes that the hierarchy is built from. When objects move, the hierarchy can be refitted to
+//! their new bounds without changing its structure, which is cheap but makes queries slower the more the objects have moved since the build.
+class BVH {
+public:
+    BVH() = default;
+
+    void build(std::span<const moos::aabb3> objectBounds);
+
+    //! Set new bounds for the given objects and grow or shrink the nodes above them to fit, in O(k log n) for k objects
+    void refit(std::span<const uint32_t> objectIndices, std::span<const moos::aabb3> newObjectBounds);
+
+    //! How many times larger the surface area of the root is now compared to when it was built, which indicates when a rebuild is worth it
+    float refitDegradation() const;
+
+    size_t objectCount() const { return m_objectLeaves.size(); }
+    size_t nodeCount() const { return m_nodes.size(); }
+
+    //! Append the indices of all objects whose bounds are (at least partially) inside the frustum
+    void queryFrustum(const Frustum&, std::vector<uint32_t>& objectIndices) const;
+
+    //! Append the indices of all objects whose bounds intersect the sphere
+    void querySphere(const Sphere&, std::vector<uint32_t>& objectIndices) const;
+
+    struct RayHit {
+        uint32_t objectIndex;
+        float distance;
+    };
+
+    //! Find the closest object hit by the ray, nearest nodes first. Since the bounds are only conservative, the intersect function is called for
+    //! each object whose bounds the ray enters before the closest hit found so far, and should return the distance to the actual hit (if any).
+    template<typename IntersectFunc>
+    std::optional<RayHit> raycast(vec3 origin, vec3 direction, float maxDistance, IntersectFunc&& intersect) const;
+
+    //! Distance along the ray to where it enters the box, if it does so before maxDistance (zero if the origin is inside of the box)
+    static std::optional<float> rayEntryDistance(const moos::aabb3&, vec3 origin, vec3 inverseDirection, float maxDistance);
+
+private:
+    struct Node {
+        moos::aabb3 bounds;
+        // The objects in the subtree of the node, i.e. for internal nodes too, as a range in m_objectIndices
+        uint32_t firstObject;
+        uint32_t objectCount;
+        // Index of the first of the two children, or zero for leaves (as the root is never a child)
+        uint32_t firstChild;
+
+        bool isLeaf() const { return firstChild == 0; }
+    };
+
+    void buildNode(uint32_t nodeIndex, std::span<const vec3> objectCenters);
+    moos::aabb3 fitNodeToChildren(uint32_t nodeIndex) const;
+
+    static constexpr uint32_t NoParent = UINT32_MAX;
+
+    // The children of a node always come after it, and the root is the first node
+    std::vector<Node> m_nodes {};
+    std::vector<uint32_t> m_parents {};
+
+    // Object indices, ordered so that the objects in the subtree of each node are consecutive
+    std::vector<uint32_t> m_objectIndices {};
+
+    // Per object, i.e. indexed by object index
+    std::vector<uint32_t> m_objectLeaves {};
+    std::vector<moos::aabb3> m_objectBounds {};
+
+    float m_builtRootSurfaceArea { 0.0f };
+};
+
+template<typename IntersectFunc>
+std::optional<BVH::RayHit> BVH::raycast(vec3 origin, vec3 direction, float maxDistance, IntersectFunc&& intersect) const
+{
+    if (m_nodes.empty())
+        return {};
+
+    // (division by zero is fine here, as the resulting infinities give the correct slab test results)
+    vec3 inverseDirection = vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    std::optional<RayHit> closestHit {};
+    float closestDistance = maxDistance;
+
+    struct StackEntry {
+        uint32_t nodeIndex;
+        float entryDistance;
+    };
+    std::vector<StackEntry> stack {};
+
+    if (auto rootDistance = rayEntryDistance(m_nodes[0].bounds, origin, inverseDirection, closestDistance))
+        stack.push_back({ 0, rootDistance.value() });
+
+    while (!stack.empty()) {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+
+        // (the closest hit might have been found after this node was pushed)
+        if (entry.entryDistance > closestDistance)
+            continue;
+
+        const Node& node = m_nodes[entry.nodeIndex];
+
+        if (node.isLeaf()) {
+            for (uint32_t i = 0; i < node.objectCount; ++i) {
+                uint32_t objectIndex = m_objectIndices[node.firstObject + i];
+                if (!rayEntryDistance(m_objectBounds[objectIndex], origin, inverseDirection, closestDistance).has_value())
+                    continue;
+                std::optional<float> hitDistance = intersect(objectIndex);
+                if (hitDistance.has_value() && hitDistance.value() <= closestDistance) {
+                    closestDistance = hitDistance.value();
+                    closestHit = RayHit { objectIndex, hitDistance.value() };
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearChild = node.firstChild;
+        uint32_t farChild = node.firstChild + 1;
+        auto nearDistance = rayEntryDistance(m_nodes[nearChild].bounds, origin, inverseDirection, closestDistance);
+        auto farDistance = rayEntryDistance(m_nodes[farChild].bounds, origin, inverseDirection, closestDistance);
+
+        if (nearDistance.has_value() && farDistance.has_value() && farDistance.value() < nearDistance.value()) {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+
+        // (push the far child first, so that the near child is visited first)
+        if (farDistance.has_value())
+            stack.push_back({ farChild, farDistance.value() });
+        if (nearDistance.has_value())
+            stack.push_back({ nearChild, nearDistance.value() });
+    }
+
+    return closestHit;
+}
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Sphere.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <moos/aabb.h>
+#include <moos/matrix.h>
+#include <vector>
+
+namespace geometry {
+
+//! World-space bounding spheres stored as one array per component (structure of arrays), so that many of them can be culled at once
+//! with SIMD instructions. See Frustum::cullSpheres.
+class SphereArray {
+public:
+    SphereArray() = default;
+
+    size_t size() const { return m_radii.size(); }
+
+    void clear()
+    {
+        m_centerX.clear();
+        m_centerY.clear();
+        m_centerZ.clear();
+        m_radii.clear();
+    }
+
+    void reserve(size_t count)
+    {
+        m_centerX.reserve(count);
+        m_centerY.reserve(count);
+        m_centerZ.reserve(count);
+        m_radii.reserve(count);
+    }
+
+    void add(const Sphere& sphere)
+    {
+        m_centerX.push_back(sphere.center().x);
+        m_centerY.push_back(sphere.center().y);
+        m_centerZ.push_back(sphere.center().z);
+        m_radii.push_back(sphere.radius());
+    }
+
+    //! Same as add(sphere.transformed(M)), but without the full matrix transpose & multiply
+    void addTransformed(const Sphere& sphere, const mat4& M)
+    {
+        const vec3& c = sphere.center();
+        m_centerX.push_back(M.x.x * c.x + M.y.x * c.y + M.z.x * c.z + M.w.x);
+        m_centerY.push_back(M.x.y * c.x + M.y.y * c.y + M.z.y * c.z + M.w.y);
+        m_centerZ.push_back(M.x.z * c.x + M.y.z * c.y + M.z.z * c.z + M.w.z);
+
+        float scaleX2 = M.x.x * M.x.x + M.y.x * M.y.x + M.z.x * M.z.x;
+        float scaleY2 = M.x.y * M.x.y + M.y.y * M.y.y + M.z.y * M.z.y;
+        float scaleZ2 = M.x.z * M.x.z + M.y.z * M.y.z + M.z.z * M.z.z;
+        m_radii.push_back(sphere.radius() * std::sqrt(std::max({ scaleX2, scaleY2, scaleZ2 })));
+    }
+
+    Sphere sphere(size_t index) const
+    {
+        return Sphere(vec3(m_centerX[index], m_centerY[index], m_centerZ[index]), m_radii[index]);
+    }
+
+    const float* centerX() const { return m_centerX.data(); }
+    const float* centerY() const { return m_centerY.data(); }
+    const float* centerZ() const { return m_centerZ.data(); }
+    const float* radii() const { return m_radii.data(); }
+
+private:
+    std::vector<float> m_centerX {};
+    std::vector<float> m_centerY {};
+    std::vector<float> m_centerZ {};
+    std::vector<float> m_radii {};
+};
+
+//! World-space axis-aligned bounding boxes stored as one array per component (structure of arrays). See Frustum::cullBoxes.
+class BoxArray {
+public:
+    BoxArray() = default;
+
+    size_t size() const { return m_minX.size(); }
+
+    void clear()
+    {
+        for (std::vector<float>* component : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ })
+            component->clear();
+    }
+
+    void reserve(size_t count)
+    {
+        for (std::vector<float>* component : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ })
+            component->reserve(count);
+    }
+
+    void add(const moos::aabb3& box)
+    {
+        m_minX.push_back(box.min.x);
+        m_minY.push_back(box.min.y);
+        m_minZ.push_back(box.min.z);
+        m_maxX.push_back(box.max.x);
+        m_maxY.push_back(box.max.y);
+        m_maxZ.push_back(box.max.z);
+    }
+
+    const float* minX() const { return m_minX.data(); }
+    const float* minY() const { return m_minY.data(); }
+    const float* minZ() const { return m_minZ.data(); }
+    const float* maxX() const { return m_maxX.data(); }
+    const float* maxY() const { return m_maxY.data(); }
+    const float* maxZ() const { return m_maxZ.data(); }
+
+private:
+    std::vector<float> m_minX {};
+    std::vector<float> m_minY {};
+    std::vector<float> m_minZ {};
+    std::vector<float> m_maxX {};
+    std::vector<float> m_maxY {};
+    std::vector<float> m_maxZ {};
+};
+
+//! One bit per tested object, set if the object is (at least partially) inside the frustum
+class VisibilityMask {
+public:
+    VisibilityMask() = default;
+
+    size_t size() const { return m_size; }
+
+    void reset(size_t size)
+    {
+        m_size = size;
+        m_words.assign((size + 63) / 64, 0);
+    }
+
+    bool isVisible(size_t index) const
+    {
+        return (m_words[index / 64] >> (index % 64)) & 1;
+    }
+
+    size_t visibleCount() const
+    {
+        size_t count = 0;
+        for (uint64_t word : m_words)
+            count += std::popcount(word);
+        return count;
+    }
+
+    //! Call the function with the index of each visible object, in increasing order
+    template<typename Func>
+    void forEachVisible(size_t begin, size_t end, Func&& func) const
+    {
+        for (size_t index = begin; index < end;) {
+            uint64_t word = m_words[index / 64] >> (index % 64);
+            if (word == 0) {
+                // (skip the rest of the word, i.e. up to 64 objects at once)
+                index = (index / 64 + 1) * 64;
+                continue;
+            }
+            index += std::countr_zero(word);
+            if (index < end)
+                func(index);
+            index += 1;
+        }
+    }
+
+    uint64_t* words() { return m_words.data(); }
+    const uint64_t* words() const { return m_words.data(); }
+
+private:
+    std::vector<uint64_t> m_words {};
+    size_t m_size { 0 };
+};
+
+}
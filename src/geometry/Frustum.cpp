@@ -2,8 +2,91 @@
 
 #include "utility/util.h"
 
+#if defined(__AVX2__)
+#define FRUSTUM_CULLING_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace geometry {
 
+namespace {
+
+#if defined(FRUSTUM_CULLING_AVX2)
+
+struct SimdFloat {
+    static constexpr size_t width = 8;
+    __m256 value;
+
+    static SimdFloat load(const float* ptr) { return { _mm256_loadu_ps(ptr) }; }
+    static SimdFloat broadcast(float x) { return { _mm256_set1_ps(x) }; }
+    static SimdFloat zero() { return { _mm256_setzero_ps() }; }
+
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm256_add_ps(a.value, b.value) }; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm256_mul_ps(a.value, b.value) }; }
+    friend SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm256_or_ps(a.value, b.value) }; }
+    friend SimdFloat operator>(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ) }; }
+
+    //! One bit per lane, set if all bits of the lane are set (e.g. for the result of a comparison)
+    uint64_t laneMask() const { return static_cast<uint64_t>(_mm256_movemask_ps(value)); }
+};
+
+#elif defined(FRUSTUM_CULLING_SSE2)
+
+struct SimdFloat {
+    static constexpr size_t width = 4;
+    __m128 value;
+
+    static SimdFloat load(const float* ptr) { return { _mm_loadu_ps(ptr) }; }
+    static SimdFloat broadcast(float x) { return { _mm_set1_ps(x) }; }
+    static SimdFloat zero() { return { _mm_setzero_ps() }; }
+
+    friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm_add_ps(a.value, b.value) }; }
+    friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm_mul_ps(a.value, b.value) }; }
+    friend SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm_or_ps(a.value, b.value) }; }
+    friend SimdFloat operator>(SimdFloat a, SimdFloat b) { return { _mm_cmpgt_ps(a.value, b.value) }; }
+
+    //! One bit per lane, set if all bits of the lane are set (e.g. for the result of a comparison)
+    uint64_t laneMask() const { return static_cast<uint64_t>(_mm_movemask_ps(value)); }
+};
+
+#endif
+
+// The plane components broadcast to all lanes, or as scalars for the remaining objects that don't fill a whole SIMD register
+template<typename T>
+struct PlaneComponents {
+    T normalX[6], normalY[6], normalZ[6], distance[6];
+};
+
+template<typename T, typename BroadcastFunc>
+PlaneComponents<T> broadcastPlanes(const Plane planes[6], BroadcastFunc&& broadcast)
+{
+    PlaneComponents<T> components;
+    for (size_t i = 0; i < 6; ++i) {
+        components.normalX[i] = broadcast(planes[i].normal().x);
+        components.normalY[i] = broadcast(planes[i].normal().y);
+        components.normalZ[i] = broadcast(planes[i].normal().z);
+        components.distance[i] = broadcast(planes[i].distance());
+    }
+    return components;
+}
+
+// Returns a lane mask for SIMD types and a bool for scalars.
+// NOTE: The SIMD & scalar versions must give identical results, as the same frustum can cull objects with either depending on their index
+template<typename T>
+auto sphereOutsideMask(const PlaneComponents<T>& planes, T x, T y, T z, T radius)
+{
+    // (no early out here, as a sphere is only culled if it's outside of any plane, so all lanes must be tested against all planes anyway)
+    auto outside = planes.normalX[0] * x + planes.normalY[0] * y + planes.normalZ[0] * z + planes.distance[0] > radius;
+    for (size_t i = 1; i < 6; ++i)
+        outside = outside | (planes.normalX[i] * x + planes.normalY[i] * y + planes.normalZ[i] * z + planes.distance[i] > radius);
+    return outside;
+}
+
+}
+
 Frustum Frustum::createFromProjectionMatrix(mat4 M)
 {
     mat4 m = transpose(M);
@@ -24,7 +107,7 @@ Frustum::Frustum(Plane planes[6])
     }
 }
 
-bool Frustum::includesSphere(const Sphere& sphere)
+bool Frustum::includesSphere(const Sphere& sphere) const
 {
     for (const Plane& plane : m_planes) {
         float distance = dot(plane.normal(), sphere.center()) + plane.distance();
@@ -35,4 +118,94 @@ bool Frustum::includesSphere(const Sphere& sphere)
     return true;
 }
 
+void Frustum::cullSpheres(const SphereArray& spheres, VisibilityMask& mask) const
+{
+    size_t count = spheres.size();
+    mask.reset(count);
+    uint64_t* words = mask.words();
+
+    const float* centerX = spheres.centerX();
+    const float* centerY = spheres.centerY();
+    const float* centerZ = spheres.centerZ();
+    const float* radii = spheres.radii();
+
+    size_t index = 0;
+
+#if defined(FRUSTUM_CULLING_AVX2) || defined(FRUSTUM_CULLING_SSE2)
+    static_assert(64 % SimdFloat::width == 0, "the bits of one SIMD register must not straddle two mask words");
+    auto simdPlanes = broadcastPlanes<SimdFloat>(m_planes, SimdFloat::broadcast);
+
+    for (; index + SimdFloat::width <= count; index += SimdFloat::width) {
+        SimdFloat outside = sphereOutsideMask(simdPlanes,
+                                              SimdFloat::load(centerX + index),
+                                              SimdFloat::load(centerY + index),
+                                              SimdFloat::load(centerZ + index),
+                                              SimdFloat::load(radii + index));
+
+        uint64_t lanesMask = (uint64_t(1) << SimdFloat::width) - 1;
+        uint64_t visibleBits = ~outside.laneMask() & lanesMask;
+        words[index / 64] |= visibleBits << (index % 64);
+    }
+#endif
+
+    auto scalarPlanes = broadcastPlanes<float>(m_planes, [](float x) { return x; });
+    for (; index < count; ++index) {
+        bool outside = sphereOutsideMask(scalarPlanes, centerX[index], centerY[index], centerZ[index], radii[index]);
+        if (!outside)
+            words[index / 64] |= uint64_t(1) << (index % 64);
+    }
+}
+
+void Frustum::cullBoxes(const BoxArray& boxes, VisibilityMask& mask) const
+{
+    size_t count = boxes.size();
+    mask.reset(count);
+    uint64_t* words = mask.words();
+
+    // A box is outside of a plane if its corner which is furthest into the plane (i.e. along the negative normal) is outside of it.
+    // Which corner that is only depends on the signs of the plane normal, so we can pick the min or max array for each component here.
+    const float* cornerX[6];
+    const float* cornerY[6];
+    const float* cornerZ[6];
+    for (size_t i = 0; i < 6; ++i) {
+        const vec3& normal = m_planes[i].normal();
+        cornerX[i] = (normal.x > 0.0f) ? boxes.minX() : boxes.maxX();
+        cornerY[i] = (normal.y > 0.0f) ? boxes.minY() : boxes.maxY();
+        cornerZ[i] = (normal.z > 0.0f) ? boxes.minZ() : boxes.maxZ();
+    }
+
+    size_t index = 0;
+
+#if defined(FRUSTUM_CULLING_AVX2) || defined(FRUSTUM_CULLING_SSE2)
+    auto simdPlanes = broadcastPlanes<SimdFloat>(m_planes, SimdFloat::broadcast);
+    SimdFloat zero = SimdFloat::zero();
+
+    for (; index + SimdFloat::width <= count; index += SimdFloat::width) {
+        SimdFloat outside = zero;
+        for (size_t i = 0; i < 6; ++i) {
+            SimdFloat distance = simdPlanes.normalX[i] * SimdFloat::load(cornerX[i] + index)
+                + simdPlanes.normalY[i] * SimdFloat::load(cornerY[i] + index)
+                + simdPlanes.normalZ[i] * SimdFloat::load(cornerZ[i] + index)
+                + simdPlanes.distance[i];
+            outside = outside | (distance > zero);
+        }
+
+        uint64_t lanesMask = (uint64_t(1) << SimdFloat::width) - 1;
+        uint64_t visibleBits = ~outside.laneMask() & lanesMask;
+        words[index / 64] |= visibleBits << (index % 64);
+    }
+#endif
+
+    for (; index < count; ++index) {
+        bool outside = false;
+        for (size_t i = 0; i < 6; ++i) {
+            const vec3& normal = m_planes[i].normal();
+            float distance = normal.x * cornerX[i][index] + normal.y * cornerY[i][index] + normal.z * cornerZ[i][index] + m_planes[i].distance();
+            outside = outside || distance > 0.0f;
+        }
+        if (!outside)
+            words[index / 64] |= uint64_t(1) << (index % 64);
+    }
+}
+
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BatchCulling.h"
 #include "Plane.h"
 #include "Sphere.h"
 
@@ -10,7 +11,15 @@ public:
     Frustum() = default;
     static Frustum createFromProjectionMatrix(mat4);
 
-    bool includesSphere(const Sphere&);
+    bool includesSphere(const Sphere&) const;
+
+    //! Test all spheres against the frustum at once, 4 or 8 at a time depending on the available SIMD instructions (SSE2 or AVX2)
+    void cullSpheres(const SphereArray&, VisibilityMask&) const;
+
+    //! Test all boxes against the frustum at once, 4 or 8 at a time depending on the available SIMD instructions (SSE2 or AVX2)
+    void cullBoxes(const BoxArray&, VisibilityMask&) const;
+
+    const Plane& plane(size_t index) const { return m_planes[index]; }
 
 private:
     explicit Frustum(Plane planes[6]);
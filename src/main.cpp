@@ -2,8 +2,17 @@
 #include "backend/vulkan/VulkanBackend.h"
 #include "rendering/App.h"
 #include "rendering/ShaderManager.h"
+#include "rendering/camera/CameraPath.h"
 #include "utility/Input.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
 
 #if defined(_MSC_VER)
 #include <direct.h>
@@ -14,6 +23,9 @@
 
 #include "app-selector.h"
 
+//! Where traces of the profiler zones are written when requested in windowed mode (open in chrome://tracing or Perfetto)
+static constexpr const char* traceFilePath = "arkose-trace.json";
+
 enum class WindowType {
     Windowed,
     Fullscreen
@@ -68,6 +80,154 @@ std::unique_ptr<Backend> createBackend(Backend::Type backendType, GLFWwindow* wi
     return backend;
 }
 
+struct HeadlessOptions {
+    uint32_t frameCount { 1000 };
+    Extent2D extent { 1920, 1080 };
+    //! Fixed time step between frames, so that runs are deterministic regardless of how long frames take
+    double deltaTime { 1.0 / 60.0 };
+    std::string cameraPathFile {};
+    std::string imageDumpDirectory {};
+    std::string timingsFile {};
+    std::string traceFile {};
+};
+
+std::optional<HeadlessOptions> parseHeadlessOptions(int argc, char** argv)
+{
+    HeadlessOptions options {};
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            const char* value = argv[++i];
+            const char* valueEnd = value + std::strlen(value);
+            auto [parseEnd, error] = std::from_chars(value, valueEnd, options.frameCount);
+            if (error != std::errc() || parseEnd != valueEnd) {
+                LogError("ArkoseRenderer: invalid frame count '%s'\n", value);
+                return {};
+            }
+        } else if (arg == "--size" && hasValue) {
+            unsigned width, height;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+                LogError("ArkoseRenderer: invalid size '%s', expected e.g. 1920x1080\n", argv[i]);
+                return {};
+            }
+            options.extent = { width, height };
+        } else if (arg == "--camera-path" && hasValue) {
+            options.cameraPathFile = argv[++i];
+        } else if (arg == "--dump-images" && hasValue) {
+            options.imageDumpDirectory = argv[++i];
+        } else if (arg == "--timings" && hasValue) {
+            options.timingsFile = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            options.traceFile = argv[++i];
+        } else {
+            LogError("ArkoseRenderer: unknown or incomplete headless option '%s'\n", arg.c_str());
+            return {};
+        }
+    }
+
+    return options;
+}
+
+//! Render a fixed number of frames offscreen along a scripted camera path, and write out the CPU & GPU time of each frame as CSV (and optionally
+//! the frame images and a trace of the profiler zones). Each frame is waited on before the next one starts, so the timings don't overlap.
+int runHeadless(Backend::Type backendType, const HeadlessOptions& options)
+{
+    std::optional<CameraPath> cameraPath {};
+    if (!options.cameraPathFile.empty()) {
+        cameraPath = CameraPath::loadFromFile(options.cameraPathFile);
+        if (!cameraPath.has_value())
+            return 1;
+    }
+
+    struct FrameTimings {
+        double cpuTime;
+        std::optional<double> gpuTime;
+    };
+    std::vector<FrameTimings> frameTimings {};
+    frameTimings.reserve(options.frameCount);
+
+    {
+        auto app = std::make_unique<SelectedApp>();
+
+        std::unique_ptr<Backend> backend;
+        switch (backendType) {
+        case Backend::Type::Vulkan:
+            backend = std::make_unique<VulkanBackend>(*app, options.extent);
+            break;
+        }
+
+        LogInfo("ArkoseRenderer: headless run of %u frames begin.\n", options.frameCount);
+
+        for (uint32_t frameIndex = 0; frameIndex < options.frameCount; ++frameIndex) {
+            SCOPED_PROFILE_ZONE("Frame");
+            double elapsedTime = frameIndex * options.deltaTime;
+
+            if (cameraPath.has_value())
+                cameraPath->applyToCamera(app->scene().camera(), float(elapsedTime));
+
+            auto cpuStartTime = std::chrono::steady_clock::now();
+            while (!backend->executeFrame(elapsedTime, options.deltaTime)) { }
+            std::chrono::duration<double> cpuTime = std::chrono::steady_clock::now() - cpuStartTime;
+
+            std::optional<double> gpuTime;
+            {
+                SCOPED_PROFILE_ZONE("Wait for frame completion");
+                gpuTime = backend->waitForFrameCompletion();
+            }
+            frameTimings.push_back({ cpuTime.count(), gpuTime });
+
+            if (!options.imageDumpDirectory.empty()) {
+                std::string imagePath = fmt::format("{}/frame-{:05}.png", options.imageDumpDirectory, frameIndex);
+                backend->saveFrameImageToFile(imagePath);
+            }
+        }
+
+        LogInfo("ArkoseRenderer: headless run end.\n");
+    }
+
+    // (the ring buffers only hold the most recent zones, so for long runs this only covers the last frames)
+    if (!options.traceFile.empty())
+        Profiler::instance().writeChromeTrace(options.traceFile);
+
+    std::ofstream timingsFileStream {};
+    if (!options.timingsFile.empty()) {
+        timingsFileStream.open(options.timingsFile);
+        if (!timingsFileStream.is_open()) {
+            LogError("ArkoseRenderer: could not open timings file '%s' for writing\n", options.timingsFile.c_str());
+            return 1;
+        }
+    }
+    std::ostream& timingsStream = timingsFileStream.is_open() ? timingsFileStream : std::cout;
+
+    timingsStream << "frame,cpu_ms,gpu_ms\n";
+    for (size_t frameIndex = 0; frameIndex < frameTimings.size(); ++frameIndex) {
+        const FrameTimings& timings = frameTimings[frameIndex];
+        std::string gpuTimeMs = timings.gpuTime.has_value() ? fmt::format("{:.4f}", timings.gpuTime.value() * 1000.0) : "";
+        timingsStream << fmt::format("{},{:.4f},{}\n", frameIndex, timings.cpuTime * 1000.0, gpuTimeMs);
+    }
+
+    double cpuTimeSum = 0.0;
+    double gpuTimeSum = 0.0;
+    size_t gpuTimeCount = 0;
+    for (const FrameTimings& timings : frameTimings) {
+        cpuTimeSum += timings.cpuTime;
+        if (timings.gpuTime.has_value()) {
+            gpuTimeSum += timings.gpuTime.value();
+            gpuTimeCount += 1;
+        }
+    }
+    if (!frameTimings.empty()) {
+        LogInfo("ArkoseRenderer: average CPU time %.3f ms, average GPU time %s\n",
+                cpuTimeSum / frameTimings.size() * 1000.0,
+                gpuTimeCount > 0 ? fmt::format("{:.3f} ms", gpuTimeSum / gpuTimeCount * 1000.0).c_str() : "unavailable");
+    }
+
+    return 0;
+}
+
 #if defined(_MSC_VER)
 void setApplicationWorkingDirectory(char* executableName)
 {
@@ -90,11 +250,41 @@ int main(int argc, char** argv)
     setApplicationWorkingDirectory(executableName);
 #endif
 
+    // Compile all shaders up front (without opening a window) so that the SPIR-V cache is warm for the next launch
+    if (argc > 1 && std::string(argv[1]) == "--precompile-shaders") {
+        bool allCompiled = ShaderManager::instance().precompileAllShaders();
+        return allCompiled ? 0 : 1;
+    }
+
+    SET_PROFILER_THREAD_NAME("Main thread");
+
+    auto backendType = Backend::Type::Vulkan;
+
+    // Render offscreen without a window (e.g. for automated benchmarking on machines without a display), see parseHeadlessOptions for options
+    if (argc > 1 && std::string(argv[1]) == "--headless") {
+        std::optional<HeadlessOptions> options = parseHeadlessOptions(argc, argv);
+        if (!options.has_value())
+            return 1;
+        return runHeadless(backendType, options.value());
+    }
+
+    // Write a trace of the profiler zones after the given number of frames, e.g. to look at startup (it can also be written at any time with F11)
+    std::optional<uint32_t> traceAfterFrameCount {};
+    if (argc > 2 && std::string(argv[1]) == "--trace-after-frames") {
+        const char* valueEnd = argv[2] + std::strlen(argv[2]);
+        uint32_t frameCount;
+        auto [parseEnd, error] = std::from_chars(argv[2], valueEnd, frameCount);
+        if (error != std::errc() || parseEnd != valueEnd) {
+            LogError("ArkoseRenderer: invalid frame count '%s' for --trace-after-frames\n", argv[2]);
+            return 1;
+        }
+        traceAfterFrameCount = frameCount;
+    }
+
     if (!glfwInit()) {
         LogErrorAndExit("ArkoseRenderer::main(): could not initialize GLFW, exiting.\n");
     }
 
-    auto backendType = Backend::Type::Vulkan;
     GLFWwindow* window = createWindow(backendType, WindowType::Windowed, { 1920, 1080 });
     Input::registerWindow(window);
 
@@ -111,10 +301,15 @@ int main(int argc, char** argv)
 
         glfwSetTime(0.0);
         double lastTime = 0.0;
+        uint32_t frameCount = 0;
         while (!glfwWindowShouldClose(window)) {
+            SCOPED_PROFILE_ZONE("Frame");
 
-            Input::preEventPoll();
-            glfwPollEvents();
+            {
+                SCOPED_PROFILE_ZONE("Poll events");
+                Input::preEventPoll();
+                glfwPollEvents();
+            }
 
             double elapsedTime = glfwGetTime();
             double deltaTime = elapsedTime - lastTime;
@@ -124,6 +319,10 @@ int main(int argc, char** argv)
             while (!frameExecuted) {
                 frameExecuted = backend->executeFrame(elapsedTime, deltaTime);
             }
+
+            frameCount += 1;
+            if (Input::instance().wasKeyPressed(Key::F11) || frameCount == traceAfterFrameCount)
+                Profiler::instance().writeChromeTrace(traceFilePath);
         }
 
         ShaderManager::instance().stopFileWatching();
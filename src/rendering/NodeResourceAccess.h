@@ -0,0 +1,44 @@
+#pragma once
+
+#include "backend/Resources.h"
+
+enum class ResourceAccessType {
+    ShaderRead,
+    //! Storage images & buffers, which may be both read and written by the shaders
+    ShaderReadWrite,
+    ColorAttachment,
+    DepthAttachment,
+};
+
+//! How a node accesses a texture or buffer, as declared through the binding sets & render targets it uses. All accesses of
+//! a single node to the same resource are merged into one, which is what the render graph derives its barriers from.
+struct NodeResourceAccess {
+    Texture* texture { nullptr };
+    Buffer* buffer { nullptr };
+
+    ResourceAccessType type { ResourceAccessType::ShaderRead };
+    //! The shader stages the resource is bound to, if any (attachments may also be bound in other passes of the same node)
+    ShaderStage shaderStages { ShaderStage(0) };
+
+    [[nodiscard]] const Resource& resource() const
+    {
+        if (texture)
+            return *texture;
+        return *buffer;
+    }
+
+    [[nodiscard]] bool isWrite() const { return type != ResourceAccessType::ShaderRead; }
+
+    //! Merge another access to the same resource by the same node into this one
+    void merge(const NodeResourceAccess& other)
+    {
+        shaderStages = ShaderStage(shaderStages | other.shaderStages);
+
+        // A texture is in a single layout for the barriers of a node, so if it's accessed in different ways the attachment layout wins, and
+        // otherwise the general one (any pass of the node that needs another layout will still transition it when it begins)
+        if (other.type == ResourceAccessType::ColorAttachment || other.type == ResourceAccessType::DepthAttachment)
+            type = other.type;
+        else if (type != other.type && type == ResourceAccessType::ShaderRead)
+            type = ResourceAccessType::ShaderReadWrite;
+    }
+};
@@ -4,6 +4,7 @@
 #include "utility/Image.h"
 #include "utility/Logging.h"
 #include "utility/util.h"
+#include <algorithm>
 #include <stb_image.h>
 
 Registry::Registry(Backend& backend, const RenderTarget* windowRenderTarget)
@@ -17,15 +18,38 @@ void Registry::setCurrentNode(std::string node)
     m_currentNodeName = std::move(node);
 }
 
+bool Registry::hasActiveCapability(Backend::Capability capability) const
+{
+    return m_backend.hasActiveCapability(capability);
+}
+
 const RenderTarget& Registry::windowRenderTarget()
 {
     if (!m_windowRenderTarget)
         LogErrorAndExit("Can't get the window render target from a non-frame registry!\n");
+
+    for (auto& colorAttachment : m_windowRenderTarget->colorAttachments())
+        registerResourceAccess(colorAttachment);
+    if (m_windowRenderTarget->hasDepthAttachment())
+        registerResourceAccess(m_windowRenderTarget->depthAttachment().value());
+
     return *m_windowRenderTarget;
 }
 
 RenderTarget& Registry::createRenderTarget(std::vector<RenderTarget::Attachment> attachments)
 {
+    for (auto& attachment : attachments) {
+        if (attachment.texture) {
+            registerResourceWrite(*attachment.texture);
+            registerResourceUse(*attachment.texture);
+        }
+        if (attachment.multisampleResolveTexture) {
+            registerResourceWrite(*attachment.multisampleResolveTexture);
+            registerResourceUse(*attachment.multisampleResolveTexture);
+        }
+        registerResourceAccess(attachment);
+    }
+
     auto renderTarget = backend().createRenderTarget(attachments);
     renderTarget->setOwningRegistry({}, this);
 
@@ -50,6 +74,7 @@ Texture& Registry::createTexture2D(Extent2D extent, Texture::Format format, Text
     auto texture = backend().createTexture(desc);
     texture->setOwningRegistry({}, this);
 
+    registerTransientResource(*texture);
     m_textures.push_back(std::move(texture));
     return *m_textures.back();
 }
@@ -71,6 +96,7 @@ Texture& Registry::createTextureArray(uint32_t itemCount, Extent2D extent, Textu
     auto texture = backend().createTexture(desc);
     texture->setOwningRegistry({}, this);
 
+    registerTransientResource(*texture);
     m_textures.push_back(std::move(texture));
     return *m_textures.back();
 }
@@ -155,6 +181,7 @@ Texture& Registry::createMultisampledTexture2D(Extent2D extent, Texture::Format
     auto texture = backend().createTexture(desc);
     texture->setOwningRegistry({}, this);
 
+    registerTransientResource(*texture);
     m_textures.push_back(std::move(texture));
     return *m_textures.back();
 }
@@ -179,6 +206,7 @@ Texture& Registry::createCubemapTexture(Extent2D extent, Texture::Format format)
     auto texture = backend().createTexture(desc);
     texture->setOwningRegistry({}, this);
 
+    registerTransientResource(*texture);
     m_textures.push_back(std::move(texture));
     return *m_textures.back();
 }
@@ -191,6 +219,10 @@ Buffer& Registry::createBuffer(size_t size, Buffer::Usage usage, Buffer::MemoryH
     auto buffer = backend().createBuffer(size, usage, memoryHint);
     buffer->setOwningRegistry({}, this);
 
+    // (only GPU-only buffers can be transient, as the others may contain data written from the CPU)
+    if (memoryHint == Buffer::MemoryHint::GpuOnly)
+        registerTransientResource(*buffer);
+
     m_buffers.push_back(std::move(buffer));
     return *m_buffers.back();
 }
@@ -204,6 +236,24 @@ Buffer& Registry::createBuffer(const std::byte* data, size_t size, Buffer::Usage
 
 BindingSet& Registry::createBindingSet(std::vector<ShaderBinding> shaderBindings)
 {
+    for (auto& binding : shaderBindings) {
+        registerResourceUse(binding);
+        registerResourceAccess(binding);
+        switch (binding.type) {
+        case ShaderBindingType::StorageImage:
+            for (Texture* texture : binding.textures)
+                registerResourceWrite(*texture);
+            break;
+        case ShaderBindingType::StorageBuffer:
+        case ShaderBindingType::StorageBufferArray:
+            for (Buffer* buffer : binding.buffers)
+                registerResourceWrite(*buffer);
+            break;
+        default:
+            break;
+        }
+    }
+
     auto bindingSet = backend().createBindingSet(shaderBindings);
     bindingSet->setOwningRegistry({}, this);
 
@@ -239,16 +289,13 @@ Texture& Registry::createPixelTexture(vec4 pixelValue, bool srgb)
     return *m_textures.back();
 }
 
-Texture& Registry::loadTexture2D(const std::string& imagePath, bool srgb, bool generateMipmaps)
+std::unique_ptr<Texture> Registry::createTextureForImageFile(const std::string& imagePath, bool srgb, bool generateMipmaps, Image::PixelType& pixelTypeToUse)
 {
-    // FIXME (maybe): Add async functionality though the Registry (i.e., every new frame it checks for new data and sees if it may update some)
-
     Image::Info* info = Image::getInfo(imagePath);
     if (!info)
         LogErrorAndExit("Registry: could not read image '%s', exiting\n", imagePath.c_str());
 
     Texture::Format format;
-    Image::PixelType pixelTypeToUse;
 
     switch (info->pixelType) {
     case Image::PixelType::RGB:
@@ -288,6 +335,14 @@ Texture& Registry::loadTexture2D(const std::string& imagePath, bool srgb, bool g
     auto texture = backend().createTexture(desc);
     texture->setOwningRegistry({}, this);
 
+    return texture;
+}
+
+Texture& Registry::loadTexture2D(const std::string& imagePath, bool srgb, bool generateMipmaps)
+{
+    Image::PixelType pixelTypeToUse;
+    auto texture = createTextureForImageFile(imagePath, srgb, generateMipmaps, pixelTypeToUse);
+
     Image* image = Image::load(imagePath, pixelTypeToUse);
     texture->setData(image->data(), image->size());
 
@@ -295,6 +350,17 @@ Texture& Registry::loadTexture2D(const std::string& imagePath, bool srgb, bool g
     return *m_textures.back();
 }
 
+Texture& Registry::streamTexture2D(const std::string& imagePath, bool srgb, bool generateMipmaps, vec4 placeholderColor)
+{
+    Image::PixelType pixelTypeToUse;
+    auto texture = createTextureForImageFile(imagePath, srgb, generateMipmaps, pixelTypeToUse);
+
+    texture->streamDataFromImageFile(imagePath, pixelTypeToUse, placeholderColor);
+
+    m_textures.push_back(std::move(texture));
+    return *m_textures.back();
+}
+
 RenderState& Registry::createRenderState(const RenderStateBuilder& builder)
 {
     return createRenderState(builder.renderTarget, builder.vertexLayout, builder.shader,
@@ -379,7 +445,10 @@ std::optional<Texture*> Registry::getTexture(const std::string& node, const std:
 
 Texture* Registry::getTextureWithoutDependency(const std::string& node, const std::string& name)
 {
-    return getResourceWithoutDependency(node, name, m_nameTextureMap);
+    Texture* texture = getResourceWithoutDependency(node, name, m_nameTextureMap);
+    if (texture)
+        registerResourceUse(*texture);
+    return texture;
 }
 
 Buffer* Registry::getBuffer(const std::string& node, const std::string& name)
@@ -389,7 +458,17 @@ Buffer* Registry::getBuffer(const std::string& node, const std::string& name)
 
 BindingSet* Registry::getBindingSet(const std::string& node, const std::string& name)
 {
-    return getResource(node, name, m_nameBindingSetMap);
+    BindingSet* bindingSet = getResource(node, name, m_nameBindingSetMap);
+
+    // Binding the set in this node means all resources referenced by it are in use here too
+    if (bindingSet) {
+        for (auto& binding : bindingSet->shaderBindings()) {
+            registerResourceUse(binding);
+            registerResourceAccess(binding);
+        }
+    }
+
+    return bindingSet;
 }
 
 TopLevelAS* Registry::getTopLevelAccelerationStructure(const std::string& node, const std::string& name)
@@ -402,6 +481,168 @@ const std::unordered_set<NodeDependency>& Registry::nodeDependencies() const
     return m_nodeDependencies;
 }
 
+const std::vector<Resource*>& Registry::transientResources() const
+{
+    return m_transientResources;
+}
+
+const std::unordered_set<std::string>& Registry::transientResourceUsers(const Resource& resource) const
+{
+    auto entry = m_transientResourceUsers.find(&resource);
+    ASSERT(entry != m_transientResourceUsers.end());
+    return entry->second;
+}
+
+const std::vector<NodeResourceAccess>& Registry::resourceAccesses(const std::string& node) const
+{
+    static const std::vector<NodeResourceAccess> noAccesses {};
+
+    auto entry = m_nodeResourceAccesses.find(node);
+    if (entry == m_nodeResourceAccesses.end())
+        return noAccesses;
+    return entry->second;
+}
+
+bool Registry::ownsResource(const Resource& resource) const
+{
+    return resource.owningRegistry({}) == this;
+}
+
+std::vector<BindingSet*> Registry::bindingSets() const
+{
+    std::vector<BindingSet*> bindingSets {};
+    for (auto& bindingSet : m_bindingSets)
+        bindingSets.push_back(bindingSet.get());
+    return bindingSets;
+}
+
+std::vector<RenderTarget*> Registry::renderTargets() const
+{
+    std::vector<RenderTarget*> renderTargets {};
+    for (auto& renderTarget : m_renderTargets)
+        renderTargets.push_back(renderTarget.get());
+    return renderTargets;
+}
+
+bool Registry::hasPublishedResources(const std::string& node) const
+{
+    for (auto& [resource, publisher] : m_resourcePublishers) {
+        if (publisher == node)
+            return true;
+    }
+    return false;
+}
+
+bool Registry::writesToResourcesOfOtherNodes(const std::string& node) const
+{
+    return m_nodesWritingToOtherNodesResources.find(node) != m_nodesWritingToOtherNodesResources.end();
+}
+
+void Registry::registerResourceWrite(const Resource& resource)
+{
+    if (!m_currentNodeName.has_value())
+        return;
+
+    auto entry = m_resourcePublishers.find(&resource);
+    if (entry == m_resourcePublishers.end())
+        return;
+
+    const std::string& publisher = entry->second;
+    if (publisher != m_currentNodeName.value())
+        m_nodesWritingToOtherNodesResources.insert(m_currentNodeName.value());
+}
+
+void Registry::registerTransientResource(Resource& resource)
+{
+    if (!isPerFrameRegistry())
+        return;
+
+    m_transientResources.push_back(&resource);
+    m_transientResourceUsers[&resource] = {};
+    registerResourceUse(resource);
+}
+
+void Registry::registerResourceUse(const Resource& resource)
+{
+    if (!m_currentNodeName.has_value())
+        return;
+
+    auto entry = m_transientResourceUsers.find(&resource);
+    if (entry != m_transientResourceUsers.end())
+        entry->second.insert(m_currentNodeName.value());
+}
+
+void Registry::registerResourceUse(const ShaderBinding& binding)
+{
+    for (Texture* texture : binding.textures) {
+        if (texture)
+            registerResourceUse(*texture);
+    }
+    for (Buffer* buffer : binding.buffers) {
+        if (buffer)
+            registerResourceUse(*buffer);
+    }
+}
+
+void Registry::registerResourceAccess(const NodeResourceAccess& access)
+{
+    if (!m_currentNodeName.has_value())
+        return;
+
+    std::vector<NodeResourceAccess>& accesses = m_nodeResourceAccesses[m_currentNodeName.value()];
+    auto entry = std::find_if(accesses.begin(), accesses.end(), [&](const NodeResourceAccess& other) {
+        return &other.resource() == &access.resource();
+    });
+
+    if (entry == accesses.end())
+        accesses.push_back(access);
+    else
+        entry->merge(access);
+}
+
+void Registry::registerResourceAccess(const RenderTarget::Attachment& attachment)
+{
+    auto type = (attachment.type == RenderTarget::AttachmentType::Depth)
+        ? ResourceAccessType::DepthAttachment
+        : ResourceAccessType::ColorAttachment;
+
+    if (attachment.texture)
+        registerResourceAccess({ .texture = attachment.texture, .type = type });
+    if (attachment.multisampleResolveTexture)
+        registerResourceAccess({ .texture = attachment.multisampleResolveTexture, .type = ResourceAccessType::ColorAttachment });
+}
+
+void Registry::registerResourceAccess(const ShaderBinding& binding)
+{
+    ResourceAccessType type;
+    switch (binding.type) {
+    case ShaderBindingType::UniformBuffer:
+    case ShaderBindingType::TextureSampler:
+    case ShaderBindingType::TextureSamplerArray:
+        type = ResourceAccessType::ShaderRead;
+        break;
+    case ShaderBindingType::StorageBuffer:
+    case ShaderBindingType::StorageBufferArray:
+    case ShaderBindingType::StorageImage:
+        type = ResourceAccessType::ShaderReadWrite;
+        break;
+    case ShaderBindingType::RTAccelerationStructure:
+        // (acceleration structures are only ever built & updated with their own barriers)
+        return;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+
+    for (Texture* texture : binding.textures) {
+        if (texture)
+            registerResourceAccess({ .texture = texture, .type = type, .shaderStages = binding.shaderStage });
+    }
+    for (Buffer* buffer : binding.buffers) {
+        if (buffer)
+            registerResourceAccess({ .buffer = buffer, .type = type, .shaderStages = binding.shaderStage });
+    }
+}
+
 Badge<Registry> Registry::exchangeBadges(Badge<Backend>) const
 {
     return {};
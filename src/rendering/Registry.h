@@ -2,6 +2,7 @@
 
 #include "AppState.h"
 #include "NodeDependency.h"
+#include "NodeResourceAccess.h"
 #include "backend/Backend.h"
 #include "backend/Resources.h"
 #include "utility/Image.h"
@@ -15,11 +16,15 @@ public:
 
     void setCurrentNode(std::string);
 
+    [[nodiscard]] bool hasActiveCapability(Backend::Capability) const;
+
     [[nodiscard]] const RenderTarget& windowRenderTarget();
     [[nodiscard]] RenderTarget& createRenderTarget(std::vector<RenderTarget::Attachment>);
 
     [[nodiscard]] Texture& createPixelTexture(vec4 pixelValue, bool srgb);
     [[nodiscard]] Texture& loadTexture2D(const std::string& imagePath, bool srgb, bool generateMipmaps);
+    //! Like loadTexture2D, but the image is decoded & uploaded in the background. Until it's done the texture is filled with the placeholder color.
+    [[nodiscard]] Texture& streamTexture2D(const std::string& imagePath, bool srgb, bool generateMipmaps, vec4 placeholderColor);
     [[nodiscard]] Texture& createTexture2D(Extent2D, Texture::Format, Texture::Filters = Texture::Filters::linear(), Texture::Mipmap = Texture::Mipmap::None, Texture::WrapModes = Texture::WrapModes::repeatAll());
     [[nodiscard]] Texture& createTextureArray(uint32_t itemCount, Extent2D, Texture::Format, Texture::Filters = Texture::Filters::linear(), Texture::Mipmap = Texture::Mipmap::None, Texture::WrapModes = Texture::WrapModes::repeatAll());
     [[nodiscard]] Texture& createTextureFromImage(const Image&, bool srgb, bool generateMipmaps, Texture::WrapModes = Texture::WrapModes::repeatAll());
@@ -58,6 +63,29 @@ public:
 
     [[nodiscard]] const std::unordered_set<NodeDependency>& nodeDependencies() const;
 
+    //! Resources which only need to live for a part of a frame (e.g. most per-frame render targets). Only
+    //! per-frame registries have transient resources, since node resources must persist between frames.
+    [[nodiscard]] const std::vector<Resource*>& transientResources() const;
+
+    //! All nodes that create, look up, or bind the given transient resource, i.e. what defines its lifetime
+    [[nodiscard]] const std::unordered_set<std::string>& transientResourceUsers(const Resource&) const;
+
+    //! All textures & buffers the node accesses through its render targets & binding sets, with one (merged) access per resource
+    [[nodiscard]] const std::vector<NodeResourceAccess>& resourceAccesses(const std::string& node) const;
+
+    //! Returns true if the resource was created through this registry (as opposed to e.g. the window render target)
+    [[nodiscard]] bool ownsResource(const Resource&) const;
+
+    [[nodiscard]] std::vector<BindingSet*> bindingSets() const;
+    [[nodiscard]] std::vector<RenderTarget*> renderTargets() const;
+
+    //! Returns true if the node has published at least one resource to this registry
+    [[nodiscard]] bool hasPublishedResources(const std::string& node) const;
+
+    //! Returns true if the node writes to a resource published by another node (e.g. as a storage image or attachment),
+    //! which means it has side effects that are not visible through the node dependencies alone.
+    [[nodiscard]] bool writesToResourcesOfOtherNodes(const std::string& node) const;
+
     // REMOVE: not needed now/soon, I think..
     [[nodiscard]] Badge<Registry> exchangeBadges(Badge<Backend>) const;
 
@@ -65,9 +93,31 @@ private:
     Backend& m_backend;
     Backend& backend() { return m_backend; }
 
+    std::unique_ptr<Texture> createTextureForImageFile(const std::string& imagePath, bool srgb, bool generateMipmaps, Image::PixelType& pixelTypeToUse);
+
     std::optional<std::string> m_currentNodeName;
     std::unordered_set<NodeDependency> m_nodeDependencies;
 
+    std::unordered_map<const Resource*, std::string> m_resourcePublishers;
+    std::unordered_set<std::string> m_nodesWritingToOtherNodesResources;
+
+    void registerResourceWrite(const Resource&);
+
+    bool isPerFrameRegistry() const { return m_windowRenderTarget != nullptr; }
+
+    std::vector<Resource*> m_transientResources;
+    std::unordered_map<const Resource*, std::unordered_set<std::string>> m_transientResourceUsers;
+
+    void registerTransientResource(Resource&);
+    void registerResourceUse(const Resource&);
+    void registerResourceUse(const ShaderBinding&);
+
+    std::unordered_map<std::string, std::vector<NodeResourceAccess>> m_nodeResourceAccesses;
+
+    void registerResourceAccess(const NodeResourceAccess&);
+    void registerResourceAccess(const RenderTarget::Attachment&);
+    void registerResourceAccess(const ShaderBinding&);
+
     const RenderTarget* m_windowRenderTarget;
 
     std::unordered_map<std::string, Buffer*> m_nameBufferMap;
@@ -128,6 +178,8 @@ void Registry::publishResource(const std::string& name, T& resource, std::unorde
     auto entry = map.find(fullName);
     ASSERT(entry == map.end());
     map[fullName] = &resource;
+
+    m_resourcePublishers[&resource] = nodeName;
 }
 
 template<typename T>
@@ -136,6 +188,8 @@ T* Registry::getResource(const std::string& node, const std::string& name, const
     T* resource = getResourceWithoutDependency(node, name, map);
 
     if (resource) {
+        registerResourceUse(*resource);
+
         ASSERT(m_currentNodeName.has_value());
         NodeDependency dependency { m_currentNodeName.value(), node };
         m_nodeDependencies.insert(dependency);
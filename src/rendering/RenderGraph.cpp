@@ -1,6 +1,10 @@
 #include "RenderGraph.h"
 
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
 #include <utility/Logging.h>
+#include <utility/Profiling.h>
 
 void RenderGraph::addNode(const std::string& name, RenderGraphBasicNode::ConstructorFunction constructorFunction)
 {
@@ -16,7 +20,7 @@ void RenderGraph::addNode(std::unique_ptr<RenderGraphNode>&& node)
     m_allNodes.emplace_back(std::move(node));
 }
 
-void RenderGraph::constructAll(Registry& nodeManager, std::vector<Registry*> frameManagers)
+void RenderGraph::constructAll(Registry& nodeManager, std::vector<Registry*> frameManagers, bool hasAsyncComputeQueue)
 {
     m_frameContexts.clear();
 
@@ -35,19 +39,26 @@ void RenderGraph::constructAll(Registry& nodeManager, std::vector<Registry*> fra
     int nextFrameIdx = 1;
 
     for (auto& frameManager : frameManagers) {
-        FrameContext frameCtx {};
-
         LogInfo("  frame=%i\n", nextFrameIdx++);
         int nextNodeIdx = 1;
 
+        std::unordered_map<RenderGraphNode*, RenderGraphNode::ExecuteCallback> executeCallbacks {};
         for (auto& node : m_allNodes) {
             LogInfo("    node=%i (%s)\n", nextNodeIdx++, node->name().c_str());
             frameManager->setCurrentNode(node->name());
-            auto executeCallback = node->constructFrame(*frameManager);
-            frameCtx.nodeContexts.push_back({ .node = node.get(),
-                                              .executeCallback = executeCallback });
+            executeCallbacks[node.get()] = node->constructFrame(*frameManager);
+        }
+
+        FrameContext frameCtx {};
+        for (RenderGraphNode* node : resolveNodeOrder(nodeManager, *frameManager)) {
+            frameCtx.nodeContexts.push_back({ .node = node,
+                                              .executeCallback = executeCallbacks[node],
+                                              .profileZoneName = Profiler::instance().persistentName(node->displayName().value_or(node->name())),
+                                              .synchronization = { .asyncCompute = hasAsyncComputeQueue && node->prefersAsyncCompute() } });
         }
 
+        deriveSynchronization(nodeManager, *frameManager, frameCtx);
+
         m_frameContexts[frameManager] = frameCtx;
     }
 
@@ -57,17 +68,445 @@ void RenderGraph::constructAll(Registry& nodeManager, std::vector<Registry*> fra
     }
 }
 
-void RenderGraph::forEachNodeInResolvedOrder(const Registry& frameManager, std::function<void(std::string nodeName, NodeTimer& timer, const RenderGraphNode::ExecuteCallback&)> callback) const
+uint32_t RenderGraph::eventCount(const Registry& frameManager) const
+{
+    auto entry = m_frameContexts.find(&frameManager);
+    ASSERT(entry != m_frameContexts.end());
+    return entry->second.eventCount;
+}
+
+uint32_t RenderGraph::semaphoreCount(const Registry& frameManager) const
+{
+    auto entry = m_frameContexts.find(&frameManager);
+    ASSERT(entry != m_frameContexts.end());
+    return entry->second.semaphoreCount;
+}
+
+const RenderGraph::FrameQueueSynchronization& RenderGraph::frameQueueSynchronization(const Registry& frameManager) const
 {
     auto entry = m_frameContexts.find(&frameManager);
     ASSERT(entry != m_frameContexts.end());
+    return entry->second.queueSynchronization;
+}
 
-    // TODO: We also have to make sure that nodes rendering to the screen are last (and in some respective order that makes sense)
-    // TODO: Actually run the callback in the correctly resolved order!
+void RenderGraph::forEachNodeInResolvedOrder(const Registry& frameManager, NodeCallback callback) const
+{
+    auto entry = m_frameContexts.find(&frameManager);
+    ASSERT(entry != m_frameContexts.end());
 
     const FrameContext& frameContext = entry->second;
-    for (auto& [node, execCallback] : frameContext.nodeContexts) {
+    for (auto& [node, execCallback, profileZoneName, synchronization] : frameContext.nodeContexts) {
         std::string nodeDisplayName = node->displayName().value_or(node->name());
-        callback(nodeDisplayName, node->timer(), execCallback);
+        callback(nodeDisplayName, profileZoneName, node->timer(), synchronization, execCallback);
+    }
+}
+
+std::vector<RenderGraph::TransientResourceLifetime> RenderGraph::transientResourceLifetimes(const Registry& frameManager) const
+{
+    auto entry = m_frameContexts.find(&frameManager);
+    ASSERT(entry != m_frameContexts.end());
+    const FrameContext& frameContext = entry->second;
+
+    std::unordered_map<std::string, uint32_t> resolvedNodeIndices {};
+    for (uint32_t idx = 0; idx < frameContext.nodeContexts.size(); ++idx)
+        resolvedNodeIndices[frameContext.nodeContexts[idx].node->name()] = idx;
+
+    std::vector<TransientResourceLifetime> lifetimes {};
+    for (Resource* resource : frameManager.transientResources()) {
+
+        std::optional<TransientResourceLifetime> lifetime {};
+        for (const std::string& user : frameManager.transientResourceUsers(*resource)) {
+            auto nodeEntry = resolvedNodeIndices.find(user);
+            if (nodeEntry == resolvedNodeIndices.end())
+                continue;
+
+            uint32_t nodeIndex = nodeEntry->second;
+            if (frameContext.nodeContexts[nodeIndex].synchronization.asyncCompute) {
+                uint32_t lastNodeIndex = uint32_t(frameContext.nodeContexts.size() - 1);
+                lifetime = { resource, 0, lastNodeIndex, true };
+                break;
+            }
+
+            if (!lifetime.has_value()) {
+                lifetime = { resource, nodeIndex, nodeIndex };
+            } else {
+                lifetime->firstNodeIndex = std::min(lifetime->firstNodeIndex, nodeIndex);
+                lifetime->lastNodeIndex = std::max(lifetime->lastNodeIndex, nodeIndex);
+            }
+        }
+
+        if (lifetime.has_value())
+            lifetimes.push_back(lifetime.value());
+    }
+
+    return lifetimes;
+}
+
+std::vector<RenderGraphNode*> RenderGraph::resolveNodeOrder(const Registry& nodeManager, const Registry& frameManager) const
+{
+    size_t nodeCount = m_allNodes.size();
+
+    std::unordered_map<std::string, size_t> nodeIndices {};
+    for (size_t idx = 0; idx < nodeCount; ++idx)
+        nodeIndices[m_allNodes[idx]->name()] = idx;
+
+    // Build the graph, with edges going from the node that publishes a resource to the nodes that consume it
+
+    std::vector<std::vector<size_t>> consumers(nodeCount);
+    std::vector<size_t> unresolvedDependencyCount(nodeCount, 0);
+
+    auto addDependencies = [&](const Registry& registry) {
+        for (const NodeDependency& dependency : registry.nodeDependencies()) {
+            auto neededIn = nodeIndices.find(dependency.neededIn());
+            auto comesFrom = nodeIndices.find(dependency.comesFrom());
+            if (neededIn == nodeIndices.end() || comesFrom == nodeIndices.end())
+                continue;
+            if (neededIn->second == comesFrom->second)
+                continue;
+
+            std::vector<size_t>& nodeConsumers = consumers[comesFrom->second];
+            if (std::find(nodeConsumers.begin(), nodeConsumers.end(), neededIn->second) != nodeConsumers.end())
+                continue;
+
+            nodeConsumers.push_back(neededIn->second);
+            unresolvedDependencyCount[neededIn->second] += 1;
+        }
+    };
+    addDependencies(nodeManager);
+    addDependencies(frameManager);
+
+    // Topological sort (Kahn's algorithm), always picking the ready node that was added first. Nodes may write to
+    // resources of other nodes without it being recorded as a dependency (e.g. several nodes writing to the "forward"
+    // color in sequence), so we have to stay as close to the order the nodes were added as possible.
+
+    std::vector<size_t> resolvedOrder {};
+    resolvedOrder.reserve(nodeCount);
+
+    std::vector<bool> resolved(nodeCount, false);
+    while (resolvedOrder.size() < nodeCount) {
+
+        size_t nextNode = nodeCount;
+        for (size_t idx = 0; idx < nodeCount; ++idx) {
+            if (!resolved[idx] && unresolvedDependencyCount[idx] == 0) {
+                nextNode = idx;
+                break;
+            }
+        }
+
+        if (nextNode == nodeCount) {
+            std::string nodesInCycle {};
+            for (size_t idx = 0; idx < nodeCount; ++idx) {
+                if (!resolved[idx])
+                    nodesInCycle += " " + m_allNodes[idx]->name();
+            }
+            LogErrorAndExit("RenderGraph: cyclic dependency between nodes, can't resolve an order for:%s\n", nodesInCycle.c_str());
+        }
+
+        resolved[nextNode] = true;
+        resolvedOrder.push_back(nextNode);
+
+        for (size_t consumer : consumers[nextNode])
+            unresolvedDependencyCount[consumer] -= 1;
     }
+
+    // Cull nodes that are only there to produce resources for other nodes, if no live node consumes them. Since all
+    // consumers come after their producers in the resolved order we can find all live nodes in a single reverse pass.
+
+    std::vector<bool> live(nodeCount, false);
+    for (auto it = resolvedOrder.rbegin(); it != resolvedOrder.rend(); ++it) {
+        size_t idx = *it;
+        const std::string& name = m_allNodes[idx]->name();
+
+        bool publishesResources = nodeManager.hasPublishedResources(name) || frameManager.hasPublishedResources(name);
+        bool hasSideEffects = nodeManager.writesToResourcesOfOtherNodes(name) || frameManager.writesToResourcesOfOtherNodes(name);
+
+        if (!publishesResources || hasSideEffects) {
+            live[idx] = true;
+            continue;
+        }
+
+        live[idx] = std::any_of(consumers[idx].begin(), consumers[idx].end(), [&](size_t consumer) { return live[consumer]; });
+    }
+
+    std::vector<RenderGraphNode*> orderedNodes {};
+    for (size_t idx : resolvedOrder) {
+        if (live[idx])
+            orderedNodes.push_back(m_allNodes[idx].get());
+        else
+            LogInfo("RenderGraph: culling node '%s' since none of its published resources are used\n", m_allNodes[idx]->name().c_str());
+    }
+
+    return orderedNodes;
+}
+
+void RenderGraph::deriveSynchronization(const Registry& nodeManager, const Registry& frameManager, FrameContext& frameContext) const
+{
+    uint32_t nodeCount = uint32_t(frameContext.nodeContexts.size());
+
+    // A node can access the same resource through both registries, e.g. a texture of the node registry in a binding set of the frame registry
+    std::vector<std::vector<NodeResourceAccess>> nodeAccesses(nodeCount);
+    for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        const std::string& nodeName = frameContext.nodeContexts[nodeIndex].node->name();
+        std::vector<NodeResourceAccess>& accesses = nodeAccesses[nodeIndex];
+
+        accesses = nodeManager.resourceAccesses(nodeName);
+        for (const NodeResourceAccess& access : frameManager.resourceAccesses(nodeName)) {
+            auto entry = std::find_if(accesses.begin(), accesses.end(), [&](const NodeResourceAccess& other) {
+                return &other.resource() == &access.resource();
+            });
+            if (entry == accesses.end())
+                accesses.push_back(access);
+            else
+                entry->merge(access);
+        }
+
+        // A node on the async compute queue can only access resources from compute shaders, so any other accesses are through binding sets
+        // or render targets that it only creates for other nodes (which record their own accesses when they get them)
+        if (frameContext.nodeContexts[nodeIndex].synchronization.asyncCompute) {
+            for (NodeResourceAccess& access : accesses)
+                access.shaderStages = ShaderStage(access.shaderStages & ShaderStageCompute);
+            accesses.erase(std::remove_if(accesses.begin(), accesses.end(), [](const NodeResourceAccess& access) { return access.shaderStages == 0; }),
+                           accesses.end());
+        }
+    }
+
+    auto isAsyncCompute = [&](uint32_t nodeIndex) -> bool {
+        return frameContext.nodeContexts[nodeIndex].synchronization.asyncCompute;
+    };
+
+    // Transient resources have no contents at the start of the frame, so their ownership never has to be transferred from there
+    std::unordered_set<const Resource*> transientResources { frameManager.transientResources().begin(), frameManager.transientResources().end() };
+
+    struct PendingAccess {
+        uint32_t nodeIndex;
+        NodeResourceAccess access;
+    };
+
+    // (node index of accesses from the previous frame)
+    constexpr uint32_t previousFrame = UINT32_MAX;
+
+    struct ResourceState {
+        //! The last write to the resource, or the last read which changed the layout of the texture (since that's a write too)
+        std::optional<PendingAccess> lastWrite {};
+        std::vector<PendingAccess> readsSinceWrite {};
+        //! The shader stages that the last write has been made visible to by barriers so far
+        ShaderStage visibleShaderStages { ShaderStage(0) };
+        ResourceAccessType lastAccessType { ResourceAccessType::ShaderRead };
+    };
+
+    // Updates the state of the resource for the next access, and returns the accesses it must wait for, if it needs a barrier
+    auto applyAccess = [](ResourceState& state, uint32_t nodeIndex, const NodeResourceAccess& access) -> std::optional<std::vector<PendingAccess>> {
+        bool changesLayout = access.texture != nullptr && access.type != state.lastAccessType;
+
+        if (!access.isWrite() && !changesLayout) {
+            std::optional<std::vector<PendingAccess>> barrierAgainst {};
+            bool lastWriteIsVisible = (access.shaderStages & ~state.visibleShaderStages) == 0;
+            if (state.lastWrite.has_value() && !lastWriteIsVisible) {
+                barrierAgainst = std::vector<PendingAccess> { state.lastWrite.value() };
+                state.visibleShaderStages = ShaderStage(state.visibleShaderStages | access.shaderStages);
+            }
+            state.readsSinceWrite.push_back({ nodeIndex, access });
+            return barrierAgainst;
+        }
+
+        std::vector<PendingAccess> barrierAgainst = state.readsSinceWrite;
+        if (state.lastWrite.has_value())
+            barrierAgainst.push_back(state.lastWrite.value());
+
+        state.lastWrite = PendingAccess { nodeIndex, access };
+        state.readsSinceWrite.clear();
+        state.visibleShaderStages = access.isWrite() ? ShaderStage(0) : access.shaderStages;
+        state.lastAccessType = access.type;
+
+        return barrierAgainst;
+    };
+
+    // The queue that owns the resource, and its last node to access the resource (none if it has owned it since the start of the frame)
+    struct QueueOwnership {
+        bool asyncCompute { false };
+        std::optional<uint32_t> lastAccessNodeIndex {};
+        NodeResourceAccess lastAccess {};
+    };
+
+    // (points in the order of the nodes which a queue can wait for the other queue to reach, other than after each of the nodes)
+    constexpr int64_t noWait = -2;
+    constexpr int64_t frameStart = -1;
+
+    // The first pass only finds the state of all resources at the end of the frame, which is where persistent resources start in the second
+    std::unordered_map<const Resource*, ResourceState> resourceStates {};
+    std::vector<std::optional<uint32_t>> nodeSignalEvents(nodeCount);
+    std::vector<uint32_t> eventLastWaitNodes {};
+
+    FrameQueueSynchronization& queueSynchronization = frameContext.queueSynchronization;
+    uint32_t semaphoreCount = 0;
+    size_t queueTransferCount = 0;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool isRecordingPass = pass == 1;
+
+        // All resources are owned by the graphics queue at the start (and end) of each frame
+        std::unordered_map<const Resource*, QueueOwnership> queueOwnerships {};
+        int64_t graphicsWaitedUntil = noWait;
+        int64_t asyncComputeWaitedUntil = noWait;
+
+        if (isRecordingPass) {
+            std::unordered_map<const Resource*, ResourceState> previousFrameStates {};
+            for (auto& [resource, state] : resourceStates) {
+                if (!nodeManager.ownsResource(*resource))
+                    continue;
+                ResourceState& previousFrameState = previousFrameStates[resource] = state;
+                if (previousFrameState.lastWrite.has_value())
+                    previousFrameState.lastWrite->nodeIndex = previousFrame;
+                for (PendingAccess& read : previousFrameState.readsSinceWrite)
+                    read.nodeIndex = previousFrame;
+            }
+            resourceStates = std::move(previousFrameStates);
+        }
+
+        for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            NodeSynchronization& synchronization = frameContext.nodeContexts[nodeIndex].synchronization;
+
+            // The last node on the other queue that this node depends on (and the first node on the async compute queue always waits for
+            // the start of the frame, so that it comes after everything the graphics queue did before the frame, like resetting queries)
+            int64_t waitUntil = synchronization.asyncCompute ? frameStart : noWait;
+
+            for (const NodeResourceAccess& access : nodeAccesses[nodeIndex]) {
+
+                QueueOwnership& ownership = queueOwnerships[&access.resource()];
+                if (ownership.asyncCompute != synchronization.asyncCompute) {
+                    bool hasContents = ownership.lastAccessNodeIndex.has_value() || !transientResources.contains(&access.resource());
+                    if (isRecordingPass && hasContents) {
+                        if (ownership.lastAccessNodeIndex.has_value())
+                            frameContext.nodeContexts[ownership.lastAccessNodeIndex.value()].synchronization.queueReleases.push_back(access);
+                        else
+                            queueSynchronization.releasesAtStart.push_back(access);
+                        synchronization.queueAcquires.push_back(access);
+                        queueTransferCount += 1;
+                    }
+
+                    waitUntil = std::max(waitUntil, ownership.lastAccessNodeIndex.has_value() ? int64_t(ownership.lastAccessNodeIndex.value()) : frameStart);
+                    ownership.asyncCompute = synchronization.asyncCompute;
+
+                    // Beyond the wait for the other queue & the ownership transfer there are no earlier accesses on this queue to synchronize with
+                    resourceStates.erase(&access.resource());
+                }
+                ownership.lastAccessNodeIndex = nodeIndex;
+                ownership.lastAccess = access;
+
+                auto entry = resourceStates.find(&access.resource());
+                if (entry == resourceStates.end()) {
+                    ResourceState& state = resourceStates[&access.resource()];
+                    state.lastAccessType = access.type;
+                    if (access.isWrite()) {
+                        state.lastWrite = PendingAccess { nodeIndex, access };
+                    } else {
+                        state.readsSinceWrite.push_back({ nodeIndex, access });
+                        state.visibleShaderStages = access.shaderStages;
+                    }
+                    // (only textures need a barrier for their first access, for the layout transition)
+                    if (isRecordingPass && access.texture)
+                        synchronization.barriers.push_back({ .nextAccess = access });
+                    continue;
+                }
+
+                std::optional<std::vector<PendingAccess>> barrierAgainst = applyAccess(entry->second, nodeIndex, access);
+                if (!isRecordingPass || !barrierAgainst.has_value())
+                    continue;
+
+                ResourceBarrier barrier { .nextAccess = access };
+                for (const PendingAccess& pendingAccess : barrierAgainst.value())
+                    barrier.previousAccesses.push_back(pendingAccess.access);
+
+                // If all previous accesses are in one earlier node of this frame, and there are other nodes on the same queue in between, split
+                // the barrier (all previous accesses are on the same queue, since the accesses are forgotten when the ownership is transferred)
+                uint32_t previousNodeIndex = barrierAgainst->front().nodeIndex;
+                bool isSplittable = previousNodeIndex != previousFrame
+                    && std::all_of(barrierAgainst->begin(), barrierAgainst->end(), [&](const PendingAccess& pendingAccess) {
+                           return pendingAccess.nodeIndex == previousNodeIndex;
+                       });
+                if (isSplittable) {
+                    isSplittable = false;
+                    for (uint32_t otherNodeIndex = previousNodeIndex + 1; otherNodeIndex < nodeIndex && !isSplittable; ++otherNodeIndex)
+                        isSplittable = isAsyncCompute(otherNodeIndex) == synchronization.asyncCompute;
+                }
+
+                if (!isSplittable) {
+                    synchronization.barriers.push_back(barrier);
+                    continue;
+                }
+
+                if (!nodeSignalEvents[previousNodeIndex].has_value()) {
+                    nodeSignalEvents[previousNodeIndex] = uint32_t(eventLastWaitNodes.size());
+                    eventLastWaitNodes.push_back(nodeIndex);
+                }
+                uint32_t event = nodeSignalEvents[previousNodeIndex].value();
+                eventLastWaitNodes[event] = nodeIndex;
+
+                synchronization.eventBarriers.push_back(barrier);
+                if (std::find(synchronization.waitEvents.begin(), synchronization.waitEvents.end(), event) == synchronization.waitEvents.end())
+                    synchronization.waitEvents.push_back(event);
+            }
+
+            // Waiting for a node on the other queue also covers all nodes before it on that queue, and all later nodes on this queue
+            int64_t& waitedUntil = synchronization.asyncCompute ? asyncComputeWaitedUntil : graphicsWaitedUntil;
+            if (waitUntil > waitedUntil) {
+                if (isRecordingPass) {
+                    uint32_t semaphore = semaphoreCount++;
+                    if (waitUntil == frameStart) {
+                        queueSynchronization.signalSemaphoreAtStart = semaphore;
+                    } else {
+                        NodeSynchronization& signalingNode = frameContext.nodeContexts[waitUntil].synchronization;
+                        ASSERT(!signalingNode.signalSemaphore.has_value());
+                        signalingNode.signalSemaphore = semaphore;
+                    }
+                    synchronization.waitSemaphore = semaphore;
+                }
+                waitedUntil = waitUntil;
+            }
+        }
+
+        if (!isRecordingPass)
+            continue;
+
+        // The graphics queue takes back everything that the async compute queue owns at the end of the frame, and also has to wait for it
+        // to finish since the frame is only done once the graphics queue is
+        for (int64_t nodeIndex = int64_t(nodeCount) - 1; nodeIndex > graphicsWaitedUntil; --nodeIndex) {
+            if (!isAsyncCompute(uint32_t(nodeIndex)))
+                continue;
+            uint32_t semaphore = semaphoreCount++;
+            frameContext.nodeContexts[nodeIndex].synchronization.signalSemaphore = semaphore;
+            queueSynchronization.waitSemaphoreAtEnd = semaphore;
+            break;
+        }
+
+        for (auto& [resource, ownership] : queueOwnerships) {
+            if (!ownership.asyncCompute || transientResources.contains(resource))
+                continue;
+            frameContext.nodeContexts[ownership.lastAccessNodeIndex.value()].synchronization.queueReleases.push_back(ownership.lastAccess);
+            // (without any shader stages the resource is acquired for any kind of access, since the next one isn't known here)
+            queueSynchronization.acquiresAtEnd.push_back({ .texture = ownership.lastAccess.texture,
+                                                          .buffer = ownership.lastAccess.buffer,
+                                                          .type = ResourceAccessType::ShaderReadWrite });
+            queueTransferCount += 1;
+        }
+    }
+
+    for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+        frameContext.nodeContexts[nodeIndex].synchronization.signalEvent = nodeSignalEvents[nodeIndex];
+
+    frameContext.eventCount = uint32_t(eventLastWaitNodes.size());
+    for (uint32_t event = 0; event < frameContext.eventCount; ++event)
+        frameContext.nodeContexts[eventLastWaitNodes[event]].synchronization.resetEvents.push_back(event);
+
+    size_t barrierCount = 0;
+    size_t splitBarrierCount = 0;
+    for (const NodeContext& nodeContext : frameContext.nodeContexts) {
+        barrierCount += nodeContext.synchronization.barriers.size();
+        splitBarrierCount += nodeContext.synchronization.eventBarriers.size();
+    }
+    LogInfo("    derived %zu resource barriers (and %zu more split using %u events)\n", barrierCount, splitBarrierCount, frameContext.eventCount);
+
+    frameContext.semaphoreCount = semaphoreCount;
+    if (semaphoreCount > 0)
+        LogInfo("    derived %zu queue ownership transfers (using %u semaphores) for the async compute queue\n", queueTransferCount, semaphoreCount);
 }
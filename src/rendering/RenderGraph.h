@@ -5,6 +5,7 @@
 #include "RenderGraphNode.h"
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -20,27 +21,122 @@ public:
     void addNode(std::unique_ptr<RenderGraphNode>&&);
 
     template<typename NodeType, typename... Args>
-    void addNode(Args&&... args)
+    NodeType& addNode(Args&&... args)
     {
         auto nodePtr = std::make_unique<NodeType>(std::forward<Args>(args)...);
+        NodeType& node = *nodePtr;
         addNode(std::move(nodePtr));
+        return node;
     }
 
-    //! Construct all nodes & set up a per-frame context for each resource manager frameManagers
-    void constructAll(Registry& nodeManager, std::vector<Registry*> frameManagers);
+    //! Construct all nodes & set up a per-frame context for each resource manager frameManagers. Nodes that prefer it are scheduled on
+    //! the async compute queue, if the backend has one.
+    void constructAll(Registry& nodeManager, std::vector<Registry*> frameManagers, bool hasAsyncComputeQueue = false);
 
-    //! The callback is called for each node (in correct order)
-    void forEachNodeInResolvedOrder(const Registry&, std::function<void(std::string, NodeTimer&, const RenderGraphNode::ExecuteCallback&)>) const;
+    struct TransientResourceLifetime {
+        Resource* resource;
+        //! Indices into the resolved node order of the first & last node using the resource
+        uint32_t firstNodeIndex;
+        uint32_t lastNodeIndex;
+        //! If the resource is used on the async compute queue, which means its contents don't carry over between frames, since ownership
+        //! of transient resources isn't transferred back to the graphics queue at the end of the frame
+        bool asyncCompute { false };
+    };
+
+    //! Lifetimes of all transient resources of the frame registry which are in use by non-culled nodes. Resources used on the async
+    //! compute queue span the whole frame, since the nodes of the two queues don't execute in the resolved order with respect to each other.
+    std::vector<TransientResourceLifetime> transientResourceLifetimes(const Registry& frameManager) const;
+
+    struct ResourceBarrier {
+        //! The accesses that have to finish before the next one, i.e. the last write and (if the next access is a write too) any reads
+        //! since then. Empty for the first access of the resource in the graph, which then only has to transition the texture layout.
+        std::vector<NodeResourceAccess> previousAccesses {};
+        NodeResourceAccess nextAccess {};
+    };
+
+    //! Synchronization derived from the resource accesses of the nodes, which is all a node needs before it executes (since nodes
+    //! don't synchronize with each other in any other way) and after it's done. Events & semaphores are numbered from zero within a
+    //! frame context. All resources are owned by the graphics queue outside of the nodes that access them on the async compute queue.
+    struct NodeSynchronization {
+        //! If the node runs on the async compute queue, instead of the graphics queue
+        bool asyncCompute { false };
+
+        //! Signaled by a node on the other queue that this node depends on, which it has to wait for before it begins. This also covers
+        //! any earlier nodes on that queue, so a node only waits if no earlier node on its queue has waited for the same or a later one.
+        std::optional<uint32_t> waitSemaphore {};
+        //! Resources that this node takes ownership of from the other queue, which released them after its last access
+        std::vector<NodeResourceAccess> queueAcquires {};
+
+        //! Barriers against the node right before, or against the previous frame, which can't be split
+        std::vector<ResourceBarrier> barriers {};
+        //! Barriers against nodes further back, split by waiting on events which those nodes signal once they're done, so that the nodes
+        //! in between can overlap with them
+        std::vector<ResourceBarrier> eventBarriers {};
+        std::vector<uint32_t> waitEvents {};
+
+        std::optional<uint32_t> signalEvent {};
+        //! Events with no later waits in the frame, so they can be reset once the node is done (as the frame starts with all unsignaled)
+        std::vector<uint32_t> resetEvents {};
+
+        //! Resources that a node on the other queue accesses next, so this node has to release its ownership of them once it's done
+        std::vector<NodeResourceAccess> queueReleases {};
+        //! Signaled once the node is done, for a node on the other queue to wait on
+        std::optional<uint32_t> signalSemaphore {};
+    };
+
+    //! Synchronization between the queues at the start & end of the frame, which is only needed if any node runs on the async compute queue
+    struct FrameQueueSynchronization {
+        //! Resources that the graphics queue releases at the start of the frame, since they are first accessed on the async compute queue
+        std::vector<NodeResourceAccess> releasesAtStart {};
+        //! Signaled at the start of the frame, for the first node on the async compute queue to wait on (if it doesn't wait for a later one)
+        std::optional<uint32_t> signalSemaphoreAtStart {};
+
+        //! Signaled by the last node on the async compute queue, for the graphics queue to wait on after all nodes (if it hasn't already)
+        std::optional<uint32_t> waitSemaphoreAtEnd {};
+        //! Resources that the graphics queue takes back ownership of after all nodes, since they were last accessed on the async compute queue
+        std::vector<NodeResourceAccess> acquiresAtEnd {};
+    };
+
+    [[nodiscard]] const FrameQueueSynchronization& frameQueueSynchronization(const Registry& frameManager) const;
+
+    //! The number of events needed for the synchronization of the frame registry's frame context
+    uint32_t eventCount(const Registry& frameManager) const;
+    //! The number of (binary) semaphores needed for the synchronization between the queues of the frame registry's frame context
+    uint32_t semaphoreCount(const Registry& frameManager) const;
+
+    using NodeCallback = std::function<void(std::string nodeName, const char* profileZoneName, NodeTimer&, const NodeSynchronization&, const RenderGraphNode::ExecuteCallback&)>;
+
+    //! The callback is called for each node that is not culled, in an order where all dependencies of a node come before it. The profile
+    //! zone name is the node's display name, interned once when the graph is constructed so it can be passed straight to the profiler.
+    void forEachNodeInResolvedOrder(const Registry&, NodeCallback) const;
 
 private:
     struct NodeContext {
         RenderGraphNode* node;
         RenderGraphNode::ExecuteCallback executeCallback;
+        const char* profileZoneName;
+        NodeSynchronization synchronization {};
     };
     struct FrameContext {
+        //! Node contexts in resolved order, excluding culled nodes
         std::vector<NodeContext> nodeContexts {};
+        FrameQueueSynchronization queueSynchronization {};
+        uint32_t eventCount { 0 };
+        uint32_t semaphoreCount { 0 };
     };
 
+    //! Resolve the execution order of all nodes from the recorded node dependencies. Nodes are
+    //! kept in the order they were added as long as it doesn't violate any dependencies. Nodes
+    //! that publish resources which no live node consumes are culled (unless they also write to
+    //! resources of other nodes). Exits with an error if the dependencies contain a cycle.
+    std::vector<RenderGraphNode*> resolveNodeOrder(const Registry& nodeManager, const Registry& frameManager) const;
+
+    //! Derive the barriers & events of all nodes in the frame context from the resource accesses recorded in the registries. Accesses that
+    //! don't conflict (e.g. sampling a texture in several nodes in a row) don't get any barriers. Resources of the node registry persist
+    //! between frames, so their first access in the frame is synchronized against their last access in the previous frame. Whenever the
+    //! queue that accesses a resource changes, its ownership is transferred between the queues & the new one waits on a semaphore instead.
+    void deriveSynchronization(const Registry& nodeManager, const Registry& frameManager, FrameContext&) const;
+
     //! All nodes that are part of this graph
     std::vector<std::unique_ptr<RenderGraphNode>> m_allNodes {};
 
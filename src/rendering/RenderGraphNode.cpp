@@ -15,6 +15,7 @@ double NodeTimer::averageCpuTime() const
 void NodeTimer::reportGpuTime(double time)
 {
     m_gpuAccumulator.report(time);
+    m_lastGpuTime = time;
 }
 
 double NodeTimer::averageGpuTime() const
@@ -22,6 +23,21 @@ double NodeTimer::averageGpuTime() const
     return m_gpuAccumulator.runningAverage();
 }
 
+std::optional<double> NodeTimer::lastGpuTime() const
+{
+    return m_lastGpuTime;
+}
+
+void NodeTimer::reportPipelineStatistics(const PipelineStatistics& statistics)
+{
+    m_lastPipelineStatistics = statistics;
+}
+
+const std::optional<NodeTimer::PipelineStatistics>& NodeTimer::lastPipelineStatistics() const
+{
+    return m_lastPipelineStatistics;
+}
+
 RenderGraphNode::RenderGraphNode(std::string name)
     : m_name(std::move(name))
 {
@@ -5,8 +5,10 @@
 #include "backend/CommandList.h"
 #include "backend/Resources.h"
 #include "utility/AvgAccumulator.h"
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 
 class NodeTimer {
@@ -16,10 +18,27 @@ public:
 
     void reportGpuTime(double);
     double averageGpuTime() const;
+    //! The GPU time of the last timed frame, which lags behind the frames in flight since it's only read back once the frame is done
+    std::optional<double> lastGpuTime() const;
+
+    //! Counts of the work done by the node on the GPU during one frame
+    struct PipelineStatistics {
+        uint64_t inputAssemblyPrimitives;
+        uint64_t vertexShaderInvocations;
+        uint64_t clippingPrimitives;
+        uint64_t fragmentShaderInvocations;
+        uint64_t computeShaderInvocations;
+    };
+
+    //! Only reported when pipeline statistics are collected, since that's not free
+    void reportPipelineStatistics(const PipelineStatistics&);
+    const std::optional<PipelineStatistics>& lastPipelineStatistics() const;
 
 private:
     AvgAccumulator<double, 60> m_cpuAccumulator;
     AvgAccumulator<double, 60> m_gpuAccumulator;
+    std::optional<double> m_lastGpuTime {};
+    std::optional<PipelineStatistics> m_lastPipelineStatistics {};
 };
 
 class RenderGraphNode {
@@ -35,7 +54,14 @@ public:
     //! Optionally return a display name for use in GUI situations
     virtual std::optional<std::string> displayName() const { return {}; }
 
-    //! This is not const since we need to write to members here that are shared for the whole node.
+    //! Nodes that only record compute work (dispatches & clears, but no rendering, or texture copies & mipmap generation, which are blits) can
+    //! opt into running on the async compute queue, where it may overlap graphics work that it doesn't depend on. Ignored if there is none.
+    //! Switching queues costs a semaphore wait & queue ownership transfers, so it only pays off for nodes with such independent work.
+    virtual bool prefersAsyncCompute() const { return false; }
+
+    //! This is not const since we need to write to members here that are shared for the whole node. All nodes are constructed before any
+    //! frames, so create the shaders of the node's states here, which queues them for compilation in the background. Creating a state
+    //! waits for its shaders, so this way they all compile in parallel rather than one node at a time.
     virtual void constructNode(Registry&) {};
 
     //! This is const, since changing or writing to any members would probably break stuff
@@ -12,11 +12,8 @@ ShaderFile::ShaderFile(std::string path, ShaderFileType type)
     : m_path(std::move(path))
     , m_type(type)
 {
-    auto maybeError = ShaderManager::instance().loadAndCompileImmediately(m_path);
-    if (maybeError.has_value()) {
-        LogError("Shader file error: %s\n", maybeError.value().c_str());
-        LogErrorAndExit("Exiting due to bad shader at startup.\n");
-    }
+    // NOTE: Compilation errors are reported when the backend first asks for the SPIR-V
+    ShaderManager::instance().requestCompilation(m_path);
 }
 
 const std::string& ShaderFile::path() const
@@ -2,14 +2,50 @@
 
 #include "utility/FileIO.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include "utility/ThreadPool.h"
 #include "utility/util.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
 #include <thread>
 
 // TODO: Implement Windows support!
 #include <sys/stat.h>
 
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static uint64_t hashBytesFnv1a(uint64_t hash, const char* bytes, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(bytes[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static constexpr uint64_t fnv1aOffsetBasis = 0xcbf29ce484222325ull;
+
+// NOTE: The SPIR-V magic number only tells us the file starts out right, so we also keep the size & a hash of the SPIR-V to reject files
+// that are truncated or otherwise corrupt (e.g. from a crash mid-write) instead of passing them on to the driver.
+struct SpirvCacheFileHeader {
+    static constexpr uint32_t expectedMagic = 0x41535043; // "ASPC"
+    static constexpr uint32_t currentVersion = 1;
+    uint32_t magic;
+    uint32_t version;
+    uint64_t spirvSize;
+    uint64_t spirvHash;
+};
+
 ShaderManager& ShaderManager::instance()
 {
     static ShaderManager instance { "shaders" };
@@ -27,47 +63,215 @@ void ShaderManager::startFileWatching(unsigned msBetweenPolls, std::function<voi
         return;
 
     m_fileWatchingActive = true;
-    m_fileWatcherThread = std::make_unique<std::thread>([this, msBetweenPolls, &fileChangeCallback]() {
-        while (m_fileWatchingActive) {
-            //LogInfo("ShaderManager: update!\n");
-            {
-                std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
-
-                std::vector<std::string> filesToRemove;
-                int numChangedFiles = 0;
-
-                for (auto& [_, data] : m_loadedShaders) {
-
-                    if (!FileIO::isFileReadable(data.filePath)) {
-                        LogWarning("ShaderManager: removing shader '%s' from managed set since it seems to have been removed.\n");
-                        filesToRemove.push_back(data.filePath);
-                        continue;
-                    }
-
-                    uint64_t lastEdit = getFileEditTimestamp(data.filePath);
-                    if (lastEdit <= data.lastEditTimestamp)
-                        continue;
-
-                    //LogInfo("ShaderManager: updating file '%s'\n", data.path.c_str());
-                    data.glslSource = FileIO::readEntireFile(data.filePath).value();
-                    data.lastEditTimestamp = lastEdit;
-                    if (compileGlslToSpirv(data)) {
-                        data.currentBinaryVersion += 1;
-                        numChangedFiles += 1;
-                    } else {
-                        LogError("Shader at path '%s' could not compile:\n\t%s\n", data.filePath.c_str(), data.lastCompileError.c_str());
-                    }
+    m_fileWatcherThread = std::make_unique<std::thread>([this, msBetweenPolls, fileChangeCallback = std::move(fileChangeCallback)]() {
+        SET_PROFILER_THREAD_NAME("Shader file watcher");
+#if defined(__linux__)
+        watchFilesUsingInotify(msBetweenPolls, fileChangeCallback);
+#else
+        watchFilesByPolling(msBetweenPolls, fileChangeCallback);
+#endif
+    });
+}
+
+#if defined(__linux__)
+void ShaderManager::watchFilesUsingInotify(unsigned msTimeout, const std::function<void()>& fileChangeCallback)
+{
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        LogWarning("ShaderManager: could not initialize inotify, falling back to polling for file changes.\n");
+        watchFilesByPolling(msTimeout, fileChangeCallback);
+        return;
+    }
+
+    // Watch all directories under the base path, since shaders can include files from anywhere in there
+    std::unordered_map<int, std::string> watchedDirectories {};
+    auto addWatch = [&](const std::string& directory) {
+        int watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_CREATE);
+        if (watchDescriptor >= 0)
+            watchedDirectories[watchDescriptor] = directory;
+        else
+            LogWarning("ShaderManager: could not watch directory '%s' for changes.\n", directory.c_str());
+    };
+
+    addWatch(m_shaderBasePath);
+    for (auto it = std::filesystem::recursive_directory_iterator(m_shaderBasePath); it != std::filesystem::recursive_directory_iterator(); ++it) {
+        if (!it->is_directory())
+            continue;
+        std::string directory = it->path().generic_string();
+        if (directory == spirvCacheDirectory()) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        addWatch(directory);
+    }
+
+    alignas(inotify_event) char eventBuffer[4096];
+
+    while (m_fileWatchingActive) {
+        std::unordered_set<std::string> changedFiles {};
+
+        // NOTE: Wait with a timeout so we notice when we're asked to stop watching (and can reload shaders that finished compiling meanwhile)
+        pollfd pollFd { inotifyFd, POLLIN, 0 };
+        bool hasEvents = poll(&pollFd, 1, static_cast<int>(msTimeout)) > 0;
+
+        ssize_t bytesRead;
+        while (hasEvents && (bytesRead = read(inotifyFd, eventBuffer, sizeof(eventBuffer))) > 0) {
+            for (char* ptr = eventBuffer; ptr < eventBuffer + bytesRead;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto directory = watchedDirectories.find(event->wd);
+                if (event->len == 0 || directory == watchedDirectories.end())
+                    continue;
+
+                std::string path = directory->second + "/" + event->name;
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & IN_CREATE)
+                        addWatch(path);
+                    continue;
                 }
 
-                for (const auto& path : filesToRemove)
-                    m_loadedShaders.erase(path);
+                // Newly created files are empty, wait for them to be written
+                if (event->mask & IN_CREATE)
+                    continue;
 
-                if (numChangedFiles > 0 && fileChangeCallback)
-                    fileChangeCallback();
+                changedFiles.insert(path);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(msBetweenPolls));
+        }
+
+        if (reloadShadersAffectedBy(changedFiles) > 0 && fileChangeCallback)
+            fileChangeCallback();
+    }
+
+    close(inotifyFd);
+}
+#endif
+
+void ShaderManager::watchFilesByPolling(unsigned msBetweenPolls, const std::function<void()>& fileChangeCallback)
+{
+    std::unordered_map<std::string, uint64_t> lastSeenTimestamps {};
+
+    while (m_fileWatchingActive) {
+        std::unordered_set<std::string> watchedFiles {};
+        {
+            std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+            for (const auto& [path, data] : m_loadedShaders) {
+                watchedFiles.insert(path);
+                watchedFiles.insert(data.includedFilePaths.begin(), data.includedFilePaths.end());
+                lastSeenTimestamps.try_emplace(path, data.lastEditTimestamp);
+            }
+        }
+
+        // NOTE: Stat the files without holding the lock, so we never block spirv() lookups
+        std::unordered_set<std::string> changedFiles {};
+        for (const std::string& path : watchedFiles) {
+            uint64_t timestamp = FileIO::isFileReadable(path) ? getFileEditTimestamp(path) : 0;
+            auto [entry, didInsert] = lastSeenTimestamps.try_emplace(path, timestamp);
+            if (!didInsert && entry->second != timestamp) {
+                entry->second = timestamp;
+                changedFiles.insert(path);
+            }
+        }
+
+        if (reloadShadersAffectedBy(changedFiles) > 0 && fileChangeCallback)
+            fileChangeCallback();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(msBetweenPolls));
+    }
+}
+
+int ShaderManager::reloadShadersAffectedBy(const std::unordered_set<std::string>& changedFiles)
+{
+    std::unordered_set<std::string> shadersChangedDuringCompilation {};
+    {
+        std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+        if (!m_pendingCompilations.empty())
+            m_filesChangedDuringCompilation.insert(changedFiles.begin(), changedFiles.end());
+        std::swap(shadersChangedDuringCompilation, m_shadersToReloadAfterCompilation);
+    }
+
+    if (changedFiles.empty() && shadersChangedDuringCompilation.empty())
+        return 0;
+
+    SCOPED_PROFILE_ZONE("Reload shaders");
+
+    {
+        std::lock_guard<std::mutex> includeFilesLock(m_includeFilesMutex);
+        for (const std::string& path : changedFiles)
+            m_includeFiles.erase(path);
+    }
+
+    // Find all shaders that are the changed files or include any of them
+    std::vector<ShaderData> shadersToCompile {};
+    {
+        std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+        for (const auto& [path, data] : m_loadedShaders) {
+            bool isAffected = changedFiles.contains(path) || shadersChangedDuringCompilation.contains(path)
+                || std::any_of(data.includedFilePaths.begin(), data.includedFilePaths.end(), [&](const std::string& includedPath) {
+                       return changedFiles.contains(includedPath);
+                   });
+            if (isAffected)
+                shadersToCompile.emplace_back(path);
+        }
+    }
+
+    if (shadersToCompile.empty())
+        return 0;
+
+    // Compile without holding the lock, so the render thread is free to keep using the current binaries meanwhile
+    std::vector<char> shaderWasRemoved(shadersToCompile.size(), false);
+    ThreadPool::global().parallelFor(shadersToCompile.size(), [&](size_t idx) {
+        ShaderData& data = shadersToCompile[idx];
+
+        if (!FileIO::isFileReadable(data.filePath)) {
+            shaderWasRemoved[idx] = true;
+            return;
+        }
+
+        data.glslSource = FileIO::readEntireFile(data.filePath).value_or("");
+        data.lastEditTimestamp = getFileEditTimestamp(data.filePath);
+        if (data.glslSource.empty())
+            return;
+
+        if (!compileGlslToSpirv(data)) {
+            LogError("Shader at path '%s' could not compile:\n\t%s\n", data.filePath.c_str(), data.lastCompileError.c_str());
         }
     });
+
+    // Swap in all new binaries at once
+    int numChangedFiles = 0;
+    {
+        std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+        for (size_t idx = 0; idx < shadersToCompile.size(); ++idx) {
+            ShaderData& compiledData = shadersToCompile[idx];
+
+            if (shaderWasRemoved[idx]) {
+                LogWarning("ShaderManager: removing shader '%s' from managed set since it seems to have been removed.\n", compiledData.filePath.c_str());
+                m_loadedShaders.erase(compiledData.filePath);
+                continue;
+            }
+
+            auto entry = m_loadedShaders.find(compiledData.filePath);
+            if (entry == m_loadedShaders.end() || compiledData.glslSource.empty())
+                continue;
+
+            ShaderData& data = entry->second;
+            data.glslSource = std::move(compiledData.glslSource);
+            data.lastEditTimestamp = compiledData.lastEditTimestamp;
+            data.lastEditSuccessfullyCompiled = compiledData.lastEditSuccessfullyCompiled;
+            data.lastCompileError = std::move(compiledData.lastCompileError);
+
+            // Note that we only should overwrite the binary if it compiled correctly!
+            if (compiledData.lastEditSuccessfullyCompiled) {
+                data.spirvBinary = std::move(compiledData.spirvBinary);
+                data.includedFilePaths = std::move(compiledData.includedFilePaths);
+                data.currentBinaryVersion += 1;
+                numChangedFiles += 1;
+            }
+        }
+    }
+
+    return numChangedFiles;
 }
 
 void ShaderManager::stopFileWatching()
@@ -80,55 +284,215 @@ void ShaderManager::stopFileWatching()
 
 std::string ShaderManager::resolvePath(const std::string& name) const
 {
-    std::string resolvedPath = m_shaderBasePath + "/" + name;
+    // NOTE: Normalized, so that paths from includes and from the file watcher can be compared directly
+    std::string resolvedPath = std::filesystem::path(m_shaderBasePath + "/" + name).lexically_normal().generic_string();
     return resolvedPath;
 }
 
 std::optional<std::string> ShaderManager::loadAndCompileImmediately(const std::string& name)
+{
+    requestCompilation(name);
+    return waitForCompilation(resolvePath(name));
+}
+
+void ShaderManager::requestCompilation(const std::string& name)
 {
     auto path = resolvePath(name);
 
     std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+    if (m_loadedShaders.contains(path) || m_pendingCompilations.contains(path))
+        return;
 
-    auto result = m_loadedShaders.find(path);
-    if (result == m_loadedShaders.end()) {
+    std::future<void> compilation = ThreadPool::global().enqueue([this, name, path]() {
+        ShaderData data { path };
 
-        if (!FileIO::isFileReadable(path))
-            return "file '" + name + "' not found";
+        if (FileIO::isFileReadable(path)) {
+            data.glslSource = FileIO::readEntireFile(path).value();
+            data.lastEditTimestamp = getFileEditTimestamp(path);
+            if (compileGlslToSpirv(data))
+                data.currentBinaryVersion = 1;
+        } else {
+            data.lastCompileError = "file '" + name + "' not found";
+        }
 
-        ShaderData data { path };
-        data.glslSource = FileIO::readEntireFile(path).value();
-        data.lastEditTimestamp = getFileEditTimestamp(path);
+        // (anyone already waiting on the compilation keeps their own reference to it)
+        std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+
+        bool changedDuringCompilation = m_filesChangedDuringCompilation.contains(path)
+            || std::any_of(data.includedFilePaths.begin(), data.includedFilePaths.end(), [&](const std::string& includedPath) {
+                   return m_filesChangedDuringCompilation.contains(includedPath);
+               });
+        if (changedDuringCompilation)
+            m_shadersToReloadAfterCompilation.insert(path);
 
-        compileGlslToSpirv(data);
         m_loadedShaders[path] = std::move(data);
+        m_pendingCompilations.erase(path);
+        if (m_pendingCompilations.empty())
+            m_filesChangedDuringCompilation.clear();
+    });
+
+    m_pendingCompilations[path] = compilation.share();
+}
+
+std::optional<std::string> ShaderManager::waitForCompilation(const std::string& path) const
+{
+    std::shared_future<void> compilation;
+    {
+        std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+        auto entry = m_pendingCompilations.find(path);
+        if (entry != m_pendingCompilations.end())
+            compilation = entry->second;
     }
 
-    ShaderData& data = m_loadedShaders[path];
-    if (data.lastEditSuccessfullyCompiled) {
-        data.currentBinaryVersion = 1;
+    // NOTE: Wait without holding the lock, as the compilation needs it to store its results
+    if (compilation.valid())
+        compilation.wait();
+
+    std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
+    auto result = m_loadedShaders.find(path);
+    if (result == m_loadedShaders.end())
+        return "shader at path '" + path + "' was never requested";
+
+    const ShaderData& data = result->second;
+    if (data.lastEditSuccessfullyCompiled)
         return {};
-    } else {
-        return data.lastCompileError;
+    return data.lastCompileError;
+}
+
+bool ShaderManager::precompileAllShaders()
+{
+    std::vector<std::string> shaderFiles {};
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(m_shaderBasePath)) {
+        if (!entry.is_regular_file())
+            continue;
+        std::string extension = entry.path().extension().string();
+        constexpr std::array<const char*, 7> shaderFileExtensions { ".vert", ".frag", ".comp", ".rgen", ".rint", ".rmiss", ".rchit" };
+        if (std::find(shaderFileExtensions.begin(), shaderFileExtensions.end(), extension) != shaderFileExtensions.end())
+            shaderFiles.push_back(entry.path().generic_string());
     }
+
+    std::atomic_int numFailedShaders = 0;
+    ThreadPool::global().parallelFor(shaderFiles.size(), [&](size_t idx) {
+        ShaderData data { shaderFiles[idx] };
+        data.glslSource = FileIO::readEntireFile(data.filePath).value_or("");
+        if (data.glslSource.empty() || !compileGlslToSpirv(data)) {
+            LogError("Shader at path '%s' could not compile:\n\t%s\n", data.filePath.c_str(), data.lastCompileError.c_str());
+            numFailedShaders += 1;
+        }
+    });
+
+    LogInfo("ShaderManager: precompiled %zu shaders, %i failed\n", shaderFiles.size(), numFailedShaders.load());
+    return numFailedShaders == 0;
 }
 
-const std::vector<uint32_t>& ShaderManager::spirv(const std::string& name) const
+std::vector<uint32_t> ShaderManager::spirv(const std::string& name) const
 {
     auto path = resolvePath(name);
 
+    // Shaders are compiled in the background from when they are first requested, so we might have to wait for it here
+    auto maybeError = waitForCompilation(path);
+    if (maybeError.has_value())
+        LogError("Shader file error: %s\n", maybeError.value().c_str());
+
     std::lock_guard<std::mutex> dataLock(m_shaderDataMutex);
     auto result = m_loadedShaders.find(path);
 
-    // NOTE: This function should only be called from some backend, so if the
-    //  file doesn't exist in the set of loaded shaders something is wrong,
-    //  because the frontend makes sure to not run if shaders don't work.
-    ASSERT(result != m_loadedShaders.end());
+    // If a reload failed to compile we still have the last binary that did compile, so only a shader that never compiled is fatal
+    if (result == m_loadedShaders.end() || result->second.currentBinaryVersion == 0)
+        LogErrorAndExit("Exiting due to bad shader at startup.\n");
 
     const ShaderData& data = result->second;
     return data.spirvBinary;
 }
 
+std::string ShaderManager::spirvCacheDirectory() const
+{
+    return m_shaderBasePath + "/.cache";
+}
+
+std::optional<std::string> ShaderManager::readIncludeFile(const std::string& path) const
+{
+    if (!FileIO::isFileReadable(path))
+        return {};
+
+    // Most shaders include the same few files, so keep them around instead of reading them again for every shader
+    uint64_t lastEdit = getFileEditTimestamp(path);
+
+    std::lock_guard<std::mutex> includeFilesLock(m_includeFilesMutex);
+
+    auto entry = m_includeFiles.find(path);
+    if (entry != m_includeFiles.end() && entry->second.lastEditTimestamp == lastEdit)
+        return entry->second.content;
+
+    std::optional<std::string> content = FileIO::readEntireFile(path);
+    if (content.has_value())
+        m_includeFiles[path] = { lastEdit, content.value() };
+
+    return content;
+}
+
+bool ShaderManager::readSpirvFromCache(const std::string& cacheFilePath, std::vector<uint32_t>& spirvBinary) const
+{
+    std::optional<FileIO::BinaryData> maybeData = FileIO::readEntireFileAsByteBuffer(cacheFilePath);
+    if (!maybeData.has_value())
+        return false;
+
+    const FileIO::BinaryData& data = maybeData.value();
+    if (data.size() < sizeof(SpirvCacheFileHeader))
+        return false;
+
+    SpirvCacheFileHeader header;
+    std::memcpy(&header, data.data(), sizeof(SpirvCacheFileHeader));
+
+    const char* spirvBytes = data.data() + sizeof(SpirvCacheFileHeader);
+    size_t spirvSize = data.size() - sizeof(SpirvCacheFileHeader);
+
+    if (header.magic != SpirvCacheFileHeader::expectedMagic || header.version != SpirvCacheFileHeader::currentVersion
+        || header.spirvSize != spirvSize || spirvSize < sizeof(uint32_t) || spirvSize % sizeof(uint32_t) != 0
+        || header.spirvHash != hashBytesFnv1a(fnv1aOffsetBasis, spirvBytes, spirvSize)) {
+        LogWarning("ShaderManager: ignoring invalid SPIR-V cache file '%s'\n", cacheFilePath.c_str());
+        return false;
+    }
+
+    constexpr uint32_t spirvMagicNumber = 0x07230203;
+    uint32_t magicNumber;
+    std::memcpy(&magicNumber, spirvBytes, sizeof(uint32_t));
+    if (magicNumber != spirvMagicNumber)
+        return false;
+
+    spirvBinary.resize(spirvSize / sizeof(uint32_t));
+    std::memcpy(spirvBinary.data(), spirvBytes, spirvSize);
+    return true;
+}
+
+void ShaderManager::writeSpirvToCache(const std::string& cacheFilePath, const std::vector<uint32_t>& spirvBinary) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(spirvCacheDirectory(), error);
+    if (error) {
+        LogWarning("ShaderManager: could not create SPIR-V cache directory '%s', ignoring.\n", spirvCacheDirectory().c_str());
+        return;
+    }
+
+    auto* spirvBytes = reinterpret_cast<const char*>(spirvBinary.data());
+    size_t spirvSize = spirvBinary.size() * sizeof(uint32_t);
+
+    SpirvCacheFileHeader header;
+    header.magic = SpirvCacheFileHeader::expectedMagic;
+    header.version = SpirvCacheFileHeader::currentVersion;
+    header.spirvSize = spirvSize;
+    header.spirvHash = hashBytesFnv1a(fnv1aOffsetBasis, spirvBytes, spirvSize);
+
+    FileIO::BinaryData data(sizeof(SpirvCacheFileHeader) + spirvSize);
+    std::memcpy(data.data(), &header, sizeof(SpirvCacheFileHeader));
+    std::memcpy(data.data() + sizeof(SpirvCacheFileHeader), spirvBytes, spirvSize);
+
+    // (another process, e.g. a precompile running next to the app, might write the same cache file at the same time, but both write the same data)
+    if (!FileIO::writeBinaryDataToFileAtomically(cacheFilePath, data)) {
+        LogWarning("ShaderManager: could not write SPIR-V cache file '%s', ignoring.\n", cacheFilePath.c_str());
+    }
+}
+
 uint64_t ShaderManager::getFileEditTimestamp(const std::string& path) const
 {
     struct stat statResult = {};
@@ -178,12 +542,14 @@ shaderc_shader_kind ShaderManager::shaderKindForPath(const std::string& path) co
 
 bool ShaderManager::compileGlslToSpirv(ShaderData& data) const
 {
+    SCOPED_PROFILE_ZONE("Compile shader");
     ASSERT(!data.glslSource.empty());
 
     class Includer : public shaderc::CompileOptions::IncluderInterface {
     public:
-        explicit Includer(const ShaderManager& shaderManager)
+        Includer(const ShaderManager& shaderManager, std::vector<std::string>& resolvedIncludes)
             : m_shaderManager(shaderManager)
+            , m_resolvedIncludes(resolvedIncludes)
         {
         }
 
@@ -201,9 +567,11 @@ bool ShaderManager::compileGlslToSpirv(ShaderData& data) const
 
             auto* fileData = new FileData();
             fileData->path = m_shaderManager.resolvePath(requested_source);
-            fileData->content = FileIO::readEntireFile(fileData->path).value();
+            fileData->content = m_shaderManager.readIncludeFile(fileData->path).value();
             data->user_data = fileData;
 
+            m_resolvedIncludes.push_back(fileData->path);
+
             data->source_name = fileData->path.c_str();
             data->source_name_length = fileData->path.size();
 
@@ -221,18 +589,54 @@ bool ShaderManager::compileGlslToSpirv(ShaderData& data) const
 
     private:
         const ShaderManager& m_shaderManager;
+        std::vector<std::string>& m_resolvedIncludes;
     };
 
     shaderc::Compiler compiler;
+    std::vector<std::string> resolvedIncludes {};
+
+    constexpr auto targetEnvironmentVersion = shaderc_env_version_vulkan_1_1;
+    constexpr auto targetSpirvVersion = shaderc_spirv_version_1_0;
+    constexpr int glslVersion = 460;
 
     shaderc::CompileOptions options;
-    options.SetIncluder(std::make_unique<Includer>(*this));
-    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
-    options.SetTargetSpirv(shaderc_spirv_version_1_0);
+    options.SetIncluder(std::make_unique<Includer>(*this, resolvedIncludes));
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, targetEnvironmentVersion);
+    options.SetTargetSpirv(targetSpirvVersion);
     options.SetSourceLanguage(shaderc_source_language_glsl);
-    options.SetForcedVersionProfile(460, shaderc_profile_none);
+    options.SetForcedVersionProfile(glslVersion, shaderc_profile_none);
 
     shaderc_shader_kind kind = shaderKindForPath(data.filePath);
+
+    // Preprocessing is cheap compared to a full compile, and its output (together with the include set and compile options)
+    // uniquely identifies the resulting SPIR-V, so use that as the key into the on-disk cache.
+    shaderc::PreprocessedSourceCompilationResult preprocessResult = compiler.PreprocessGlsl(data.glslSource, kind, data.filePath.c_str(), options);
+    if (preprocessResult.GetCompilationStatus() != shaderc_compilation_status_success) {
+        data.lastEditSuccessfullyCompiled = false;
+        data.lastCompileError = preprocessResult.GetErrorMessage();
+        return false;
+    }
+
+    std::sort(resolvedIncludes.begin(), resolvedIncludes.end());
+    resolvedIncludes.erase(std::unique(resolvedIncludes.begin(), resolvedIncludes.end()), resolvedIncludes.end());
+    data.includedFilePaths = resolvedIncludes;
+
+    uint64_t cacheKey = fnv1aOffsetBasis;
+    cacheKey = hashBytesFnv1a(cacheKey, preprocessResult.cbegin(), preprocessResult.cend() - preprocessResult.cbegin());
+    for (const std::string& include : resolvedIncludes)
+        cacheKey = hashBytesFnv1a(cacheKey, include.c_str(), include.size() + 1);
+    std::string optionsString = fmt::format("{}:{}:{}:{}", int(kind), int(targetEnvironmentVersion), int(targetSpirvVersion), glslVersion);
+    cacheKey = hashBytesFnv1a(cacheKey, optionsString.c_str(), optionsString.size());
+
+    std::string cacheFilePath = fmt::format("{}/{:016x}.spv", spirvCacheDirectory(), cacheKey);
+    std::vector<uint32_t> cachedSpirvBinary {};
+    if (readSpirvFromCache(cacheFilePath, cachedSpirvBinary)) {
+        data.lastEditSuccessfullyCompiled = true;
+        data.lastCompileError.clear();
+        data.spirvBinary = std::move(cachedSpirvBinary);
+        return true;
+    }
+
     shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(data.glslSource, kind, data.filePath.c_str(), options);
 
     // Note that we only should overwrite the binary if it compiled correctly!
@@ -243,6 +647,7 @@ bool ShaderManager::compileGlslToSpirv(ShaderData& data) const
         data.lastEditSuccessfullyCompiled = true;
         data.lastCompileError.clear();
         data.spirvBinary = std::vector<uint32_t>(result.cbegin(), result.cend());
+        writeSpirvToCache(cacheFilePath, data.spirvBinary);
     }
 
     return data.lastEditSuccessfullyCompiled;
@@ -1,12 +1,14 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <mutex>
 #include <optional>
 #include <shaderc/shaderc.hpp>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -15,7 +17,16 @@ public:
     static ShaderManager& instance();
 
     std::optional<std::string> loadAndCompileImmediately(const std::string& name);
-    const std::vector<uint32_t>& spirv(const std::string& name) const;
+
+    //! Start compiling the shader in the background (if not already loaded), so that many shaders can compile concurrently.
+    //! Any later call to spirv() for the shader will wait for the compilation to finish.
+    void requestCompilation(const std::string& name);
+
+    //! Returns a copy of the current binary, since the file watcher can swap in a new one at any time after a reload
+    std::vector<uint32_t> spirv(const std::string& name) const;
+
+    //! Compile all shaders under the base path (in parallel) so that the SPIR-V cache is warm. Returns true if all compiled.
+    bool precompileAllShaders();
 
     void startFileWatching(unsigned msBetweenPolls, std::function<void()> fileChangeCallback = {});
     void stopFileWatching();
@@ -29,8 +40,19 @@ private:
     ~ShaderManager() = default;
 
     std::string resolvePath(const std::string& name) const;
+    std::optional<std::string> waitForCompilation(const std::string& path) const;
+    std::string spirvCacheDirectory() const;
     uint64_t getFileEditTimestamp(const std::string&) const;
 
+#if defined(__linux__)
+    void watchFilesUsingInotify(unsigned msTimeout, const std::function<void()>& fileChangeCallback);
+#endif
+    void watchFilesByPolling(unsigned msBetweenPolls, const std::function<void()>& fileChangeCallback);
+
+    //! Recompiles all loaded shaders that are, or include, any of the changed files, and any shaders whose files changed while they were
+    //! still being compiled for the first time. Returns the number of updated shaders.
+    int reloadShadersAffectedBy(const std::unordered_set<std::string>& changedFiles);
+
     struct ShaderData {
         ShaderData() = default;
         explicit ShaderData(std::string path)
@@ -47,15 +69,35 @@ private:
 
         std::string glslSource {};
         std::vector<uint32_t> spirvBinary {};
+
+        //! All files included when last compiled (directly or indirectly), so we know what to recompile when they change
+        std::vector<std::string> includedFilePaths {};
     };
 
     shaderc_shader_kind shaderKindForPath(const std::string&) const;
     bool compileGlslToSpirv(ShaderData& data) const;
 
+    std::optional<std::string> readIncludeFile(const std::string& path) const;
+    bool readSpirvFromCache(const std::string& cacheFilePath, std::vector<uint32_t>& spirvBinary) const;
+    void writeSpirvToCache(const std::string& cacheFilePath, const std::vector<uint32_t>& spirvBinary) const;
+
     std::string m_shaderBasePath;
     std::unordered_map<std::string, ShaderData> m_loadedShaders {};
+    std::unordered_map<std::string, std::shared_future<void>> m_pendingCompilations {};
+
+    // Changes to files while there are pending compilations can't be handled before those are done (they aren't loaded yet, and we don't
+    // know what they include), so the changed files are remembered and any affected shaders reloaded once they have finished compiling.
+    std::unordered_set<std::string> m_filesChangedDuringCompilation {};
+    std::unordered_set<std::string> m_shadersToReloadAfterCompilation {};
 
     std::unique_ptr<std::thread> m_fileWatcherThread {};
     mutable std::mutex m_shaderDataMutex {};
+
+    struct IncludeFileData {
+        uint64_t lastEditTimestamp;
+        std::string content;
+    };
+    mutable std::unordered_map<std::string, IncludeFileData> m_includeFiles {};
+    mutable std::mutex m_includeFilesMutex {};
     volatile bool m_fileWatchingActive { false };
 };
@@ -0,0 +1,74 @@
+#include "CameraPath.h"
+
+#include "rendering/camera/FpsCamera.h"
+#include "utility/FileIO.h"
+#include "utility/Logging.h"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+std::optional<CameraPath> CameraPath::loadFromFile(const std::string& filePath)
+{
+    using json = nlohmann::json;
+
+    if (!FileIO::isFileReadable(filePath)) {
+        LogError("CameraPath: could not read camera path file '%s'\n", filePath.c_str());
+        return {};
+    }
+
+    json jsonPath;
+    std::ifstream fileStream(filePath);
+    fileStream >> jsonPath;
+
+    auto readVec3 = [&](const json& val) -> vec3 {
+        std::vector<float> values = val;
+        ASSERT(values.size() == 3);
+        return { values[0], values[1], values[2] };
+    };
+
+    CameraPath path {};
+    for (auto& jsonKeyframe : jsonPath.at("keyframes")) {
+        path.m_keyframes.push_back({ .time = jsonKeyframe.at("time").get<float>(),
+                                     .origin = readVec3(jsonKeyframe.at("origin")),
+                                     .target = readVec3(jsonKeyframe.at("target")) });
+    }
+
+    if (path.m_keyframes.empty()) {
+        LogError("CameraPath: camera path file '%s' has no keyframes\n", filePath.c_str());
+        return {};
+    }
+
+    std::stable_sort(path.m_keyframes.begin(), path.m_keyframes.end(), [](const Keyframe& lhs, const Keyframe& rhs) {
+        return lhs.time < rhs.time;
+    });
+
+    return path;
+}
+
+float CameraPath::duration() const
+{
+    return m_keyframes.back().time - m_keyframes.front().time;
+}
+
+void CameraPath::applyToCamera(FpsCamera& camera, float time) const
+{
+    auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time, [](float time, const Keyframe& keyframe) {
+        return time < keyframe.time;
+    });
+
+    if (next == m_keyframes.begin()) {
+        camera.lookAt(next->origin, next->target, moos::globalUp);
+        return;
+    }
+
+    const Keyframe& previous = *(next - 1);
+    if (next == m_keyframes.end()) {
+        camera.lookAt(previous.origin, previous.target, moos::globalUp);
+        return;
+    }
+
+    float t = (time - previous.time) / (next->time - previous.time);
+    vec3 origin = previous.origin + (next->origin - previous.origin) * t;
+    vec3 target = previous.target + (next->target - previous.target) * t;
+    camera.lookAt(origin, target, moos::globalUp);
+}
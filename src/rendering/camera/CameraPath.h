@@ -0,0 +1,31 @@
+#pragma once
+
+#include <moos/vector.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+class FpsCamera;
+
+//! A scripted camera path, for driving the camera without any input (e.g. when benchmarking). It's made up of keyframes of the camera origin
+//! & target at given times, in the same form as the cameras of the scene files. Between keyframes both are interpolated linearly, and outside
+//! of the keyframes they are held at the first or last one.
+class CameraPath {
+public:
+    //! The file should be on the form { "keyframes": [ { "time": 0.0, "origin": [x, y, z], "target": [x, y, z] }, ... ] } with times in seconds
+    static std::optional<CameraPath> loadFromFile(const std::string& filePath);
+
+    float duration() const;
+
+    void applyToCamera(FpsCamera&, float time) const;
+
+private:
+    struct Keyframe {
+        float time;
+        vec3 origin;
+        vec3 target;
+    };
+
+    // (sorted by time, and never empty)
+    std::vector<Keyframe> m_keyframes {};
+};
@@ -141,7 +141,7 @@ void FpsCamera::update(const Input& input, const Extent2D& screenExtent, float d
     float width = static_cast<float>(screenExtent.width());
     float height = static_cast<float>(screenExtent.height());
     float aspectRatio = (height > 1e-6f) ? (width / height) : 1.0f;
-    m_projectionFromView = moos::perspectiveProjectionToVulkanClipSpace(m_fieldOfView, aspectRatio, zNear, 10000.0f);
+    m_projectionFromView = moos::perspectiveProjectionToVulkanClipSpace(m_fieldOfView, aspectRatio, zNear, zFar);
 }
 
 void FpsCamera::setDidModify(bool value)
@@ -34,6 +34,9 @@ public:
     float iso { 400.0f };
     float shutterSpeed { 1.0f / iso };
 
+    static constexpr float zNear { 0.25f };
+    static constexpr float zFar { 10000.0f };
+
     bool useAutomaticExposure { true };
     float exposureCompensation { 0.0f };
     float adaptionRate { 0.0018f };
@@ -54,8 +57,6 @@ private:
 
     bool m_didModify { true };
 
-    static constexpr float zNear { 0.25f };
-
     float maxSpeed { 10.0f };
     static constexpr float timeToMaxSpeed { 0.25f };
     static constexpr float timeFromMaxSpeed { 0.60f };
@@ -0,0 +1,86 @@
+#include "LightClustering.h"
+
+#include <algorithm>
+#include <cmath>
+
+// NOTE: All of this is mirrored in the shaders (common/lightClustering.glsl), so any changes must be made in both places!
+
+LightClustering::Result LightClustering::binLights(mat4 viewFromProjection, const LightClusterInfo& clusterInfo, const std::vector<LocalLightData>& lights)
+{
+    Result result {};
+    result.clusterLightCounts.resize(LIGHT_CLUSTER_COUNT, 0);
+    result.clusterLightIndices.resize(LIGHT_CLUSTER_COUNT * LIGHT_CLUSTER_MAX_LIGHTS, 0);
+
+    int lightCount = std::min(clusterInfo.localLightCount, static_cast<int>(lights.size()));
+
+    for (int z = 0; z < LIGHT_CLUSTER_COUNT_Z; ++z) {
+        for (int y = 0; y < LIGHT_CLUSTER_COUNT_Y; ++y) {
+            for (int x = 0; x < LIGHT_CLUSTER_COUNT_X; ++x) {
+
+                int clusterIdx = clusterIndex(x, y, z);
+                Bounds bounds = clusterViewSpaceBounds(x, y, z, viewFromProjection, clusterInfo.zNear, clusterInfo.zFar);
+
+                int& clusterLightCount = result.clusterLightCounts[clusterIdx];
+                int baseIndex = clusterIdx * LIGHT_CLUSTER_MAX_LIGHTS;
+
+                for (int lightIdx = 0; lightIdx < lightCount && clusterLightCount < LIGHT_CLUSTER_MAX_LIGHTS; ++lightIdx) {
+                    if (sphereIntersectsBounds(lights[lightIdx].viewSpacePositionAndRange, bounds)) {
+                        result.clusterLightIndices[baseIndex + clusterLightCount] = lightIdx;
+                        clusterLightCount += 1;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+int LightClustering::clusterIndex(int x, int y, int z)
+{
+    return x + LIGHT_CLUSTER_COUNT_X * (y + LIGHT_CLUSTER_COUNT_Y * z);
+}
+
+float LightClustering::sliceDepth(int slice, float zNear, float zFar)
+{
+    return zNear * std::pow(zFar / zNear, static_cast<float>(slice) / static_cast<float>(LIGHT_CLUSTER_COUNT_Z));
+}
+
+LightClustering::Bounds LightClustering::clusterViewSpaceBounds(int x, int y, int z, mat4 viewFromProjection, float zNear, float zFar)
+{
+    float tileSizeX = 2.0f / LIGHT_CLUSTER_COUNT_X;
+    float tileSizeY = 2.0f / LIGHT_CLUSTER_COUNT_Y;
+    float ndcMinX = -1.0f + x * tileSizeX;
+    float ndcMinY = -1.0f + y * tileSizeY;
+
+    float sliceNearDepth = sliceDepth(z, zNear, zFar);
+    float sliceFarDepth = sliceDepth(z + 1, zNear, zFar);
+
+    Bounds bounds { vec3(1e30f), vec3(-1e30f) };
+
+    for (int corner = 0; corner < 4; ++corner) {
+        float ndcX = (corner & 1) ? ndcMinX + tileSizeX : ndcMinX;
+        float ndcY = (corner & 2) ? ndcMinY + tileSizeY : ndcMinY;
+
+        // Any point along the ray through the corner will do, so then scale it so that it's at depth 1
+        vec4 viewSpacePoint = viewFromProjection * vec4(ndcX, ndcY, 0.5f, 1.0f);
+        vec3 ray = viewSpacePoint.xyz() / viewSpacePoint.w;
+        ray = ray / -ray.z;
+
+        for (vec3 point : { ray * sliceNearDepth, ray * sliceFarDepth }) {
+            bounds.min = vec3(std::min(bounds.min.x, point.x), std::min(bounds.min.y, point.y), std::min(bounds.min.z, point.z));
+            bounds.max = vec3(std::max(bounds.max.x, point.x), std::max(bounds.max.y, point.y), std::max(bounds.max.z, point.z));
+        }
+    }
+
+    return bounds;
+}
+
+bool LightClustering::sphereIntersectsBounds(vec4 sphere, const Bounds& bounds)
+{
+    vec3 closestPoint = vec3(std::clamp(sphere.x, bounds.min.x, bounds.max.x),
+                             std::clamp(sphere.y, bounds.min.y, bounds.max.y),
+                             std::clamp(sphere.z, bounds.min.z, bounds.max.z));
+    vec3 delta = sphere.xyz() - closestPoint;
+    return dot(delta, delta) <= sphere.w * sphere.w;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <moos/matrix.h>
+#include <moos/vector.h>
+#include <vector>
+
+// Shared with shaders
+#include "LightData.h"
+
+//! CPU reference implementation of the light binning performed by the light clustering compute pass (light-clustering/assignLights.comp).
+//! It mirrors the shader code (see common/lightClustering.glsl) so that the GPU results can be validated against it, and so that the
+//! binning can be tested & timed without a GPU.
+class LightClustering {
+public:
+    struct Result {
+        //! Number of lights binned into each cluster (at most LIGHT_CLUSTER_MAX_LIGHTS)
+        std::vector<int> clusterLightCounts {};
+        //! LIGHT_CLUSTER_MAX_LIGHTS light indices per cluster, where only the first clusterLightCounts[cluster] are valid
+        std::vector<int> clusterLightIndices {};
+    };
+
+    static Result binLights(mat4 viewFromProjection, const LightClusterInfo&, const std::vector<LocalLightData>&);
+
+    static int clusterIndex(int x, int y, int z);
+    static float sliceDepth(int slice, float zNear, float zFar);
+
+    struct Bounds {
+        vec3 min;
+        vec3 max;
+    };
+    static Bounds clusterViewSpaceBounds(int x, int y, int z, mat4 viewFromProjection, float zNear, float zFar);
+    static bool sphereIntersectsBounds(vec4 sphere, const Bounds&);
+};
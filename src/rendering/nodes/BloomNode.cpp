@@ -9,6 +9,13 @@ BloomNode::BloomNode(Scene& scene)
 {
 }
 
+void BloomNode::constructNode(Registry&)
+{
+    m_downsampleShader = Shader::createCompute("bloom/downsample.comp");
+    m_upsampleShader = Shader::createCompute("bloom/upsample.comp");
+    m_blendShader = Shader::createCompute("bloom/blend.comp");
+}
+
 RenderGraphNode::ExecuteCallback BloomNode::constructFrame(Registry& reg) const
 {
     Texture& mainTexture = *reg.getTexture("forward", "color").value();
@@ -52,16 +59,12 @@ RenderGraphNode::ExecuteCallback BloomNode::constructFrame(Registry& reg) const
         }
     }
 
-    Shader downsampleShader = Shader::createCompute("bloom/downsample.comp");
-    ComputeState& downsampleState = reg.createComputeState(downsampleShader, captures.downsampleSets);
-
-    Shader upsampleShader = Shader::createCompute("bloom/upsample.comp");
-    ComputeState& upsampleState = reg.createComputeState(upsampleShader, captures.upsampleSets);
+    ComputeState& downsampleState = reg.createComputeState(m_downsampleShader, captures.downsampleSets);
+    ComputeState& upsampleState = reg.createComputeState(m_upsampleShader, captures.upsampleSets);
 
     BindingSet& blendBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, &mainTexture, ShaderBindingType::StorageImage },
                                                          { 1, ShaderStageCompute, captures.upsampleTextures[0], ShaderBindingType::TextureSampler } });
-    Shader bloomBlendShader = Shader::createCompute("bloom/blend.comp");
-    ComputeState& bloomBlendComputeState = reg.createComputeState(bloomBlendShader, { &blendBindingSet });
+    ComputeState& bloomBlendComputeState = reg.createComputeState(m_blendShader, { &blendBindingSet });
 
     return [&mainTexture, &downsampleState, &upsampleState, &bloomBlendComputeState, &blendBindingSet, captures](const AppState& appState, CommandList& cmdList) {
         const Extent3D localSizeForComp { 16, 16, 1 };
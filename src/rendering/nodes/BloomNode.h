@@ -10,8 +10,13 @@ public:
     static std::string name() { return "bloom"; }
     std::optional<std::string> displayName() const override { return "Bloom"; }
 
+    void constructNode(Registry&) override;
     ExecuteCallback constructFrame(Registry&) const override;
 
 private:
     Scene& m_scene;
+
+    Shader m_downsampleShader {};
+    Shader m_upsampleShader {};
+    Shader m_blendShader {};
 };
@@ -12,6 +12,11 @@ DebugForwardNode::DebugForwardNode(Scene& scene)
 {
 }
 
+void DebugForwardNode::constructNode(Registry&)
+{
+    m_shader = Shader::createBasicRasterize("forward/debug.vert", "forward/debug.frag");
+}
+
 RenderGraphNode::ExecuteCallback DebugForwardNode::constructFrame(Registry& reg) const
 {
     const RenderTarget& windowTarget = reg.windowRenderTarget();
@@ -52,9 +57,7 @@ RenderGraphNode::ExecuteCallback DebugForwardNode::constructFrame(Registry& reg)
           { 3, VertexAttributeType ::Float4, offsetof(Vertex, tangent) } }
     };
 
-    Shader shader = Shader::createBasicRasterize("forward/debug.vert", "forward/debug.frag");
-
-    RenderStateBuilder renderStateBuilder { *renderTarget, shader, vertexLayout };
+    RenderStateBuilder renderStateBuilder { *renderTarget, m_shader, vertexLayout };
     renderStateBuilder.polygonMode = PolygonMode::Filled;
     renderStateBuilder.addBindingSet(cameraBindingSet);
     renderStateBuilder.addBindingSet(objectBindingSet);
@@ -11,10 +11,12 @@ public:
 
     std::optional<std::string> displayName() const override { return "Forward [DEBUG]"; }
 
+    void constructNode(Registry&) override;
     ExecuteCallback constructFrame(Registry&) const override;
 
     static constexpr Texture::Multisampling multisamplingLevel() { return Texture::Multisampling::X8; }
 
 private:
     Scene& m_scene;
+    Shader m_shader {};
 };
@@ -45,6 +45,10 @@ void DiffuseGINode::constructNode(Registry& reg)
 
     reg.publish("irradianceProbes", *m_irradianceProbes);
     reg.publish("filteredDistanceProbes", *m_filteredDistanceProbes);
+
+    m_renderShader = Shader::createBasicRasterize("diffuse-gi/forward.vert", "diffuse-gi/forward.frag");
+    m_irradianceFilterShader = Shader::createCompute("diffuse-gi/filterIrradiance.comp");
+    m_distanceFilterShader = Shader::createCompute("diffuse-gi/filterDistances.comp");
 }
 
 RenderGraphNode::ExecuteCallback DiffuseGINode::constructFrame(Registry& reg) const
@@ -73,8 +77,7 @@ RenderGraphNode::ExecuteCallback DiffuseGINode::constructFrame(Registry& reg) co
     BindingSet& objectBindingSet = *reg.getBindingSet("scene", "objectSet");
     BindingSet& lightBindingSet = *reg.getBindingSet("scene", "lightSet");
 
-    Shader renderShader = Shader::createBasicRasterize("diffuse-gi/forward.vert", "diffuse-gi/forward.frag");
-    RenderStateBuilder renderStateBuilder { renderTarget, renderShader, vertexLayout };
+    RenderStateBuilder renderStateBuilder { renderTarget, m_renderShader, vertexLayout };
     renderStateBuilder.addBindingSet(cameraBindingSet);
     renderStateBuilder.addBindingSet(objectBindingSet);
     renderStateBuilder.addBindingSet(lightBindingSet);
@@ -83,13 +86,11 @@ RenderGraphNode::ExecuteCallback DiffuseGINode::constructFrame(Registry& reg) co
     BindingSet& irradianceFilterBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, &tempIrradianceProbe, ShaderBindingType::StorageImage },
                                                                     { 1, ShaderStageCompute, &probeColorCubemap, ShaderBindingType::TextureSampler },
                                                                     { 2, ShaderStageCompute, reg.getTexture("scene", "environmentMap").value(), ShaderBindingType::TextureSampler } });
-    Shader irradianceFilterShader = Shader::createCompute("diffuse-gi/filterIrradiance.comp");
-    ComputeState& irradianceFilterState = reg.createComputeState(irradianceFilterShader, { &irradianceFilterBindingSet });
+    ComputeState& irradianceFilterState = reg.createComputeState(m_irradianceFilterShader, { &irradianceFilterBindingSet });
 
     BindingSet& distanceFilterBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, &tempFilteredDistanceProbe, ShaderBindingType::StorageImage },
                                                                   { 1, ShaderStageCompute, &probeDistCubemap, ShaderBindingType::TextureSampler } });
-    Shader distanceFilterShader = Shader::createCompute("diffuse-gi/filterDistances.comp");
-    ComputeState& distanceFilterState = reg.createComputeState(distanceFilterShader, { &distanceFilterBindingSet });
+    ComputeState& distanceFilterState = reg.createComputeState(m_distanceFilterShader, { &distanceFilterBindingSet });
 
     m_scene.forEachMesh([&](size_t, Mesh& mesh) {
         mesh.ensureVertexBuffer(semanticVertexLayout);
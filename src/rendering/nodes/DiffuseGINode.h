@@ -39,4 +39,8 @@ private:
 
     Texture* m_irradianceProbes;
     Texture* m_filteredDistanceProbes;
+
+    Shader m_renderShader {};
+    Shader m_irradianceFilterShader {};
+    Shader m_distanceFilterShader {};
 };
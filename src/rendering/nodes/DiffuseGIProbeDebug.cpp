@@ -25,6 +25,8 @@ void DiffuseGIProbeDebug::constructNode(Registry& reg)
 #endif
 
     setUpSphereRenderData(reg);
+
+    m_debugShader = Shader::createBasicRasterize("diffuse-gi/probe-debug.vert", "diffuse-gi/probe-debug.frag");
 }
 
 RenderGraphNode::ExecuteCallback DiffuseGIProbeDebug::constructFrame(Registry& reg) const
@@ -36,8 +38,7 @@ RenderGraphNode::ExecuteCallback DiffuseGIProbeDebug::constructFrame(Registry& r
 
     BindingSet& probeDataBindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, m_probeData, ShaderBindingType::TextureSampler } });
 
-    Shader debugShader = Shader::createBasicRasterize("diffuse-gi/probe-debug.vert", "diffuse-gi/probe-debug.frag");
-    RenderStateBuilder stateBuilder { renderTarget, debugShader, VertexLayout::positionOnly() };
+    RenderStateBuilder stateBuilder { renderTarget, m_debugShader, VertexLayout::positionOnly() };
     BindingSet& cameraBindingSet = *reg.getBindingSet("scene", "cameraSet");
     stateBuilder.addBindingSet(cameraBindingSet).addBindingSet(probeDataBindingSet);
     stateBuilder.writeDepth = true;
@@ -17,6 +17,7 @@ private:
     Scene& m_scene;
 
     Texture* m_probeData;
+    Shader m_debugShader {};
 
     void setUpSphereRenderData(Registry&);
     Buffer* m_sphereVertexBuffer { nullptr };
@@ -99,6 +99,9 @@ void ExposureNode::constructNode(Registry& reg)
     // Stores the last average luminance, after exposure, so we can do soft exposure transitions
     // TODO: Maybe use a storage buffer instead? Not sure what is faster for this.. note that we need read & write capabilities
     m_lastAvgLuminanceTexture = &reg.createTexture2D({ 1, 1 }, Texture::Format::R32F);
+
+    m_logLuminanceShader = Shader::createCompute("post/logLuminance.comp");
+    m_exposeShader = Shader::createCompute("post/expose.comp");
 }
 
 RenderGraphNode::ExecuteCallback ExposureNode::constructFrame(Registry& reg) const
@@ -112,13 +115,13 @@ RenderGraphNode::ExecuteCallback ExposureNode::constructFrame(Registry& reg) con
 
     BindingSet& logLumBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, &targetImage, ShaderBindingType::TextureSampler },
                                                           { 1, ShaderStageCompute, &logLuminanceTexture, ShaderBindingType::StorageImage } });
-    ComputeState& logLumComputeState = reg.createComputeState(Shader::createCompute("post/logLuminance.comp"), { &logLumBindingSet });
+    ComputeState& logLumComputeState = reg.createComputeState(m_logLuminanceShader, { &logLumBindingSet });
 
     BindingSet& exposeBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, reg.getBuffer("scene", "camera") },
                                                           { 1, ShaderStageCompute, &logLuminanceTexture, ShaderBindingType::TextureSampler },
                                                           { 2, ShaderStageCompute, &targetImage, ShaderBindingType::StorageImage },
                                                           { 3, ShaderStageCompute, m_lastAvgLuminanceTexture, ShaderBindingType::StorageImage } });
-    ComputeState& exposeComputeState = reg.createComputeState(Shader::createCompute("post/expose.comp"), { &exposeBindingSet });
+    ComputeState& exposeComputeState = reg.createComputeState(m_exposeShader, { &exposeBindingSet });
 
     return [&](const AppState& appState, CommandList& cmdList) {
         FpsCamera& camera = m_scene.camera();
@@ -132,18 +135,12 @@ RenderGraphNode::ExecuteCallback ExposureNode::constructFrame(Registry& reg) con
         // Compute average log-luminance by creating mipmaps
         cmdList.generateMipmaps(logLuminanceTexture);
 
-        // Perform the exposure pass (since we use a node-resource, m_lastAvgLuminanceTexture, we must synchronize its access here)
-        // FIXME: Don't use the hardcoded 1 for event index! Maybe we should have some event resource type?
-        cmdList.waitEvent(1, appState.frameIndex() == 0 ? PipelineStage::Host : PipelineStage::Compute);
-        cmdList.resetEvent(1, PipelineStage::Compute);
-        {
-            cmdList.setComputeState(exposeComputeState);
-            cmdList.bindSet(exposeBindingSet, 0);
-            cmdList.pushConstant(ShaderStageCompute, (float)appState.deltaTime(), 0);
-            cmdList.pushConstant(ShaderStageCompute, appState.isRelativeFirstFrame() ? 9999.99f : camera.adaptionRate, 1 * sizeof(float));
-            cmdList.pushConstant(ShaderStageCompute, camera.useAutomaticExposure, 2 * sizeof(float));
-            cmdList.dispatch(targetImage.extent(), { 16, 16, 1 });
-        }
-        cmdList.signalEvent(1, PipelineStage::Compute);
+        // Perform the exposure pass (the render graph synchronizes the access to m_lastAvgLuminanceTexture with the previous frame)
+        cmdList.setComputeState(exposeComputeState);
+        cmdList.bindSet(exposeBindingSet, 0);
+        cmdList.pushConstant(ShaderStageCompute, (float)appState.deltaTime(), 0);
+        cmdList.pushConstant(ShaderStageCompute, appState.isRelativeFirstFrame() ? 9999.99f : camera.adaptionRate, 1 * sizeof(float));
+        cmdList.pushConstant(ShaderStageCompute, camera.useAutomaticExposure, 2 * sizeof(float));
+        cmdList.dispatch(targetImage.extent(), { 16, 16, 1 });
     };
 }
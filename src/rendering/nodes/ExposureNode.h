@@ -22,4 +22,7 @@ private:
 
     Scene& m_scene;
     Texture* m_lastAvgLuminanceTexture;
+
+    Shader m_logLuminanceShader {};
+    Shader m_exposeShader {};
 };
@@ -1,9 +1,11 @@
 #include "ForwardRenderNode.h"
 
+#include "IndirectData.h"
 #include "LightData.h"
 #include "SceneNode.h"
 #include "geometry/Frustum.h"
 #include "utility/Logging.h"
+#include <chrono>
 #include <imgui.h>
 
 std::string ForwardRenderNode::name()
@@ -11,12 +13,70 @@ std::string ForwardRenderNode::name()
     return "forward";
 }
 
-ForwardRenderNode::ForwardRenderNode(Scene& scene)
+ForwardRenderNode::ForwardRenderNode(Scene& scene, DrawMode drawMode, bool switchableDrawMode)
     : RenderGraphNode(ForwardRenderNode::name())
     , m_scene(scene)
+    , m_drawMode(drawMode)
+    , m_switchableDrawMode(switchableDrawMode)
 {
 }
 
+void ForwardRenderNode::constructNode(Registry& nodeReg)
+{
+    m_shader = Shader::createBasicRasterize("forward/forward.vert", "forward/forward.frag");
+
+    bool wantsToDrawIndirect = m_drawMode == DrawMode::GpuDriven || m_switchableDrawMode;
+    m_canDrawIndirect = wantsToDrawIndirect && nodeReg.hasActiveCapability(Backend::Capability::DrawIndirectCount);
+    if (!m_canDrawIndirect) {
+        m_drawMode = DrawMode::CpuCulling;
+        return;
+    }
+
+    m_cullShader = Shader::createCompute("forward/cull.comp");
+
+    // Pack all meshes into one vertex & index buffer so a single indirect draw can draw any of them
+
+    std::vector<std::byte> vertexData {};
+    std::vector<uint32_t> indexData {};
+    std::vector<IndirectDrawableGeometry> drawableGeometry {};
+
+    m_scene.forEachMesh([&](size_t, Mesh& mesh) {
+        ASSERT(mesh.isIndexed());
+
+        IndirectDrawableGeometry geometry {};
+
+        geometry::Sphere sphere = mesh.boundingSphere();
+        geometry.localBoundingSphere = vec4(sphere.center(), sphere.radius());
+
+        geometry.vertexOffset = static_cast<int>(vertexData.size() / sizeof(ForwardVertex));
+        std::span<const std::byte> packedVertexData = mesh.packedVertexData(semanticVertexLayout);
+        if (packedVertexData.empty()) {
+            std::vector<std::byte> meshVertexData = mesh.packVertexData(semanticVertexLayout);
+            vertexData.insert(vertexData.end(), meshVertexData.begin(), meshVertexData.end());
+        } else {
+            vertexData.insert(vertexData.end(), packedVertexData.begin(), packedVertexData.end());
+        }
+
+        const std::vector<uint32_t>& meshIndexData = mesh.indexData();
+        geometry.firstIndex = static_cast<int>(indexData.size());
+        geometry.indexCount = static_cast<int>(meshIndexData.size());
+        indexData.insert(indexData.end(), meshIndexData.begin(), meshIndexData.end());
+
+        drawableGeometry.push_back(geometry);
+    });
+
+    m_meshCount = static_cast<uint32_t>(drawableGeometry.size());
+    if (m_meshCount == 0) {
+        m_canDrawIndirect = false;
+        m_drawMode = DrawMode::CpuCulling;
+        return;
+    }
+
+    m_sharedVertexBuffer = &nodeReg.createBuffer(vertexData.data(), vertexData.size(), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
+    m_sharedIndexBuffer = &nodeReg.createBuffer(indexData, Buffer::Usage::Index, Buffer::MemoryHint::GpuOptimal);
+    m_drawableGeometryBuffer = &nodeReg.createBuffer(drawableGeometry, Buffer::Usage::StorageBuffer, Buffer::MemoryHint::GpuOptimal);
+}
+
 RenderGraphNode::ExecuteCallback ForwardRenderNode::constructFrame(Registry& reg) const
 {
     Texture& colorTexture = reg.createTexture2D(reg.windowRenderTarget().extent(), Texture::Format::RGBA16F);
@@ -30,44 +90,157 @@ RenderGraphNode::ExecuteCallback ForwardRenderNode::constructFrame(Registry& reg
     BindingSet& cameraBindingSet = *reg.getBindingSet("scene", "cameraSet");
     BindingSet& objectBindingSet = *reg.getBindingSet("scene", "objectSet");
     BindingSet& lightBindingSet = *reg.getBindingSet("scene", "lightSet");
+    BindingSet& clusterBindingSet = *reg.getBindingSet("light-clustering", "clusterSet");
 
-    Shader shader = Shader::createBasicRasterize("forward/forward.vert", "forward/forward.frag");
-    RenderStateBuilder renderStateBuilder { renderTarget, shader, vertexLayout };
+    RenderStateBuilder renderStateBuilder { renderTarget, m_shader, vertexLayout };
     renderStateBuilder.addBindingSet(cameraBindingSet);
     renderStateBuilder.addBindingSet(objectBindingSet);
     renderStateBuilder.addBindingSet(lightBindingSet);
+    renderStateBuilder.addBindingSet(clusterBindingSet);
     RenderState& renderState = reg.createRenderState(renderStateBuilder);
 
-    m_scene.forEachMesh([&](size_t, Mesh& mesh) {
-        mesh.ensureVertexBuffer(semanticVertexLayout);
-        mesh.ensureIndexBuffer();
-    });
+    // (the per-mesh geometry is only needed if the node can draw with CPU culling, as the GPU-driven path uses the shared buffers)
+    bool canDrawWithCpuCulling = !m_canDrawIndirect || m_switchableDrawMode;
+    if (canDrawWithCpuCulling) {
+        m_scene.forEachMesh([&](size_t, Mesh& mesh) {
+            mesh.ensureVertexBuffer(semanticVertexLayout);
+            mesh.ensureIndexBuffer();
+        });
+    }
+
+    // Resources for GPU-driven drawing
+
+    bool canDrawIndirect = m_canDrawIndirect;
+    Buffer* indirectCommandBuffer = nullptr;
+    Buffer* indirectCountBuffer = nullptr;
+    BindingSet* cullBindingSet = nullptr;
+    ComputeState* cullComputeState = nullptr;
+
+    if (canDrawIndirect) {
+        // NOTE: Tightly packed VkDrawIndexedIndirectCommand, which is what the cull shader writes
+        constexpr size_t drawCommandSize = 5 * sizeof(uint32_t);
+        indirectCommandBuffer = &reg.createBuffer(m_meshCount * drawCommandSize, Buffer::Usage::IndirectBuffer, Buffer::MemoryHint::GpuOnly);
+        indirectCountBuffer = &reg.createBuffer(sizeof(uint32_t), Buffer::Usage::IndirectBuffer, Buffer::MemoryHint::TransferOptimal);
+
+        cullBindingSet = &reg.createBindingSet({ { 0, ShaderStageCompute, reg.getBuffer("scene", "objectData") },
+                                                 { 1, ShaderStageCompute, m_drawableGeometryBuffer },
+                                                 { 2, ShaderStageCompute, indirectCommandBuffer },
+                                                 { 3, ShaderStageCompute, indirectCountBuffer } });
+        cullComputeState = &reg.createComputeState(m_cullShader, { cullBindingSet });
+    }
+
+    return [&, canDrawIndirect, indirectCommandBuffer, indirectCountBuffer, cullBindingSet, cullComputeState](const AppState& appState, CommandList& cmdList) {
+        mat4 cameraViewProjection = m_scene.camera().projectionMatrix() * m_scene.camera().viewMatrix();
+        auto cameraFrustum = geometry::Frustum::createFromProjectionMatrix(cameraViewProjection);
+
+        if (canDrawIndirect && m_switchableDrawMode) {
+            bool useGpuDrivenPath = m_drawMode == DrawMode::GpuDriven;
+            ImGui::Checkbox("GPU-driven culling & drawing", &useGpuDrivenPath);
+            m_drawMode = useGpuDrivenPath ? DrawMode::GpuDriven : DrawMode::CpuCulling;
+        }
+
+        if (canDrawIndirect && m_drawMode == DrawMode::GpuDriven) {
+            auto recordingStartTime = std::chrono::steady_clock::now();
+
+            uint32_t drawableCount = static_cast<uint32_t>(std::min(size_t(m_meshCount), m_meshLimit));
+
+            uint32_t zero = 0;
+            indirectCountBuffer->updateData(&zero, sizeof(zero));
+
+            // Cull all drawables & write the draw commands for the visible ones
+
+            cmdList.setComputeState(*cullComputeState);
+            cmdList.bindSet(*cullBindingSet, 0);
+
+            vec4 frustumPlanes[6];
+            for (size_t i = 0; i < 6; ++i) {
+                const geometry::Plane& plane = cameraFrustum.plane(i);
+                frustumPlanes[i] = vec4(plane.normal(), plane.distance());
+            }
+            cmdList.pushConstants(ShaderStageCompute, frustumPlanes, sizeof(frustumPlanes), 0);
+            cmdList.pushConstant(ShaderStageCompute, drawableCount, sizeof(frustumPlanes));
+
+            cmdList.dispatch({ drawableCount, 1, 1 }, { 64, 1, 1 });
+            cmdList.bufferWriteBarrier({ indirectCommandBuffer, indirectCountBuffer });
+
+            // Draw all visible drawables in one go
+
+            cmdList.beginRendering(renderState, ClearColor(0, 0, 0, 0), 1.0f);
+            cmdList.pushConstant(ShaderStageFragment, m_scene.ambient(), 0);
+
+            cmdList.bindSet(cameraBindingSet, 0);
+            cmdList.bindSet(objectBindingSet, 1);
+            cmdList.bindSet(lightBindingSet, 2);
+            cmdList.bindSet(clusterBindingSet, 3);
+
+            cmdList.drawIndexedIndirect(*m_sharedVertexBuffer, *m_sharedIndexBuffer, IndexType::UInt32,
+                                        *indirectCommandBuffer, *indirectCountBuffer, drawableCount);
+
+            std::chrono::duration<double, std::milli> recordingTime = std::chrono::steady_clock::now() - recordingStartTime;
+            m_lastDrawRecordingTimeMs = recordingTime.count();
+
+            ImGui::Text("Draw recording time: %.3f ms", m_lastDrawRecordingTimeMs);
+            return;
+        }
 
-    return [&](const AppState& appState, CommandList& cmdList) {
         cmdList.beginRendering(renderState, ClearColor(0, 0, 0, 0), 1.0f);
         cmdList.pushConstant(ShaderStageFragment, m_scene.ambient(), 0);
 
         cmdList.bindSet(cameraBindingSet, 0);
         cmdList.bindSet(objectBindingSet, 1);
         cmdList.bindSet(lightBindingSet, 2);
+        cmdList.bindSet(clusterBindingSet, 3);
 
         // Perform frustum culling & draw non-culled meshes
 
-        int numDrawCallsIssued = 0;
-        mat4 cameraViewProjection = m_scene.camera().projectionMatrix() * m_scene.camera().viewMatrix();
-        auto cameraFrustum = geometry::Frustum::createFromProjectionMatrix(cameraViewProjection);
+        auto recordingStartTime = std::chrono::steady_clock::now();
 
-        m_scene.forEachMesh([&](size_t meshIndex, Mesh& mesh) {
-            geometry::Sphere sphere = mesh.boundingSphere().transformed(mesh.transform().worldMatrix());
-            if (!cameraFrustum.includesSphere(sphere))
-                return;
+        static bool cullUsingSceneBVH = true;
+        ImGui::Checkbox("Cull using scene BVH", &cullUsingSceneBVH);
 
-            cmdList.drawIndexed(mesh.vertexBuffer(semanticVertexLayout),
-                                mesh.indexBuffer(), mesh.indexCount(), mesh.indexType(),
-                                meshIndex);
-            numDrawCallsIssued += 1;
-        });
+        // Indices (as in Scene::forEachMesh) of the meshes to draw
+        std::vector<uint32_t> visibleMeshIndices {};
+
+        if (cullUsingSceneBVH) {
+            m_scene.meshBVH().queryFrustum(cameraFrustum, visibleMeshIndices);
+            std::erase_if(visibleMeshIndices, [&](uint32_t meshIndex) { return meshIndex >= m_meshLimit; });
+        } else {
+            geometry::SphereArray worldSpaceBoundingSpheres {};
+            m_scene.forEachMesh([&](size_t meshIndex, Mesh& mesh) {
+                if (meshIndex < m_meshLimit)
+                    worldSpaceBoundingSpheres.addTransformed(mesh.boundingSphere(), mesh.transform().worldMatrix());
+            });
+
+            // (all meshes at once, which is cheap enough with SIMD that it's not worth splitting up over the draw recording threads)
+            geometry::VisibilityMask visibleMeshes {};
+            cameraFrustum.cullSpheres(worldSpaceBoundingSpheres, visibleMeshes);
+            visibleMeshes.forEachVisible(0, visibleMeshes.size(), [&](size_t meshIndex) {
+                visibleMeshIndices.push_back(static_cast<uint32_t>(meshIndex));
+            });
+        }
+
+        static bool recordDrawsInParallel = true;
+        ImGui::Checkbox("Record draws in parallel", &recordDrawsInParallel);
+
+        auto drawVisibleMeshes = [&](CommandList& drawCmdList, size_t begin, size_t end) {
+            for (size_t idx = begin; idx < end; ++idx) {
+                uint32_t meshIndex = visibleMeshIndices[idx];
+                Mesh& mesh = m_scene.mesh(meshIndex);
+                drawCmdList.drawIndexed(mesh.vertexBuffer(semanticVertexLayout),
+                                        mesh.indexBuffer(), mesh.indexCount(), mesh.indexType(),
+                                        meshIndex);
+            }
+        };
+
+        if (recordDrawsInParallel)
+            cmdList.drawInParallel(visibleMeshIndices.size(), drawVisibleMeshes);
+        else
+            drawVisibleMeshes(cmdList, 0, visibleMeshIndices.size());
+
+        std::chrono::duration<double, std::milli> recordingTime = std::chrono::steady_clock::now() - recordingStartTime;
+        m_lastDrawRecordingTimeMs = recordingTime.count();
 
-        ImGui::Text("Issued draw calls: %i", numDrawCallsIssued);
+        ImGui::Text("Issued draw calls: %u", uint32_t(visibleMeshIndices.size()));
+        ImGui::Text("Draw recording time: %.3f ms", m_lastDrawRecordingTimeMs);
     };
 }
@@ -4,16 +4,41 @@
 #include "rendering/camera/FpsCamera.h"
 #include "rendering/scene/Model.h"
 #include "rendering/scene/Scene.h"
+#include <limits>
 
 class ForwardRenderNode final : public RenderGraphNode {
 public:
-    explicit ForwardRenderNode(Scene&);
+    enum class DrawMode {
+        //! Frustum cull on the CPU and record one draw call per visible mesh
+        CpuCulling,
+        //! Frustum cull in a compute shader which writes the draw commands, then draw them all with a single indirect draw
+        GpuDriven,
+    };
+
+    //! Each draw mode needs its own copy of the geometry (per-mesh buffers vs. all meshes packed into shared buffers), so only the geometry for
+    //! the given draw mode is created, unless the draw mode is switchable. GPU-driven drawing falls back to CPU culling if it's not supported.
+    explicit ForwardRenderNode(Scene&, DrawMode = DrawMode::GpuDriven, bool switchableDrawMode = false);
 
     std::optional<std::string> displayName() const override { return "Forward"; }
     static std::string name();
 
+    void constructNode(Registry&) override;
     ExecuteCallback constructFrame(Registry&) const override;
 
+    //! Only for nodes constructed with a switchable draw mode
+    void setDrawMode(DrawMode drawMode)
+    {
+        ASSERT(m_switchableDrawMode);
+        m_drawMode = drawMode;
+    }
+    DrawMode drawMode() const { return m_drawMode; }
+
+    //! Only consider the first meshLimit meshes of the scene (useful for benchmarking)
+    void setMeshLimit(size_t meshLimit) { m_meshLimit = meshLimit; }
+
+    //! CPU time spent recording the draws (including culling, for the CPU path) in the last executed frame
+    double lastDrawRecordingTimeMs() const { return m_lastDrawRecordingTimeMs; }
+
 private:
     struct ForwardVertex {
         vec3 position;
@@ -36,4 +61,21 @@ private:
                                                 VertexComponent::Tangent4F };
 
     Scene& m_scene;
+
+    Shader m_shader {};
+    Shader m_cullShader {};
+
+    mutable DrawMode m_drawMode;
+    bool m_switchableDrawMode;
+    size_t m_meshLimit { std::numeric_limits<size_t>::max() };
+    mutable double m_lastDrawRecordingTimeMs { 0.0 };
+
+    //! If the GPU-driven draw mode can be used, i.e. it's supported and the draw mode is either switchable or GPU-driven
+    bool m_canDrawIndirect { false };
+
+    // Shared geometry for GPU-driven drawing, with all meshes in the order of Scene::forEachMesh (only created if m_canDrawIndirect)
+    Buffer* m_sharedVertexBuffer { nullptr };
+    Buffer* m_sharedIndexBuffer { nullptr };
+    Buffer* m_drawableGeometryBuffer { nullptr };
+    uint32_t m_meshCount { 0 };
 };
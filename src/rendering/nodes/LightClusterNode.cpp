@@ -0,0 +1,127 @@
+#include "LightClusterNode.h"
+
+#include "rendering/lighting/LightClustering.h"
+#include "utility/Logging.h"
+#include <algorithm>
+#include <chrono>
+#include <imgui.h>
+
+// Shared with shaders
+#include "LightData.h"
+
+std::string LightClusterNode::name()
+{
+    return "light-clustering";
+}
+
+LightClusterNode::LightClusterNode(Scene& scene)
+    : RenderGraphNode(LightClusterNode::name())
+    , m_scene(scene)
+{
+}
+
+void LightClusterNode::constructNode(Registry&)
+{
+    m_assignLightsShader = Shader::createCompute("light-clustering/assignLights.comp");
+}
+
+RenderGraphNode::ExecuteCallback LightClusterNode::constructFrame(Registry& reg) const
+{
+    Buffer& clusterInfoBuffer = reg.createBuffer(sizeof(LightClusterInfo), Buffer::Usage::UniformBuffer, Buffer::MemoryHint::TransferOptimal);
+    Buffer& localLightBuffer = reg.createBuffer(SCENE_MAX_LOCAL_LIGHTS * sizeof(LocalLightData), Buffer::Usage::StorageBuffer, Buffer::MemoryHint::TransferOptimal);
+    Buffer& clusterLightCountBuffer = reg.createBuffer(LIGHT_CLUSTER_COUNT * sizeof(int), Buffer::Usage::StorageBuffer, Buffer::MemoryHint::GpuOptimal);
+    Buffer& clusterLightIndexBuffer = reg.createBuffer(LIGHT_CLUSTER_COUNT * LIGHT_CLUSTER_MAX_LIGHTS * sizeof(int), Buffer::Usage::StorageBuffer, Buffer::MemoryHint::GpuOptimal);
+
+    BindingSet& assignLightsBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, reg.getBuffer("scene", "camera") },
+                                                                { 1, ShaderStageCompute, &clusterInfoBuffer },
+                                                                { 2, ShaderStageCompute, &localLightBuffer },
+                                                                { 3, ShaderStageCompute, &clusterLightCountBuffer },
+                                                                { 4, ShaderStageCompute, &clusterLightIndexBuffer } });
+    ComputeState& assignLightsComputeState = reg.createComputeState(m_assignLightsShader, { &assignLightsBindingSet });
+
+    BindingSet& clusterBindingSet = reg.createBindingSet({ { 0, ShaderStageFragment, &clusterInfoBuffer },
+                                                           { 1, ShaderStageFragment, &localLightBuffer },
+                                                           { 2, ShaderStageFragment, &clusterLightCountBuffer },
+                                                           { 3, ShaderStageFragment, &clusterLightIndexBuffer } });
+    reg.publish("clusterSet", clusterBindingSet);
+
+    // The inputs of the last binning into the buffers of this frame, so we can validate the results against the CPU reference
+    struct BinningInput {
+        mat4 viewFromProjection;
+        LightClusterInfo clusterInfo;
+        std::vector<LocalLightData> lights;
+    };
+
+    return [&, lastInput = std::optional<BinningInput>()](const AppState& appState, CommandList& cmdList) mutable {
+        static bool validateAgainstCpuReference = false;
+        ImGui::Checkbox("Validate against CPU reference", &validateAgainstCpuReference);
+
+        if (validateAgainstCpuReference && lastInput.has_value()) {
+            std::vector<int> gpuClusterLightCounts(LIGHT_CLUSTER_COUNT);
+            std::vector<int> gpuClusterLightIndices(LIGHT_CLUSTER_COUNT * LIGHT_CLUSTER_MAX_LIGHTS);
+            cmdList.slowBlockingReadFromBuffer(clusterLightCountBuffer, 0, clusterLightCountBuffer.size(), gpuClusterLightCounts.data());
+            cmdList.slowBlockingReadFromBuffer(clusterLightIndexBuffer, 0, clusterLightIndexBuffer.size(), gpuClusterLightIndices.data());
+
+            auto cpuStartTime = std::chrono::steady_clock::now();
+            LightClustering::Result reference = LightClustering::binLights(lastInput->viewFromProjection, lastInput->clusterInfo, lastInput->lights);
+            std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - cpuStartTime;
+
+            int mismatchingClusters = 0;
+            for (int clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; ++clusterIdx) {
+                int count = reference.clusterLightCounts[clusterIdx];
+                auto referenceBegin = reference.clusterLightIndices.begin() + clusterIdx * LIGHT_CLUSTER_MAX_LIGHTS;
+                auto gpuBegin = gpuClusterLightIndices.begin() + clusterIdx * LIGHT_CLUSTER_MAX_LIGHTS;
+                if (gpuClusterLightCounts[clusterIdx] != count || !std::equal(referenceBegin, referenceBegin + count, gpuBegin))
+                    mismatchingClusters += 1;
+            }
+
+            ImGui::Text("CPU reference binning time: %.2f ms", cpuTime.count());
+            ImGui::Text("Clusters not matching the CPU reference: %i", mismatchingClusters);
+            if (mismatchingClusters > 0)
+                LogWarning("LightClusterNode: %i clusters don't match the CPU reference binning\n", mismatchingClusters);
+        }
+
+        const FpsCamera& camera = m_scene.camera();
+
+        BinningInput input {};
+        input.viewFromProjection = inverse(camera.projectionMatrix());
+
+        mat4 viewFromWorld = camera.viewMatrix();
+        for (const PointLight& light : m_scene.pointLights()) {
+            input.lights.push_back({ .colorAndIntensity = vec4(light.color, light.intensity),
+                                     .viewSpacePositionAndRange = vec4((viewFromWorld * vec4(light.position, 1.0f)).xyz(), light.range),
+                                     .viewSpaceDirection = vec4(0.0f),
+                                     .cosOuterConeAngle = -1.0f,
+                                     .cosInnerConeAngle = -1.0f });
+        }
+        for (const SpotLight& light : m_scene.spotLights()) {
+            input.lights.push_back({ .colorAndIntensity = vec4(light.color, light.intensity),
+                                     .viewSpacePositionAndRange = vec4((viewFromWorld * vec4(light.position, 1.0f)).xyz(), light.range),
+                                     .viewSpaceDirection = viewFromWorld * vec4(normalize(light.direction), 0.0f),
+                                     .cosOuterConeAngle = std::cos(light.outerConeAngle),
+                                     .cosInnerConeAngle = std::cos(light.innerConeAngle) });
+        }
+
+        if (input.lights.size() > SCENE_MAX_LOCAL_LIGHTS) {
+            LogWarning("LightClusterNode: the scene has %zu point & spot lights, but only %i are supported, ignoring the rest.\n", input.lights.size(), SCENE_MAX_LOCAL_LIGHTS);
+            input.lights.resize(SCENE_MAX_LOCAL_LIGHTS);
+        }
+
+        input.clusterInfo = { .zNear = FpsCamera::zNear,
+                              .zFar = FpsCamera::zFar,
+                              .localLightCount = static_cast<int>(input.lights.size()) };
+
+        clusterInfoBuffer.updateData(&input.clusterInfo, sizeof(LightClusterInfo));
+        if (!input.lights.empty())
+            localLightBuffer.updateData(input.lights.data(), input.lights.size() * sizeof(LocalLightData));
+
+        ImGui::Text("Point & spot lights: %i", input.clusterInfo.localLightCount);
+
+        cmdList.setComputeState(assignLightsComputeState);
+        cmdList.bindSet(assignLightsBindingSet, 0);
+        cmdList.dispatch({ LIGHT_CLUSTER_COUNT, 1, 1 }, { 64, 1, 1 });
+        cmdList.bufferWriteBarrier({ &clusterLightCountBuffer, &clusterLightIndexBuffer });
+
+        lastInput = std::move(input);
+    };
+}
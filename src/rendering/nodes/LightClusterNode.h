@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../RenderGraphNode.h"
+#include "rendering/scene/Scene.h"
+
+//! Bins all point & spot lights of the scene into clusters (froxels) of the view frustum, so that shading only has to consider the
+//! lights which can affect the cluster the shaded point is in. The results are published as "clusterSet" for use in fragment shaders.
+class LightClusterNode final : public RenderGraphNode {
+public:
+    explicit LightClusterNode(Scene&);
+
+    std::optional<std::string> displayName() const override { return "Light clustering"; }
+    bool prefersAsyncCompute() const override { return true; }
+    static std::string name();
+
+    void constructNode(Registry&) override;
+    ExecuteCallback constructFrame(Registry&) const override;
+
+private:
+    Scene& m_scene;
+    Shader m_assignLightsShader {};
+};
@@ -1,14 +1,9 @@
 #include "PickingNode.h"
 
-#include "CameraState.h"
-#include "LightData.h"
-#include "utility/Logging.h"
+#include <chrono>
 #include <imgui.h>
 #include <moos/vector.h>
 
-// Shared with shaders
-#include "Picking.h"
-
 std::string PickingNode::name()
 {
     return "picking";
@@ -17,63 +12,14 @@ std::string PickingNode::name()
 PickingNode::PickingNode(Scene& scene)
     : RenderGraphNode(PickingNode::name())
     , m_scene(scene)
+    , m_picker(scene)
 {
 }
 
 RenderGraphNode::ExecuteCallback PickingNode::constructFrame(Registry& reg) const
 {
-    Buffer& transformDataBuffer = reg.createBuffer(PICKING_MAX_DRAWABLES * sizeof(mat4), Buffer::Usage::UniformBuffer, Buffer::MemoryHint::TransferOptimal);
-
-    Texture& indexMap = reg.createTexture2D(reg.windowRenderTarget().extent(), Texture::Format::R32);
-    Texture& indexDepthMap = reg.createTexture2D(reg.windowRenderTarget().extent(), Texture::Format::Depth32F);
-    RenderTarget& indexMapRenderTarget = reg.createRenderTarget({ { RenderTarget::AttachmentType::Color0, &indexMap, LoadOp::Clear, StoreOp::Store },
-                                                                  { RenderTarget::AttachmentType::Depth, &indexDepthMap, LoadOp::Clear, StoreOp::Discard } });
-
-    Shader drawIndexShader = Shader::createBasicRasterize("picking/drawIndices.vert", "picking/drawIndices.frag");
-    VertexLayout vertexLayout = { sizeof(vec3), { { 0, VertexAttributeType::Float3, 0 } } };
-    BindingSet& drawIndexBindingSet = reg.createBindingSet({ { 0, ShaderStageVertex, reg.getBuffer("scene", "camera") },
-                                                             { 1, ShaderStageVertex, &transformDataBuffer } });
-    RenderStateBuilder renderStateBuilder(indexMapRenderTarget, drawIndexShader, vertexLayout);
-    renderStateBuilder.addBindingSet(drawIndexBindingSet);
-    RenderState& drawIndicesState = reg.createRenderState(renderStateBuilder);
-
-    Buffer& pickedIndexBuffer = reg.createBuffer(sizeof(moos::u32), Buffer::Usage::StorageBuffer, Buffer::MemoryHint::Readback);
-    Shader collectorShader = Shader::createCompute("picking/collectIndex.comp");
-    BindingSet& collectIndexBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, &indexMap, ShaderBindingType::StorageImage },
-                                                                { 1, ShaderStageCompute, &pickedIndexBuffer } });
-    ComputeState& collectState = reg.createComputeState(collectorShader, { &collectIndexBindingSet });
-
+    // NOTE: Picking is done entirely on the CPU, by ray casting against the scene, so there is nothing to record here
     return [&](const AppState& appState, CommandList& cmdList) {
-        int numMeshes;
-        {
-            mat4 objectTransforms[PICKING_MAX_DRAWABLES];
-            numMeshes = m_scene.forEachMesh([&](size_t index, Mesh& mesh) {
-                objectTransforms[index] = mesh.transform().worldMatrix();
-                mesh.ensureVertexBuffer({ VertexComponent::Position3F });
-                mesh.ensureIndexBuffer();
-            });
-            transformDataBuffer.updateData(objectTransforms, numMeshes * sizeof(mat4));
-
-            cmdList.beginRendering(drawIndicesState, ClearColor(1, 0, 1), 1.0f);
-            cmdList.bindSet(drawIndexBindingSet, 0);
-
-            m_scene.forEachMesh([&](size_t index, Mesh& mesh) {
-                cmdList.drawIndexed(mesh.vertexBuffer({ VertexComponent::Position3F }), mesh.indexBuffer(), mesh.indexCount(), mesh.indexType(), static_cast<uint32_t>(index));
-            });
-
-            cmdList.endRendering();
-        }
-
-        {
-            cmdList.setComputeState(collectState);
-            cmdList.bindSet(collectIndexBindingSet, 0);
-
-            vec2 pickLocation = Input::instance().mousePosition();
-            cmdList.pushConstant(ShaderStageCompute, pickLocation, 0);
-
-            cmdList.dispatch(indexMap.extent(), { 16, 16, 1 });
-        }
-
         auto didClick = [this](Button button) -> bool {
             auto& input = Input::instance();
 
@@ -90,23 +36,28 @@ RenderGraphNode::ExecuteCallback PickingNode::constructFrame(Registry& reg) cons
             return false;
         };
 
-        if (!didClick(Button::Middle))
-            return;
+        if (didClick(Button::Middle)) {
+            auto pickStartTime = std::chrono::steady_clock::now();
+            m_lastPick = m_picker.pick(Input::instance().mousePosition(), appState.windowExtent());
+            std::chrono::duration<double, std::milli> pickTime = std::chrono::steady_clock::now() - pickStartTime;
+            m_lastPickTimeMs = pickTime.count();
+
+            if (m_lastPick.has_value()) {
+                m_scene.setSelectedMesh(m_lastPick->mesh);
+                m_scene.setSelectedModel(m_lastPick->mesh->model());
+            } else {
+                m_scene.setSelectedMesh(nullptr);
+                m_scene.setSelectedModel(nullptr);
+            }
+        }
 
-        moos::u32 selectedIndex;
-        cmdList.slowBlockingReadFromBuffer(pickedIndexBuffer, 0, sizeof(moos::u32), &selectedIndex);
-        if (selectedIndex < numMeshes) {
-            m_scene.forEachMesh([&](size_t index, Mesh& mesh) {
-                if (index == selectedIndex) {
-                    //LogInfo("Selected mesh (global index %u) of model '%s'\n", selectedIndex, mesh.model()->name().c_str());
-                    m_scene.setSelectedMesh(&mesh);
-                    m_scene.setSelectedModel(mesh.model());
-                }
-            });
+        if (m_lastPick.has_value()) {
+            ImGui::Text("Picked mesh %u, triangle %u", m_lastPick->meshIndex, m_lastPick->triangleIndex);
+            ImGui::Text("Barycentrics: (%.3f, %.3f, %.3f)", m_lastPick->barycentrics.x, m_lastPick->barycentrics.y, m_lastPick->barycentrics.z);
         } else {
-            //LogInfo("Unselecting mesh & model\n");
-            m_scene.setSelectedMesh(nullptr);
-            m_scene.setSelectedModel(nullptr);
+            ImGui::Text("Nothing picked (middle click to pick)");
         }
+        // (the first pick of a mesh includes building its triangle BVH, so it's a lot slower than later picks)
+        ImGui::Text("Pick time: %.3f ms", m_lastPickTimeMs);
     };
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../RenderGraphNode.h"
+#include "rendering/picking/ScenePicker.h"
 #include "rendering/scene/Model.h"
 #include "rendering/scene/Scene.h"
 
@@ -16,4 +17,9 @@ public:
 private:
     Scene& m_scene;
     mutable std::optional<vec2> m_mouseDownLocation {};
+
+    // (shared by all frames, so the triangle BVHs of the meshes are only built once)
+    mutable ScenePicker m_picker;
+    mutable std::optional<ScenePicker::Result> m_lastPick {};
+    mutable double m_lastPickTimeMs { 0.0 };
 };
@@ -1,6 +1,8 @@
 #include "RTAccelerationStructures.h"
 
 #include "RTData.h"
+#include <cstring>
+#include <string_view>
 
 RTAccelerationStructures::RTAccelerationStructures(Scene& scene)
     : RenderGraphNode(RTAccelerationStructures::name())
@@ -16,14 +18,17 @@ std::string RTAccelerationStructures::name()
 void RTAccelerationStructures::constructNode(Registry& nodeReg)
 {
     m_mainInstances.clear();
+    m_blasesByGeometryHash.clear();
 
     uint32_t nextTriangleInstanceId = 0;
 
     m_scene.forEachModel([&](size_t, Model& model) {
         model.forEachMesh([&](Mesh& mesh) {
-            RTGeometry geometry = createGeometryForTriangleMesh(mesh, nodeReg);
+            // NOTE: The closest hit shaders find the mesh data using the custom instance index, and since there is no way to tell which geometry
+            //  of a BLAS was hit with NV ray tracing, we need one instance per mesh. The BLAS can still be shared by meshes with identical geometry.
+            BottomLevelAS& blas = bottomLevelAccelerationStructureForMesh(mesh, nodeReg);
             uint8_t hitMask = HitMask::TriangleMeshWithoutProxy;
-            RTGeometryInstance instance = createGeometryInstance(geometry, model.transform(), nextTriangleInstanceId++, hitMask, HitGroupIndex::Triangle, nodeReg);
+            RTGeometryInstance instance = createGeometryInstance(blas, mesh.transform(), nextTriangleInstanceId++, hitMask, HitGroupIndex::Triangle);
             m_mainInstances.push_back(instance);
         });
     });
@@ -35,25 +40,24 @@ RenderGraphNode::ExecuteCallback RTAccelerationStructures::constructFrame(Regist
     reg.publish("scene", main);
 
     return [&](const AppState& appState, CommandList& cmdList) {
-        cmdList.rebuildTopLevelAcceratationStructure(main);
+        cmdList.updateTopLevelAccelerationStructure(main);
     };
 }
 
-RTGeometry RTAccelerationStructures::createGeometryForTriangleMesh(Mesh& mesh, Registry& reg) const
+RTGeometry RTAccelerationStructures::createGeometryForTriangleMesh(Mesh& mesh) const
 {
+    // The mesh transform is part of the instance transform, so the BLAS is in mesh-local space and can be shared by all meshes with the same geometry
     RTTriangleGeometry geometry { .vertexBuffer = mesh.vertexBuffer({ VertexComponent::Position3F }),
                                   .vertexFormat = RTVertexFormat::XYZ32F,
                                   .vertexStride = sizeof(vec3),
-                                  .indexBuffer = reg.createBuffer(mesh.indexData(), Buffer::Usage::Index, Buffer::MemoryHint::GpuOptimal),
+                                  .indexBuffer = mesh.indexBuffer(),
                                   .indexType = mesh.indexType(),
-                                  .transform = mesh.transform().localMatrix() };
+                                  .transform = mat4(1.0f) };
     return geometry;
 }
 
-RTGeometryInstance RTAccelerationStructures::createGeometryInstance(const RTGeometry& geometry, const Transform& transform, uint32_t customId, uint8_t hitMask, uint32_t sbtOffset, Registry& reg) const
+RTGeometryInstance RTAccelerationStructures::createGeometryInstance(const BottomLevelAS& blas, const Transform& transform, uint32_t customId, uint8_t hitMask, uint32_t sbtOffset) const
 {
-    // TODO: Later we probably want to keep all meshes of a model in a single BLAS, but that requires some fancy SBT stuff which I don't wanna mess with now.
-    BottomLevelAS& blas = reg.createBottomLevelAccelerationStructure({ geometry });
     RTGeometryInstance instance = { .blas = blas,
                                     .transform = transform,
                                     .shaderBindingTableOffset = sbtOffset,
@@ -61,3 +65,30 @@ RTGeometryInstance RTAccelerationStructures::createGeometryInstance(const RTGeom
                                     .hitMask = hitMask };
     return instance;
 }
+
+BottomLevelAS& RTAccelerationStructures::bottomLevelAccelerationStructureForMesh(Mesh& mesh, Registry& reg)
+{
+    const std::vector<vec3>& positions = mesh.positionData();
+    const std::vector<uint32_t>& indices = mesh.indexData();
+
+    auto hashBytes = [](const void* data, size_t size) -> size_t {
+        return std::hash<std::string_view>()(std::string_view(static_cast<const char*>(data), size));
+    };
+
+    size_t geometryHash = hashBytes(positions.data(), positions.size() * sizeof(vec3));
+    geometryHash ^= hashBytes(indices.data(), indices.size() * sizeof(uint32_t)) + 0x9e3779b9 + (geometryHash << 6u) + (geometryHash >> 2u);
+
+    std::vector<SharedBLAS>& candidates = m_blasesByGeometryHash[geometryHash];
+    for (const SharedBLAS& candidate : candidates) {
+        const std::vector<vec3>& candidatePositions = candidate.mesh->positionData();
+        const std::vector<uint32_t>& candidateIndices = candidate.mesh->indexData();
+        if (candidatePositions.size() == positions.size() && candidateIndices == indices
+            && std::memcmp(candidatePositions.data(), positions.data(), positions.size() * sizeof(vec3)) == 0) {
+            return *candidate.blas;
+        }
+    }
+
+    BottomLevelAS& blas = reg.createBottomLevelAccelerationStructure({ createGeometryForTriangleMesh(mesh) });
+    candidates.push_back({ &mesh, &blas });
+    return blas;
+}
@@ -2,6 +2,7 @@
 
 #include "../RenderGraphNode.h"
 #include "rendering/scene/Scene.h"
+#include <unordered_map>
 
 class SphereSetModel;
 class VoxelContourModel;
@@ -31,10 +32,20 @@ public:
     };
 
 private:
-    RTGeometry createGeometryForTriangleMesh(Mesh&, Registry&) const;
-    RTGeometryInstance createGeometryInstance(const RTGeometry&, const Transform&, uint32_t customId, uint8_t hitMask, uint32_t sbtOffset, Registry&) const;
+    RTGeometry createGeometryForTriangleMesh(Mesh&) const;
+    RTGeometryInstance createGeometryInstance(const BottomLevelAS&, const Transform&, uint32_t customId, uint8_t hitMask, uint32_t sbtOffset) const;
+
+    //! Meshes with identical geometry (e.g. the same mesh of multiple instances of a model) share a single BLAS
+    BottomLevelAS& bottomLevelAccelerationStructureForMesh(Mesh&, Registry&);
 
 private:
     Scene& m_scene;
     std::vector<RTGeometryInstance> m_mainInstances {};
+
+    struct SharedBLAS {
+        const Mesh* mesh;
+        BottomLevelAS* blas;
+    };
+    // Keyed by a hash of the mesh geometry, with possibly multiple entries in case of hash collisions
+    std::unordered_map<size_t, std::vector<SharedBLAS>> m_blasesByGeometryHash {};
 };
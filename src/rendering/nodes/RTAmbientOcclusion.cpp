@@ -21,6 +21,13 @@ void RTAmbientOcclusion::constructNode(Registry& reg)
 {
     Extent2D windowExtent = GlobalState::get().windowExtent();
     m_accumulatedAO = &reg.createTexture2D(windowExtent, Texture::Format::R16F);
+
+    ShaderFile raygen("rt-ao/raygen.rgen");
+    ShaderFile miss("rt-ao/miss.rmiss");
+    HitGroup triangleHitGroup(ShaderFile("rt-ao/closestHit.rchit"));
+    m_shaderBindingTable = ShaderBindingTable { raygen, { triangleHitGroup }, { miss } };
+
+    m_averageAccumulationShader = Shader::createCompute("rt-ao/averageAccum.comp");
 }
 
 RenderGraphNode::ExecuteCallback RTAmbientOcclusion::constructFrame(Registry& reg) const
@@ -38,17 +45,13 @@ RenderGraphNode::ExecuteCallback RTAmbientOcclusion::constructFrame(Registry& re
                                                          { 3, ShaderStageRTRayGen, gBufferNormal, ShaderBindingType::TextureSampler },
                                                          { 4, ShaderStageRTRayGen, gBufferDepth, ShaderBindingType::TextureSampler } });
 
-    ShaderFile raygen("rt-ao/raygen.rgen");
-    ShaderFile miss("rt-ao/miss.rmiss");
-    HitGroup triangleHitGroup(ShaderFile("rt-ao/closestHit.rchit"));
-    ShaderBindingTable sbt { raygen, { triangleHitGroup }, { miss } };
-
+    ShaderBindingTable sbt = m_shaderBindingTable;
     uint32_t maxRecursionDepth = 1;
     RayTracingState& rtState = reg.createRayTracingState(sbt, { &frameBindingSet }, maxRecursionDepth);
 
     BindingSet& avgAccumBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, m_accumulatedAO, ShaderBindingType::StorageImage },
                                                             { 1, ShaderStageCompute, &ambientOcclusion, ShaderBindingType::StorageImage } });
-    ComputeState& compAvgAccumState = reg.createComputeState(Shader::createCompute("rt-ao/averageAccum.comp"), { &avgAccumBindingSet });
+    ComputeState& compAvgAccumState = reg.createComputeState(m_averageAccumulationShader, { &avgAccumBindingSet });
 
     return [&](const AppState& appState, CommandList& cmdList) {
         static bool enabled = false;
@@ -65,35 +68,30 @@ RenderGraphNode::ExecuteCallback RTAmbientOcclusion::constructFrame(Registry& re
             return;
         }
 
-        cmdList.waitEvent(1, appState.frameIndex() == 0 ? PipelineStage::Host : PipelineStage::RayTracing);
-        cmdList.resetEvent(1, PipelineStage::RayTracing);
-        {
-            if (m_scene.camera().didModify() || Input::instance().isKeyDown(Key::R)) {
-                cmdList.clearTexture(*m_accumulatedAO, ClearColor(0, 0, 0));
-                m_numAccumulatedFrames = 0;
-            }
-
-            if (m_numAccumulatedFrames < 256) {
-                cmdList.setRayTracingState(rtState);
-                cmdList.bindSet(frameBindingSet, 0);
-                cmdList.pushConstant(ShaderStageRTRayGen, radius, 0);
-                cmdList.pushConstant(ShaderStageRTRayGen, static_cast<uint32_t>(signedNumSamples), 4);
-                cmdList.pushConstant(ShaderStageRTRayGen, appState.frameIndex(), 8);
-                cmdList.pushConstant(ShaderStageRTRayGen, (uint32_t)RTAccelerationStructures::HitMask::TriangleMeshWithProxy, 12);
-                cmdList.pushConstant(ShaderStageRTRayGen, darkening, 16);
-                cmdList.traceRays(appState.windowExtent());
-                m_numAccumulatedFrames += 1;
-            }
-
-            cmdList.debugBarrier(); // TODO: Add fine grained barrier here to make sure ray tracing is done before averaging!
-
-            cmdList.setComputeState(compAvgAccumState);
-            cmdList.bindSet(avgAccumBindingSet, 0);
-            cmdList.pushConstant(ShaderStageCompute, m_numAccumulatedFrames);
-
-            Extent2D globalSize = appState.windowExtent();
-            cmdList.dispatch(globalSize, Extent3D(16));
+        if (m_scene.camera().didModify() || Input::instance().isKeyDown(Key::R)) {
+            cmdList.clearTexture(*m_accumulatedAO, ClearColor(0, 0, 0));
+            m_numAccumulatedFrames = 0;
+        }
+
+        if (m_numAccumulatedFrames < 256) {
+            cmdList.setRayTracingState(rtState);
+            cmdList.bindSet(frameBindingSet, 0);
+            cmdList.pushConstant(ShaderStageRTRayGen, radius, 0);
+            cmdList.pushConstant(ShaderStageRTRayGen, static_cast<uint32_t>(signedNumSamples), 4);
+            cmdList.pushConstant(ShaderStageRTRayGen, appState.frameIndex(), 8);
+            cmdList.pushConstant(ShaderStageRTRayGen, (uint32_t)RTAccelerationStructures::HitMask::TriangleMeshWithProxy, 12);
+            cmdList.pushConstant(ShaderStageRTRayGen, darkening, 16);
+            cmdList.traceRays(appState.windowExtent());
+            m_numAccumulatedFrames += 1;
         }
-        cmdList.signalEvent(1, PipelineStage::RayTracing);
+
+        cmdList.debugBarrier(); // TODO: Add fine grained barrier here to make sure ray tracing is done before averaging!
+
+        cmdList.setComputeState(compAvgAccumState);
+        cmdList.bindSet(avgAccumBindingSet, 0);
+        cmdList.pushConstant(ShaderStageCompute, m_numAccumulatedFrames);
+
+        Extent2D globalSize = appState.windowExtent();
+        cmdList.dispatch(globalSize, Extent3D(16));
     };
 }
@@ -21,5 +21,7 @@ private:
     const Scene& m_scene;
 
     Texture* m_accumulatedAO;
+    ShaderBindingTable m_shaderBindingTable {};
+    Shader m_averageAccumulationShader {};
     mutable uint32_t m_numAccumulatedFrames { 0 };
 };
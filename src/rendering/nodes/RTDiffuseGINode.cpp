@@ -20,6 +20,13 @@ std::string RTDiffuseGINode::name()
 
 void RTDiffuseGINode::constructNode(Registry& nodeReg)
 {
+    ShaderFile raygen = ShaderFile("rt-diffuseGI/raygen.rgen");
+    HitGroup mainHitGroup { ShaderFile("rt-diffuseGI/closestHit.rchit") };
+    std::vector<ShaderFile> missShaders { ShaderFile("rt-diffuseGI/miss.rmiss"),
+                                          ShaderFile("rt-diffuseGI/shadow.rmiss") };
+    m_shaderBindingTable = ShaderBindingTable { raygen, { mainHitGroup }, missShaders };
+    m_averageAccumulationShader = Shader::createCompute("rt-diffuseGI/averageAccum.comp");
+
     std::vector<Buffer*> vertexBuffers {};
     std::vector<Buffer*> indexBuffers {};
     std::vector<Texture*> allTextures {};
@@ -89,11 +96,7 @@ RenderGraphNode::ExecuteCallback RTDiffuseGINode::constructFrame(Registry& reg)
                                                          { 7, ShaderStageRTMiss, reg.getTexture("scene", "environmentMap").value_or(&reg.createPixelTexture(vec4(1.0), true)), ShaderBindingType::TextureSampler },
                                                          { 8, ShaderStageRTClosestHit, &dirLightBuffer } });
 
-    ShaderFile raygen = ShaderFile("rt-diffuseGI/raygen.rgen");
-    HitGroup mainHitGroup { ShaderFile("rt-diffuseGI/closestHit.rchit") };
-    std::vector<ShaderFile> missShaders { ShaderFile("rt-diffuseGI/miss.rmiss"),
-                                          ShaderFile("rt-diffuseGI/shadow.rmiss") };
-    ShaderBindingTable sbt { raygen, { mainHitGroup }, missShaders };
+    ShaderBindingTable sbt = m_shaderBindingTable;
 
     uint32_t maxRecursionDepth = 2;
     RayTracingState& rtState = reg.createRayTracingState(sbt, { &frameBindingSet, m_objectDataBindingSet }, maxRecursionDepth);
@@ -103,7 +106,7 @@ RenderGraphNode::ExecuteCallback RTDiffuseGINode::constructFrame(Registry& reg)
 
     BindingSet& avgAccumBindingSet = reg.createBindingSet({ { 0, ShaderStageCompute, m_accumulationTexture, ShaderBindingType::StorageImage },
                                                             { 1, ShaderStageCompute, &diffuseGI, ShaderBindingType::StorageImage } });
-    ComputeState& compAvgAccumState = reg.createComputeState(Shader::createCompute("rt-diffuseGI/averageAccum.comp"), { &avgAccumBindingSet });
+    ComputeState& compAvgAccumState = reg.createComputeState(m_averageAccumulationShader, { &avgAccumBindingSet });
 
     return [&](const AppState& appState, CommandList& cmdList) {
         constexpr int samplesPerPass = 1; // (I don't wanna pass in a uniform for optimization reasons, so keep this up to date!)
@@ -128,7 +131,6 @@ RenderGraphNode::ExecuteCallback RTDiffuseGINode::constructFrame(Registry& reg)
             .colorAndIntensity = { light.color, light.illuminance },
             .worldSpaceDirection = vec4(normalize(light.direction), 0.0),
             .viewSpaceDirection = m_scene.camera().viewMatrix() * vec4(normalize(m_scene.sun().direction), 0.0),
-            .lightProjectionFromWorld = light.viewProjection()
         };
         dirLightBuffer.updateData(&dirLightData, sizeof(DirectionalLightData));
 
@@ -139,28 +141,23 @@ RenderGraphNode::ExecuteCallback RTDiffuseGINode::constructFrame(Registry& reg)
         cmdList.pushConstant(ShaderStageRTRayGen, ignoreColor);
         cmdList.pushConstant(ShaderStageRTRayGen, appState.frameIndex(), 4);
 
-        cmdList.waitEvent(0, appState.frameIndex() == 0 ? PipelineStage::Host : PipelineStage::RayTracing);
-        cmdList.resetEvent(0, PipelineStage::RayTracing);
-        {
-            if (m_scene.camera().didModify() || Input::instance().isKeyDown(Key::R)) {
-                cmdList.clearTexture(*m_accumulationTexture, ClearColor(0, 0, 0));
-                m_numAccumulatedFrames = 0;
-            }
+        if (m_scene.camera().didModify() || Input::instance().isKeyDown(Key::R)) {
+            cmdList.clearTexture(*m_accumulationTexture, ClearColor(0, 0, 0));
+            m_numAccumulatedFrames = 0;
+        }
 
-            if (currentSamplesPerPixel < maxSamplesPerPixel) {
-                cmdList.traceRays(appState.windowExtent());
-                m_numAccumulatedFrames += 1;
-            }
+        if (currentSamplesPerPixel < maxSamplesPerPixel) {
+            cmdList.traceRays(appState.windowExtent());
+            m_numAccumulatedFrames += 1;
+        }
 
-            cmdList.debugBarrier(); // TODO: Add fine grained barrier here to make sure ray tracing is done before averaging!
+        cmdList.debugBarrier(); // TODO: Add fine grained barrier here to make sure ray tracing is done before averaging!
 
-            cmdList.setComputeState(compAvgAccumState);
-            cmdList.bindSet(avgAccumBindingSet, 0);
-            cmdList.pushConstant(ShaderStageCompute, m_numAccumulatedFrames);
+        cmdList.setComputeState(compAvgAccumState);
+        cmdList.bindSet(avgAccumBindingSet, 0);
+        cmdList.pushConstant(ShaderStageCompute, m_numAccumulatedFrames);
 
-            Extent2D globalSize = appState.windowExtent();
-            cmdList.dispatch(globalSize, Extent3D(16));
-        }
-        cmdList.signalEvent(0, PipelineStage::RayTracing);
+        Extent2D globalSize = appState.windowExtent();
+        cmdList.dispatch(globalSize, Extent3D(16));
     };
 }
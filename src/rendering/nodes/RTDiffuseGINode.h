@@ -26,4 +26,6 @@ private:
     mutable uint32_t m_numAccumulatedFrames { 0 };
 
     BindingSet* m_objectDataBindingSet {};
+    ShaderBindingTable m_shaderBindingTable {};
+    Shader m_averageAccumulationShader {};
 };
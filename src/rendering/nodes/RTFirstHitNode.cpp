@@ -17,6 +17,11 @@ std::string RTFirstHitNode::name()
 
 void RTFirstHitNode::constructNode(Registry& nodeReg)
 {
+    ShaderFile raygen = ShaderFile("rt-firsthit/raygen.rgen");
+    HitGroup mainHitGroup { ShaderFile("rt-firsthit/closestHit.rchit") };
+    ShaderFile missShader { ShaderFile("rt-firsthit/miss.rmiss") };
+    m_shaderBindingTable = ShaderBindingTable { raygen, { mainHitGroup }, { missShader } };
+
     std::vector<Buffer*> vertexBuffers {};
     std::vector<Buffer*> indexBuffers {};
     std::vector<Texture*> allTextures {};
@@ -79,10 +84,7 @@ RenderGraphNode::ExecuteCallback RTFirstHitNode::constructFrame(Registry& reg) c
                                                          { 2, ShaderStageRTRayGen, reg.getBuffer("scene", "camera") },
                                                          { 3, ShaderStageRTMiss, &timeBuffer } });
 
-    ShaderFile raygen = ShaderFile("rt-firsthit/raygen.rgen");
-    HitGroup mainHitGroup { ShaderFile("rt-firsthit/closestHit.rchit") };
-    ShaderFile missShader { ShaderFile("rt-firsthit/miss.rmiss") };
-    ShaderBindingTable sbt { raygen, { mainHitGroup }, { missShader } };
+    ShaderBindingTable sbt = m_shaderBindingTable;
 
     uint32_t maxRecursionDepth = 1;
     RayTracingState& rtState = reg.createRayTracingState(sbt, { &frameBindingSet, m_objectDataBindingSet, &environmentBindingSet }, maxRecursionDepth);
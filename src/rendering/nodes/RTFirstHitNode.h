@@ -20,4 +20,5 @@ public:
 private:
     Scene& m_scene;
     BindingSet* m_objectDataBindingSet {};
+    ShaderBindingTable m_shaderBindingTable {};
 };
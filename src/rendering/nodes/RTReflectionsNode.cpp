@@ -17,6 +17,12 @@ std::string RTReflectionsNode::name()
 
 void RTReflectionsNode::constructNode(Registry& nodeReg)
 {
+    ShaderFile raygen = ShaderFile("rt-reflections/raygen.rgen");
+    HitGroup mainHitGroup { ShaderFile("rt-reflections/closestHit.rchit") };
+    std::vector<ShaderFile> missShaders { ShaderFile("rt-reflections/miss.rmiss"),
+                                          ShaderFile("rt-reflections/shadow.rmiss") };
+    m_shaderBindingTable = ShaderBindingTable { raygen, { mainHitGroup }, missShaders };
+
     std::vector<Buffer*> vertexBuffers {};
     std::vector<Buffer*> indexBuffers {};
     std::vector<RTMesh> rtMeshes {};
@@ -82,11 +88,7 @@ RenderGraphNode::ExecuteCallback RTReflectionsNode::constructFrame(Registry& reg
                                                          { 7, ShaderStageRTMiss, reg.getTexture("scene", "environmentMap").value_or(&reg.createPixelTexture(vec4(1.0f), true)), ShaderBindingType::TextureSampler },
                                                          { 8, ShaderStageRTClosestHit, &dirLightBuffer } });
 
-    ShaderFile raygen = ShaderFile("rt-reflections/raygen.rgen");
-    HitGroup mainHitGroup { ShaderFile("rt-reflections/closestHit.rchit") };
-    std::vector<ShaderFile> missShaders { ShaderFile("rt-reflections/miss.rmiss"),
-                                          ShaderFile("rt-reflections/shadow.rmiss") };
-    ShaderBindingTable sbt { raygen, { mainHitGroup }, missShaders };
+    ShaderBindingTable sbt = m_shaderBindingTable;
 
     uint32_t maxRecursionDepth = 2;
     RayTracingState& rtState = reg.createRayTracingState(sbt, { &frameBindingSet, m_objectDataBindingSet }, maxRecursionDepth);
@@ -98,7 +100,6 @@ RenderGraphNode::ExecuteCallback RTReflectionsNode::constructFrame(Registry& reg
             .colorAndIntensity = { light.color, light.illuminance },
             .worldSpaceDirection = vec4(normalize(light.direction), 0.0),
             .viewSpaceDirection = m_scene.camera().viewMatrix() * vec4(normalize(m_scene.sun().direction), 0.0),
-            .lightProjectionFromWorld = light.viewProjection()
         };
         dirLightBuffer.updateData(&dirLightData, sizeof(DirectionalLightData));
 
@@ -104,7 +104,7 @@ RenderGraphNode::ExecuteCallback SceneNode::constructFrame(Registry& reg) const
 
     // Object data stuff
     size_t objectDataBufferSize = m_drawables.size() * sizeof(ShaderDrawable);
-    Buffer& objectDataBuffer = reg.createBuffer(objectDataBufferSize, Buffer::Usage::UniformBuffer, Buffer::MemoryHint::TransferOptimal);
+    Buffer& objectDataBuffer = reg.createBuffer(objectDataBufferSize, Buffer::Usage::StorageBuffer, Buffer::MemoryHint::TransferOptimal);
     reg.publish("objectData", objectDataBuffer);
 
     BindingSet& objectBindingSet = reg.createBindingSet({ { 0, ShaderStageVertex, &objectDataBuffer },
@@ -138,6 +138,10 @@ RenderGraphNode::ExecuteCallback SceneNode::constructFrame(Registry& reg) const
             ImGui::ColorEdit3("Sun color", value_ptr(m_scene.sun().color));
             ImGui::SliderFloat("Sun illuminance (lx)", &m_scene.sun().illuminance, 1.0f, 150000.0f);
             ImGui::SliderFloat("Ambient (lx)", &m_scene.ambient(), 0.0f, 1000.0f);
+            ImGui::SliderInt("Sun shadow cascades", &m_scene.sun().shadowCascadeCount, 1, SHADOW_MAX_CASCADES);
+            ImGui::SliderFloat("Sun shadow distance (m)", &m_scene.sun().shadowDistance, 1.0f, 500.0f);
+            ImGui::SliderFloat("Sun shadow cascade split lambda", &m_scene.sun().shadowCascadeSplitLambda, 0.0f, 1.0f);
+            ImGui::SliderFloat("Sun shadow cascade snap step", &m_scene.sun().shadowCascadeSnapStep, 0.0f, 1.0f);
             ImGui::TreePop();
         }
 
@@ -190,9 +194,14 @@ RenderGraphNode::ExecuteCallback SceneNode::constructFrame(Registry& reg) const
                 .colorAndIntensity = { light.color, light.illuminance },
                 .worldSpaceDirection = vec4(normalize(light.direction), 0.0),
                 .viewSpaceDirection = m_scene.camera().viewMatrix() * vec4(normalize(m_scene.sun().direction), 0.0),
-                .lightProjectionFromWorld = light.viewProjection()
             };
 
+            // NOTE: These are the exact same cascades as the shadow map node renders, as they only depend on the light & camera
+            std::vector<mat4> cascadeViewProjections = light.shadowCascadeViewProjections(m_scene.camera());
+            for (size_t cascade = 0; cascade < cascadeViewProjections.size(); ++cascade)
+                dirLightData.lightProjectionFromWorld[cascade] = cascadeViewProjections[cascade];
+            dirLightData.cascadeCount = static_cast<int>(cascadeViewProjections.size());
+
             lightDataBuffer.updateData(&dirLightData, sizeof(DirectionalLightData));
         }
 
@@ -1,6 +1,10 @@
 #include "ShadowMapNode.h"
 
-#include "ShadowData.h"
+#include "geometry/Frustum.h"
+#include <algorithm>
+#include <cstring>
+#include <imgui.h>
+#include <optional>
 
 std::string ShadowMapNode::name()
 {
@@ -13,45 +17,119 @@ ShadowMapNode::ShadowMapNode(Scene& scene)
 {
 }
 
+void ShadowMapNode::constructNode(Registry&)
+{
+    m_shader = Shader::createVertexOnly("shadow/shadowSun.vert");
+}
+
 RenderGraphNode::ExecuteCallback ShadowMapNode::constructFrame(Registry& reg) const
 {
     // TODO: Render all applicable shadow maps here, not just the default 'sun' as we do now.
     DirectionalLight& sunLight = m_scene.sun();
+    Texture& shadowMap = sunLight.shadowMap();
+
+    BindingSet& objectBindingSet = reg.createBindingSet({ { 0, ShaderStageVertex, reg.getBuffer("scene", "objectData") } });
 
-    Buffer& lightDataBuffer = reg.createBuffer(sizeof(mat4), Buffer::Usage::UniformBuffer, Buffer::MemoryHint::TransferOptimal);
-    BindingSet& lightBindingSet = reg.createBindingSet({ { 0, ShaderStageVertex, &lightDataBuffer } });
+    // Each cascade is rendered to its own layer of the shadow map, so they each need a separate render target
+    std::vector<RenderState*> cascadeRenderStates {};
+    for (uint32_t cascade = 0; cascade < shadowMap.arrayCount(); ++cascade) {
+        const RenderTarget& cascadeRenderTarget = reg.createRenderTarget({ { .type = RenderTarget::AttachmentType::Depth, .texture = &shadowMap, .arrayLayer = cascade } });
 
-    Buffer& transformDataBuffer = reg.createBuffer(m_scene.meshCount() * sizeof(mat4), Buffer::Usage::UniformBuffer, Buffer::MemoryHint::TransferOptimal);
-    BindingSet& transformBindingSet = reg.createBindingSet({ { 0, ShaderStageVertex, &transformDataBuffer } });
+        RenderStateBuilder renderStateBuilder { cascadeRenderTarget, m_shader, VertexLayout::positionOnly() };
+        renderStateBuilder.addBindingSet(objectBindingSet);
 
-    const RenderTarget& shadowRenderTarget = reg.createRenderTarget({ { RenderTarget::AttachmentType::Depth, &sunLight.shadowMap() } });
-    Shader shader = Shader::createVertexOnly("shadow/shadowSun.vert");
+        cascadeRenderStates.push_back(&reg.createRenderState(renderStateBuilder));
+    }
 
-    RenderStateBuilder renderStateBuilder { shadowRenderTarget, shader, VertexLayout::positionOnly() };
-    renderStateBuilder
-        .addBindingSet(lightBindingSet)
-        .addBindingSet(transformBindingSet);
+    // A cascade is only rendered again if its projection changed, e.g. due to the sun or camera moving, or if a caster inside of it moved. The
+    // cache is cleared on (re)construction, so then all cascades are rendered.
+    m_cascadeCache = {};
+    m_cascadeCache.cascadeViewProjections.resize(cascadeRenderStates.size());
 
-    RenderState& renderState = reg.createRenderState(renderStateBuilder);
+    return [&, cascadeRenderStates](const AppState& appState, CommandList& cmdList) {
+        std::vector<std::optional<mat4>>& cachedCascadeViewProjections = m_cascadeCache.cascadeViewProjections;
+        std::vector<mat4>& cachedCasterTransforms = m_cascadeCache.casterTransforms;
+        geometry::SphereArray& cachedCasterBoundingSpheres = m_cascadeCache.casterBoundingSpheres;
 
-    return [&](const AppState& appState, CommandList& cmdList) {
-        mat4 objectTransforms[SHADOW_MAX_OCCLUDERS];
-        int meshCount = m_scene.forEachMesh([&](size_t idx, Mesh& mesh) {
-            objectTransforms[idx] = mesh.transform().worldMatrix();
+        static bool cacheCascades = true;
+        ImGui::Checkbox("Cache cascades between frames", &cacheCascades);
+
+        std::vector<Mesh*> meshes {};
+        std::vector<mat4> casterTransforms {};
+        geometry::SphereArray worldSpaceBoundingSpheres {};
+        m_scene.forEachMesh([&](size_t, Mesh& mesh) {
             mesh.ensureVertexBuffer({ VertexComponent::Position3F });
             mesh.ensureIndexBuffer();
+            meshes.push_back(&mesh);
+            casterTransforms.push_back(mesh.transform().worldMatrix());
+            worldSpaceBoundingSpheres.addTransformed(mesh.boundingSphere(), casterTransforms.back());
         });
-        transformDataBuffer.updateData(objectTransforms, meshCount * sizeof(mat4));
 
-        mat4 lightProjectionFromWorld = sunLight.viewProjection();
-        lightDataBuffer.updateData(&lightProjectionFromWorld, sizeof(mat4));
+        // NOTE: These must match the cascades in the light data uploaded by the scene node, which they do since it uses the same light & camera
+        std::vector<mat4> cascadeViewProjections = sunLight.shadowCascadeViewProjections(m_scene.camera());
+        ASSERT(cascadeViewProjections.size() <= cascadeRenderStates.size());
 
-        cmdList.beginRendering(renderState, ClearColor(1, 0, 1), 1.0f);
-        cmdList.bindSet(lightBindingSet, 0);
-        cmdList.bindSet(transformBindingSet, 1);
+        auto isSameMatrix = [](const mat4& lhs, const mat4& rhs) -> bool {
+            // (exact comparison is what we want here, as anything that moved at all must be rendered again)
+            return std::memcmp(&lhs, &rhs, sizeof(mat4)) == 0;
+        };
 
-        m_scene.forEachMesh([&](size_t idx, Mesh& mesh) {
-            cmdList.drawIndexed(mesh.vertexBuffer({ VertexComponent::Position3F }), mesh.indexBuffer(), mesh.indexCount(), mesh.indexType(), idx);
-        });
+        // Find casters which have moved (or been added or removed) since the cached cascades were rendered
+        bool casterSetChanged = casterTransforms.size() != cachedCasterTransforms.size();
+        std::vector<geometry::Sphere> movedCasterBoundingSpheres {};
+        if (!casterSetChanged) {
+            for (size_t idx = 0; idx < casterTransforms.size(); ++idx) {
+                if (!isSameMatrix(casterTransforms[idx], cachedCasterTransforms[idx])) {
+                    // (both where it was and where it is now, as the shadow must disappear from the old location)
+                    movedCasterBoundingSpheres.push_back(cachedCasterBoundingSpheres.sphere(idx));
+                    movedCasterBoundingSpheres.push_back(worldSpaceBoundingSpheres.sphere(idx));
+                }
+            }
+        }
+
+        for (size_t cascade = 0; cascade < cascadeViewProjections.size(); ++cascade) {
+            mat4 lightProjectionFromWorld = cascadeViewProjections[cascade];
+            auto cascadeFrustum = geometry::Frustum::createFromProjectionMatrix(lightProjectionFromWorld);
+
+            bool canUseCachedCascade = cacheCascades && !casterSetChanged
+                && cachedCascadeViewProjections[cascade].has_value()
+                && isSameMatrix(cachedCascadeViewProjections[cascade].value(), lightProjectionFromWorld)
+                && std::none_of(movedCasterBoundingSpheres.begin(), movedCasterBoundingSpheres.end(), [&](const geometry::Sphere& sphere) {
+                       return cascadeFrustum.includesSphere(sphere);
+                   });
+
+            if (canUseCachedCascade) {
+                ImGui::Text("Cascade %u: cached", uint32_t(cascade));
+                continue;
+            }
+
+            cmdList.beginRendering(*cascadeRenderStates[cascade], ClearColor(1, 0, 1), 1.0f);
+            cmdList.bindSet(objectBindingSet, 0);
+            cmdList.pushConstants(ShaderStageVertex, &lightProjectionFromWorld, sizeof(mat4), 0);
+
+            std::vector<uint32_t> casterIndices {};
+            m_scene.meshBVH().queryFrustum(cascadeFrustum, casterIndices);
+
+            // NOTE: The vertex & index buffers are ensured above, so looking them up from multiple threads here is fine
+            cmdList.drawInParallel(casterIndices.size(), [&](CommandList& drawCmdList, size_t begin, size_t end) {
+                for (size_t idx = begin; idx < end; ++idx) {
+                    uint32_t meshIndex = casterIndices[idx];
+                    Mesh& mesh = *meshes[meshIndex];
+                    drawCmdList.drawIndexed(mesh.vertexBuffer({ VertexComponent::Position3F }), mesh.indexBuffer(), mesh.indexCount(), mesh.indexType(), meshIndex);
+                }
+            });
+
+            cmdList.endRendering();
+            cachedCascadeViewProjections[cascade] = lightProjectionFromWorld;
+
+            ImGui::Text("Cascade %u: %u of %u meshes drawn", uint32_t(cascade), uint32_t(casterIndices.size()), uint32_t(meshes.size()));
+        }
+
+        // Any cascades not in use now must be rendered when they are used again, as they have probably moved since
+        for (size_t cascade = cascadeViewProjections.size(); cascade < cachedCascadeViewProjections.size(); ++cascade)
+            cachedCascadeViewProjections[cascade].reset();
+
+        cachedCasterTransforms = std::move(casterTransforms);
+        cachedCasterBoundingSpheres = std::move(worldSpaceBoundingSpheres);
     };
 }
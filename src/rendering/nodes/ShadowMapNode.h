@@ -1,5 +1,6 @@
 #pragma once
 
+#include "geometry/BatchCulling.h"
 #include "rendering/RenderGraphNode.h"
 #include "rendering/camera/FpsCamera.h"
 #include "rendering/scene/Model.h"
@@ -14,8 +15,19 @@ public:
 
     std::optional<std::string> displayName() const override { return "Shadow Mapping"; }
 
+    void constructNode(Registry&) override;
     ExecuteCallback constructFrame(Registry&) const override;
 
 private:
     Scene& m_scene;
+    Shader m_shader {};
+
+    //! The cascades last rendered into the shadow map, and the caster transforms at the time. This is shared by all frames, since they all
+    //! render into the same shadow map, so a cascade is only ever cached if it's what the shadow map currently holds.
+    struct CascadeCache {
+        std::vector<std::optional<mat4>> cascadeViewProjections {};
+        std::vector<mat4> casterTransforms {};
+        geometry::SphereArray casterBoundingSpheres {};
+    };
+    mutable CascadeCache m_cascadeCache {};
 };
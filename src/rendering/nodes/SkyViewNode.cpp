@@ -8,6 +8,11 @@ SkyViewNode::SkyViewNode(Scene& scene)
 {
 }
 
+void SkyViewNode::constructNode(Registry&)
+{
+    m_skyViewShader = Shader::createCompute("post/sky-view.comp");
+}
+
 RenderGraphNode::ExecuteCallback SkyViewNode::constructFrame(Registry& reg) const
 {
     Texture& targetImage = *reg.getTexture("forward", "color").value();
@@ -23,7 +28,7 @@ RenderGraphNode::ExecuteCallback SkyViewNode::constructFrame(Registry& reg) cons
                                                            { 2, ShaderStageCompute, &depthImage, ShaderBindingType::TextureSampler },
                                                            { 3, ShaderStageCompute, &skyViewTexture, ShaderBindingType::TextureSampler } });
 
-    ComputeState& skyViewComputeState = reg.createComputeState(Shader::createCompute("post/sky-view.comp"), { &skyViewBindingSet });
+    ComputeState& skyViewComputeState = reg.createComputeState(m_skyViewShader, { &skyViewBindingSet });
 
     return [&](const AppState& appState, CommandList& cmdList) {
         cmdList.setComputeState(skyViewComputeState);
@@ -10,8 +10,10 @@ public:
     static std::string name() { return "skyview"; }
     std::optional<std::string> displayName() const override { return "Sky view"; }
 
+    void constructNode(Registry&) override;
     ExecuteCallback constructFrame(Registry&) const override;
 
 private:
     Scene& m_scene;
+    Shader m_skyViewShader {};
 };
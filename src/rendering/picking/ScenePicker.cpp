@@ -0,0 +1,148 @@
+#include "ScenePicker.h"
+
+#include "rendering/scene/Scene.h"
+#include <algorithm>
+
+ScenePicker::ScenePicker(Scene& scene)
+    : m_scene(scene)
+{
+}
+
+std::optional<ScenePicker::Result> ScenePicker::pick(vec2 pixelPosition, Extent2D viewportExtent)
+{
+    if (viewportExtent.width() == 0 || viewportExtent.height() == 0)
+        return {};
+
+    const FpsCamera& camera = m_scene.camera();
+
+    // (the projection flips y, so the top of the viewport is at -1 in normalized device coordinates, just like for the pixel position)
+    float ndcX = 2.0f * (pixelPosition.x + 0.5f) / float(viewportExtent.width()) - 1.0f;
+    float ndcY = 2.0f * (pixelPosition.y + 0.5f) / float(viewportExtent.height()) - 1.0f;
+
+    // Any point along the ray through the pixel will do, as it starts at the camera position anyway
+    mat4 worldFromProjection = inverse(camera.projectionMatrix() * camera.viewMatrix());
+    vec4 worldSpacePoint = worldFromProjection * vec4(ndcX, ndcY, 0.5f, 1.0f);
+    vec3 direction = normalize(worldSpacePoint.xyz() / worldSpacePoint.w - camera.position());
+
+    return raycast(camera.position(), direction, FpsCamera::zFar);
+}
+
+std::optional<ScenePicker::Result> ScenePicker::raycast(vec3 origin, vec3 direction, float maxDistance)
+{
+    // NOTE: The BVHs only call the intersect functions for candidates that could be closer than the closest hit so far, but they don't
+    // tell us which hit ends up being the closest, so we keep track of that here too.
+    std::optional<Result> closestResult {};
+
+    m_scene.meshBVH().raycast(origin, direction, maxDistance, [&](uint32_t meshIndex) -> std::optional<float> {
+        Mesh& mesh = m_scene.mesh(meshIndex);
+        const MeshTriangles& triangles = meshTriangles(mesh);
+
+        // Intersect in mesh-local space, where the ray is transformed but not normalized, so that distances along it stay the same
+        mat4 localFromWorld = inverse(mesh.transform().worldMatrix());
+        vec3 localOrigin = vec3(localFromWorld * vec4(origin, 1.0f));
+        vec3 localDirection = vec3(localFromWorld * vec4(direction, 0.0f));
+
+        std::optional<TriangleHit> closestTriangleHit {};
+        uint32_t closestTriangleIndex = 0;
+
+        triangles.bvh.raycast(localOrigin, localDirection, maxDistance, [&](uint32_t triangleIndex) -> std::optional<float> {
+            vec3 v0 = triangles.positions[triangles.indices[3 * triangleIndex + 0]];
+            vec3 v1 = triangles.positions[triangles.indices[3 * triangleIndex + 1]];
+            vec3 v2 = triangles.positions[triangles.indices[3 * triangleIndex + 2]];
+
+            auto hit = intersectTriangle(localOrigin, localDirection, v0, v1, v2);
+            if (!hit.has_value())
+                return {};
+
+            if (!closestTriangleHit.has_value() || hit->distance < closestTriangleHit->distance) {
+                closestTriangleHit = hit;
+                closestTriangleIndex = triangleIndex;
+            }
+
+            return hit->distance;
+        });
+
+        if (!closestTriangleHit.has_value())
+            return {};
+
+        if (!closestResult.has_value() || closestTriangleHit->distance < closestResult->distance) {
+            float u = closestTriangleHit->u;
+            float v = closestTriangleHit->v;
+            closestResult = Result { .mesh = &mesh,
+                                     .meshIndex = meshIndex,
+                                     .triangleIndex = closestTriangleIndex,
+                                     .barycentrics = vec3(1.0f - u - v, u, v),
+                                     .worldSpacePosition = origin + direction * closestTriangleHit->distance,
+                                     .distance = closestTriangleHit->distance };
+        }
+
+        return closestTriangleHit->distance;
+    });
+
+    return closestResult;
+}
+
+const ScenePicker::MeshTriangles& ScenePicker::meshTriangles(const Mesh& mesh)
+{
+    auto entry = m_meshTriangles.find(&mesh);
+    if (entry != m_meshTriangles.end())
+        return entry->second;
+
+    MeshTriangles triangles {};
+    triangles.positions = mesh.positionData();
+
+    if (mesh.isIndexed()) {
+        triangles.indices = mesh.indexData();
+    } else {
+        triangles.indices.resize(triangles.positions.size());
+        for (uint32_t i = 0; i < triangles.indices.size(); ++i)
+            triangles.indices[i] = i;
+    }
+
+    // (any trailing indices that don't make up a whole triangle are ignored)
+    size_t triangleCount = triangles.indices.size() / 3;
+
+    std::vector<moos::aabb3> triangleBounds {};
+    triangleBounds.reserve(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const vec3& v0 = triangles.positions[triangles.indices[3 * triangle + 0]];
+        const vec3& v1 = triangles.positions[triangles.indices[3 * triangle + 1]];
+        const vec3& v2 = triangles.positions[triangles.indices[3 * triangle + 2]];
+        triangleBounds.emplace_back(vec3(std::min({ v0.x, v1.x, v2.x }), std::min({ v0.y, v1.y, v2.y }), std::min({ v0.z, v1.z, v2.z })),
+                                    vec3(std::max({ v0.x, v1.x, v2.x }), std::max({ v0.y, v1.y, v2.y }), std::max({ v0.z, v1.z, v2.z })));
+    }
+
+    triangles.bvh.build(triangleBounds);
+
+    return m_meshTriangles.emplace(&mesh, std::move(triangles)).first->second;
+}
+
+std::optional<ScenePicker::TriangleHit> ScenePicker::intersectTriangle(vec3 origin, vec3 direction, vec3 v0, vec3 v1, vec3 v2)
+{
+    // Möller-Trumbore, which hits both front & back faces
+    vec3 edge1 = v1 - v0;
+    vec3 edge2 = v2 - v0;
+
+    vec3 p = cross(direction, edge2);
+    float determinant = dot(edge1, p);
+    // (the ray is parallel to the triangle)
+    if (determinant == 0.0f)
+        return {};
+    float inverseDeterminant = 1.0f / determinant;
+
+    vec3 s = origin - v0;
+    float u = dot(s, p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f)
+        return {};
+
+    vec3 q = cross(s, edge1);
+    float v = dot(direction, q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f)
+        return {};
+
+    float distance = dot(edge2, q) * inverseDeterminant;
+    if (distance < 0.0f)
+        return {};
+
+    return TriangleHit { distance, u, v };
+}
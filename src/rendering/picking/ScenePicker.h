@@ -0,0 +1,54 @@
+#pragma once
+
+#include "geometry/BVH.h"
+#include "utility/Extent.h"
+#include <moos/vector.h>
+#include <optional>
+#include <unordered_map>
+
+class Mesh;
+class Scene;
+
+//! Picks meshes by ray casting on the CPU: first against the scene's mesh BVH, and then against the triangles of each candidate mesh, using a
+//! triangle BVH per mesh. The triangle BVHs are built in mesh-local space from the position & index data on the first ray to reach the mesh,
+//! so after that a pick only touches a few nodes & triangles, with no GPU work involved.
+class ScenePicker {
+public:
+    explicit ScenePicker(Scene&);
+
+    struct Result {
+        Mesh* mesh;
+        uint32_t meshIndex;
+        uint32_t triangleIndex;
+        //! Weights of the three vertices of the triangle for the hit point
+        vec3 barycentrics;
+        vec3 worldSpacePosition;
+        float distance;
+    };
+
+    //! Cast a ray from the camera through the given pixel (with the origin in the top left corner of the viewport)
+    std::optional<Result> pick(vec2 pixelPosition, Extent2D viewportExtent);
+
+    //! The direction doesn't have to be normalized, in which case the max & hit distances are in units of its length
+    std::optional<Result> raycast(vec3 origin, vec3 direction, float maxDistance);
+
+private:
+    struct MeshTriangles {
+        std::vector<vec3> positions {};
+        // Three indices into the positions per triangle
+        std::vector<uint32_t> indices {};
+        geometry::BVH bvh {};
+    };
+
+    const MeshTriangles& meshTriangles(const Mesh&);
+
+    struct TriangleHit {
+        float distance;
+        float u;
+        float v;
+    };
+    static std::optional<TriangleHit> intersectTriangle(vec3 origin, vec3 direction, vec3 v0, vec3 v1, vec3 v2);
+
+    Scene& m_scene;
+    std::unordered_map<const Mesh*, MeshTriangles> m_meshTriangles {};
+};
@@ -0,0 +1,93 @@
+#include "DirectionalLight.h"
+
+#include "rendering/camera/FpsCamera.h"
+#include <algorithm>
+#include <cmath>
+
+std::vector<mat4> DirectionalLight::shadowCascadeViewProjections(const FpsCamera& camera) const
+{
+    int cascadeCount = std::clamp(shadowCascadeCount, 1, SHADOW_MAX_CASCADES);
+    float zNear = FpsCamera::zNear;
+    float zFar = std::max(shadowDistance, zNear + 0.01f);
+
+    // Rays through the corners of the camera frustum, scaled so that they are at (view-space) depth 1
+    mat4 viewFromProjection = inverse(camera.projectionMatrix());
+    vec3 cornerRays[4];
+    for (int corner = 0; corner < 4; ++corner) {
+        float ndcX = (corner & 1) ? 1.0f : -1.0f;
+        float ndcY = (corner & 2) ? 1.0f : -1.0f;
+        vec4 viewSpacePoint = viewFromProjection * vec4(ndcX, ndcY, 0.5f, 1.0f);
+        vec3 ray = viewSpacePoint.xyz() / viewSpacePoint.w;
+        cornerRays[corner] = ray / -ray.z;
+    }
+
+    mat4 worldFromView = inverse(camera.viewMatrix());
+
+    // The light space orientation, with an arbitrary origin since it's only used for snapping to shadow map texels
+    mat4 lightFromWorld = moos::lookAt(vec3(0.0f), normalize(direction));
+    mat4 worldFromLight = inverse(lightFromWorld);
+
+    Extent2D mapSize = shadowMapSize();
+    float mapResolution = static_cast<float>(std::min(mapSize.width(), mapSize.height()));
+
+    std::vector<mat4> viewProjections {};
+
+    float sliceNearDepth = zNear;
+    for (int cascade = 0; cascade < cascadeCount; ++cascade) {
+
+        float t = static_cast<float>(cascade + 1) / static_cast<float>(cascadeCount);
+        float logarithmicSplit = zNear * std::pow(zFar / zNear, t);
+        float uniformSplit = zNear + (zFar - zNear) * t;
+        float sliceFarDepth = shadowCascadeSplitLambda * logarithmicSplit + (1.0f - shadowCascadeSplitLambda) * uniformSplit;
+
+        // Fit a bounding sphere rather than a box to the slice, so that the size of the cascade doesn't change when the camera rotates
+        vec3 sliceCorners[8];
+        vec3 sliceCenter { 0.0f };
+        for (int corner = 0; corner < 4; ++corner) {
+            sliceCorners[2 * corner + 0] = cornerRays[corner] * sliceNearDepth;
+            sliceCorners[2 * corner + 1] = cornerRays[corner] * sliceFarDepth;
+            sliceCenter += sliceCorners[2 * corner + 0] + sliceCorners[2 * corner + 1];
+        }
+        sliceCenter /= 8.0f;
+
+        float radius = 0.0f;
+        for (const vec3& corner : sliceCorners)
+            radius = std::max(radius, length(corner - sliceCenter));
+
+        // (round up, so that floating point noise doesn't make the cascade change size from frame to frame)
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // Snap the center to a grid of whole shadow map texels in light space, so that the shadow edges don't shimmer when the camera moves.
+        // The grid step is a number of texels, and the cascade extent is padded by one step so that it always covers the whole slice, i.e.
+        // extent = radius + snapTexels * (2 * extent / mapResolution). With a coarse grid the cascade stays in place while the camera moves
+        // within a grid cell, which lets the shadow map node reuse the cached cascade instead of rendering it again.
+        float snapStep = std::clamp(shadowCascadeSnapStep, 0.0f, 1.0f);
+        float snapTexels = std::max(1.0f, std::floor(mapResolution * snapStep / (2.0f * (1.0f + snapStep))));
+        float extent = radius / (1.0f - 2.0f * snapTexels / mapResolution);
+        float snapSize = snapTexels * (2.0f * extent / mapResolution);
+
+        vec4 lightSpaceCenter = lightFromWorld * worldFromView * vec4(sliceCenter, 1.0f);
+        lightSpaceCenter.x = std::floor(lightSpaceCenter.x / snapSize) * snapSize;
+        lightSpaceCenter.y = std::floor(lightSpaceCenter.y / snapSize) * snapSize;
+        lightSpaceCenter.z = std::floor(lightSpaceCenter.z / snapSize) * snapSize;
+        vec3 worldSpaceCenter = vec3(worldFromLight * lightSpaceCenter);
+
+        mat4 lightOrientation = moos::lookAt(worldSpaceCenter, worldSpaceCenter + normalize(direction));
+
+        // Extend the depth range towards the light so that occluders outside of the slice can still cast shadows into it
+        float nearDepth = -(extent + shadowDistance);
+        float farDepth = extent;
+        float depthRange = farDepth - nearDepth;
+
+        // Orthographic projection to Vulkan clip space, i.e. with flipped y and depth in [0, 1] (like the moos projections)
+        mat4 lightProjection = mat4(vec4(1.0f / extent, 0.0f, 0.0f, 0.0f),
+                                    vec4(0.0f, -1.0f / extent, 0.0f, 0.0f),
+                                    vec4(0.0f, 0.0f, -1.0f / depthRange, 0.0f),
+                                    vec4(0.0f, 0.0f, -nearDepth / depthRange, 1.0f));
+
+        viewProjections.push_back(lightProjection * lightOrientation);
+        sliceNearDepth = sliceFarDepth;
+    }
+
+    return viewProjections;
+}
@@ -2,6 +2,12 @@
 
 #include "Light.h"
 #include <moos/transform.h>
+#include <vector>
+
+// Shared with shaders
+#include "LightData.h"
+
+class FpsCamera;
 
 class DirectionalLight : public Light {
 public:
@@ -10,17 +16,14 @@ public:
         : Light(color)
         , illuminance(illuminance)
         , direction(normalize(direction))
-        , shadowMapWorldOrigin(0, 0, 0)
-        , shadowMapWorldExtent(50.0f)
     {
     }
 
-    mat4 viewProjection() const final
-    {
-        mat4 lightOrientation = moos::lookAt(shadowMapWorldOrigin, shadowMapWorldOrigin + normalize(direction));
-        mat4 lightProjection = moos::orthographicProjectionToVulkanClipSpace(shadowMapWorldExtent, -shadowMapWorldExtent, shadowMapWorldExtent);
-        return lightProjection * lightOrientation;
-    }
+    // One layer per cascade, so that the number of cascades in use can be changed without reallocating the shadow map
+    uint32_t shadowMapLayerCount() const final { return SHADOW_MAX_CASCADES; }
+
+    //! Fit one shadow cascade to each slice of the camera frustum (up to the shadow distance), ordered from the nearest slice
+    std::vector<mat4> shadowCascadeViewProjections(const FpsCamera&) const;
 
     // Light illuminance (lux, lx = lm / m^2)
     // TODO: Actually use physically based units!
@@ -29,9 +32,15 @@ public:
     // Direction of outgoing light, i.e. -L in a BRDF
     vec3 direction { 1, 1, 1 };
 
-    // When rendering a shadow map, from what point in the world should it be rendered from
-    vec3 shadowMapWorldOrigin { 0, 0, 0 };
+    // Number of shadow cascades to render, at most SHADOW_MAX_CASCADES
+    int shadowCascadeCount { SHADOW_MAX_CASCADES };
+
+    // Distance from the camera at which the last shadow cascade ends
+    float shadowDistance { 50.0f };
+
+    // Blend between uniform (0) and logarithmic (1) cascade split distances, i.e. the "practical split scheme"
+    float shadowCascadeSplitLambda { 0.8f };
 
-    // When rendering a shadow map, how much of the scene around it should it cover (area, relative to direction)
-    float shadowMapWorldExtent { 50.0f };
+    // Cascades only move in steps of this fraction (at most 1) of their radius, at the cost of some resolution, so that they can be cached between frames
+    float shadowCascadeSnapStep { 0.1f };
 };
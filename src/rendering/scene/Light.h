@@ -16,9 +16,8 @@ public:
     // Linear sRGB color
     vec3 color { 1.0f };
 
-    virtual mat4 viewProjection() const = 0;
-
     Extent2D shadowMapSize() const { return m_shadowMapSize; }
+    virtual uint32_t shadowMapLayerCount() const { return 1; }
     void setShadowMapSize(Extent2D size);
 
     Texture& shadowMap();
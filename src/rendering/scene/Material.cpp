@@ -28,7 +28,7 @@ Texture* Material::baseColorTexture()
             m_baseColorTexture = baseColor.hasPath()
                 // FIXME: The comment below applied for glTF 2.0 materials only, so we should standardize it here!
                 // (the constant color/factor is already in linear sRGB so we don't want to make an sRGB texture for it)
-                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), baseColor.path, true)
+                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), baseColor.path, true, baseColorFactor)
                 : MaterialTextureCache::global({}).getPixelColorTexture(sceneRegistry(), baseColorFactor, false);
         }
     }
@@ -37,13 +37,16 @@ Texture* Material::baseColorTexture()
 
 Texture* Material::normalMapTexture()
 {
+    // (i.e., a normal pointing straight out of the surface in tangent space)
+    const vec4 flatNormalPlaceholder = vec4(0.5f, 0.5f, 1.0f, 1.0f);
+
     if (!m_normalMapTexture) {
         if (normalMap.hasImage()) {
             m_normalMapTexture = &sceneRegistry().createTextureFromImage(*normalMap.image, false, true);
         } else {
             m_normalMapTexture = normalMap.hasPath()
-                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), normalMap.path, false)
-                : MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), "assets/default-normal.png", false);
+                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), normalMap.path, false, flatNormalPlaceholder)
+                : MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), "assets/default-normal.png", false, flatNormalPlaceholder);
         }
     }
     return m_normalMapTexture;
@@ -56,7 +59,7 @@ Texture* Material::metallicRoughnessTexture()
             m_metallicRoughnessTexture = &sceneRegistry().createTextureFromImage(*metallicRoughness.image, false, true);
         } else {
             m_metallicRoughnessTexture = metallicRoughness.hasPath()
-                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), metallicRoughness.path, false)
+                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), metallicRoughness.path, false, { 0, 0, 0, 0 })
                 : MaterialTextureCache::global({}).getPixelColorTexture(sceneRegistry(), { 0, 0, 0, 0 }, true);
         }
     }
@@ -70,7 +73,7 @@ Texture* Material::emissiveTexture()
             m_emissiveTexture = &sceneRegistry().createTextureFromImage(*emissive.image, true, true);
         } else {
             m_emissiveTexture = emissive.hasPath()
-                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), emissive.path, true)
+                ? MaterialTextureCache::global({}).getLoadedTexture(sceneRegistry(), emissive.path, true, { 0, 0, 0, 0 })
                 : MaterialTextureCache::global({}).getPixelColorTexture(sceneRegistry(), { 0, 0, 0, 0 }, true);
         }
     }
@@ -85,13 +88,13 @@ MaterialTextureCache& MaterialTextureCache::global(Badge<Material>)
     return *s_globalCache;
 }
 
-Texture* MaterialTextureCache::getLoadedTexture(Registry& reg, const std::string& imagePath, bool sRGB)
+Texture* MaterialTextureCache::getLoadedTexture(Registry& reg, const std::string& imagePath, bool sRGB, vec4 placeholderColor)
 {
     auto entry = m_loadedTextures.find(imagePath);
     if (entry != m_loadedTextures.end())
         return entry->second;
 
-    Texture& texture = reg.loadTexture2D(imagePath, sRGB, true);
+    Texture& texture = reg.streamTexture2D(imagePath, sRGB, true, placeholderColor);
     m_loadedTextures[imagePath] = &texture;
 
     return &texture;
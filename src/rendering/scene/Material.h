@@ -52,7 +52,8 @@ public:
     MaterialTextureCache() = default;
     static MaterialTextureCache& global(Badge<Material>);
 
-    Texture* getLoadedTexture(Registry&, const std::string& name, bool sRGB);
+    //! Textures are loaded in the background, so the placeholder color is what they contain until loading is done
+    Texture* getLoadedTexture(Registry&, const std::string& name, bool sRGB, vec4 placeholderColor);
     Texture* getPixelColorTexture(Registry&, vec4 color, bool sRGB);
 
 private:
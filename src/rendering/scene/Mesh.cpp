@@ -13,23 +13,8 @@ Material& Mesh::material()
     return *m_material;
 }
 
-void Mesh::ensureVertexBuffer(const SemanticVertexLayout& layout)
+std::vector<std::byte> Mesh::packVertexData(const SemanticVertexLayout& layout) const
 {
-    // NOTE: Will create & cache the buffer (if it doesn't already exist)
-    vertexBuffer(layout);
-}
-
-const Buffer& Mesh::vertexBuffer(const SemanticVertexLayout& layout)
-{
-    auto entry = m_vertexBuffers.find(layout);
-    if (entry != m_vertexBuffers.end())
-        return *entry->second;
-
-    if (!model())
-        LogErrorAndExit("Mesh: can't request vertex buffer for mesh that is not part of a model, exiting\n");
-    if (!model()->scene())
-        LogErrorAndExit("Mesh: can't request vertex buffer for mesh that is not part of a scene, exiting\n");
-
     size_t vertexCount = 0u;
     for (auto& component : layout.components()) {
         switch (component) {
@@ -51,8 +36,8 @@ const Buffer& Mesh::vertexBuffer(const SemanticVertexLayout& layout)
     size_t packedVertexSize = layout.packedVertexSize();
     size_t bufferSize = vertexCount * packedVertexSize;
 
-    auto* data = (moos::u8*)malloc(bufferSize);
-    ASSERT(data);
+    std::vector<std::byte> packedData(bufferSize);
+    auto* data = reinterpret_cast<moos::u8*>(packedData.data());
 
     // FIXME: This only really works for float components. Later we need a way of doing this for other types as well,
     //  but right now we only have floating point components anyway.
@@ -97,8 +82,37 @@ const Buffer& Mesh::vertexBuffer(const SemanticVertexLayout& layout)
         }
     }
 
+    return packedData;
+}
+
+void Mesh::ensureVertexBuffer(const SemanticVertexLayout& layout)
+{
+    // NOTE: Will create & cache the buffer (if it doesn't already exist)
+    vertexBuffer(layout);
+}
+
+const Buffer& Mesh::vertexBuffer(const SemanticVertexLayout& layout)
+{
+    auto entry = m_vertexBuffers.find(layout);
+    if (entry != m_vertexBuffers.end())
+        return *entry->second;
+
+    if (!model())
+        LogErrorAndExit("Mesh: can't request vertex buffer for mesh that is not part of a model, exiting\n");
+    if (!model()->scene())
+        LogErrorAndExit("Mesh: can't request vertex buffer for mesh that is not part of a scene, exiting\n");
+
     Registry& sceneRegistry = model()->scene()->registry();
-    Buffer& vertexBuffer = sceneRegistry.createBuffer((std::byte*)data, bufferSize, Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
+
+    std::span<const std::byte> packedData = packedVertexData(layout);
+    if (!packedData.empty()) {
+        Buffer& vertexBuffer = sceneRegistry.createBuffer(packedData.data(), packedData.size(), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
+        m_vertexBuffers[layout] = &vertexBuffer;
+        return vertexBuffer;
+    }
+
+    std::vector<std::byte> data = packVertexData(layout);
+    Buffer& vertexBuffer = sceneRegistry.createBuffer(data.data(), data.size(), Buffer::Usage::Vertex, Buffer::MemoryHint::GpuOptimal);
 
     m_vertexBuffers[layout] = &vertexBuffer;
     return vertexBuffer;
@@ -121,6 +135,13 @@ const Buffer& Mesh::indexBuffer()
         LogErrorAndExit("Mesh: can't request index buffer for mesh/model that is not part of a scene, exiting\n");
 
     Registry& sceneRegistry = model()->scene()->registry();
+
+    std::span<const std::byte> packedData = packedIndexData();
+    if (!packedData.empty()) {
+        m_indexBuffer = &sceneRegistry.createBuffer(packedData.data(), packedData.size(), Buffer::Usage::Index, Buffer::MemoryHint::GpuOptimal);
+        return *m_indexBuffer;
+    }
+
     m_indexBuffer = &sceneRegistry.createBuffer(indexData(), Buffer::Usage::Index, Buffer::MemoryHint::GpuOptimal);
     return *m_indexBuffer;
 }
@@ -7,6 +7,7 @@
 #include "rendering/scene/Vertex.h"
 #include <moos/aabb.h>
 #include <moos/vector.h>
+#include <span>
 #include <unordered_map>
 
 class Model;
@@ -25,10 +26,14 @@ public:
 
     Material& material();
     virtual const Transform& transform() const { return m_transform; }
+    Transform& transform() { return m_transform; }
 
     virtual moos::aabb3 boundingBox() const = 0;
     virtual geometry::Sphere boundingSphere() const = 0;
 
+    //! Interleave the vertex data of this mesh as specified by the layout, ready for uploading to the GPU
+    std::vector<std::byte> packVertexData(const SemanticVertexLayout&) const;
+
     void ensureVertexBuffer(const SemanticVertexLayout&);
     const Buffer& vertexBuffer(const SemanticVertexLayout&);
 
@@ -45,6 +50,10 @@ public:
     virtual size_t indexCount() const = 0;
     virtual bool isIndexed() const = 0;
 
+    //! Meshes that already have their data packed for the GPU (e.g. baked meshes) can return it here, so it can be uploaded as-is
+    virtual std::span<const std::byte> packedVertexData(const SemanticVertexLayout&) const { return {}; }
+    virtual std::span<const std::byte> packedIndexData() const { return {}; }
+
 protected:
     // CPU data cache
     mutable std::optional<std::vector<vec3>> m_positionData;
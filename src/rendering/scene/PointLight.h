@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Light.h"
+
+class PointLight : public Light {
+public:
+    PointLight() = default;
+    PointLight(vec3 color, float intensity, vec3 position, float range)
+        : Light(color)
+        , intensity(intensity)
+        , position(position)
+        , range(range)
+    {
+    }
+
+    // Luminous intensity (candela, cd = lm / sr)
+    float intensity { 1.0f };
+
+    vec3 position { 0, 0, 0 };
+
+    // Distance at which the light has faded out completely, i.e. it has no effect on anything further away
+    float range { 10.0f };
+};
@@ -1,9 +1,13 @@
 #include "Scene.h"
 
 #include "rendering/Registry.h"
+#include "rendering/scene/models/BakedModel.h"
 #include "rendering/scene/models/GltfModel.h"
 #include "utility/FileIO.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <imgui.h>
 #include <moos/transform.h>
@@ -16,6 +20,7 @@ Scene::Scene(Registry& registry)
 
 void Scene::loadFromFile(const std::string& path)
 {
+    SCOPED_PROFILE_ZONE("Load scene");
     using json = nlohmann::json;
 
     if (!FileIO::isFileReadable(path))
@@ -45,7 +50,7 @@ void Scene::loadFromFile(const std::string& path)
     for (auto& jsonModel : jsonScene.at("models")) {
         std::string modelGltf = jsonModel.at("gltf");
 
-        auto model = GltfModel::load(modelGltf);
+        auto model = BakedModel::loadGltfUsingCache(modelGltf);
         if (!model)
             continue;
 
@@ -91,8 +96,8 @@ void Scene::loadFromFile(const std::string& path)
 
             DirectionalLight light { color, illuminance, direction };
 
-            light.shadowMapWorldOrigin = { 0, 0, 0 };
-            light.shadowMapWorldExtent = jsonLight.at("worldExtent");
+            light.shadowDistance = jsonLight.at("shadowDistance");
+            light.shadowCascadeCount = std::clamp(jsonLight.at("shadowCascadeCount").get<int>(), 1, SHADOW_MAX_CASCADES);
 
             int mapSize[2];
             jsonLight.at("shadowMapSize").get_to(mapSize);
@@ -103,6 +108,27 @@ void Scene::loadFromFile(const std::string& path)
             // TODO!
             m_directionalLights.push_back(light);
 
+        } else if (type == "point") {
+
+            vec3 color = readVec3(jsonLight.at("color"));
+            float intensity = jsonLight.at("intensity");
+            vec3 position = readVec3(jsonLight.at("position"));
+            float range = jsonLight.at("range");
+
+            addLight(PointLight { color, intensity, position, range });
+
+        } else if (type == "spot") {
+
+            vec3 color = readVec3(jsonLight.at("color"));
+            float intensity = jsonLight.at("intensity");
+            vec3 position = readVec3(jsonLight.at("position"));
+            vec3 direction = readVec3(jsonLight.at("direction"));
+            float range = jsonLight.at("range");
+            float innerConeAngle = moos::toRadians(jsonLight.at("innerConeAngle").get<float>());
+            float outerConeAngle = moos::toRadians(jsonLight.at("outerConeAngle").get<float>());
+
+            addLight(SpotLight { color, intensity, position, direction, range, innerConeAngle, outerConeAngle });
+
         } else if (type == "ambient") {
 
             float illuminance = jsonLight.at("illuminance");
@@ -184,10 +210,84 @@ Model& Scene::addModel(std::unique_ptr<Model> model)
 {
     ASSERT(model);
     model->setScene({}, this);
+
+    // (the model transform first, as it's the parent of all of the mesh transforms)
+    model->transform().addToHierarchy(m_transformHierarchy);
+    model->forEachMesh([&](Mesh& mesh) {
+        mesh.transform().addToHierarchy(m_transformHierarchy);
+
+        m_meshIndexOfTransform.resize(m_transformHierarchy.size(), NoMesh);
+        m_meshIndexOfTransform[mesh.transform().hierarchyIndex()] = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.push_back(&mesh);
+    });
+
+    // (also for the transforms after the last mesh, e.g. if the model has no meshes)
+    m_meshIndexOfTransform.resize(m_transformHierarchy.size(), NoMesh);
+    m_meshBVHNeedsRebuild = true;
+
     m_models.push_back(std::move(model));
     return *m_models.back().get();
 }
 
+void Scene::updateTransforms()
+{
+    m_transformHierarchy.update();
+
+    auto worldSpaceBoundingBox = [](const Mesh& mesh) -> moos::aabb3 {
+        // Transform the box as its center & half-extents, where the extents along each world axis are then the sum of the absolute
+        // contributions from each local axis, which gives the tightest box around the transformed box
+        moos::aabb3 box = mesh.boundingBox();
+        mat4 M = mesh.transform().worldMatrix();
+        vec3 center = vec3(M * vec4((box.min + box.max) / 2.0f, 1.0f));
+        vec3 halfExtent = (box.max - box.min) / 2.0f;
+        vec3 worldHalfExtent = vec3(std::abs(M.x.x) * halfExtent.x + std::abs(M.y.x) * halfExtent.y + std::abs(M.z.x) * halfExtent.z,
+                                    std::abs(M.x.y) * halfExtent.x + std::abs(M.y.y) * halfExtent.y + std::abs(M.z.y) * halfExtent.z,
+                                    std::abs(M.x.z) * halfExtent.x + std::abs(M.y.z) * halfExtent.y + std::abs(M.z.z) * halfExtent.z);
+        return moos::aabb3(center - worldHalfExtent, center + worldHalfExtent);
+    };
+
+    // A refit keeps the tree structure, which gets worse the more the meshes move around, so rebuild it when it's gotten much larger
+    constexpr float maxMeshBVHDegradation = 2.0f;
+
+    if (m_meshBVHNeedsRebuild || m_meshBVH.refitDegradation() > maxMeshBVHDegradation) {
+        std::vector<moos::aabb3> meshBounds {};
+        meshBounds.reserve(m_meshes.size());
+        for (const Mesh* mesh : m_meshes)
+            meshBounds.push_back(worldSpaceBoundingBox(*mesh));
+
+        m_meshBVH.build(meshBounds);
+        m_meshBVHNeedsRebuild = false;
+        return;
+    }
+
+    std::vector<uint32_t> movedMeshIndices {};
+    std::vector<moos::aabb3> movedMeshBounds {};
+    for (TransformHierarchy::Index transformIndex : m_transformHierarchy.lastUpdatedIndices()) {
+        uint32_t meshIndex = m_meshIndexOfTransform[transformIndex];
+        if (meshIndex != NoMesh) {
+            movedMeshIndices.push_back(meshIndex);
+            movedMeshBounds.push_back(worldSpaceBoundingBox(*m_meshes[meshIndex]));
+        }
+    }
+
+    if (!movedMeshIndices.empty())
+        m_meshBVH.refit(movedMeshIndices, movedMeshBounds);
+}
+
+PointLight& Scene::addLight(PointLight light)
+{
+    light.setScene({}, this);
+    m_pointLights.push_back(light);
+    return m_pointLights.back();
+}
+
+SpotLight& Scene::addLight(SpotLight light)
+{
+    light.setScene({}, this);
+    m_spotLights.push_back(light);
+    return m_spotLights.back();
+}
+
 size_t Scene::meshCount() const
 {
     size_t count = 0u;
@@ -288,5 +388,5 @@ std::unique_ptr<Model> Scene::loadProxy(const std::string& path)
     }
 
     // Else, assume it's a gltf and simply fail if it isn't..
-    return GltfModel::load(path);
+    return BakedModel::loadGltfUsingCache(path);
 }
@@ -2,6 +2,9 @@
 
 #include "DirectionalLight.h"
 #include "Model.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "geometry/BVH.h"
 #include "rendering/camera/FpsCamera.h"
 #include "rendering/scene/ProbeGrid.h"
 #include <memory>
@@ -24,6 +27,10 @@ public:
 
     Model& addModel(std::unique_ptr<Model>);
 
+    //! Compute the world & normal matrices of all model & mesh transforms that changed since the last update, and refit (or rebuild) the
+    //! mesh BVH to match. Called once per frame before rendering, so that all render graph nodes can then read the cached matrices.
+    void updateTransforms();
+
     size_t modelCount() const { return m_models.size(); }
     size_t meshCount() const;
 
@@ -33,6 +40,13 @@ public:
     int forEachMesh(std::function<void(size_t, const Mesh&)> callback) const;
     int forEachMesh(std::function<void(size_t, Mesh&)> callback);
 
+    //! The mesh with the given index, as passed to the forEachMesh callbacks
+    const Mesh& mesh(size_t index) const { return *m_meshes[index]; }
+    Mesh& mesh(size_t index) { return *m_meshes[index]; }
+
+    //! Spatial index over the world-space bounding boxes of all meshes, as of the last transform update. Object indices are mesh indices.
+    const geometry::BVH& meshBVH() const { return m_meshBVH; }
+
     void setSelectedModel(Model* model) { m_selectedModel = model; }
     Model* selectedModel() { return m_selectedModel; }
 
@@ -46,6 +60,17 @@ public:
     const DirectionalLight& sun() const { return m_directionalLights[0]; }
     DirectionalLight& sun() { return m_directionalLights[0]; }
 
+    PointLight& addLight(PointLight);
+    SpotLight& addLight(SpotLight);
+
+    const std::vector<PointLight>& pointLights() const { return m_pointLights; }
+    std::vector<PointLight>& pointLights() { return m_pointLights; }
+    const std::vector<SpotLight>& spotLights() const { return m_spotLights; }
+    std::vector<SpotLight>& spotLights() { return m_spotLights; }
+
+    //! Number of lights with a limited range, i.e. point & spot lights
+    size_t localLightCount() const { return m_pointLights.size() + m_spotLights.size(); }
+
     bool hasProbeGrid() { return m_probeGrid.has_value(); }
     void setProbeGrid(ProbeGrid probeGrid) { m_probeGrid = probeGrid; }
     ProbeGrid& probeGrid() { return m_probeGrid.value(); }
@@ -67,9 +92,21 @@ private:
 
     Registry& m_registry;
 
+    // (declared before the models, as their transforms reference it)
+    TransformHierarchy m_transformHierarchy {};
     std::vector<std::unique_ptr<Model>> m_models;
 
+    // All meshes of all models, in mesh index order, and the mesh index (if any) for each transform in the hierarchy
+    static constexpr uint32_t NoMesh = UINT32_MAX;
+    std::vector<Mesh*> m_meshes {};
+    std::vector<uint32_t> m_meshIndexOfTransform {};
+
+    geometry::BVH m_meshBVH {};
+    bool m_meshBVHNeedsRebuild { false };
+
     std::vector<DirectionalLight> m_directionalLights;
+    std::vector<PointLight> m_pointLights;
+    std::vector<SpotLight> m_spotLights;
 
     std::optional<ProbeGrid> m_probeGrid;
 
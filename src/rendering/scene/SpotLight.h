@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Light.h"
+#include <moos/transform.h>
+
+class SpotLight : public Light {
+public:
+    SpotLight() = default;
+    SpotLight(vec3 color, float intensity, vec3 position, vec3 direction, float range, float innerConeAngle, float outerConeAngle)
+        : Light(color)
+        , intensity(intensity)
+        , position(position)
+        , direction(normalize(direction))
+        , range(range)
+        , innerConeAngle(innerConeAngle)
+        , outerConeAngle(outerConeAngle)
+    {
+    }
+
+    mat4 viewProjection() const
+    {
+        mat4 lightOrientation = moos::lookAt(position, position + normalize(direction));
+        mat4 lightProjection = moos::perspectiveProjectionToVulkanClipSpace(2.0f * outerConeAngle, 1.0f, 0.05f, range);
+        return lightProjection * lightOrientation;
+    }
+
+    // Luminous intensity (candela, cd = lm / sr) along the center of the cone
+    float intensity { 1.0f };
+
+    vec3 position { 0, 0, 0 };
+
+    // Direction of outgoing light, i.e. along the center of the cone
+    vec3 direction { 0, -1, 0 };
+
+    // Distance at which the light has faded out completely, i.e. it has no effect on anything further away
+    float range { 10.0f };
+
+    // Half-angles (radians) of the cone, where the light is at full intensity within the inner cone and fades out towards the outer
+    float innerConeAngle { moos::toRadians(20.0f) };
+    float outerConeAngle { moos::toRadians(30.0f) };
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "rendering/scene/TransformHierarchy.h"
+#include "utility/util.h"
 #include <moos/matrix.h>
 #include <moos/vector.h>
 
@@ -11,8 +13,29 @@ public:
     {
     }
 
+    //! Add the transform to the hierarchy, so that its world & normal matrices are cached there. The parent (if any) must already be
+    //! part of the same hierarchy. While the hierarchy has changes that are not yet updated, the matrices are computed on demand instead.
+    void addToHierarchy(TransformHierarchy& hierarchy)
+    {
+        ASSERT(m_hierarchy == nullptr);
+
+        TransformHierarchy::Index parentIndex = TransformHierarchy::NoParent;
+        if (m_parent) {
+            ASSERT(m_parent->m_hierarchy == &hierarchy);
+            parentIndex = m_parent->m_hierarchyIndex;
+        }
+
+        m_hierarchyIndex = hierarchy.add(m_localMatrix, parentIndex);
+        m_hierarchy = &hierarchy;
+    }
+
+    //! The index of the transform in its hierarchy, if it has been added to one
+    TransformHierarchy::Index hierarchyIndex() const { return m_hierarchyIndex; }
+
     void setLocalMatrix(mat4 matrix)
     {
+        if (m_hierarchy)
+            m_hierarchy->setLocalMatrix(m_hierarchyIndex, matrix);
         m_localMatrix = matrix;
     }
 
@@ -23,6 +46,9 @@ public:
 
     mat4 worldMatrix() const
     {
+        if (m_hierarchy && !m_hierarchy->hasPendingChanges()) {
+            return m_hierarchy->worldMatrix(m_hierarchyIndex);
+        }
         if (!m_parent) {
             return m_localMatrix;
         }
@@ -31,6 +57,9 @@ public:
 
     mat3 worldNormalMatrix() const
     {
+        if (m_hierarchy && !m_hierarchy->hasPendingChanges()) {
+            return m_hierarchy->worldNormalMatrix(m_hierarchyIndex);
+        }
         mat3 world3x3 = mat3(worldMatrix());
         mat3 normalMatrix = transpose(inverse(world3x3));
         return normalMatrix;
@@ -52,4 +81,7 @@ private:
     //vec3 m_scale { 1.0 };
     const Transform* m_parent {};
     mutable mat4 m_localMatrix { 1.0f };
+
+    TransformHierarchy* m_hierarchy { nullptr };
+    TransformHierarchy::Index m_hierarchyIndex { TransformHierarchy::NoParent };
 };
@@ -0,0 +1,58 @@
+#include "TransformHierarchy.h"
+
+#include "utility/util.h"
+#include <algorithm>
+
+TransformHierarchy::Index TransformHierarchy::add(mat4 localMatrix, Index parent)
+{
+    Index index = static_cast<Index>(size());
+    ASSERT(parent == NoParent || parent < index);
+
+    m_parents.push_back(parent);
+    m_localMatrices.push_back(localMatrix);
+    m_worldMatrices.emplace_back(1.0f);
+    m_worldNormalMatrices.emplace_back(1.0f);
+
+    m_dirty.push_back(1);
+    m_anyDirty = true;
+
+    return index;
+}
+
+void TransformHierarchy::setLocalMatrix(Index index, mat4 localMatrix)
+{
+    m_localMatrices[index] = localMatrix;
+    m_dirty[index] = 1;
+    m_anyDirty = true;
+}
+
+void TransformHierarchy::update()
+{
+    m_lastUpdatedIndices.clear();
+
+    if (!m_anyDirty)
+        return;
+
+    for (Index index = 0; index < size(); ++index) {
+        Index parent = m_parents[index];
+
+        // Since parents come before their children, the parent is already updated & its dirty flag is final at this point
+        if (parent != NoParent && m_dirty[parent])
+            m_dirty[index] = 1;
+
+        if (!m_dirty[index])
+            continue;
+
+        m_worldMatrices[index] = (parent != NoParent)
+            ? m_worldMatrices[parent] * m_localMatrices[index]
+            : m_localMatrices[index];
+
+        mat3 world3x3 = mat3(m_worldMatrices[index]);
+        m_worldNormalMatrices[index] = transpose(inverse(world3x3));
+
+        m_lastUpdatedIndices.push_back(index);
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), uint8_t(0));
+    m_anyDirty = false;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <moos/matrix.h>
+#include <vector>
+
+//! Flat storage for all transforms of a scene, as separate arrays per attribute, where parents always come before their children.
+//! World & normal matrices are cached, and computed by update() in a single pass over the arrays, but only for the transforms which
+//! changed since the last update (and their descendants). All reads in between updates are then just array lookups.
+class TransformHierarchy {
+public:
+    using Index = uint32_t;
+    static constexpr Index NoParent = UINT32_MAX;
+
+    TransformHierarchy() = default;
+    ~TransformHierarchy() = default;
+
+    TransformHierarchy(TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(TransformHierarchy&) = delete;
+
+    //! The parent must already be in the hierarchy, which ensures that parents always come before their children
+    Index add(mat4 localMatrix, Index parent = NoParent);
+
+    size_t size() const { return m_localMatrices.size(); }
+
+    mat4 localMatrix(Index index) const { return m_localMatrices[index]; }
+    void setLocalMatrix(Index, mat4);
+
+    //! The world & normal matrices as of the last update
+    const mat4& worldMatrix(Index index) const { return m_worldMatrices[index]; }
+    const mat3& worldNormalMatrix(Index index) const { return m_worldNormalMatrices[index]; }
+
+    //! Compute the world & normal matrices of all transforms which changed since the last update, and of all of their descendants
+    void update();
+    bool hasPendingChanges() const { return m_anyDirty; }
+
+    //! The transforms whose world matrices were computed in the last update, in increasing order
+    const std::vector<Index>& lastUpdatedIndices() const { return m_lastUpdatedIndices; }
+
+private:
+    std::vector<Index> m_parents {};
+    std::vector<mat4> m_localMatrices {};
+    std::vector<mat4> m_worldMatrices {};
+    std::vector<mat3> m_worldNormalMatrices {};
+
+    // (not std::vector<bool>, as we don't want the bit packing in the update loop)
+    std::vector<uint8_t> m_dirty {};
+    bool m_anyDirty { false };
+
+    std::vector<Index> m_lastUpdatedIndices {};
+};
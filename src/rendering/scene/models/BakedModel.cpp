@@ -0,0 +1,501 @@
+#include "BakedModel.h"
+
+#include "rendering/scene/models/GltfModel.h"
+#include "utility/FileIO.h"
+#include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+// NOTE: The baked file is a header followed by one record per mesh, followed by all the data the records point into. It's
+//  written in native byte order and struct layout since it's only a local cache of the source file, never something to share.
+
+struct BakedRange {
+    uint64_t offset;
+    uint64_t size;
+};
+
+//! Another file that the source file references (e.g. an external buffer or image), which the baked file is also stale relative to
+struct BakedDependency {
+    BakedRange path;
+    uint64_t fileSize;
+    int64_t fileTimestamp;
+};
+
+struct BakedFileHeader {
+    static constexpr uint32_t expectedMagic = 0x4c444d42; // "BMDL"
+    static constexpr uint32_t currentVersion = 2;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t padding;
+
+    // For knowing if the baked file is stale
+    uint64_t sourceFileSize;
+    int64_t sourceFileTimestamp;
+    BakedRange dependencies; // (an array of BakedDependency)
+};
+
+enum BakedStream : uint32_t {
+    BakedStreamPosition,
+    BakedStreamTexCoord,
+    BakedStreamNormal,
+    BakedStreamTangent,
+    BakedStreamInterleaved,
+    BakedStreamCount,
+};
+
+struct BakedMeshRecord {
+    float localMatrix[16];
+    float aabbMin[3];
+    float aabbMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+
+    float baseColorFactor[4];
+    BakedRange baseColor;
+    BakedRange normalMap;
+    BakedRange metallicRoughness;
+    BakedRange emissive;
+
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize; // (0 for non-indexed meshes)
+    uint32_t padding;
+
+    BakedRange indices;
+    BakedRange streams[BakedStreamCount];
+};
+
+//! The layouts we store pre-interleaved, i.e. the ones the render graph nodes actually ask for
+static const SemanticVertexLayout s_positionOnlyLayout { VertexComponent::Position3F };
+static const SemanticVertexLayout s_interleavedLayout { VertexComponent::Position3F,
+                                                        VertexComponent::TexCoord2F,
+                                                        VertexComponent::Normal3F,
+                                                        VertexComponent::Tangent4F };
+
+static std::optional<std::pair<uint64_t, int64_t>> sourceFileStamp(const std::string& sourcePath)
+{
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return {};
+    auto lastWriteTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+        return {};
+    return std::make_pair(fileSize, static_cast<int64_t>(lastWriteTime.time_since_epoch().count()));
+}
+
+static bool isRangeInFile(const MappedFile& file, const BakedRange& range)
+{
+    return range.offset <= file.size() && range.size <= file.size() - range.offset;
+}
+
+static std::span<const BakedDependency> bakedDependencies(const MappedFile& file, const BakedFileHeader& header)
+{
+    auto* dependencies = reinterpret_cast<const BakedDependency*>(file.data() + header.dependencies.offset);
+    return { dependencies, header.dependencies.size / sizeof(BakedDependency) };
+}
+
+static const BakedFileHeader* validatedHeader(const MappedFile& file)
+{
+    if (file.size() < sizeof(BakedFileHeader))
+        return nullptr;
+
+    auto* header = reinterpret_cast<const BakedFileHeader*>(file.data());
+    if (header->magic != BakedFileHeader::expectedMagic || header->version != BakedFileHeader::currentVersion)
+        return nullptr;
+    if (sizeof(BakedFileHeader) + header->meshCount * sizeof(BakedMeshRecord) > file.size())
+        return nullptr;
+
+    // Everything the file points into must be within it too. MappedFile only asserts on this, and a truncated or corrupt file would otherwise
+    // be read out of bounds, so instead such a file is rejected (and then simply baked again).
+    if (!isRangeInFile(file, header->dependencies) || header->dependencies.offset % alignof(BakedDependency) != 0 || header->dependencies.size % sizeof(BakedDependency) != 0)
+        return nullptr;
+    for (const BakedDependency& dependency : bakedDependencies(file, *header)) {
+        if (!isRangeInFile(file, dependency.path))
+            return nullptr;
+    }
+
+    auto* records = reinterpret_cast<const BakedMeshRecord*>(file.data() + sizeof(BakedFileHeader));
+    for (uint32_t meshIdx = 0; meshIdx < header->meshCount; ++meshIdx) {
+        const BakedMeshRecord& record = records[meshIdx];
+
+        for (const BakedRange* range : { &record.baseColor, &record.normalMap, &record.metallicRoughness, &record.emissive, &record.indices }) {
+            if (!isRangeInFile(file, *range))
+                return nullptr;
+        }
+        for (const BakedRange& range : record.streams) {
+            if (!isRangeInFile(file, range))
+                return nullptr;
+        }
+
+        // (the index & vertex data is uploaded as is, so its sizes must also match the counts that are drawn with)
+        if (record.indexSize != 0 && record.indexSize != sizeof(uint16_t) && record.indexSize != sizeof(uint32_t))
+            return nullptr;
+        if (uint64_t(record.indexCount) * record.indexSize != record.indices.size)
+            return nullptr;
+        if (uint64_t(record.vertexCount) * s_interleavedLayout.packedVertexSize() != record.streams[BakedStreamInterleaved].size)
+            return nullptr;
+    }
+
+    return header;
+}
+
+//! If the baked file was baked from the current versions of the source file and all the files it references
+static bool isUpToDate(const MappedFile& file, const BakedFileHeader& header, std::pair<uint64_t, int64_t> sourceStamp)
+{
+    if (header.sourceFileSize != sourceStamp.first || header.sourceFileTimestamp != sourceStamp.second)
+        return false;
+
+    for (const BakedDependency& dependency : bakedDependencies(file, header)) {
+        std::span<const std::byte> pathBytes = file.range(dependency.path.offset, dependency.path.size);
+        std::string path { reinterpret_cast<const char*>(pathBytes.data()), pathBytes.size() };
+
+        auto dependencyStamp = sourceFileStamp(path);
+        if (!dependencyStamp.has_value() || dependencyStamp->first != dependency.fileSize || dependencyStamp->second != dependency.fileTimestamp)
+            return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<Model> BakedModel::load(const std::string& bakedPath)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::open(bakedPath);
+    if (!file || !validatedHeader(*file)) {
+        LogError("Could not load baked model file at path '%s'\n", bakedPath.c_str());
+        return nullptr;
+    }
+
+    return std::make_unique<BakedModel>(std::move(file));
+}
+
+std::unique_ptr<Model> BakedModel::loadGltfUsingCache(const std::string& gltfPath)
+{
+    SCOPED_PROFILE_ZONE("Load model");
+
+    std::string bakedPath = gltfPath + ".baked";
+    auto sourceStamp = sourceFileStamp(gltfPath);
+
+    if (sourceStamp.has_value()) {
+        std::unique_ptr<MappedFile> file = MappedFile::open(bakedPath);
+        const BakedFileHeader* header = file ? validatedHeader(*file) : nullptr;
+        if (header && isUpToDate(*file, *header, sourceStamp.value()))
+            return std::make_unique<BakedModel>(std::move(file));
+    }
+
+    std::unique_ptr<Model> gltfModel = GltfModel::load(gltfPath);
+    if (!gltfModel)
+        return nullptr;
+
+    std::vector<std::string> dependencyPaths = static_cast<GltfModel&>(*gltfModel).externalFilePaths();
+    if (bake(*gltfModel, gltfPath, bakedPath, dependencyPaths)) {
+        LogInfo("Baked model '%s' to '%s'\n", gltfPath.c_str(), bakedPath.c_str());
+        if (auto bakedModel = load(bakedPath))
+            return bakedModel;
+    }
+
+    return gltfModel;
+}
+
+bool BakedModel::bake(Model& source, const std::string& sourcePath, const std::string& bakedPath, const std::vector<std::string>& dependencyPaths)
+{
+    auto sourceStamp = sourceFileStamp(sourcePath);
+    if (!sourceStamp.has_value())
+        return false;
+
+    std::vector<BakedMeshRecord> records {};
+    FileIO::BinaryData fileData(sizeof(BakedFileHeader) + source.meshCount() * sizeof(BakedMeshRecord));
+
+    auto appendData = [&](const void* data, size_t size) -> BakedRange {
+        constexpr size_t alignment = 16;
+        size_t offset = (fileData.size() + alignment - 1) & ~(alignment - 1);
+        fileData.resize(offset + size);
+        if (size > 0)
+            std::memcpy(fileData.data() + offset, data, size);
+        return { offset, size };
+    };
+
+    bool canBake = true;
+    source.forEachMesh([&](Mesh& mesh) {
+        Material& material = mesh.material();
+        for (const Material::PathOrImage* pathOrImage : { &material.baseColor, &material.normalMap, &material.metallicRoughness, &material.emissive }) {
+            // We only store references to material textures, so textures embedded in the source file can't be baked
+            if (pathOrImage->hasImage())
+                canBake = false;
+        }
+        if (!canBake)
+            return;
+
+        BakedMeshRecord& record = records.emplace_back();
+
+        mat4 localMatrix = mesh.transform().localMatrix();
+        static_assert(sizeof(mat4) == sizeof(record.localMatrix));
+        std::memcpy(record.localMatrix, &localMatrix, sizeof(record.localMatrix));
+
+        const std::vector<vec3>& positions = mesh.positionData();
+        vec3 aabbMin = positions.empty() ? vec3(0.0f) : positions.front();
+        vec3 aabbMax = aabbMin;
+        for (const vec3& position : positions) {
+            aabbMin = vec3(std::min(aabbMin.x, position.x), std::min(aabbMin.y, position.y), std::min(aabbMin.z, position.z));
+            aabbMax = vec3(std::max(aabbMax.x, position.x), std::max(aabbMax.y, position.y), std::max(aabbMax.z, position.z));
+        }
+        record.aabbMin[0] = aabbMin.x;
+        record.aabbMin[1] = aabbMin.y;
+        record.aabbMin[2] = aabbMin.z;
+        record.aabbMax[0] = aabbMax.x;
+        record.aabbMax[1] = aabbMax.y;
+        record.aabbMax[2] = aabbMax.z;
+
+        geometry::Sphere sphere = mesh.boundingSphere();
+        record.sphereCenter[0] = sphere.center().x;
+        record.sphereCenter[1] = sphere.center().y;
+        record.sphereCenter[2] = sphere.center().z;
+        record.sphereRadius = sphere.radius();
+
+        record.baseColorFactor[0] = material.baseColorFactor.x;
+        record.baseColorFactor[1] = material.baseColorFactor.y;
+        record.baseColorFactor[2] = material.baseColorFactor.z;
+        record.baseColorFactor[3] = material.baseColorFactor.w;
+        record.baseColor = appendData(material.baseColor.path.data(), material.baseColor.path.size());
+        record.normalMap = appendData(material.normalMap.path.data(), material.normalMap.path.size());
+        record.metallicRoughness = appendData(material.metallicRoughness.path.data(), material.metallicRoughness.path.size());
+        record.emissive = appendData(material.emissive.path.data(), material.emissive.path.size());
+
+        record.streams[BakedStreamPosition] = appendData(positions.data(), positions.size() * sizeof(vec3));
+        record.streams[BakedStreamTexCoord] = appendData(mesh.texcoordData().data(), mesh.texcoordData().size() * sizeof(vec2));
+        record.streams[BakedStreamNormal] = appendData(mesh.normalData().data(), mesh.normalData().size() * sizeof(vec3));
+        record.streams[BakedStreamTangent] = appendData(mesh.tangentData().data(), mesh.tangentData().size() * sizeof(vec4));
+
+        std::vector<std::byte> interleavedData = mesh.packVertexData(s_interleavedLayout);
+        record.streams[BakedStreamInterleaved] = appendData(interleavedData.data(), interleavedData.size());
+        record.vertexCount = static_cast<uint32_t>(interleavedData.size() / s_interleavedLayout.packedVertexSize());
+
+        if (mesh.isIndexed()) {
+            const std::vector<uint32_t>& indices = mesh.indexData();
+            record.indexCount = static_cast<uint32_t>(indices.size());
+
+            // Use 16-bit indices whenever they are enough, to halve the size of the index data
+            if (record.vertexCount <= std::numeric_limits<uint16_t>::max() + 1u) {
+                std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+                record.indexSize = sizeof(uint16_t);
+                record.indices = appendData(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+            } else {
+                record.indexSize = sizeof(uint32_t);
+                record.indices = appendData(indices.data(), indices.size() * sizeof(uint32_t));
+            }
+        }
+    });
+
+    if (!canBake) {
+        LogWarning("Can't bake model '%s' since it has embedded textures, will load from source every time.\n", sourcePath.c_str());
+        return false;
+    }
+
+    std::vector<BakedDependency> dependencies {};
+    for (const std::string& dependencyPath : dependencyPaths) {
+        // (a file that doesn't exist can't have changed since, so there is nothing to check for it later)
+        auto dependencyStamp = sourceFileStamp(dependencyPath);
+        if (!dependencyStamp.has_value())
+            continue;
+        BakedRange pathRange = appendData(dependencyPath.data(), dependencyPath.size());
+        dependencies.push_back({ pathRange, dependencyStamp->first, dependencyStamp->second });
+    }
+
+    BakedRange dependenciesRange = appendData(dependencies.data(), dependencies.size() * sizeof(BakedDependency));
+
+    BakedFileHeader header {};
+    header.magic = BakedFileHeader::expectedMagic;
+    header.version = BakedFileHeader::currentVersion;
+    header.meshCount = static_cast<uint32_t>(records.size());
+    header.sourceFileSize = sourceStamp->first;
+    header.sourceFileTimestamp = sourceStamp->second;
+    header.dependencies = dependenciesRange;
+
+    std::memcpy(fileData.data(), &header, sizeof(BakedFileHeader));
+    std::memcpy(fileData.data() + sizeof(BakedFileHeader), records.data(), records.size() * sizeof(BakedMeshRecord));
+
+    // Write to a temporary file which is then moved into place, so that a bake which is interrupted never leaves a partial file behind
+    std::string temporaryPath = bakedPath + ".tmp";
+    if (!FileIO::writeBinaryDataToFile(temporaryPath, fileData)) {
+        LogWarning("Could not write baked model file '%s'\n", temporaryPath.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, bakedPath, error);
+    if (error) {
+        LogWarning("Could not move baked model file into place at '%s': %s\n", bakedPath.c_str(), error.message().c_str());
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+BakedModel::BakedModel(std::unique_ptr<MappedFile> file)
+    : m_file(std::move(file))
+{
+    const BakedFileHeader* header = validatedHeader(*m_file);
+    ASSERT(header);
+
+    auto* records = reinterpret_cast<const BakedMeshRecord*>(m_file->data() + sizeof(BakedFileHeader));
+    for (uint32_t meshIdx = 0; meshIdx < header->meshCount; ++meshIdx) {
+        auto bakedMesh = std::make_unique<BakedMesh>(this, records[meshIdx], *m_file);
+        bakedMesh->setModel(this);
+        m_meshes.push_back(std::move(bakedMesh));
+    }
+}
+
+size_t BakedModel::meshCount() const
+{
+    return m_meshes.size();
+}
+
+void BakedModel::forEachMesh(std::function<void(Mesh&)> callback)
+{
+    for (auto& mesh : m_meshes) {
+        callback(*mesh);
+    }
+}
+
+void BakedModel::forEachMesh(std::function<void(const Mesh&)> callback) const
+{
+    for (auto& mesh : m_meshes) {
+        callback(*mesh);
+    }
+}
+
+static mat4 bakedLocalMatrix(const BakedMeshRecord& record)
+{
+    mat4 localMatrix;
+    std::memcpy(&localMatrix, record.localMatrix, sizeof(record.localMatrix));
+    return localMatrix;
+}
+
+BakedMesh::BakedMesh(const BakedModel* parent, const BakedMeshRecord& record, const MappedFile& file)
+    : Mesh(Transform(bakedLocalMatrix(record), &parent->transform()))
+    , m_record(record)
+    , m_file(file)
+{
+    vec3 aabbMin = { record.aabbMin[0], record.aabbMin[1], record.aabbMin[2] };
+    vec3 aabbMax = { record.aabbMax[0], record.aabbMax[1], record.aabbMax[2] };
+    m_aabb = moos::aabb3(aabbMin, aabbMax);
+
+    vec3 sphereCenter = { record.sphereCenter[0], record.sphereCenter[1], record.sphereCenter[2] };
+    m_boundingSphere = geometry::Sphere(sphereCenter, record.sphereRadius);
+}
+
+std::string BakedMesh::readString(uint64_t offset, uint64_t length) const
+{
+    std::span<const std::byte> bytes = m_file.range(offset, length);
+    return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+std::unique_ptr<Material> BakedMesh::createMaterial()
+{
+    auto material = std::make_unique<Material>();
+    material->setMesh(this);
+
+    const float* c = m_record.baseColorFactor;
+    material->baseColorFactor = vec4(c[0], c[1], c[2], c[3]);
+
+    material->baseColor = { readString(m_record.baseColor.offset, m_record.baseColor.size), nullptr };
+    material->normalMap = { readString(m_record.normalMap.offset, m_record.normalMap.size), nullptr };
+    material->metallicRoughness = { readString(m_record.metallicRoughness.offset, m_record.metallicRoughness.size), nullptr };
+    material->emissive = { readString(m_record.emissive.offset, m_record.emissive.size), nullptr };
+
+    return material;
+}
+
+template<typename T>
+static std::vector<T> readStream(const MappedFile& file, const BakedRange& range)
+{
+    std::span<const std::byte> bytes = file.range(range.offset, range.size);
+    std::vector<T> values(bytes.size() / sizeof(T));
+    std::memcpy(values.data(), bytes.data(), values.size() * sizeof(T));
+    return values;
+}
+
+const std::vector<vec3>& BakedMesh::positionData() const
+{
+    if (!m_positionData.has_value())
+        m_positionData = readStream<vec3>(m_file, m_record.streams[BakedStreamPosition]);
+    return m_positionData.value();
+}
+
+const std::vector<vec2>& BakedMesh::texcoordData() const
+{
+    if (!m_texcoordData.has_value())
+        m_texcoordData = readStream<vec2>(m_file, m_record.streams[BakedStreamTexCoord]);
+    return m_texcoordData.value();
+}
+
+const std::vector<vec3>& BakedMesh::normalData() const
+{
+    if (!m_normalData.has_value())
+        m_normalData = readStream<vec3>(m_file, m_record.streams[BakedStreamNormal]);
+    return m_normalData.value();
+}
+
+const std::vector<vec4>& BakedMesh::tangentData() const
+{
+    if (!m_tangentData.has_value())
+        m_tangentData = readStream<vec4>(m_file, m_record.streams[BakedStreamTangent]);
+    return m_tangentData.value();
+}
+
+const std::vector<uint32_t>& BakedMesh::indexData() const
+{
+    if (m_indexData.has_value())
+        return m_indexData.value();
+
+    ASSERT(isIndexed());
+    if (m_record.indexSize == sizeof(uint16_t)) {
+        std::vector<uint16_t> shortIndices = readStream<uint16_t>(m_file, m_record.indices);
+        m_indexData = std::vector<uint32_t>(shortIndices.begin(), shortIndices.end());
+    } else {
+        m_indexData = readStream<uint32_t>(m_file, m_record.indices);
+    }
+
+    return m_indexData.value();
+}
+
+IndexType BakedMesh::indexType() const
+{
+    return (m_record.indexSize == sizeof(uint16_t)) ? IndexType::UInt16 : IndexType::UInt32;
+}
+
+size_t BakedMesh::indexCount() const
+{
+    ASSERT(isIndexed());
+    return m_record.indexCount;
+}
+
+bool BakedMesh::isIndexed() const
+{
+    return m_record.indexSize != 0;
+}
+
+std::span<const std::byte> BakedMesh::packedVertexData(const SemanticVertexLayout& layout) const
+{
+    // NOTE: A position-only stream is the same as the packed data for the position-only layout
+    if (layout == s_positionOnlyLayout)
+        return m_file.range(m_record.streams[BakedStreamPosition].offset, m_record.streams[BakedStreamPosition].size);
+    if (layout == s_interleavedLayout)
+        return m_file.range(m_record.streams[BakedStreamInterleaved].offset, m_record.streams[BakedStreamInterleaved].size);
+
+    // Not baked, so let the mesh pack it itself
+    return {};
+}
+
+std::span<const std::byte> BakedMesh::packedIndexData() const
+{
+    if (!isIndexed())
+        return {};
+    return m_file.range(m_record.indices.offset, m_record.indices.size);
+}
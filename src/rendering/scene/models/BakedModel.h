@@ -0,0 +1,67 @@
+#pragma once
+
+#include "rendering/scene/Model.h"
+#include "utility/MappedFile.h"
+#include <memory>
+#include <string>
+
+struct BakedMeshRecord;
+class BakedModel;
+
+class BakedMesh : public Mesh {
+public:
+    BakedMesh(const BakedModel* parent, const BakedMeshRecord&, const MappedFile&);
+    ~BakedMesh() override = default;
+
+    const std::vector<vec3>& positionData() const override;
+    const std::vector<vec2>& texcoordData() const override;
+    const std::vector<vec3>& normalData() const override;
+    const std::vector<vec4>& tangentData() const override;
+
+    const std::vector<uint32_t>& indexData() const override;
+    IndexType indexType() const override;
+    size_t indexCount() const override;
+    bool isIndexed() const override;
+
+    std::span<const std::byte> packedVertexData(const SemanticVertexLayout&) const override;
+    std::span<const std::byte> packedIndexData() const override;
+
+    moos::aabb3 boundingBox() const override { return m_aabb; }
+    geometry::Sphere boundingSphere() const override { return m_boundingSphere; }
+
+protected:
+    std::unique_ptr<Material> createMaterial() override;
+
+private:
+    std::string readString(uint64_t offset, uint64_t length) const;
+
+    const BakedMeshRecord& m_record;
+    const MappedFile& m_file;
+
+    moos::aabb3 m_aabb;
+    geometry::Sphere m_boundingSphere;
+};
+
+//! A model loaded from a binary file of baked meshes, which have their vertex & index data laid out exactly like it should be
+//! uploaded to the GPU. The file is memory mapped, so loading is basically free and uploading needs no repacking.
+class BakedModel : public Model {
+public:
+    [[nodiscard]] static std::unique_ptr<Model> load(const std::string& bakedPath);
+
+    //! Load the baked version of the glTF model if it's up to date, otherwise load the glTF and try to bake it for next time
+    [[nodiscard]] static std::unique_ptr<Model> loadGltfUsingCache(const std::string& gltfPath);
+
+    //! The baked file is stale if the source file or any of the dependencies (other files that the source file references) change
+    static bool bake(Model& source, const std::string& sourcePath, const std::string& bakedPath, const std::vector<std::string>& dependencyPaths = {});
+
+    explicit BakedModel(std::unique_ptr<MappedFile>);
+    ~BakedModel() override = default;
+
+    size_t meshCount() const override;
+    void forEachMesh(std::function<void(Mesh&)>) override;
+    void forEachMesh(std::function<void(const Mesh&)>) const override;
+
+private:
+    std::unique_ptr<MappedFile> m_file {};
+    std::vector<std::unique_ptr<BakedMesh>> m_meshes {};
+};
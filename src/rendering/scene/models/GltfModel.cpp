@@ -3,6 +3,7 @@
 #include "utility/FileIO.h"
 #include "utility/Image.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
 #include <moos/transform.h>
 #include <string>
 #include <unordered_map>
@@ -11,6 +12,8 @@ static std::unordered_map<std::string, tinygltf::Model> s_loadedModels {};
 
 std::unique_ptr<Model> GltfModel::load(const std::string& path)
 {
+    SCOPED_PROFILE_ZONE("Load glTF model");
+
     if (!FileIO::isFileReadable(path)) {
         LogError("Could not find glTF model file at path '%s'\n", path.c_str());
         return nullptr;
@@ -148,6 +151,24 @@ std::string GltfModel::directory() const
     return dir;
 }
 
+std::vector<std::string> GltfModel::externalFilePaths() const
+{
+    std::vector<std::string> paths {};
+
+    // (data URIs are embedded, and so are the buffers of binary glTF files, which have no URI at all)
+    auto addUri = [&](const std::string& uri) {
+        if (!uri.empty() && !uri.starts_with("data:"))
+            paths.push_back(directory() + uri);
+    };
+
+    for (const tinygltf::Buffer& buffer : m_model->buffers)
+        addUri(buffer.uri);
+    for (const tinygltf::Image& image : m_model->images)
+        addUri(image.uri);
+
+    return paths;
+}
+
 GltfMesh::GltfMesh(std::string name, const GltfModel* parent, const tinygltf::Model& model, const tinygltf::Primitive& primitive, mat4 matrix)
     : Mesh(Transform(matrix, &parent->transform()))
     , m_name(std::move(name))
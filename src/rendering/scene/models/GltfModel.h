@@ -54,6 +54,9 @@ public:
 
     [[nodiscard]] std::string directory() const;
 
+    //! Other files that the glTF file references, i.e. external buffers & images (but not any embedded ones)
+    [[nodiscard]] std::vector<std::string> externalFilePaths() const;
+
 private:
     std::string m_path {};
     const tinygltf::Model* m_model {};
@@ -1,6 +1,8 @@
 #include "FileIO.h"
 
+#include <filesystem>
 #include <fstream>
+#include <random>
 
 std::optional<FileIO::BinaryData> FileIO::readEntireFileAsByteBuffer(const std::string& filePath)
 {
@@ -40,6 +42,38 @@ std::optional<std::string> FileIO::readEntireFile(const std::string& filePath)
     return contents;
 }
 
+bool FileIO::writeBinaryDataToFile(const std::string& filePath, const BinaryData& binaryData)
+{
+    std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open())
+        return false;
+
+    file.write(binaryData.data(), binaryData.size());
+    bool isGood = file.good();
+
+    file.close();
+    return isGood;
+}
+
+bool FileIO::writeBinaryDataToFileAtomically(const std::string& filePath, const BinaryData& binaryData)
+{
+    std::string temporaryPath = filePath + "." + std::to_string(std::random_device()()) + ".tmp";
+    std::error_code error;
+    if (!writeBinaryDataToFile(temporaryPath, binaryData)) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporaryPath, filePath, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
 bool FileIO::isFileReadable(const std::string& filePath)
 {
     std::ifstream file(filePath);
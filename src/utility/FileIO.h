@@ -11,6 +11,12 @@ std::optional<BinaryData> readEntireFileAsByteBuffer(const std::string& filePath
 
 std::optional<std::string> readEntireFile(const std::string& filePath);
 
+bool writeBinaryDataToFile(const std::string& filePath, const BinaryData&);
+
+//! Writes to a uniquely named temporary file next to the target which is then renamed into place, so that readers never see a partially
+//! written file, e.g. if the process crashes mid-write or several processes write the same file at once (the last rename wins).
+bool writeBinaryDataToFileAtomically(const std::string& filePath, const BinaryData&);
+
 bool isFileReadable(const std::string& filePath);
 
 }
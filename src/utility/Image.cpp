@@ -2,6 +2,8 @@
 
 #include "utility/FileIO.h"
 #include "utility/Logging.h"
+#include "utility/Profiling.h"
+#include "utility/util.h"
 #include <memory>
 #include <moos/core.h>
 #include <stb_image.h>
@@ -52,14 +54,28 @@ Image* Image::load(const std::string& imagePath, PixelType pixelType)
         return image;
     }
 
-    // TODO: Consider putting like a nullptr Image::Info in the cache in this case?
-    if (!FileIO::isFileReadable(imagePath))
+    std::unique_ptr<Image> image = decode(imagePath, pixelType);
+    if (!image)
         LogErrorAndExit("Image: could not read file at path '%s'.\n", imagePath.c_str());
 
+    s_imageCache[imagePath] = std::move(image);
+    return s_imageCache[imagePath].get();
+}
+
+std::unique_ptr<Image> Image::decode(const std::string& imagePath, PixelType pixelType)
+{
+    SCOPED_PROFILE_ZONE("Decode image");
+
+    if (!FileIO::isFileReadable(imagePath))
+        return nullptr;
+
     //LogInfo("Image: actually loading texture '%s'\n", imagePath.c_str());
 
     FILE* file = fopen(imagePath.c_str(), "rb");
     ASSERT(file);
+    AT_SCOPE_EXIT([&]() {
+        fclose(file);
+    });
 
     int desiredNumberOfComponents = static_cast<int>(pixelType);
     ASSERT(desiredNumberOfComponents >= 1 && desiredNumberOfComponents <= 4);
@@ -76,14 +92,14 @@ Image* Image::load(const std::string& imagePath, PixelType pixelType)
         size = info.width * info.height * desiredNumberOfComponents * sizeof(float);
     } else {
         info.componentType = ComponentType::UInt8;
-        data = stbi_load(imagePath.c_str(), &info.width, &info.height, nullptr, desiredNumberOfComponents);
+        data = stbi_load_from_file(file, &info.width, &info.height, nullptr, desiredNumberOfComponents);
         size = info.width * info.height * desiredNumberOfComponents * sizeof(stbi_uc);
     }
 
-    auto image = std::make_unique<Image>(DataOwner::StbImage, info, data, size);
-    s_imageCache[imagePath] = std::move(image);
+    if (!data)
+        return nullptr;
 
-    return s_imageCache[imagePath].get();
+    return std::make_unique<Image>(DataOwner::StbImage, info, data, size);
 }
 
 Image::Image(DataOwner owner, Info info, void* data, size_t size)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 class Image {
@@ -34,6 +35,9 @@ public:
     static Info* getInfo(const std::string& imagePath);
     static Image* load(const std::string& imagePath, PixelType);
 
+    //! Decode the image file without going through the image cache, so it's safe to call from any thread
+    static std::unique_ptr<Image> decode(const std::string& imagePath, PixelType);
+
     const Info& info() const { return m_info; }
 
     const void* data() const { return m_data; }
@@ -0,0 +1,50 @@
+#include "MappedFile.h"
+
+#include "utility/util.h"
+
+// TODO: Implement Windows support!
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& filePath)
+{
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat statResult = {};
+    if (fstat(fd, &statResult) != 0 || statResult.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = statResult.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // NOTE: The mapping stays valid after closing the file descriptor
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const std::byte*>(mapping), size));
+}
+
+MappedFile::MappedFile(const std::byte* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<std::byte*>(m_data), m_size);
+}
+
+std::span<const std::byte> MappedFile::range(size_t offset, size_t size) const
+{
+    ASSERT(offset + size <= m_size);
+    return { m_data + offset, size };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+//! A read-only memory mapping of an entire file, which stays valid for the lifetime of the object
+class MappedFile {
+public:
+    static std::unique_ptr<MappedFile> open(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&) = delete;
+
+    [[nodiscard]] const std::byte* data() const { return m_data; }
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    [[nodiscard]] std::span<const std::byte> range(size_t offset, size_t size) const;
+
+private:
+    MappedFile(const std::byte* data, size_t size);
+
+    const std::byte* m_data { nullptr };
+    size_t m_size { 0 };
+};
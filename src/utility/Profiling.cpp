@@ -0,0 +1,149 @@
+#include "Profiling.h"
+
+#include "utility/Logging.h"
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+
+Profiler& Profiler::instance()
+{
+    static Profiler instance {};
+    return instance;
+}
+
+Profiler::Profiler()
+    : m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    // NOTE: Points into m_threadBuffers, which never removes any buffers, so it stays valid for the lifetime of the thread
+    thread_local ThreadBuffer* buffer = nullptr;
+
+    if (buffer == nullptr) {
+        auto newBuffer = std::make_unique<ThreadBuffer>();
+        newBuffer->zones = std::make_unique<Zone[]>(zonesPerThread);
+
+        std::scoped_lock<std::mutex> lock(m_threadBuffersMutex);
+        newBuffer->threadId = uint32_t(m_threadBuffers.size());
+        newBuffer->threadName = fmt::format("Thread {}", newBuffer->threadId);
+        buffer = m_threadBuffers.emplace_back(std::move(newBuffer)).get();
+    }
+
+    return *buffer;
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::scoped_lock<std::mutex> lock(m_threadBuffersMutex);
+    buffer.threadName = name;
+}
+
+const char* Profiler::persistentName(const std::string& name)
+{
+    // (the set is node based, so pointers to its strings stay valid when it grows)
+    std::scoped_lock<std::mutex> lock(m_persistentNamesMutex);
+    return m_persistentNames.insert(name).first->c_str();
+}
+
+uint64_t Profiler::now() const
+{
+    auto elapsed = std::chrono::steady_clock::now() - m_epoch;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Profiler::recordZone(const char* name, uint64_t startTime, uint64_t endTime)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    // Only this thread ever writes the count, so it doesn't need any stronger ordering to read it
+    uint64_t zoneIndex = buffer.writtenZoneCount.load(std::memory_order_relaxed);
+    buffer.zones[zoneIndex % zonesPerThread] = { name, startTime, endTime };
+
+    // Publish the zone to any dumping thread
+    buffer.writtenZoneCount.store(zoneIndex + 1, std::memory_order_release);
+}
+
+static std::string escapeJsonString(const char* string)
+{
+    std::string escaped {};
+    for (const char* c = string; *c != '\0'; ++c) {
+        switch (*c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        default:
+            // (control characters are not allowed in JSON strings, and shouldn't be in zone names anyway)
+            if (static_cast<unsigned char>(*c) >= 0x20)
+                escaped += *c;
+            break;
+        }
+    }
+    return escaped;
+}
+
+bool Profiler::writeChromeTrace(const std::string& filePath)
+{
+    std::ofstream file { filePath };
+    if (!file.is_open()) {
+        LogError("Profiler: could not open trace file '%s' for writing\n", filePath.c_str());
+        return false;
+    }
+
+    std::vector<Zone> zones {};
+    zones.reserve(zonesPerThread);
+
+    size_t totalZoneCount = 0;
+    bool isFirstEvent = true;
+
+    auto writeEvent = [&](const std::string& event) {
+        file << (isFirstEvent ? "\n" : ",\n") << event;
+        isFirstEvent = false;
+    };
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    // NOTE: New threads can't register while we hold the lock, but all existing threads keep recording into their buffers meanwhile
+    std::scoped_lock<std::mutex> lock(m_threadBuffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : m_threadBuffers) {
+
+        writeEvent(fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                               buffer->threadId, escapeJsonString(buffer->threadName.c_str())));
+
+        // Copy the zones, and then discard any that the owning thread might have overwritten while we were copying them. This is like the
+        // read side of a seqlock, where the write count is the sequence number and the zones that are overwritten are the oldest ones.
+        uint64_t endIndex = buffer->writtenZoneCount.load(std::memory_order_acquire);
+        uint64_t beginIndex = (endIndex > zonesPerThread) ? endIndex - zonesPerThread : 0;
+
+        zones.clear();
+        for (uint64_t index = beginIndex; index < endIndex; ++index)
+            zones.push_back(buffer->zones[index % zonesPerThread]);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t writtenCountAfterCopy = buffer->writtenZoneCount.load(std::memory_order_relaxed);
+
+        // (+1 since the thread could be in the middle of writing the zone after the last one it published)
+        uint64_t firstIntactIndex = (writtenCountAfterCopy + 1 > zonesPerThread) ? writtenCountAfterCopy + 1 - zonesPerThread : 0;
+        size_t overwrittenZoneCount = size_t(std::clamp(firstIntactIndex, beginIndex, endIndex) - beginIndex);
+
+        for (size_t i = overwrittenZoneCount; i < zones.size(); ++i) {
+            const Zone& zone = zones[i];
+            // (Chrome trace timestamps are in microseconds)
+            writeEvent(fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                   escapeJsonString(zone.name), buffer->threadId,
+                                   double(zone.startTime) / 1000.0, double(zone.endTime - zone.startTime) / 1000.0));
+        }
+
+        totalZoneCount += zones.size() - overwrittenZoneCount;
+    }
+
+    file << "\n]}\n";
+
+    LogInfo("Profiler: wrote %zu zones from %zu threads to '%s'\n", totalZoneCount, m_threadBuffers.size(), filePath.c_str());
+    return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+//! Records scoped CPU zones into one ring buffer per thread, and writes them out as Chrome trace events on demand, for viewing in
+//! chrome://tracing or Perfetto. Recording a zone is lock-free and only touches the recording thread's own buffer, so it's cheap enough to
+//! always be on. When a buffer wraps around the oldest zones of that thread are overwritten, so a dump covers the last few seconds or so.
+class Profiler {
+public:
+    static Profiler& instance();
+
+    Profiler(Profiler&) = delete;
+    Profiler& operator=(Profiler&) = delete;
+
+    //! Name the calling thread in the trace
+    void setThreadName(const std::string&);
+
+    //! Zone names are not copied when recorded, so they must outlive any later dump. This returns an interned copy of the name that
+    //! lives as long as the profiler, for names that don't, e.g. render graph node names. (It takes a lock, so prefer string literals.)
+    const char* persistentName(const std::string&);
+
+    void recordZone(const char* name, uint64_t startTime, uint64_t endTime);
+
+    //! Nanoseconds since the profiler was created
+    uint64_t now() const;
+
+    //! Write the zones currently in the buffers of all threads as a Chrome trace JSON file. Can be called from any thread, while recording.
+    bool writeChromeTrace(const std::string& filePath);
+
+private:
+    Profiler();
+    ~Profiler() = default;
+
+    struct Zone {
+        const char* name;
+        uint64_t startTime;
+        uint64_t endTime;
+    };
+
+    // Per thread, should be a power of two
+    static constexpr uint64_t zonesPerThread { 1 << 16 };
+
+    struct ThreadBuffer {
+        uint32_t threadId;
+        std::string threadName {};
+        //! Only ever written by the owning thread. The zone at index i is stored at zones[i % zonesPerThread].
+        std::unique_ptr<Zone[]> zones {};
+        std::atomic<uint64_t> writtenZoneCount { 0 };
+    };
+
+    ThreadBuffer& threadBuffer();
+
+    std::chrono::steady_clock::time_point m_epoch {};
+
+    //! Buffers of threads that have exited are kept, so that their zones can still be dumped
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers {};
+    std::mutex m_threadBuffersMutex {};
+
+    std::unordered_set<std::string> m_persistentNames {};
+    std::mutex m_persistentNamesMutex {};
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : m_name(name)
+        , m_startTime(Profiler::instance().now())
+    {
+    }
+
+    ~ProfileZone()
+    {
+        Profiler& profiler = Profiler::instance();
+        profiler.recordZone(m_name, m_startTime, profiler.now());
+    }
+
+    ProfileZone(ProfileZone&) = delete;
+    ProfileZone& operator=(ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_startTime;
+};
+
+#if defined(ARKOSE_PROFILING)
+#define PROFILE_ZONE_CONCAT_IMPL(x, y) x##y
+#define PROFILE_ZONE_CONCAT(x, y) PROFILE_ZONE_CONCAT_IMPL(x, y)
+//! Profile the rest of the current scope as a zone with the given name (see Profiler::persistentName for names that aren't string literals)
+#define SCOPED_PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZoneAtLine, __LINE__) { name }
+#define SET_PROFILER_THREAD_NAME(name) Profiler::instance().setThreadName(name)
+#else
+#define SCOPED_PROFILE_ZONE(name)
+#define SET_PROFILER_THREAD_NAME(name)
+#endif
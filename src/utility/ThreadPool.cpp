@@ -0,0 +1,116 @@
+#include "ThreadPool.h"
+
+#include "utility/Profiling.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+    }
+    m_queueCondition.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool globalPool { std::thread::hardware_concurrency() };
+    return globalPool;
+}
+
+ThreadPool& ThreadPool::commandRecording()
+{
+    static ThreadPool commandRecordingPool { std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+    return commandRecordingPool;
+}
+
+std::future<void> ThreadPool::enqueue(std::function<void()> task)
+{
+    std::packaged_task<void()> packagedTask { std::move(task) };
+    std::future<void> future = packagedTask.get_future();
+
+    {
+        std::scoped_lock<std::mutex> lock(m_queueMutex);
+        m_tasks.push(std::move(packagedTask));
+    }
+    m_queueCondition.notify_one();
+
+    return future;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index)>& function)
+{
+    if (count <= 1) {
+        if (count == 1)
+            function(0);
+        return;
+    }
+
+    // Indices are claimed by whichever thread gets to them first, including this one. Worker tasks might not start until after we're
+    // done (if the queue is busy), so the shared state must outlive this call, and a late worker simply finds no indices left to run.
+    struct ParallelForState {
+        std::atomic<size_t> nextIndex { 0 };
+        size_t finishedCount { 0 };
+        std::mutex finishedMutex {};
+        std::condition_variable finishedCondition {};
+    };
+    auto state = std::make_shared<ParallelForState>();
+
+    auto runIndices = [state, count, &function]() {
+        size_t runCount = 0;
+        for (size_t index = state->nextIndex++; index < count; index = state->nextIndex++) {
+            function(index);
+            runCount += 1;
+        }
+
+        if (runCount > 0) {
+            std::scoped_lock<std::mutex> lock(state->finishedMutex);
+            state->finishedCount += runCount;
+            if (state->finishedCount == count)
+                state->finishedCondition.notify_all();
+        }
+    };
+
+    size_t workerTaskCount = std::min(count - 1, m_threads.size());
+    for (size_t i = 0; i < workerTaskCount; ++i)
+        enqueue(runIndices);
+
+    runIndices();
+
+    std::unique_lock<std::mutex> lock(state->finishedMutex);
+    state->finishedCondition.wait(lock, [&]() { return state->finishedCount == count; });
+}
+
+void ThreadPool::workerLoop()
+{
+    SET_PROFILER_THREAD_NAME("Thread pool worker");
+
+    while (true) {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        task();
+    }
+}
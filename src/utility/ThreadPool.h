@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&) = delete;
+
+    //! A pool with one thread per hardware thread, shared by everything that wants to go wide
+    static ThreadPool& global();
+
+    //! A pool only for recording command buffers in parallel, so that frame recording never queues up behind background work on the global
+    //! pool (e.g. texture decoding or shader compilation). It has one thread less than the hardware, since the recording thread helps out.
+    static ThreadPool& commandRecording();
+
+    [[nodiscard]] uint32_t threadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+    std::future<void> enqueue(std::function<void()> task);
+
+    //! Calls the function once for each index in [0, count), spread over the worker threads, and waits for all of them to finish. The
+    //! calling thread also runs indices itself while waiting, so it never sits idle behind tasks that were enqueued before these.
+    void parallelFor(size_t count, const std::function<void(size_t index)>&);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_threads {};
+
+    std::mutex m_queueMutex {};
+    std::condition_variable m_queueCondition {};
+    std::queue<std::packaged_task<void()>> m_tasks {};
+    bool m_stopping { false };
+};